@@ -71,6 +71,7 @@
 
 #include "utils.h"
 #include "scsi_cmds.h"
+#include "scsi_output.h"
 
 /* Enable Debugging for the tool */
 #define debug		0
@@ -85,14 +86,23 @@
 
 #define SYSFS_FC_HOST_PATH	"/sys/class/fc_host"
 #define SYSFS_FC_RPRT_PATH	"/sys/class/fc_remote_ports"
+#define SYSFS_FC_VPORT_PATH	"/sys/class/fc_vports"
 #define SYSFS_ISCSI_HOST_PATH	"/sys/class/iscsi_host"
 #define SYSFS_ISCSI_SESS_PATH	"/sys/class/iscsi_session"
 #define SYSFS_ISCSI_CONN_PATH	"/sys/class/iscsi_connection"
+#define SYSFS_ISCSI_TRANSPORT_PATH	"/sys/class/iscsi_transport"
 #define SYSFS_BLOCK_PATH	"/sys/block"
 #define SYSFS_SCSI_DEV_PATH	"/sys/class/scsi_device"
 #define SYSFS_SCSI_GEN_PATH	"/sys/class/scsi_generic"
 #define SYSFS_SCSI_HOST_PATH	"/sys/class/scsi_host"
 #define SYSFS_SCSI_DISK_PATH	"/sys/class/scsi_disk"
+#define SYSFS_NET_PATH		"/sys/class/net"
+#define SYSFS_NODE_PATH		"/sys/devices/system/node"
+#define SYSFS_CPU_PATH		"/sys/devices/system/cpu"
+#define SYSFS_NVME_PATH		"/sys/class/nvme"
+#define SYSFS_NVME_SUBSYS_PATH	"/sys/class/nvme-subsystem"
+#define PROC_IRQ_PATH		"/proc/irq"
+#define PROC_INTERRUPTS_PATH	"/proc/interrupts"
 
 #define PCI_BUS_PATH		"/sys/bys/pci"
 #define RESCAN_PCI_PATH		"/sys/bus/pci/rescan"
@@ -165,6 +175,211 @@ struct disk_stats {
 	uint64_t	io_ticks;
 	uint64_t	time_in_queue;
 	uint64_t	msec;
+	uint64_t	in_flight;
+};
+
+/*  Per interval figures derived from two disk_stats samples */
+struct disk_rates {
+	double	ios[2];		/* requests per second */
+	double	mb[2];		/* MB per second */
+	double	merges[2];	/* merged requests per second */
+	double	await[2];	/* average ms per request */
+	double	req_kb[2];	/* average request size in KB */
+	double	queue_size;	/* average number of requests in flight */
+	double	util;		/* percentage of time the device was busy */
+};
+
+/* One host rescan, run on a pooled thread */
+struct scan_job {
+	char	host_name[16];
+	int	host_no;
+	char	chtl[48];	/* "C T L" written to scsi_host/hostN/scan */
+	int	lip;		/* issue a LIP first */
+	int	err;
+	u64	ms;		/* time until the scan write returned */
+	char	*result;
+};
+
+/* A SCSI device which showed up or went away during a rescan */
+struct scan_change {
+	char	change[8];	/* added, removed */
+	int	host;		/* host, channel, target, lun */
+	int	channel;
+	int	target;
+	int	lun;
+	char	*state;
+	char	*disk_name;
+};
+
+/* One sysfs attribute changed by 'tune', with its value before and after */
+struct tune_attr {
+	char	dev[32];	/* rport-H:B-N, sdX, sessionN, nvmeN */
+	char	attr[20];	/* dev_loss_tmo, timeout, ... */
+	char	path[128];
+	char	old[24];
+	char	val[24];
+	int	state;		/* enum tune_state */
+	int	err;
+	int	rewrite;	/* written even if equal, after an earlier change */
+	char	result[48];
+};
+
+/* One blk-mq hardware queue of a disk, from /sys/block/X/mq/N */
+struct mq_queue_info {
+	char	disk_name[32];
+	int	hctx;
+	int	nr_tags;
+	int	nr_reserved_tags;
+	int	nr_cpus;	/* online CPUs submitting to the queue */
+	char	nodes[16];
+	char	cpu_list[128];
+};
+
+/* How the online CPUs are spread over the hardware queues of a disk */
+struct mq_map_info {
+	char	disk_name[32];
+	int	nr_hw_queues;
+	int	nr_cpus;	/* online CPUs of the host */
+	int	nr_maps;	/* most queues one CPU is in, >1 with poll queues */
+	char	cpus_per_queue[24];
+	int	idle_queues;	/* queues without an online CPU */
+	int	cross_node;	/* queues with CPUs of several NUMA nodes */
+	char	unmapped[32];	/* online CPUs in no queue */
+	int	nr_tags;	/* smallest queue depth of a queue */
+	int	nr_requests;
+	int	rq_affinity;
+	char	status[48];
+};
+
+/* Interrupt placement of the PCI function of SCSI hosts or NVMe controllers */
+struct irq_audit_info {
+	char	device[24];	/* hostN or nvmeN, several when they share it */
+	char	driver[16];
+	char	pci[16];
+	int	numa_node;
+	int	nr_irqs;
+	int	active_irqs;	/* vectors which fired */
+	int	remote_irqs;	/* vectors served only by other nodes */
+	char	irq_cpus[32];
+	char	irq_nodes[16];
+	u64	interrupts;
+	int	remote_pct;	/* share of the interrupts taken off node */
+	char	status[48];
+};
+
+/* One interrupt vector of a PCI function, for audit irq --vectors */
+struct irq_vector_info {
+	char	device[24];
+	int	irq;
+	char	affinity[32];	/* CPUs allowed */
+	char	effective[32];	/* CPUs really interrupted */
+	char	nodes[16];
+	u64	interrupts;
+	int	remote_pct;
+	char	placement[12];	/* local, remote, split, - */
+};
+
+/* Negotiated against the best possible link of a PCI function or FC port */
+struct link_audit_info {
+	char	device[24];
+	char	type[8];	/* pcie, fc */
+	char	driver[16];
+	char	address[24];	/* PCI function or WWPN */
+	char	speed[16];
+	char	max_speed[16];
+	char	width[8];	/* x4, - for FC */
+	char	max_width[8];
+	char	status[48];
+};
+
+/* One queue setting of a disk which differs from the advised value */
+struct advice_info {
+	char	name[32];
+	char	class[12];	/* hdd, ssd, nvme, array, mpath-leg, mpath */
+	char	workload[12];	/* idle, sequential, random, mixed */
+	char	setting[16];
+	char	current[24];
+	char	advised[24];
+	char	rationale[96];
+};
+
+/* An NVMe subsystem, from /sys/class/nvme-subsystem/nvme-subsysN */
+struct nvme_subsys_info {
+	int	instance;
+	char	name[24];
+	char	nqn[224];
+	char	model[48];
+	char	iopolicy[16];	/* numa, round-robin, queue-depth */
+	int	nr_ctrls;
+	int	nr_ns;
+	int	nr_paths;
+	int	nr_optimized;
+	char	status[48];
+};
+
+/* A controller of a subsystem, from /sys/class/nvme/nvmeN */
+struct nvme_ctrl_info {
+	int	subsys;		/* instance of the subsystem */
+	int	instance;
+	char	name[16];
+	char	transport[8];	/* pcie, tcp, rdma, fc, loop */
+	char	address[96];
+	char	state[16];
+	int	queue_count;
+	int	sqsize;
+	int	kato;
+	int	nr_paths;
+	int	nr_optimized;
+};
+
+/* A namespace of a subsystem, the nvmeXnY head with multipath */
+struct nvme_ns_info {
+	int	subsys;
+	int	instance;
+	char	name[16];
+	int	nsid;
+	int	nr_paths;
+	int	nr_live;	/* paths of a live controller, ANA accessible */
+	int	nr_optimized;
+	char	status[24];
+};
+
+/* One path of a namespace through a controller, the hidden nvmeXcYnZ */
+struct nvme_path_info {
+	int	subsys;
+	int	ns;		/* instance of the namespace */
+	int	ctrl;		/* instance of the controller */
+	char	ns_name[16];
+	int	nsid;
+	char	name[24];
+	char	ctrl_name[16];
+	char	ctrl_state[16];
+	char	ana_state[20];	/* optimized, non-optimized, inaccessible ... */
+	int	ana_grpid;
+};
+
+/*
+ * Samples every block device of the host from /proc/diskstats. Each
+ * device keeps two samples which are used in turns, so that rates are
+ * computed without copying.
+ */
+struct disk_sample {
+	char			name[32];
+	dev_t			dev;
+	int			valid[2];	/* found in the read of a slot */
+	struct disk_stats	ds[2];
+};
+
+struct disk_sampler {
+	struct disk_sample	*disks;
+	int			nr_disks;
+
+	u32			*index;		/* disk index + 1, by dev_t */
+	u32			mask;
+
+	int			fd;		/* /proc/diskstats */
+	char			*buf;
+	size_t			buf_size;
 };
 
 struct disk_queue_data {
@@ -354,9 +569,13 @@ enum nvme_driver_module {
 struct fc_device_info *alloc_fc_dev(void);
 struct scsi_device_info *alloc_scsi_dev(void);
 struct iscsi_dev_info *alloc_iscsi_dev(void);
+void clear_scsi_dev(struct scsi_device_info *);
 void put_scsi_dev(struct scsi_device_info *);
 void put_fc_dev(struct fc_device_info *);
 void put_iscsi_dev(struct iscsi_dev_info *);
+void parallel_for_each(void *, int, size_t, void (*)(void *), int);
+int dev_name_cmp(const char *, const char *);
+void raise_nofile_limit(unsigned long);
 
 /* Various functions to display command handling help */
 void usage(void);
@@ -364,7 +583,7 @@ int validate_usage(void);
 void version_cmd();
 void general_help();
 int help_cmd(int, char **);
-void handle_cmd_errors(char **, struct scsi_device_list *);
+int handle_cmd_errors(char **, struct scsi_device_list *);
 
 /* functions for command validation */
 void list_builtins();
@@ -376,7 +595,11 @@ int validate_sysfs_path(char *);
 int remove_space(char *);
 int remove_newline(char *);
 int remove_int(char *);
+int load_sysfs_path(char *, char *, int);
 char *open_sysfs_stats_file(char *);
+int sysfs_read_at(int, const char *, char *, int);
+int sysfs_read_str_at(int, const char *, char *, int);
+int sysfs_write_at(int, const char *, const char *);
 
 /* Functions to display various list options  */
 int list_enclosure(struct scsi_device_info *);
@@ -392,6 +615,34 @@ int validate_enclosure_type(struct scsi_device_info *);
 int show_enclosure_details(char **, struct scsi_device_list *);
 int show_disk_details(char **, struct scsi_device_list *);
 int get_disk_stats(struct scsi_device_info *, char *);
+u64 parse_u64(const char **);
+int parse_disk_stats(const char *, struct disk_stats *);
+void calc_disk_rates(struct disk_stats *, struct disk_stats *, u64,
+    struct disk_rates *);
+int interval_timer_start(unsigned int);
+u64 now_ms(void);
+void sleep_ms(unsigned int);
+int interval_timer_wait(int);
+int watch_disk_stats(char *, unsigned int, unsigned int);
+struct disk_sampler *disk_sampler_open(void);
+int disk_sampler_read(struct disk_sampler *, int);
+void disk_sampler_close(struct disk_sampler *);
+int watch_all_disk_stats(unsigned int, unsigned int);
+int show_top_disks(void);
+int scan_run(struct scan_job *, int, int);
+int scan_jobs_opt(int);
+int scan_scsi_hosts(int, char **);
+int tune_fc(void);
+int tune_disk(void);
+int tune_iscsi(void);
+int tune_nvme(void);
+int tune_rollback(char *);
+int list_mq(void);
+int show_disk_mq(char *);
+int audit_irq(void);
+int audit_links(void);
+int list_nvme_subsys(void);
+int advise_disk(char *);
 int get_disk_vendor_model(struct scsi_device_info *);
 int get_disk_type(struct scsi_device_info *d_info);
 int get_disk_queue_data(struct scsi_device_info *);
@@ -404,7 +655,6 @@ char *get_device_entry(char *);
 char *dev_type_to_dev_name(int);
 int get_enclosure_details(struct scsi_device_info *);
 int get_disk_error_count(char **, struct scsi_device_info *);
-int scsi_scan_disk_dev(char **, struct scsi_device_info *);
 int set_disk_offline(char **, struct scsi_device_info *);
 int set_disk_online(char **, struct scsi_device_info *);
 int set_disk_alias(char **, struct scsi_device_info *);
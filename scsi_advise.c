@@ -0,0 +1,550 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdarg.h>
+
+#include "scsi.h"
+#include "scsi_print.h"
+
+/*
+ * Block queue advisor
+ *
+ * Each disk is first put in a class from sysfs alone: a path of a
+ * dm-multipath device, a LUN of a known storage array, an NVMe
+ * namespace, a rotational disk or an SSD. The class sets the scheduler
+ * and rq_affinity. The /proc/diskstats counters, since boot or over
+ * --interval, then tell how the disk is used: the average request size
+ * and the share of merged requests drive read_ahead_kb and
+ * max_sectors_kb, the requests in flight while busy drive nr_requests.
+ * Only settings which differ from the advice are listed.
+ */
+
+#define ADVISE_MIN_IOS		1000	/* fewer requests tell nothing */
+#define ADVISE_SEQ_KB		128	/* average read of sequential reads */
+#define ADVISE_SEQ_MERGE_PCT	40
+#define ADVISE_RANDOM_KB	16
+#define ADVISE_RANDOM_MERGE_PCT	10
+#define ADVISE_RA_SEQ_KB	1024
+#define ADVISE_RA_RANDOM_KB	128
+#define ADVISE_MAX_SECTORS_KB	4096
+#define ADVISE_MAX_REQUESTS	1024
+#define ADVISE_MAX		5	/* settings advised per disk */
+
+enum advise_class {
+	ADV_NONE,	/* not advised: loop, md, bio based dm, ... */
+	ADV_HDD,
+	ADV_SSD,
+	ADV_NVME,
+	ADV_ARRAY,
+	ADV_MPATH_LEG,
+	ADV_MPATH,
+};
+
+struct advise_rule {
+	const char	*name;
+	const char	*sched;
+	const char	*sched_why;
+	int		rq_affinity;	/* 0 leaves it alone */
+	const char	*rq_why;
+};
+
+static const struct advise_rule advise_rules[] = {
+	[ADV_HDD] = { "hdd", "mq-deadline",
+	    "seeks are costly, sorted and merged requests save them", 0, NULL },
+	[ADV_SSD] = { "ssd", "none",
+	    "no seek cost, a scheduler only adds latency",
+	    2, "complete on the submitting CPU, few HBA queues serve it" },
+	[ADV_NVME] = { "nvme", "none",
+	    "per-CPU queues, a scheduler only adds latency", 0, NULL },
+	[ADV_ARRAY] = { "array", "none",
+	    "the array caches and reorders requests itself",
+	    2, "complete on the submitting CPU, LUNs share few HBA queues" },
+	[ADV_MPATH_LEG] = { "mpath-leg", "none",
+	    "requests are scheduled on the multipath device",
+	    2, "complete on the submitting CPU, LUNs share few HBA queues" },
+	[ADV_MPATH] = { "mpath", "none",
+	    "the array behind the paths reorders requests itself", 0, NULL },
+};
+
+/* LUNs of these are array volumes, 'model' NULL matches any model */
+static const struct {
+	const char	*vendor;
+	const char	*model;
+} advise_arrays[] = {
+	{ "3PARdata", NULL },	{ "COMPELNT", NULL },	{ "DataCore", NULL },
+	{ "DELL", "MD3" },	{ "DGC", NULL },	{ "EMC", NULL },
+	{ "EQLOGIC", NULL },	{ "FUJITSU", "ETERNUS" }, { "HITACHI", NULL },
+	{ "HP", "HSV" },	{ "HP", "MSA" },	{ "HP", "OPEN-" },
+	{ "HPE", "MSA" },	{ "HUAWEI", "XSG" },	{ "IBM", "2145" },
+	{ "IBM", "2107" },	{ "IBM", "2810" },	{ "IBM", "FlashSystem" },
+	{ "INFINIDAT", NULL },	{ "KMNRIO", NULL },	{ "LIO-ORG", NULL },
+	{ "NETAPP", NULL },	{ "NEXSAN", NULL },	{ "Nimble", NULL },
+	{ "PURE", NULL },
+};
+
+struct advise_disk {
+	struct disk_sample	*s;
+	int			class;
+	int			rotational;
+	int			nr_requests;
+	int			read_ahead_kb;
+	int			rq_affinity;
+	int			max_sectors_kb;
+	int			max_hw_sectors_kb;
+	char			sched[128];	/* [mq-deadline] kyber bfq none */
+	char			vendor[16];
+	char			model[40];
+};
+
+static int advise_block_fd = -1;
+
+static int advise_read_int(int dfd, const char *attr)
+{
+	char val[32];
+
+	if (sysfs_read_at(dfd, attr, val, sizeof(val)) <= 0)
+		return -1;
+	return atoi(val);
+}
+
+/* Whether one of the holders of the disk is a dm-multipath device */
+static int advise_mpath_leg(int dfd)
+{
+	struct dirent	*dent;
+	DIR		*dir;
+	char		attr[NAME_MAX + 32], uuid[16];
+	int		fd, leg = 0;
+
+	fd = openat(dfd, "holders", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+	dir = fdopendir(fd);
+	if (!dir) {
+		close(fd);
+		return 0;
+	}
+
+	for_each_dir(dent, dir) {
+		snprintf(attr, sizeof(attr), "%s/dm/uuid", dent->d_name);
+		if (sysfs_read_at(fd, attr, uuid, sizeof(uuid)) > 0 &&
+		    !strncmp(uuid, "mpath-", 6)) {
+			leg = 1;
+			break;
+		}
+	}
+	closedir(dir);
+
+	return leg;
+}
+
+static int advise_array(const char *vendor, const char *model)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(advise_arrays); i++) {
+		if (strcmp(vendor, advise_arrays[i].vendor))
+			continue;
+		if (!advise_arrays[i].model ||
+		    !strncmp(model, advise_arrays[i].model,
+		    strlen(advise_arrays[i].model)))
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Runs on a pooled thread, reads the queue and class of one disk */
+static void advise_read_disk(void *arg)
+{
+	struct advise_disk	*d = arg;
+	const char		*name = d->s->name;
+	char			uuid[16];
+	int			dfd;
+
+	if (!strncmp(name, "sd", 2))
+		d->class = ADV_SSD;
+	else if (!strncmp(name, "nvme", 4))
+		d->class = ADV_NVME;
+	else if (!strncmp(name, "dm-", 3))
+		d->class = ADV_MPATH;
+	else
+		return;
+
+	dfd = openat(advise_block_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0) {
+		d->class = ADV_NONE;
+		return;
+	}
+
+	/* Bio based dm devices, linear or striped, have no scheduler */
+	if (sysfs_read_at(dfd, "queue/scheduler", d->sched,
+	    sizeof(d->sched)) <= 0 || !strchr(d->sched, '[')) {
+		d->class = ADV_NONE;
+		goto out;
+	}
+
+	if (d->class == ADV_MPATH &&
+	    (sysfs_read_at(dfd, "dm/uuid", uuid, sizeof(uuid)) <= 0 ||
+	    strncmp(uuid, "mpath-", 6))) {
+		d->class = ADV_NONE;
+		goto out;
+	}
+
+	d->rotational = advise_read_int(dfd, "queue/rotational") == 1;
+	d->nr_requests = advise_read_int(dfd, "queue/nr_requests");
+	d->read_ahead_kb = advise_read_int(dfd, "queue/read_ahead_kb");
+	d->rq_affinity = advise_read_int(dfd, "queue/rq_affinity");
+	d->max_sectors_kb = advise_read_int(dfd, "queue/max_sectors_kb");
+	d->max_hw_sectors_kb = advise_read_int(dfd, "queue/max_hw_sectors_kb");
+
+	if (d->class != ADV_SSD)
+		goto out;
+
+	sysfs_read_str_at(dfd, "device/vendor", d->vendor, sizeof(d->vendor));
+	sysfs_read_str_at(dfd, "device/model", d->model, sizeof(d->model));
+	if (advise_mpath_leg(dfd))
+		d->class = ADV_MPATH_LEG;
+	else if (advise_array(d->vendor, d->model))
+		d->class = ADV_ARRAY;
+	else if (d->rotational)
+		d->class = ADV_HDD;
+
+out:
+	close(dfd);
+}
+
+/* Whether 'name' is one of the schedulers listed in 'list' */
+static int advise_sched_avail(const char *list, const char *name)
+{
+	size_t		len = strlen(name);
+	const char	*p;
+
+	for (p = strstr(list, name); p; p = strstr(p + 1, name)) {
+		if ((p == list || p[-1] == ' ' || p[-1] == '[') &&
+		    (!p[len] || p[len] == ' ' || p[len] == ']'))
+			return 1;
+	}
+
+	return 0;
+}
+
+static void advise_sched_current(const char *list, char *buf, size_t len)
+{
+	const char	*p = strchr(list, '['), *end;
+
+	end = p ? strchr(p, ']') : NULL;
+	if (!end) {
+		snprintf(buf, len, "-");
+		return;
+	}
+	snprintf(buf, len, "%.*s", (int)(end - p - 1), p + 1);
+}
+
+static int advise_add(struct advice_info *a, int nr, const char *setting,
+    const char *cur, const char *val, const char *fmt, ...)
+    __attribute__((format(printf, 6, 7)));
+
+/* Fills advice 'nr' of 'a', the disk of a[0], returns the advices */
+static int advise_add(struct advice_info *a, int nr, const char *setting,
+    const char *cur, const char *val, const char *fmt, ...)
+{
+	va_list	ap;
+
+	if (nr)
+		a[nr] = a[0];
+	snprintf(a[nr].setting, sizeof(a[nr].setting), "%s", setting);
+	snprintf(a[nr].current, sizeof(a[nr].current), "%s", cur);
+	snprintf(a[nr].advised, sizeof(a[nr].advised), "%s", val);
+	va_start(ap, fmt);
+	vsnprintf(a[nr].rationale, sizeof(a[nr].rationale), fmt, ap);
+	va_end(ap);
+
+	return nr + 1;
+}
+
+static void advise_set_int(char *buf, size_t len, int v)
+{
+	snprintf(buf, len, "%d", v);
+}
+
+/*
+ * advise_eval() will run the rules on disk 'd', whose counters changed
+ * by 'ds' over the sampled time, and fill the advices in 'a'. Returns
+ * the number of advices.
+ */
+static int advise_eval(struct advise_disk *d, struct disk_stats *ds,
+    struct advice_info *a)
+{
+	const struct advise_rule	*rule = advise_rules + d->class;
+	const char			*sched, *sched_why;
+	char				cur[24], val[24];
+	u64				ios, merges, rd_ios, rd_merges;
+	int				avg_kb, merge_pct, rd_kb, rd_pct;
+	double				queue;
+	int				nr = 0, v;
+
+	memset(a, 0, sizeof(*a));
+	snprintf(a->name, sizeof(a->name), "%s", d->s->name);
+	snprintf(a->class, sizeof(a->class), "%s", rule->name);
+
+	rd_ios = ds->ios[0];
+	rd_merges = ds->merges[0];
+	ios = ds->ios[0] + ds->ios[1];
+	merges = ds->merges[0] + ds->merges[1];
+	avg_kb = ios ? (ds->sectors[0] + ds->sectors[1]) / 2 / ios : 0;
+	merge_pct = ios ? merges * 100 / (ios + merges) : 0;
+	rd_kb = rd_ios ? ds->sectors[0] / 2 / rd_ios : 0;
+	rd_pct = rd_ios ? rd_merges * 100 / (rd_ios + rd_merges) : 0;
+	/* Requests in flight while the disk was busy */
+	queue = ds->io_ticks ? (double)ds->time_in_queue / ds->io_ticks : 0;
+
+	if (ios < ADVISE_MIN_IOS)
+		snprintf(a->workload, sizeof(a->workload), "idle");
+	else if (avg_kb >= ADVISE_SEQ_KB || merge_pct >= ADVISE_SEQ_MERGE_PCT)
+		snprintf(a->workload, sizeof(a->workload), "sequential");
+	else if (avg_kb <= ADVISE_RANDOM_KB &&
+	    merge_pct < ADVISE_RANDOM_MERGE_PCT)
+		snprintf(a->workload, sizeof(a->workload), "random");
+	else
+		snprintf(a->workload, sizeof(a->workload), "mixed");
+
+	/* Multipath over rotational disks, a JBOD with two SAS ports */
+	sched = rule->sched;
+	sched_why = rule->sched_why;
+	if (d->class == ADV_MPATH && d->rotational) {
+		sched = advise_rules[ADV_HDD].sched;
+		sched_why = advise_rules[ADV_HDD].sched_why;
+	}
+	advise_sched_current(d->sched, cur, sizeof(cur));
+	if (strcmp(cur, sched) && advise_sched_avail(d->sched, sched))
+		nr = advise_add(a, nr, "scheduler", cur, sched, "%s", sched_why);
+	else
+		sched = cur;
+
+	if (rule->rq_affinity && d->rq_affinity >= 0 &&
+	    d->rq_affinity != rule->rq_affinity) {
+		advise_set_int(cur, sizeof(cur), d->rq_affinity);
+		advise_set_int(val, sizeof(val), rule->rq_affinity);
+		nr = advise_add(a, nr, "rq_affinity", cur, val, "%s",
+		    rule->rq_why);
+	}
+
+	if (ios < ADVISE_MIN_IOS)
+		return nr;
+
+	/* Without a scheduler nr_requests is the tag depth of the device */
+	if (strcmp(sched, "none") && d->nr_requests > 0 &&
+	    queue >= d->nr_requests * 3 / 4.0 &&
+	    d->nr_requests < ADVISE_MAX_REQUESTS) {
+		v = min(d->nr_requests * 2, ADVISE_MAX_REQUESTS);
+		advise_set_int(cur, sizeof(cur), d->nr_requests);
+		advise_set_int(val, sizeof(val), v);
+		nr = advise_add(a, nr, "nr_requests", cur, val,
+		    "%.1f requests in flight while busy fill the queue", queue);
+	}
+
+	/* The multipath device reads ahead for its paths */
+	if (d->class != ADV_MPATH_LEG && rd_ios >= ADVISE_MIN_IOS &&
+	    d->read_ahead_kb >= 0) {
+		v = d->read_ahead_kb;
+		if ((rd_kb >= ADVISE_SEQ_KB || rd_pct >= ADVISE_SEQ_MERGE_PCT) &&
+		    v < ADVISE_RA_SEQ_KB)
+			v = ADVISE_RA_SEQ_KB;
+		else if (rd_kb <= ADVISE_RANDOM_KB &&
+		    rd_pct < ADVISE_RANDOM_MERGE_PCT && v > ADVISE_RA_RANDOM_KB)
+			v = ADVISE_RA_RANDOM_KB;
+		if (v != d->read_ahead_kb) {
+			advise_set_int(cur, sizeof(cur), d->read_ahead_kb);
+			advise_set_int(val, sizeof(val), v);
+			nr = advise_add(a, nr, "read_ahead_kb", cur, val,
+			    "reads are %s, %d KB on average, %d%% merged",
+			    v > d->read_ahead_kb ? "sequential" : "random",
+			    rd_kb, rd_pct);
+		}
+	}
+
+	/*
+	 * Requests cut at max_sectors_kb. Paths and their multipath device
+	 * have to agree on it, they are left alone.
+	 */
+	if (d->class != ADV_MPATH_LEG && d->class != ADV_MPATH &&
+	    d->max_sectors_kb > 0 &&
+	    d->max_hw_sectors_kb > d->max_sectors_kb &&
+	    d->max_sectors_kb < ADVISE_MAX_SECTORS_KB &&
+	    avg_kb >= d->max_sectors_kb * 3 / 4) {
+		v = min(d->max_hw_sectors_kb, ADVISE_MAX_SECTORS_KB);
+		advise_set_int(cur, sizeof(cur), d->max_sectors_kb);
+		advise_set_int(val, sizeof(val), v);
+		nr = advise_add(a, nr, "max_sectors_kb", cur, val,
+		    "requests of %d KB on average are cut at %d KB, the "
+		    "device takes %d KB", avg_kb, d->max_sectors_kb,
+		    d->max_hw_sectors_kb);
+	}
+
+	return nr;
+}
+
+static int advise_disk_cmp(const void *a, const void *b)
+{
+	const struct advise_disk *x = a, *y = b;
+
+	return dev_name_cmp(x->s->name, y->s->name);
+}
+
+/**
+ * advise_disk() will classify the disk 'name', or every disk when NULL,
+ * and advise scheduler, rq_affinity, nr_requests, read_ahead_kb and
+ * max_sectors_kb from the class and the counters of the disk
+ */
+int advise_disk(char *name)
+{
+	struct disk_sampler	*s;
+	struct advise_disk	*disks = NULL;
+	struct advice_info	advice[ADVISE_MAX];
+	struct disk_stats	ds;
+	unsigned int		interval = 0;
+	char			*val, *end;
+	int			nr = 0, i, j, n, jobs, slot = 1, err = 0;
+	int			nr_classed = 0, nr_advised = 0, nr_advice = 0;
+	u64			start;
+	long			v;
+
+	print_trace_enter();
+
+	jobs = scan_jobs_opt(16);
+	if (jobs < 0)
+		return jobs;
+
+	val = cmd_opt_value("interval");
+	if (val) {
+		v = strtol(val, &end, 0);
+		if (*end || v <= 0) {
+			print_err("Invalid interval '%s', expected milliseconds",
+			    val);
+			return -EINVAL;
+		}
+		interval = v;
+	}
+
+	s = disk_sampler_open();
+	if (!s) {
+		print_err("Can not read the block devices");
+		return -ENODEV;
+	}
+
+	/* Counters since boot unless an interval is sampled */
+	if (interval) {
+		err = disk_sampler_read(s, 0);
+		if (!err)
+			sleep_ms(interval);
+	}
+	if (!err)
+		err = disk_sampler_read(s, slot);
+	if (err)
+		goto out;
+
+	start = now_ms();
+	disks = calloc(s->nr_disks ? s->nr_disks : 1, sizeof(*disks));
+	if (!disks) {
+		err = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < s->nr_disks; i++) {
+		if (name && strcmp(name, s->disks[i].name))
+			continue;
+		disks[nr++].s = s->disks + i;
+	}
+	if (!nr) {
+		if (name)
+			print_err("%s: no such disk", name);
+		err = -ENODEV;
+		goto out;
+	}
+
+	advise_block_fd = open(SYSFS_BLOCK_PATH,
+	    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (advise_block_fd < 0) {
+		err = -errno;
+		goto out;
+	}
+	parallel_for_each(disks, nr, sizeof(*disks), advise_read_disk, jobs);
+	close(advise_block_fd);
+	advise_block_fd = -1;
+
+	qsort(disks, nr, sizeof(*disks), advise_disk_cmp);
+
+	print_advice_header();
+	for (i = 0; i < nr; i++) {
+		if (disks[i].class == ADV_NONE || !disks[i].s->valid[1] ||
+		    (interval && !disks[i].s->valid[0]))
+			continue;
+		nr_classed++;
+
+		for (j = 0; j < 2; j++) {
+			ds.ios[j] = disks[i].s->ds[1].ios[j] -
+			    disks[i].s->ds[0].ios[j];
+			ds.merges[j] = disks[i].s->ds[1].merges[j] -
+			    disks[i].s->ds[0].merges[j];
+			ds.sectors[j] = disks[i].s->ds[1].sectors[j] -
+			    disks[i].s->ds[0].sectors[j];
+		}
+		ds.io_ticks = disks[i].s->ds[1].io_ticks -
+		    disks[i].s->ds[0].io_ticks;
+		ds.time_in_queue = disks[i].s->ds[1].time_in_queue -
+		    disks[i].s->ds[0].time_in_queue;
+
+		n = advise_eval(disks + i, &ds, advice);
+		for (j = 0; j < n; j++)
+			print_advice(advice + j);
+		if (n)
+			nr_advised++;
+		nr_advice += n;
+	}
+
+	if (out_is_text())
+		out_printf("\n%d changes advised on %d of %d devices in "
+		    "%llu ms\n", nr_advice, nr_advised, nr_classed,
+		    (unsigned long long)(now_ms() - start));
+
+out:
+	free(disks);
+	disk_sampler_close(s);
+
+	return err;
+}
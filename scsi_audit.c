@@ -0,0 +1,797 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scsi.h"
+#include "scsi_numa.h"
+#include "scsi_print.h"
+
+/*
+ * Interrupt placement audit
+ *
+ * Every SCSI host and NVMe controller is traced to its PCI function,
+ * whose MSI-X vectors are read from msi_irqs and /proc/irq/N. The counts
+ * of all vectors come from a single read of /proc/interrupts, summed per
+ * NUMA node of the CPUs which took them. Hosts sharing a PCI function
+ * share its vectors and are reported on one row.
+ *
+ * Link audit
+ *
+ * The same PCI functions are checked for a PCIe link trained below the
+ * speed or width of the device, and every FC port for a speed below the
+ * best one it supports. Both are plain sysfs reads, a handful per device.
+ */
+
+#define AUDIT_REMOTE_PCT	10	/* interrupts taken off node to flag */
+
+/* /proc/interrupts, counts of irqs[i] at counts[i * nr_nodes + node] */
+struct irq_table {
+	int	*irqs;
+	u64	*counts;
+	int	nr;
+	int	nr_nodes;
+};
+
+struct audit_ctx;
+
+/* A PCI function with the SCSI hosts or NVMe controllers on top of it */
+struct audit_func {
+	struct audit_ctx	*ctx;
+	char			path[PATH_MAX];
+	char			device[24];	/* host3,host4 */
+	char			pci[16];
+	struct irq_audit_info	irq;
+	struct link_audit_info	link;
+	struct irq_vector_info	*vectors;
+	int			nr_vectors;
+};
+
+struct audit_ctx {
+	struct irq_table	table;
+	struct audit_func	*funcs;
+	int			nr_funcs;
+	int			node_cpus[NUMA_MAX_NODES];
+	int			nr_online;
+};
+
+/* Node of every /proc/interrupts column, from the "CPUn" header */
+static int irq_table_columns(char *line, int **col_node)
+{
+	char	*tok, *save;
+	int	nr = 0, size = 0, cpu, node, *p;
+
+	for (tok = strtok_r(line, " \t\n", &save); tok;
+	     tok = strtok_r(NULL, " \t\n", &save)) {
+		if (sscanf(tok, "CPU%d", &cpu) != 1)
+			continue;
+
+		if (nr == size) {
+			size = size ? size * 2 : 64;
+			p = realloc(*col_node, size * sizeof(*p));
+			if (!p)
+				return -ENOMEM;
+			*col_node = p;
+		}
+		node = cpu_node(cpu);
+		(*col_node)[nr++] = node < 0 ? 0 : node;
+	}
+
+	return nr;
+}
+
+static int irq_table_read(struct irq_table *t)
+{
+	FILE	*fp;
+	char	*line = NULL, *s, *end;
+	size_t	len = 0;
+	int	*col_node = NULL, nr_cols, size = 0, col, err = 0;
+	long	irq;
+	u64	*counts, v;
+	void	*p;
+
+	fp = fopen(PROC_INTERRUPTS_PATH, "r");
+	if (!fp)
+		return -errno;
+
+	t->nr_nodes = numa_nr_nodes();
+	nr_cols = getline(&line, &len, fp) < 0 ? -EIO :
+	    irq_table_columns(line, &col_node);
+	if (nr_cols <= 0) {
+		err = nr_cols ? nr_cols : -EIO;
+		goto out;
+	}
+
+	while (getline(&line, &len, fp) >= 0) {
+		/* Only numbered lines, not NMI, LOC, ... */
+		irq = strtol(line, &end, 10);
+		if (end == line || *end != ':' || irq < 0)
+			continue;
+
+		if (t->nr == size) {
+			size = size ? size * 2 : 256;
+			p = realloc(t->irqs, size * sizeof(*t->irqs));
+			if (!p) {
+				err = -ENOMEM;
+				break;
+			}
+			t->irqs = p;
+			p = realloc(t->counts,
+			    size * t->nr_nodes * sizeof(*t->counts));
+			if (!p) {
+				err = -ENOMEM;
+				break;
+			}
+			t->counts = p;
+		}
+
+		counts = t->counts + (size_t)t->nr * t->nr_nodes;
+		memset(counts, 0, t->nr_nodes * sizeof(*counts));
+		s = end + 1;
+		for (col = 0; col < nr_cols; col++) {
+			v = strtoull(s, &end, 10);
+			if (end == s)
+				break;
+			counts[col_node[col]] += v;
+			s = end;
+		}
+		t->irqs[t->nr++] = irq;
+	}
+
+out:
+	free(line);
+	free(col_node);
+	fclose(fp);
+
+	return err;
+}
+
+/* Counts per node of 'irq', NULL if /proc/interrupts does not list it */
+static u64 *irq_table_find(struct irq_table *t, int irq)
+{
+	int lo = 0, hi = t->nr - 1, mid;
+
+	/* The kernel lists interrupts in ascending order */
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (t->irqs[mid] == irq)
+			return t->counts + (size_t)mid * t->nr_nodes;
+		if (t->irqs[mid] < irq)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return NULL;
+}
+
+static void irq_table_free(struct irq_table *t)
+{
+	free(t->irqs);
+	free(t->counts);
+	memset(t, 0, sizeof(*t));
+}
+
+/* Adds 'name' to the PCI function of sysfs device 'link' */
+static int audit_add_func(struct audit_ctx *a, const char *link,
+    const char *name)
+{
+	struct audit_func	*f;
+	char		path[PATH_MAX];
+	size_t		len;
+	int		i;
+
+	if (pci_dev_path(link, path))
+		return 0;
+
+	for (i = 0; i < a->nr_funcs; i++) {
+		if (strcmp(a->funcs[i].path, path))
+			continue;
+
+		f = a->funcs + i;
+		len = strlen(f->device);
+		if (len + strlen(name) + 1 < sizeof(f->device))
+			snprintf(f->device + len, sizeof(f->device) - len,
+			    ",%s", name);
+		else if (len + 1 < sizeof(f->device))
+			snprintf(f->device + len, sizeof(f->device) - len,
+			    "+");
+		return 0;
+	}
+
+	f = realloc(a->funcs, (a->nr_funcs + 1) * sizeof(*f));
+	if (!f)
+		return -ENOMEM;
+	a->funcs = f;
+
+	f += a->nr_funcs++;
+	memset(f, 0, sizeof(*f));
+	f->ctx = a;
+	memcpy(f->path, path, sizeof(f->path));
+	snprintf(f->device, sizeof(f->device), "%s", name);
+	snprintf(f->pci, sizeof(f->pci), "%s", strrchr(path, '/') + 1);
+
+	return 0;
+}
+
+/* PCI functions of the SCSI hosts and the NVMe controllers */
+static int audit_find_funcs(struct audit_ctx *a)
+{
+	static const char * const classes[] = {
+		SYSFS_SCSI_HOST_PATH, SYSFS_NVME_PATH,
+	};
+	struct dirent	*dent;
+	DIR		*dir;
+	char		link[PATH_MAX];
+	size_t		i;
+	int		err = 0;
+
+	for (i = 0; i < ARRAY_SIZE(classes) && !err; i++) {
+		dir = opendir(classes[i]);
+		if (!dir)
+			continue;
+
+		for_each_dir(dent, dir) {
+			snprintf(link, sizeof(link), "%s/%s/device",
+			    classes[i], dent->d_name);
+			err = audit_add_func(a, link, dent->d_name);
+			if (err)
+				break;
+		}
+		closedir(dir);
+	}
+
+	return err;
+}
+
+static const char *irq_placement(int node, u64 nodes)
+{
+	if (node < 0 || numa_nr_nodes() < 2 || !nodes)
+		return "-";
+	if (nodes == 1ULL << node)
+		return "local";
+	if (!(nodes & 1ULL << node))
+		return "remote";
+
+	return "split";
+}
+
+static void audit_status(struct audit_ctx *a, struct irq_audit_info *info,
+    const struct cpu_mask *cpus)
+{
+	const char	*flags[4];
+	size_t		pos = 0;
+	int		i, nr = 0, avail, spread;
+	u64		all_nodes;
+
+	avail = info->numa_node >= 0 && info->numa_node < NUMA_MAX_NODES &&
+	    a->node_cpus[info->numa_node] ? a->node_cpus[info->numa_node] :
+	    a->nr_online;
+	avail = min(avail, info->nr_irqs);
+
+	/*
+	 * Per-CPU queue vectors are spread over every node on purpose, each
+	 * one interrupting the CPUs which submitted the I/O
+	 */
+	all_nodes = numa_nr_nodes() < 64 ?
+	    (1ULL << numa_nr_nodes()) - 1 : ~0ULL;
+	spread = info->nr_irqs >= numa_nr_nodes() &&
+	    numa_nodes_of(cpus) == all_nodes;
+
+	if (!info->nr_irqs)
+		flags[nr++] = "no-irqs";
+	if (info->remote_irqs && !spread)
+		flags[nr++] = "remote";
+	if (info->remote_pct >= AUDIT_REMOTE_PCT && !spread)
+		flags[nr++] = "remote-load";
+	/* Vectors piled on half the CPUs they could spread over */
+	if (info->nr_irqs > 2 && cpu_mask_weight(cpus) * 2 <= avail)
+		flags[nr++] = "stacked";
+
+	snprintf(info->status, sizeof(info->status), "ok");
+	for (i = 0; i < nr; i++)
+		pos += snprintf(info->status + pos, sizeof(info->status) - pos,
+		    "%s%s", i ? "," : "", flags[i]);
+}
+
+/* Name of the driver bound to PCI function 'path', "-" when unbound */
+static void pci_driver_name(const char *path, char *buf, size_t size)
+{
+	char	link[PATH_MAX + 8], drv[PATH_MAX], *slash;
+	ssize_t	len;
+
+	snprintf(link, sizeof(link), "%s/driver", path);
+	len = readlink(link, drv, sizeof(drv) - 1);
+	if (len <= 0) {
+		snprintf(buf, size, "-");
+		return;
+	}
+
+	drv[len] = '\0';
+	slash = strrchr(drv, '/');
+	snprintf(buf, size, "%.15s", slash ? slash + 1 : drv);
+}
+
+/* Runs on a pooled thread, reads the vectors of one PCI function */
+static void audit_irq_func(void *arg)
+{
+	struct audit_func	*f = arg;
+	struct audit_ctx	*a = f->ctx;
+	struct irq_audit_info	*info = &f->irq;
+	struct irq_vector_info	*v;
+	struct cpu_mask		allowed, effective, all;
+	u64			*counts, total, remote, sum = 0, off = 0;
+	int			*irqs, nr, i, node;
+	size_t			w;
+
+	pci_driver_name(f->path, info->driver, sizeof(info->driver));
+	memcpy(info->device, f->device, sizeof(info->device));
+	memcpy(info->pci, f->pci, sizeof(info->pci));
+	info->numa_node = dev_numa_node(f->path);
+	memset(&all, 0, sizeof(all));
+
+	nr = dev_irqs(f->path, &irqs);
+	f->vectors = nr ? calloc(nr, sizeof(*f->vectors)) : NULL;
+	if (!f->vectors)
+		nr = 0;
+
+	for (i = 0; i < nr; i++) {
+		v = f->vectors + f->nr_vectors;
+		if (irq_affinity(irqs[i], &allowed, &effective))
+			continue;
+		f->nr_vectors++;
+
+		memcpy(v->device, info->device, sizeof(v->device));
+		v->irq = irqs[i];
+		cpulist_format(&allowed, v->affinity, sizeof(v->affinity));
+		cpulist_format(&effective, v->effective, sizeof(v->effective));
+		nodelist_format(numa_nodes_of(&effective), v->nodes,
+		    sizeof(v->nodes));
+		snprintf(v->placement, sizeof(v->placement), "%s",
+		    irq_placement(info->numa_node, numa_nodes_of(&effective)));
+
+		total = remote = 0;
+		counts = irq_table_find(&a->table, irqs[i]);
+		for (node = 0; counts && node < a->table.nr_nodes; node++) {
+			total += counts[node];
+			if (info->numa_node >= 0 && node != info->numa_node)
+				remote += counts[node];
+		}
+		v->interrupts = total;
+		v->remote_pct = total ? remote * 100 / total : 0;
+
+		for (w = 0; w < ARRAY_SIZE(all.bits); w++)
+			all.bits[w] |= effective.bits[w];
+		if (total)
+			info->active_irqs++;
+		if (!strcmp(v->placement, "remote"))
+			info->remote_irqs++;
+		sum += total;
+		off += remote;
+	}
+	free(irqs);
+
+	info->nr_irqs = f->nr_vectors;
+	info->interrupts = sum;
+	info->remote_pct = sum ? off * 100 / sum : 0;
+	cpulist_format(&all, info->irq_cpus, sizeof(info->irq_cpus));
+	nodelist_format(numa_nodes_of(&all), info->irq_nodes,
+	    sizeof(info->irq_nodes));
+	if (!f->nr_vectors) {
+		snprintf(info->irq_cpus, sizeof(info->irq_cpus), "-");
+		snprintf(info->irq_nodes, sizeof(info->irq_nodes), "-");
+	}
+
+	audit_status(a, info, &all);
+}
+
+static int audit_func_cmp(const void *a, const void *b)
+{
+	const struct audit_func *x = a, *y = b;
+
+	return strcmp(x->pci, y->pci);
+}
+
+/**
+ * audit_irq() will show for the PCI function of every SCSI host and NVMe
+ * controller where its interrupt vectors are allowed to go, where they
+ * really go and on which NUMA nodes they were handled, against the node
+ * of the device itself
+ */
+int audit_irq(void)
+{
+	struct audit_ctx	a;
+	struct cpu_mask		online;
+	int			i, j, jobs, node, flagged = 0, err;
+
+	print_trace_enter();
+
+	jobs = scan_jobs_opt(16);
+	if (jobs < 0)
+		return jobs;
+
+	memset(&a, 0, sizeof(a));
+
+	a.nr_online = cpu_online_mask(&online);
+	if (a.nr_online < 0) {
+		print_err("Can not read the online CPUs (%s)",
+		    strerror(-a.nr_online));
+		return a.nr_online;
+	}
+	for (i = 0; i < CPU_MASK_BITS; i++) {
+		node = cpu_mask_test(&online, i) ? cpu_node(i) : -1;
+		if (node >= 0)
+			a.node_cpus[node]++;
+	}
+
+	err = irq_table_read(&a.table);
+	if (err) {
+		print_err("Can not read %s (%s)", PROC_INTERRUPTS_PATH,
+		    strerror(-err));
+		goto out;
+	}
+
+	err = audit_find_funcs(&a);
+	if (err)
+		goto out;
+
+	if (!a.nr_funcs) {
+		print_info("\n No PCI SCSI hosts or NVMe controllers found \n");
+		goto out;
+	}
+
+	parallel_for_each(a.funcs, a.nr_funcs, sizeof(*a.funcs),
+	    audit_irq_func, jobs);
+
+	qsort(a.funcs, a.nr_funcs, sizeof(*a.funcs), audit_func_cmp);
+
+	print_irq_audit_header();
+	for (i = 0; i < a.nr_funcs; i++) {
+		print_irq_audit(&a.funcs[i].irq);
+		if (strcmp(a.funcs[i].irq.status, "ok"))
+			flagged++;
+	}
+
+	if (cmd_opt_isset("vectors")) {
+		print_irq_vector_header();
+		for (i = 0; i < a.nr_funcs; i++) {
+			for (j = 0; j < a.funcs[i].nr_vectors; j++)
+				print_irq_vector(a.funcs[i].vectors + j);
+		}
+	}
+
+	if (out_is_text() && flagged)
+		out_printf("\n%d of %d PCI functions have misplaced "
+		    "interrupts\n", flagged, a.nr_funcs);
+
+out:
+	for (i = 0; i < a.nr_funcs; i++)
+		free(a.funcs[i].vectors);
+	free(a.funcs);
+	irq_table_free(&a.table);
+
+	return err;
+}
+
+/* Speed in GT/s or Gbit of "16.0 GT/s PCIe" or "16 Gbit", 0 if unknown */
+static double link_speed(const char *s)
+{
+	char	*end;
+	double	v;
+
+	v = strtod(s, &end);
+	return end == s || v < 0 ? 0 : v;
+}
+
+static void link_flag(struct link_audit_info *info, const char *flag)
+{
+	size_t len = strlen(info->status);
+
+	snprintf(info->status + len, sizeof(info->status) - len, "%s%s",
+	    len ? "," : "", flag);
+}
+
+/* Copies the speed attribute 'attr' without its " PCIe" suffix */
+static int link_read_speed(int dfd, const char *attr, char *buf, size_t size)
+{
+	char	val[64], *p;
+
+	if (sysfs_read_at(dfd, attr, val, sizeof(val)) <= 0 ||
+	    !link_speed(val)) {
+		snprintf(buf, size, "-");
+		return -ENODATA;
+	}
+
+	p = strstr(val, " PCIe");
+	if (p)
+		*p = '\0';
+	snprintf(buf, size, "%.15s", val);
+
+	return 0;
+}
+
+static int link_read_width(int dfd, const char *attr, char *buf, size_t size)
+{
+	char	val[32];
+	int	width;
+
+	width = sysfs_read_at(dfd, attr, val, sizeof(val)) > 0 ? atoi(val) : 0;
+	if (width <= 0 || width > 32) {
+		snprintf(buf, size, "-");
+		return -ENODATA;
+	}
+	snprintf(buf, size, "x%d", width);
+
+	return 0;
+}
+
+/* Runs on a pooled thread, reads the PCIe link of one PCI function */
+static void audit_link_func(void *arg)
+{
+	struct audit_func	*f = arg;
+	struct link_audit_info	*info = &f->link;
+	int			dfd, err = 0;
+
+	memcpy(info->device, f->device, sizeof(info->device));
+	snprintf(info->type, sizeof(info->type), "pcie");
+	pci_driver_name(f->path, info->driver, sizeof(info->driver));
+	snprintf(info->address, sizeof(info->address), "%s", f->pci);
+
+	dfd = open(f->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0) {
+		snprintf(info->speed, sizeof(info->speed), "-");
+		snprintf(info->max_speed, sizeof(info->max_speed), "-");
+		snprintf(info->width, sizeof(info->width), "-");
+		snprintf(info->max_width, sizeof(info->max_width), "-");
+		link_flag(info, "unknown");
+		return;
+	}
+
+	/* Virtual functions and some root complex devices have no link */
+	err |= link_read_speed(dfd, "current_link_speed", info->speed,
+	    sizeof(info->speed));
+	err |= link_read_speed(dfd, "max_link_speed", info->max_speed,
+	    sizeof(info->max_speed));
+	err |= link_read_width(dfd, "current_link_width", info->width,
+	    sizeof(info->width));
+	err |= link_read_width(dfd, "max_link_width", info->max_width,
+	    sizeof(info->max_width));
+	close(dfd);
+
+	if (err) {
+		link_flag(info, "unknown");
+		return;
+	}
+
+	if (link_speed(info->speed) < link_speed(info->max_speed))
+		link_flag(info, "speed-downtrained");
+	if (atoi(info->width + 1) < atoi(info->max_width + 1))
+		link_flag(info, "width-downtrained");
+	if (!info->status[0])
+		link_flag(info, "ok");
+}
+
+/* The fastest of "4 Gbit, 8 Gbit, 16 Gbit" */
+static double fc_max_speed(char *list, char *buf, size_t size)
+{
+	char	*tok, *save;
+	double	v, max = 0;
+
+	snprintf(buf, size, "-");
+	for (tok = strtok_r(list, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		while (*tok == ' ')
+			tok++;
+		v = link_speed(tok);
+		if (v > max) {
+			max = v;
+			snprintf(buf, size, "%.15s", tok);
+		}
+	}
+
+	return max;
+}
+
+/* Reads the port of FC host 'name' into 'info' */
+static void audit_fc_port(int dfd, const char *name,
+    struct link_audit_info *info)
+{
+	char	val[256], link[PATH_MAX], pci[PATH_MAX];
+	double	max;
+
+	snprintf(info->device, sizeof(info->device), "%.23s", name);
+	snprintf(info->type, sizeof(info->type), "fc");
+	snprintf(info->width, sizeof(info->width), "-");
+	snprintf(info->max_width, sizeof(info->max_width), "-");
+
+	snprintf(link, sizeof(link), "%s/%.200s/device", SYSFS_FC_HOST_PATH,
+	    name);
+	if (pci_dev_path(link, pci))
+		snprintf(info->driver, sizeof(info->driver), "-");
+	else
+		pci_driver_name(pci, info->driver, sizeof(info->driver));
+
+	snprintf(link, sizeof(link), "%.200s/port_name", name);
+	if (sysfs_read_at(dfd, link, val, sizeof(val)) > 0)
+		snprintf(info->address, sizeof(info->address), "%.23s", val);
+	else
+		snprintf(info->address, sizeof(info->address), "-");
+
+	snprintf(link, sizeof(link), "%.200s/supported_speeds", name);
+	if (sysfs_read_at(dfd, link, val, sizeof(val)) <= 0)
+		val[0] = '\0';
+	max = fc_max_speed(val, info->max_speed, sizeof(info->max_speed));
+
+	/*
+	 * The fc_host speed is what the port negotiated, for every driver;
+	 * qla2xxx port_speed is the configured one and may read "auto".
+	 */
+	snprintf(link, sizeof(link), "%.200s/speed", name);
+	if (sysfs_read_at(dfd, link, val, sizeof(val)) <= 0)
+		val[0] = '\0';
+	snprintf(info->speed, sizeof(info->speed), "%.15s",
+	    link_speed(val) ? val : "-");
+
+	snprintf(link, sizeof(link), "%.200s/port_state", name);
+	if (sysfs_read_at(dfd, link, val, sizeof(val)) > 0 &&
+	    strcmp(val, "Online")) {
+		link_flag(info, "link-down");
+		return;
+	}
+
+	if (!max || !link_speed(info->speed))
+		link_flag(info, "unknown");
+	else if (link_speed(info->speed) < max)
+		link_flag(info, "speed-downtrained");
+	else
+		link_flag(info, "ok");
+}
+
+static int link_device_cmp(const void *a, const void *b)
+{
+	const struct link_audit_info *x = a, *y = b;
+
+	return dev_name_cmp(x->device, y->device);
+}
+
+/* Every port of /sys/class/fc_host, sorted by host number */
+static int audit_fc_ports(struct link_audit_info **ports)
+{
+	struct link_audit_info	*p = NULL, *tmp;
+	struct dirent		*dent;
+	DIR			*dir;
+	int			nr = 0, size = 0;
+
+	*ports = NULL;
+	dir = opendir(SYSFS_FC_HOST_PATH);
+	if (!dir)
+		return 0;
+
+	for_each_dir(dent, dir) {
+		if (nr == size) {
+			size = size ? size * 2 : 8;
+			tmp = realloc(p, size * sizeof(*p));
+			if (!tmp) {
+				free(p);
+				closedir(dir);
+				return -ENOMEM;
+			}
+			p = tmp;
+		}
+		memset(p + nr, 0, sizeof(*p));
+		audit_fc_port(dirfd(dir), dent->d_name, p + nr);
+		nr++;
+	}
+	closedir(dir);
+
+	qsort(p, nr, sizeof(*p), link_device_cmp);
+	*ports = p;
+
+	return nr;
+}
+
+/**
+ * audit_links() will show the PCIe link of the PCI function of every SCSI
+ * host and NVMe controller and the speed of every FC port, against the
+ * best the device supports
+ */
+int audit_links(void)
+{
+	struct audit_ctx	a;
+	struct link_audit_info	*ports = NULL;
+	int			i, jobs, nr_ports, flagged = 0, down = 0, err;
+
+	print_trace_enter();
+
+	jobs = scan_jobs_opt(16);
+	if (jobs < 0)
+		return jobs;
+
+	memset(&a, 0, sizeof(a));
+
+	err = audit_find_funcs(&a);
+	if (err)
+		goto out;
+
+	nr_ports = audit_fc_ports(&ports);
+	if (nr_ports < 0) {
+		err = nr_ports;
+		goto out;
+	}
+
+	if (!a.nr_funcs && !nr_ports) {
+		print_info("\n No PCI SCSI hosts, NVMe controllers or FC ports "
+		    "found \n");
+		goto out;
+	}
+
+	parallel_for_each(a.funcs, a.nr_funcs, sizeof(*a.funcs),
+	    audit_link_func, jobs);
+
+	qsort(a.funcs, a.nr_funcs, sizeof(*a.funcs), audit_func_cmp);
+
+	print_link_audit_header();
+	for (i = 0; i < a.nr_funcs; i++) {
+		print_link_audit(&a.funcs[i].link);
+		if (strstr(a.funcs[i].link.status, "downtrained"))
+			flagged++;
+	}
+	for (i = 0; i < nr_ports; i++) {
+		print_link_audit(ports + i);
+		if (!strcmp(ports[i].status, "link-down"))
+			down++;
+		else if (strcmp(ports[i].status, "ok") &&
+		    strcmp(ports[i].status, "unknown"))
+			flagged++;
+	}
+
+	/* A port which is down runs at no speed, it is not downtrained */
+	if (out_is_text() && (flagged || down))
+		out_printf("\n");
+	if (out_is_text() && flagged)
+		out_printf("%d of %d links run below capability\n", flagged,
+		    a.nr_funcs + nr_ports - down);
+	if (out_is_text() && down)
+		out_printf("%d FC port%s down\n", down, down > 1 ? "s are" :
+		    " is");
+
+out:
+	free(ports);
+	free(a.funcs);
+
+	return err;
+}
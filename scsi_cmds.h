@@ -56,6 +56,19 @@ struct supported_sub_cmds {
 	const char *sub_cmd_desc;
 };
 
+/* Long options ("--name [value]") accepted after the command name */
+struct supported_opts {
+	const char *opt;
+	int has_arg;
+	const char *opt_desc;
+	int is_set;
+	char *value;
+};
+
+int parse_cmd_options(int *argc, char **argv);
+int cmd_opt_isset(const char *opt);
+char *cmd_opt_value(const char *opt);
+
 /* Various command implementation */
 int cmd_alias(int argc, char **argv, struct scsi_device_list *);
 int cmd_errors(int argc, char **argv, struct scsi_device_list *);
@@ -66,5 +79,12 @@ int cmd_reset(int argc, char **argv, struct scsi_device_list *);
 int cmd_stats(int argc, char **argv, struct scsi_device_list *);
 int cmd_show(int argc, char **argv, struct scsi_device_list *);
 int cmd_scan(int argc, char **argv, struct scsi_device_list *);
+int cmd_top(int argc, char **argv, struct scsi_device_list *);
+int cmd_snapshot(int argc, char **argv, struct scsi_device_list *);
+int cmd_tune(int argc, char **argv, struct scsi_device_list *);
+int cmd_fc(int argc, char **argv, struct scsi_device_list *);
+int cmd_watch(int argc, char **argv, struct scsi_device_list *);
+int cmd_audit(int argc, char **argv, struct scsi_device_list *);
+int cmd_advise(int argc, char **argv, struct scsi_device_list *);
 
 #endif
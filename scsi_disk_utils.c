@@ -38,6 +38,7 @@
  */
 
 #include "scsi.h"
+#include "scsi_numa.h"
 #include "scsi_print.h"
 
 struct device_type_name {
@@ -79,13 +80,46 @@ char *dev_type_to_dev_name(int dev_type)
 	return "Unknow Device";
 }
 
+/**
+ * parse_disk_stats() will parse the counters of one block device, as found
+ * in /sys/block/X/stat or after the name in /proc/diskstats. Returns the
+ * number of fields found.
+ */
+int parse_disk_stats(const char *p, struct disk_stats *ds)
+{
+	u64	v[11];
+	int	i;
+
+	for (i = 0; i < NUM_ENTRIES(v); i++) {
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (*p < '0' || *p > '9')
+			break;
+		v[i] = parse_u64(&p);
+	}
+
+	if (i < NUM_ENTRIES(v))
+		return i;
+
+	ds->ios[0] = v[0];
+	ds->merges[0] = v[1];
+	ds->sectors[0] = v[2];
+	ds->ticks[0] = v[3];
+	ds->ios[1] = v[4];
+	ds->merges[1] = v[5];
+	ds->sectors[1] = v[6];
+	ds->ticks[1] = v[7];
+	ds->in_flight = v[8];
+	ds->io_ticks = v[9];
+	ds->time_in_queue = v[10];
+
+	return i;
+}
+
 int get_disk_stats(struct scsi_device_info *s_info_p, char *disk_name)
 {
 	char	line[256];
 	char	path[256];
-	char	*p;
-	FILE	*f;
-	int	ret = 0;
 
 	print_trace_enter();
 
@@ -93,31 +127,17 @@ int get_disk_stats(struct scsi_device_info *s_info_p, char *disk_name)
 
 	print_debug("Path: %s, disk: %s \n", path, disk_name);
 
-	f = fopen(path, "r");
-	if (f == NULL) {
-		printf("file open %s returned NULL\n", path);
-		return -EIO;
-	}
-
-	p = fgets(line, sizeof(line), f);
-	if (!p) {
-		fclose(f);
+	if (load_sysfs_path(path, line, sizeof(line))) {
+		out_printf("file open %s returned NULL\n", path);
 		return -EIO;
 	}
 
-	print_debug("Open Path %s,\n Stats \n%s\n", path, p);
+	print_debug("Open Path %s,\n Stats \n%s\n", path, line);
 
-	ret = sscanf(p, "%"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" "
-			"%"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64" "
-			" %"SCNu64" %"SCNu64"\n",
-			&s_info_p->dstat.ios[0], &s_info_p->dstat.merges[0],
-			&s_info_p->dstat.sectors[0], &s_info_p->dstat.ticks[0],
-			&s_info_p->dstat.ios[1], &s_info_p->dstat.merges[1],
-			&s_info_p->dstat.sectors[1], &s_info_p->dstat.ticks[1],
-			&s_info_p->dstat.io_ticks, &s_info_p->dstat.time_in_queue);
-        fclose(f);
+	if (parse_disk_stats(line, &s_info_p->dstat) < 11)
+		return -EIO;
 
-        return ret != 10;
+	return 0;
 }
 
 int get_disk_vendor_model(struct scsi_device_info *s_info)
@@ -334,14 +354,45 @@ int list_enclosure(struct scsi_device_info *s_info)
 	return err;
 }
 
+/*
+ * In stream mode ('--stream') a single record buffer is reused for every
+ * device found on the system and each row is pushed out as soon as it is
+ * rendered, so memory stays flat regardless of the number of devices.
+ */
+static struct scsi_device_info *get_list_rec(struct scsi_device_info *rec,
+					     int stream)
+{
+	if (stream && rec) {
+		clear_scsi_dev(rec);
+		return rec;
+	}
+
+	return alloc_scsi_dev();
+}
+
+static struct scsi_device_info *put_list_rec(struct scsi_device_info *rec,
+					     int stream)
+{
+	if (stream) {
+		out_flush();
+		return rec;
+	}
+
+	put_scsi_dev(rec);
+	return NULL;
+}
+
 int list_block_devs(struct scsi_device_info *d_info)
 {
 	struct dirent		*entry;
 	DIR			*dir;
 	char			disk_path[512];
+	int			stream = cmd_opt_isset("stream");
 
 	print_trace_enter();
 
+	d_info = NULL;
+
 	dir = opendir(SYSFS_BLOCK_PATH);
 	if (unlikely(!dir)) {
 		print_info("\n No Block device configured \n");
@@ -359,9 +410,11 @@ int list_block_devs(struct scsi_device_info *d_info)
 		if (!strncmp(entry->d_name, "sd", 2)) {
 			print_trace_enter();
 
-			d_info = alloc_scsi_dev();
-			if (!d_info)
+			d_info = get_list_rec(d_info, stream);
+			if (!d_info) {
+				closedir(dir);
 				return -ENODEV;
+			}
 
 			d_info->disk_path = strdup(disk_path);
 			d_info->disk_name = strdup(entry->d_name);
@@ -373,7 +426,7 @@ int list_block_devs(struct scsi_device_info *d_info)
 			get_disk_vendor_model(d_info);
 			print_disk_info(d_info);
 
-			put_scsi_dev(d_info);
+			d_info = put_list_rec(d_info, stream);
 			continue;
 		}
 	}
@@ -381,6 +434,7 @@ int list_block_devs(struct scsi_device_info *d_info)
 
 	dir = opendir(SYSFS_BLOCK_PATH);
 	if (unlikely(!dir)) {
+		put_scsi_dev(d_info);
 		print_info("\n No Block device configured \n");
 		return -ENODEV;
 	}
@@ -394,9 +448,11 @@ int list_block_devs(struct scsi_device_info *d_info)
 		    strncmp(entry->d_name, "nvme-fabrics", 12)) {
 			print_trace_enter();
 
-			d_info = alloc_scsi_dev();
-			if (!d_info)
+			d_info = get_list_rec(d_info, stream);
+			if (!d_info) {
+				closedir(dir);
 				return -ENOSPC;
+			}
 
 			d_info->device_type = DIRECT_ACCESS_BLOCK_DEVICE;
 			snprintf(d_info->disk_type, sizeof(d_info->disk_type),
@@ -408,13 +464,15 @@ int list_block_devs(struct scsi_device_info *d_info)
 			get_nvme_device_model(d_info);
 			print_nvme_disk_info(d_info);
 
-			put_scsi_dev(d_info);
+			d_info = put_list_rec(d_info, stream);
 
 			continue;
 		}
 	}
 	closedir(dir);
 
+	put_scsi_dev(d_info);
+
 	return 0;
 }
 
@@ -537,7 +595,7 @@ int list_tape_devs(struct scsi_device_info *d_info)
 			get_disk_type(d_info);
 			snprintf(d_info->disk_type, sizeof(d_info->disk_type),
 			    dev_type_to_dev_name(d_info->device_type));
-			printf("%s: Tape Device %s\n", __func__, disk_path);
+			out_printf("%s: Tape Device %s\n", __func__, disk_path);
 
 			put_scsi_dev(d_info);
 			continue;
@@ -553,9 +611,12 @@ int list_generic_devs(struct scsi_device_info *d_info)
 	struct dirent	*entry;
 	DIR		*dir;
 	char		disk_path[512];
+	int		stream = cmd_opt_isset("stream");
 
 	print_trace_enter();
 
+	d_info = NULL;
+
 	dir = opendir("/dev");
 	if (unlikely(!dir))
 		return -ENODEV;
@@ -570,9 +631,11 @@ int list_generic_devs(struct scsi_device_info *d_info)
 		    !strncmp(entry->d_name, "ng", 2)) {
 			print_trace_enter();
 
-			d_info = alloc_scsi_dev();
-			if (!d_info)
+			d_info = get_list_rec(d_info, stream);
+			if (!d_info) {
+				closedir(dir);
 				return -ENOSPC;
+			}
 
 			d_info->device_type = GENERIC_DEV;
 			d_info->disk_path = strdup(disk_path);
@@ -590,12 +653,14 @@ int list_generic_devs(struct scsi_device_info *d_info)
 			get_disk_vendor_model(d_info);
 			print_generic_disk_info(d_info);
 
-			put_scsi_dev(d_info);
+			d_info = put_list_rec(d_info, stream);
 			continue;
 		}
 	}
 	closedir(dir);
 
+	put_scsi_dev(d_info);
+
 	return 0;
 }
 
@@ -604,9 +669,12 @@ int list_multipath_devs(struct scsi_device_info *d_info)
 	struct dirent	*entry;
 	DIR		*dir;
 	char		disk_path[512] = { 0 };
+	int		stream = cmd_opt_isset("stream");
 
 	print_trace_enter();
 
+	d_info = NULL;
+
 	dir = opendir(SYSFS_BLOCK_PATH);
 	if (unlikely(!dir))
 		return -ENODEV;
@@ -617,30 +685,15 @@ int list_multipath_devs(struct scsi_device_info *d_info)
 
 	for_each_dir(entry, dir) {
 		snprintf(disk_path, sizeof(disk_path), "%s/%s", SYSFS_BLOCK_PATH, entry->d_name);
-		if (!strncmp(entry->d_name, "dm-", 2)) {
-			print_trace_enter();
-
-			d_info = alloc_scsi_dev();
-			if (!d_info)
-				return -ENOSPC;
-
-			d_info->device_type = UNKNOWN_DEVICE;
-			d_info->disk_path = strdup(disk_path);
-			d_info->disk_name = strdup(entry->d_name);
-			get_device_numbers(entry->d_name, d_info);
-			get_hctl_info(d_info);
-			get_disk_vendor_model(d_info);
-			print_mpath_disk_info(d_info);
-
-			put_scsi_dev(d_info);
-			continue;
-		}
-		if (!strncmp(entry->d_name, "md", 2)) {
+		if (!strncmp(entry->d_name, "dm-", 2) ||
+		    !strncmp(entry->d_name, "md", 2)) {
 			print_trace_enter();
 
-			d_info = alloc_scsi_dev();
-			if (!d_info)
+			d_info = get_list_rec(d_info, stream);
+			if (!d_info) {
+				closedir(dir);
 				return -ENOSPC;
+			}
 
 			d_info->device_type = UNKNOWN_DEVICE;
 			d_info->disk_path = strdup(disk_path);
@@ -650,12 +703,13 @@ int list_multipath_devs(struct scsi_device_info *d_info)
 			get_disk_vendor_model(d_info);
 			print_mpath_disk_info(d_info);
 
-			put_scsi_dev(d_info);
+			d_info = put_list_rec(d_info, stream);
 			continue;
 		}
 	}
 	closedir(dir);
 
+	put_scsi_dev(d_info);
 
 	return 0;
 }
@@ -894,6 +948,10 @@ int get_single_nvme_disk_details(char *disk_name, struct scsi_device_info *d_inf
 	d_info->pci_address = strdup(temp_str);
 	print_debug("%s: %s\n", path, d_info->pci_address);
 
+	/* /sys/block/nvme0n1/device/numa_node, -1 for fabrics */
+	snprintf(path, sizeof(path), "%s/device", d_info->disk_path);
+	d_info->numa_node = dev_numa_node(path);
+
 	/* /sys/block/nvme0n1/device/cntlid */
 	snprintf(path, sizeof(path), "%s/device/%s", d_info->disk_path, "cntlid");
 	snprintf(temp_str, sizeof(temp_str), open_sysfs_stats_file(path));
@@ -995,7 +1053,7 @@ int get_single_nvme_disk_details(char *disk_name, struct scsi_device_info *d_inf
 
 int get_single_scsi_disk_details(char *disk_name, struct scsi_device_info *d_info)
 {
-	char		path[1024], temp_disk_path[128];
+	char		path[1024], temp_disk_path[128], pci_path[PATH_MAX];
 	char		temp_str[64] = { 0 };
 	char		*end;
 	int		err = 0;
@@ -1212,6 +1270,14 @@ int get_single_scsi_disk_details(char *disk_name, struct scsi_device_info *d_inf
 	d_info->vendor = strdup(temp_str);
 	print_debug("%s: %s \n", path, d_info->vendor);
 
+	/* PCI function of the HBA above /sys/block/sda/device */
+	snprintf(path, sizeof(path), "%s/device", d_info->disk_path);
+	d_info->numa_node = -1;
+	if (!pci_dev_path(path, pci_path)) {
+		d_info->pci_address = strdup(strrchr(pci_path, '/') + 1);
+		d_info->numa_node = dev_numa_node(pci_path);
+	}
+
 	get_disk_queue_data(d_info);
 
 	print_scsi_disk_details(d_info);
@@ -1229,7 +1295,7 @@ int show_enclosure_details(char *argv[], struct scsi_device_list *sdev)
 		return -EINVAL;
 
 	if (disk_info->disk_name)
-		printf("%s: %s\n", __func__, disk_info->disk_name);
+		out_printf("%s: %s\n", __func__, disk_info->disk_name);
 
 	return 0;
 }
@@ -1308,31 +1374,6 @@ int get_disk_error_count(char **argv, struct scsi_device_info *d_info)
 	return err;
 }
 
-/**
- * Issue Scsi scan for a disk device
- */
-int scsi_scan_disk_dev(char **argv, struct scsi_device_info *d_info)
-{
-	int	err = 0;
-	char	disk_name[16];
-
-	if (strlen(argv[3]) == 0)
-		return -EIO;
-
-	snprintf(disk_name, sizeof(disk_name), argv[3]);
-
-	/* Verify that the scsi deice is not a boot device */
-	d_info = alloc_scsi_dev();
-	if (!d_info)
-		return -ENODEV;
-
-	d_info->disk_name = strdup(disk_name);
-
-	put_scsi_dev(d_info);
-
-	return err;
-}
-
 /**
  * Set scsi disk device offlinee
  */
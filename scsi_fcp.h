@@ -119,6 +119,67 @@ struct fc_host_statistics {
 	u64 fpin_dn_unknown;
 };
 
+/* Statistics the driver does not maintain read as all ones */
+#define FC_STAT_UNSUPPORTED	0xffffffffffffffffULL
+
+/*
+ * A per second rate derived from one counter of fc_host_statistics,
+ * 'scale' converts the counter units to the reported units. The title
+ * is printed with a "/s" suffix when rates rather than totals are shown.
+ */
+struct fc_rate {
+	const char	*title;
+	const char	*key;
+	size_t		offset;
+	double		scale;
+};
+
+struct fc_rate_table {
+	const struct fc_rate	*rates;
+	int			nr_rates;
+};
+
+extern const struct fc_rate_table fc_rate_table;
+extern const struct fc_rate_table fc_rport_rate_table;
+
+/* A leading name column of a rates table */
+struct fc_rate_col {
+	const char	*title;
+	const char	*key;
+	int		width;
+};
+
+/*
+ * Sampling state of one FC host or remote port: the statistics files
+ * stay open for the whole run and two samples are used in turns.
+ */
+struct fc_port_sample {
+	char				name[32];
+	const struct fc_rate_table	*table;
+	int				*fds;		/* per fc_rate */
+	double				*rates;		/* NAN if unsupported */
+	struct fc_host_statistics	stats[2];
+};
+
+/*
+ * Remote port statistics only carry the FPIN counters, they are kept in
+ * the matching fields of fc_host_statistics.
+ */
+struct fc_rport_sample {
+	struct fc_port_sample	port;		/* port.name is rport-H:B-N */
+	char			host_name[16];
+	char			port_name[24];	/* target WWPN */
+	int			host;		/* index of the host group */
+	int			target;		/* index of the target group */
+};
+
+/* Rates summed over the rports of one host or one target WWPN */
+struct fc_rate_group {
+	const char	*name;
+	int		nr_rports;
+	double		*rates;
+};
+
 struct fc_rport_info {
 	char	*rport_path;
 	char	*rport_name;
@@ -128,8 +189,65 @@ struct fc_rport_info {
 	char	*roles;
 	char	*maxframe_size;
 	char	*supported_classes;
-	int	dev_loss_tmo;
+	int	dev_loss_tmo;		/* -1 if not provided */
+	char	*fast_io_fail_tmo;	/* seconds or "off" */
 	char	*port_state; /* Linkedown, Linkup */
+	int	host_no;		/* owning hostN */
+	int	channel;
+	int	target_id;		/* scsi_target_id, -1 if none */
+};
+
+/* One LUN reached through a remote port, names borrowed from the rport */
+struct fc_lun_info {
+	char	*rport_name;
+	char	*port_name;		/* target WWPN */
+	int	host;			/* host, channel, target, lun */
+	int	channel;
+	int	target;
+	int	lun;
+	char	*state;
+	char	*disk_name;		/* sdX */
+	char	*sg_name;		/* sgN */
+	char	*holders;		/* dm-N,... */
+};
+
+/* An NPIV virtual port and the SCSI host it created */
+struct fc_vport_info {
+	char	*vport_name;		/* vport-H:C-N */
+	int	parent_no;		/* host number of the physical port */
+	char	parent[16];		/* hostH */
+	char	host_name[16];		/* SCSI host of the vport, - if none */
+	char	*port_name;
+	char	*node_name;
+	char	*vport_state;		/* Active, Initializing, Failed, ... */
+	char	*vport_type;
+	char	*symbolic_name;
+};
+
+/* One vport_create or vport_delete from a spec file */
+struct fc_vport_job {
+	char	parent[16];		/* hostN */
+	int	parent_no;
+	char	wwpn[20];		/* 16 hex digits */
+	char	wwnn[20];
+	char	vport_name[32];		/* set once the vport is found */
+	int	present;		/* found by the last poll */
+	int	err;
+	u64	ms;			/* until done or given up */
+	char	result[32];
+};
+
+/*
+ * Remote ports bucketed by owning host, the rports of hostN are
+ * rports[host_start[N]] up to rports[host_start[N + 1]]
+ */
+struct fc_rport_index {
+	struct fc_rport_info	*rports;
+	int			nr_rports;
+	int			*host_start;
+	char			*host_read;	/* attributes read */
+	int			nr_hosts;	/* highest host number + 1 */
+	int			class_fd;	/* SYSFS_FC_RPRT_PATH */
 };
 
 struct fc_device_info {
@@ -174,14 +292,23 @@ int get_adapter_details(struct fc_device_info *);
 void get_driver_info(struct fc_device_info *);
 int fc_hba_reset(int, char **);
 int get_fc_dev_stats(char *, struct fc_device_info *);
+int reset_fc_port_stats(char *);
+int watch_fc_port_stats(char *, unsigned int, unsigned int);
+int watch_fc_rport_stats(char *, unsigned int, unsigned int);
 int get_fc_info(struct fc_device_info *);
 int get_fcport_error_count(char **, struct fc_device_info *);
-int scsi_scan_fcport_dev(char **, struct fc_device_info *);
+int scan_fc_hosts(int, char **);
 int set_fcport_offline(char **, struct fc_device_info *);
 int set_fcport_online(char **, struct fc_device_info *);
 int set_fcport_alias(char **, struct fc_device_info *);
 
 /* For Rport Information */
 int list_rport_adapters(struct fc_device_info *);
-void get_rport_info(struct fc_rport_info *);
+int get_rport_info(int, struct fc_rport_info *);
+int fc_rport_index_build(struct fc_rport_index *);
+struct fc_rport_info *fc_rport_index_host(struct fc_rport_index *, int, int *);
+void fc_rport_index_free(struct fc_rport_index *);
+int list_fc_luns(int);
+int list_fc_vports(void);
+int fc_vport_batch(char *, int);
 #endif
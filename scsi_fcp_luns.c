@@ -0,0 +1,475 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scsi.h"
+#include "scsi_fcp.h"
+#include "scsi_print.h"
+
+/*
+ * FC LUN map
+ *
+ * Which block devices sit behind a target WWPN is spread over four sysfs
+ * classes. Rather than walking the device tree below every rport, each
+ * class is listed once and joined on the SCSI address:
+ *
+ *   fc_remote_ports/rport-H:C-N	H:C:scsi_target_id -> rport
+ *   scsi_device/H:C:T:L		H:C:T -> rport, one LUN each
+ *   block/sdX -> .../H:C:T:L/block/sdX	H:C:T:L -> LUN
+ *   scsi_generic/sgN -> .../H:C:T:L/...	H:C:T:L -> LUN
+ *   block/dm-N/slaves/sdX		sdX -> LUN
+ */
+struct fc_lun_map {
+	struct fc_rport_index	rports;
+	u32			*targets;	/* rport index + 1, by H:C:T */
+	u32			target_mask;
+	struct fc_lun_info	*luns;
+	int			nr_luns;
+	u32			*hctls;		/* lun index + 1, by H:C:T:L */
+	u32			*names;		/* lun index + 1, by disk name */
+	u32			lun_mask;
+};
+
+static u32 hctl_hash(int h, int c, int t, int l)
+{
+	u64 k = (u64)h << 48 ^ (u64)c << 40 ^ (u64)t << 24 ^ (u32)l;
+
+	return (k * 0x9e3779b97f4a7c15ULL) >> 32;
+}
+
+static u32 name_hash(const char *name)
+{
+	u32 h = 2166136261u;
+
+	while (*name)
+		h = (h ^ (unsigned char)*name++) * 16777619u;
+
+	return h;
+}
+
+/* Smallest power of two holding 'nr' entries at half load */
+static u32 index_size(int nr)
+{
+	u32 size = 16;
+
+	while (size < (u32)nr * 2)
+		size <<= 1;
+
+	return size;
+}
+
+static struct fc_rport_info *lun_map_target(struct fc_lun_map *m, int h,
+    int c, int t)
+{
+	struct fc_rport_info	*rp;
+	u32			i;
+
+	for (i = hctl_hash(h, c, t, -1) & m->target_mask; m->targets[i];
+	    i = (i + 1) & m->target_mask) {
+		rp = m->rports.rports + m->targets[i] - 1;
+		if (rp->host_no == h && rp->channel == c && rp->target_id == t)
+			return rp;
+	}
+
+	return NULL;
+}
+
+static struct fc_lun_info *lun_map_hctl(struct fc_lun_map *m, int h, int c,
+    int t, int l)
+{
+	struct fc_lun_info	*lun;
+	u32			i;
+
+	for (i = hctl_hash(h, c, t, l) & m->lun_mask; m->hctls[i];
+	    i = (i + 1) & m->lun_mask) {
+		lun = m->luns + m->hctls[i] - 1;
+		if (lun->host == h && lun->channel == c && lun->target == t &&
+		    lun->lun == l)
+			return lun;
+	}
+
+	return NULL;
+}
+
+static struct fc_lun_info *lun_map_name(struct fc_lun_map *m,
+    const char *name)
+{
+	struct fc_lun_info	*lun;
+	u32			i;
+
+	for (i = name_hash(name) & m->lun_mask; m->names[i];
+	    i = (i + 1) & m->lun_mask) {
+		lun = m->luns + m->names[i] - 1;
+		if (!strcmp(lun->disk_name, name))
+			return lun;
+	}
+
+	return NULL;
+}
+
+/* Index the rports of 'host_no' (or all hosts if -1) by H:C:T */
+static int lun_map_rports(struct fc_lun_map *m, int host_no)
+{
+	struct fc_rport_info	*rp;
+	int			h, i, nr;
+	u32			k;
+
+	m->target_mask = index_size(m->rports.nr_rports) - 1;
+	m->targets = calloc(m->target_mask + 1, sizeof(*m->targets));
+	if (!m->targets)
+		return -ENOMEM;
+
+	for (h = 0; h < m->rports.nr_hosts; h++) {
+		if (host_no >= 0 && h != host_no)
+			continue;
+
+		rp = fc_rport_index_host(&m->rports, h, &nr);
+		for (i = 0; i < nr; i++) {
+			if (rp[i].target_id < 0)
+				continue;
+
+			k = hctl_hash(h, rp[i].channel, rp[i].target_id, -1);
+			for (k &= m->target_mask; m->targets[k];
+			    k = (k + 1) & m->target_mask)
+				;
+			m->targets[k] = rp + i - m->rports.rports + 1;
+		}
+	}
+
+	return 0;
+}
+
+/* One LUN per scsi_device of a known target */
+static int lun_map_devices(struct fc_lun_map *m)
+{
+	struct fc_rport_info	*rp;
+	struct fc_lun_info	*lun, *tmp;
+	struct dirent		*entry;
+	char			path[80], buf[32];
+	DIR			*dir;
+	int			h, c, t, l, alloc = 0, fd;
+	u32			i;
+
+	fd = open(SYSFS_SCSI_DEV_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return -ENODEV;
+
+	dir = fdopendir(fd);
+	if (!dir) {
+		close(fd);
+		return -ENODEV;
+	}
+
+	for_each_dir(entry, dir) {
+		if (sscanf(entry->d_name, "%d:%d:%d:%d", &h, &c, &t, &l) != 4)
+			continue;
+
+		rp = lun_map_target(m, h, c, t);
+		if (!rp)
+			continue;
+
+		if (m->nr_luns == alloc) {
+			alloc = alloc ? alloc * 2 : 64;
+			tmp = realloc(m->luns, alloc * sizeof(*tmp));
+			if (!tmp)
+				break;
+			m->luns = tmp;
+		}
+
+		lun = m->luns + m->nr_luns++;
+		memset(lun, 0, sizeof(*lun));
+		lun->rport_name = rp->rport_name;
+		lun->port_name = rp->port_name;
+		lun->host = h;
+		lun->channel = c;
+		lun->target = t;
+		lun->lun = l;
+
+		snprintf(path, sizeof(path), "%.40s/device/state",
+		    entry->d_name);
+		if (sysfs_read_at(dirfd(dir), path, buf, sizeof(buf)) > 0)
+			lun->state = strdup(buf);
+	}
+	closedir(dir);
+
+	m->lun_mask = index_size(m->nr_luns) - 1;
+	m->hctls = calloc(m->lun_mask + 1, sizeof(*m->hctls));
+	m->names = calloc(m->lun_mask + 1, sizeof(*m->names));
+	if (!m->hctls || !m->names)
+		return -ENOMEM;
+
+	for (l = 0; l < m->nr_luns; l++) {
+		lun = m->luns + l;
+		i = hctl_hash(lun->host, lun->channel, lun->target, lun->lun);
+		for (i &= m->lun_mask; m->hctls[i]; i = (i + 1) & m->lun_mask)
+			;
+		m->hctls[i] = l + 1;
+	}
+
+	return 0;
+}
+
+/*
+ * The class links of sd and sg devices point into the device tree of
+ * their SCSI device: ".../H:C:T:L/<marker>/<name>"
+ */
+static struct fc_lun_info *lun_map_link(struct fc_lun_map *m, int dfd,
+    const char *name, const char *marker)
+{
+	char	link[PATH_MAX];
+	char	*p;
+	ssize_t	len;
+	int	h, c, t, l;
+
+	len = readlinkat(dfd, name, link, sizeof(link) - 1);
+	if (len <= 0)
+		return NULL;
+	link[len] = '\0';
+
+	p = strstr(link, marker);
+	if (!p)
+		return NULL;
+	*p = '\0';
+
+	p = strrchr(link, '/');
+	if (!p || sscanf(p + 1, "%d:%d:%d:%d", &h, &c, &t, &l) != 4)
+		return NULL;
+
+	return lun_map_hctl(m, h, c, t, l);
+}
+
+static void lun_add_holder(struct fc_lun_info *lun, const char *dm)
+{
+	char	*tmp;
+	size_t	len;
+
+	len = lun->holders ? strlen(lun->holders) + 1 : 0;
+	tmp = realloc(lun->holders, len + strlen(dm) + 1);
+	if (!tmp)
+		return;
+
+	if (len)
+		tmp[len - 1] = ',';
+	strcpy(tmp + len, dm);
+	lun->holders = tmp;
+}
+
+/* Name sd disks and their device-mapper holders from /sys/block */
+static int lun_map_disks(struct fc_lun_map *m)
+{
+	struct fc_lun_info	*lun;
+	struct dirent		*entry, *slave;
+	char			path[64];
+	char			(*pairs)[2][32] = NULL, (*tmp)[2][32];
+	DIR			*dir, *sdir;
+	int			nr_pairs = 0, alloc = 0, fd, sfd, i;
+	u32			k;
+
+	fd = open(SYSFS_BLOCK_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return -ENODEV;
+
+	dir = fdopendir(fd);
+	if (!dir) {
+		close(fd);
+		return -ENODEV;
+	}
+
+	for_each_dir(entry, dir) {
+		if (!strncmp(entry->d_name, "sd", 2)) {
+			lun = lun_map_link(m, fd, entry->d_name, "/block/");
+			if (lun && !lun->disk_name)
+				lun->disk_name = strdup(entry->d_name);
+			continue;
+		}
+
+		if (strncmp(entry->d_name, "dm-", 3))
+			continue;
+
+		/* Slaves are matched once every sd disk has a name */
+		snprintf(path, sizeof(path), "%.32s/slaves", entry->d_name);
+		sfd = openat(fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (sfd < 0)
+			continue;
+		sdir = fdopendir(sfd);
+		if (!sdir) {
+			close(sfd);
+			continue;
+		}
+
+		for_each_dir(slave, sdir) {
+			if (strncmp(slave->d_name, "sd", 2))
+				continue;
+
+			if (nr_pairs == alloc) {
+				alloc = alloc ? alloc * 2 : 64;
+				tmp = realloc(pairs, alloc * sizeof(*pairs));
+				if (!tmp)
+					break;
+				pairs = tmp;
+			}
+			snprintf(pairs[nr_pairs][0], sizeof(pairs[0][0]),
+			    "%.31s", entry->d_name);
+			snprintf(pairs[nr_pairs][1], sizeof(pairs[0][1]),
+			    "%.31s", slave->d_name);
+			nr_pairs++;
+		}
+		closedir(sdir);
+	}
+	closedir(dir);
+
+	for (i = 0; i < m->nr_luns; i++) {
+		if (!m->luns[i].disk_name)
+			continue;
+
+		k = name_hash(m->luns[i].disk_name);
+		for (k &= m->lun_mask; m->names[k]; k = (k + 1) & m->lun_mask)
+			;
+		m->names[k] = i + 1;
+	}
+
+	for (i = 0; i < nr_pairs; i++) {
+		lun = lun_map_name(m, pairs[i][1]);
+		if (lun)
+			lun_add_holder(lun, pairs[i][0]);
+	}
+	free(pairs);
+
+	return 0;
+}
+
+static void lun_map_generic(struct fc_lun_map *m)
+{
+	struct fc_lun_info	*lun;
+	struct dirent		*entry;
+	DIR			*dir;
+	int			fd;
+
+	fd = open(SYSFS_SCSI_GEN_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	dir = fdopendir(fd);
+	if (!dir) {
+		close(fd);
+		return;
+	}
+
+	for_each_dir(entry, dir) {
+		lun = lun_map_link(m, fd, entry->d_name, "/scsi_generic/");
+		if (lun && !lun->sg_name)
+			lun->sg_name = strdup(entry->d_name);
+	}
+	closedir(dir);
+}
+
+static void lun_map_free(struct fc_lun_map *m)
+{
+	int i;
+
+	for (i = 0; i < m->nr_luns; i++) {
+		free(m->luns[i].state);
+		free(m->luns[i].disk_name);
+		free(m->luns[i].sg_name);
+		free(m->luns[i].holders);
+	}
+	free(m->luns);
+	free(m->hctls);
+	free(m->names);
+	free(m->targets);
+	fc_rport_index_free(&m->rports);
+}
+
+static int lun_cmp(const void *a, const void *b)
+{
+	const struct fc_lun_info *x = a, *y = b;
+
+	if (x->host != y->host)
+		return x->host < y->host ? -1 : 1;
+	if (x->channel != y->channel)
+		return x->channel < y->channel ? -1 : 1;
+	if (x->target != y->target)
+		return x->target < y->target ? -1 : 1;
+	if (x->lun != y->lun)
+		return x->lun < y->lun ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * list_fc_luns() will print every LUN reached through the FC remote
+ * ports of host 'host_no', or of all hosts if it is -1, together with the
+ * target WWPN and the sd, sg and device-mapper devices on top of it
+ */
+int list_fc_luns(int host_no)
+{
+	struct fc_lun_map	m;
+	int			i, err;
+
+	print_trace_enter();
+
+	memset(&m, 0, sizeof(m));
+	err = fc_rport_index_build(&m.rports);
+	if (err) {
+		print_err("No FC remote ports found");
+		return err;
+	}
+
+	err = lun_map_rports(&m, host_no);
+	if (!err)
+		err = lun_map_devices(&m);
+	if (!err)
+		err = lun_map_disks(&m);
+	if (err) {
+		print_err("Can not map FC LUNs (%s)", strerror(-err));
+		goto out;
+	}
+	lun_map_generic(&m);
+
+	/* The hash indexes are not used past this point */
+	qsort(m.luns, m.nr_luns, sizeof(*m.luns), lun_cmp);
+
+	print_fc_lun_header();
+	for (i = 0; i < m.nr_luns; i++)
+		print_fc_lun_info(m.luns + i);
+
+out:
+	lun_map_free(&m);
+
+	return err;
+}
@@ -0,0 +1,874 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <time.h>
+
+#include "scsi.h"
+#include "scsi_fcp.h"
+#include "scsi_print.h"
+
+#define FC_WORD_SIZE		4
+#define MB			(1024.0 * 1024.0)
+
+#define FC_RATE(_title, _name, _scale)					\
+	{ _title, #_name, offsetof(struct fc_host_statistics, _name), _scale }
+
+static const struct fc_rate fc_rates[] = {
+	FC_RATE("TXfr", tx_frames, 1),
+	FC_RATE("RXfr", rx_frames, 1),
+	FC_RATE("TXMB", tx_words, FC_WORD_SIZE / MB),
+	FC_RATE("RXMB", rx_words, FC_WORD_SIZE / MB),
+	FC_RATE("InIO", fcp_input_requests, 1),
+	FC_RATE("OutIO", fcp_output_requests, 1),
+	FC_RATE("InMB", fcp_input_megabytes, 1),
+	FC_RATE("OutMB", fcp_output_megabytes, 1),
+	FC_RATE("ErrFr", error_frames, 1),
+	FC_RATE("CRC", invalid_crc_count, 1),
+	FC_RATE("LinkF", link_failure_count, 1),
+	FC_RATE("LSync", loss_of_sync_count, 1),
+	FC_RATE("LSig", loss_of_signal_count, 1),
+	FC_RATE("FpinLI", fpin_li, 1),
+	FC_RATE("FpinCN", fpin_cn, 1),
+	FC_RATE("FpinDN", fpin_dn, 1),
+	FC_RATE("CnWarn", cn_sig_warn, 1),
+	FC_RATE("CnAlrm", cn_sig_alarm, 1),
+};
+
+const struct fc_rate_table fc_rate_table = { fc_rates, NUM_ENTRIES(fc_rates) };
+
+/* Counters of /sys/class/fc_remote_ports/rport-H:B-N/statistics */
+static const struct fc_rate fc_rport_rates[] = {
+	FC_RATE("FpinCN", fpin_cn, 1),
+	FC_RATE("CrStall", fpin_cn_credit_stall, 1),
+	FC_RATE("LostCr", fpin_cn_lost_credit, 1),
+	FC_RATE("OverSub", fpin_cn_oversubscription, 1),
+	FC_RATE("FpinLI", fpin_li, 1),
+	FC_RATE("LICRC", fpin_li_invalid_crc_count, 1),
+	FC_RATE("LILinkF", fpin_li_link_failure_count, 1),
+	FC_RATE("FpinDN", fpin_dn, 1),
+	FC_RATE("DNTmo", fpin_dn_timeout, 1),
+};
+
+/* Positions in fc_rport_rates used to rank congested rports */
+#define FC_RPORT_RANK_CN	0
+#define FC_RPORT_RANK_LI	4
+#define FC_RPORT_RANK_DN	7
+
+const struct fc_rate_table fc_rport_rate_table = {
+	fc_rport_rates, NUM_ENTRIES(fc_rport_rates)
+};
+
+static const struct fc_rate_col fc_host_cols[] = {
+	{ "Host",	"host",		10 },
+};
+
+#define fc_stat(_stats, _rate)						\
+	(*(u64 *)((char *)(_stats) + (_rate)->offset))
+
+/**
+ * reset_fc_port_stats() will clear the statistics of an FC host
+ */
+int reset_fc_port_stats(char *host_name)
+{
+	char	path[256];
+	int	fd, err = 0;
+
+	print_trace_enter();
+
+	snprintf(path, sizeof(path), "%s/%s/statistics/reset_statistics",
+	    SYSFS_FC_HOST_PATH, host_name);
+
+	fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0 || write(fd, "1", 1) != 1)
+		err = -errno;
+	if (fd >= 0)
+		close(fd);
+
+	if (err)
+		print_err("Can not reset statistics of %s (%s)", host_name,
+		    strerror(-err));
+	else
+		print_info(" Statistics of %s reset\n", host_name);
+
+	return err;
+}
+
+static void fc_port_sampler_close(struct fc_port_sample *fs)
+{
+	int i;
+
+	if (fs->fds) {
+		for (i = 0; i < fs->table->nr_rates; i++) {
+			if (fs->fds[i] >= 0)
+				close(fs->fds[i]);
+		}
+	}
+
+	free(fs->fds);
+	free(fs->rates);
+	fs->fds = NULL;
+	fs->rates = NULL;
+}
+
+/*
+ * Open the counters of 'table' below the "statistics" directory of the
+ * sysfs device 'dfd'. A missing counter keeps a negative errno in place
+ * of its fd and is reported as unsupported.
+ */
+static int fc_stats_open(struct fc_port_sample *fs, int dfd,
+    const struct fc_rate_table *table)
+{
+	int	sfd, i;
+
+	fs->table = table;
+	fs->fds = NULL;
+	fs->rates = NULL;
+	memset(fs->stats, 0, sizeof(fs->stats));
+
+	sfd = openat(dfd, "statistics", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (sfd < 0)
+		return -ENODEV;
+
+	fs->fds = malloc(table->nr_rates * sizeof(*fs->fds));
+	fs->rates = malloc(table->nr_rates * sizeof(*fs->rates));
+	if (!fs->fds || !fs->rates) {
+		close(sfd);
+		free(fs->fds);
+		free(fs->rates);
+		fs->fds = NULL;
+		fs->rates = NULL;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < table->nr_rates; i++) {
+		fs->fds[i] = openat(sfd, table->rates[i].key,
+		    O_RDONLY | O_CLOEXEC);
+		if (fs->fds[i] < 0)
+			fs->fds[i] = -errno;
+	}
+	close(sfd);
+
+	return 0;
+}
+
+/*
+ * Set up the sample of 'host_name', opening its counters only when they
+ * are going to be re-read, 'open_stats' being zero for a one-shot print.
+ */
+static int fc_port_sampler_open(struct fc_port_sample *fs, char *host_name,
+    int open_stats)
+{
+	char	path[256];
+	int	dfd, err;
+
+	memset(fs, 0, sizeof(*fs));
+	snprintf(fs->name, sizeof(fs->name), "%.*s",
+	    (int)sizeof(fs->name) - 1, host_name);
+
+	snprintf(path, sizeof(path), "%s/%s", SYSFS_FC_HOST_PATH, host_name);
+	dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return -ENODEV;
+
+	err = open_stats ? fc_stats_open(fs, dfd, &fc_rate_table) : 0;
+	close(dfd);
+
+	return err;
+}
+
+/*
+ * Counters are printed by the transport class as "0x%llx", anything we
+ * can not parse is taken as unsupported.
+ */
+static u64 fc_parse_stat(const char *p)
+{
+	u64	v = 0;
+	int	c, n = 0;
+
+	if (p[0] != '0' || (p[1] != 'x' && p[1] != 'X'))
+		return FC_STAT_UNSUPPORTED;
+
+	for (p += 2; (c = *p) && n < 16; p++, n++) {
+		if (c >= '0' && c <= '9')
+			c -= '0';
+		else if (c >= 'a' && c <= 'f')
+			c -= 'a' - 10;
+		else if (c >= 'A' && c <= 'F')
+			c -= 'A' - 10;
+		else
+			break;
+		v = v << 4 | c;
+	}
+
+	return n ? v : FC_STAT_UNSUPPORTED;
+}
+
+static void fc_port_sample(struct fc_port_sample *fs, int slot)
+{
+	const struct fc_rate	*r;
+	char			buf[32];
+	ssize_t			ret;
+	int			i;
+
+	for (i = 0; i < fs->table->nr_rates; i++) {
+		r = fs->table->rates + i;
+
+		ret = fs->fds[i] < 0 ? -1 :
+		    pread(fs->fds[i], buf, sizeof(buf) - 1, 0);
+		if (ret <= 0) {
+			fc_stat(&fs->stats[slot], r) = FC_STAT_UNSUPPORTED;
+			continue;
+		}
+		buf[ret] = '\0';
+		fc_stat(&fs->stats[slot], r) = fc_parse_stat(buf);
+	}
+}
+
+static void fc_port_rates(struct fc_port_sample *fs, int cur, u64 ms)
+{
+	const struct fc_rate	*r;
+	double			secs = ms ? ms / 1000.0 : 1;
+	u64			old, new;
+	int			i;
+
+	for (i = 0; i < fs->table->nr_rates; i++) {
+		r = fs->table->rates + i;
+		old = fc_stat(&fs->stats[cur ^ 1], r);
+		new = fc_stat(&fs->stats[cur], r);
+
+		/* unsupported, or reset behind our back */
+		if (old == FC_STAT_UNSUPPORTED || new == FC_STAT_UNSUPPORTED ||
+		    new < old)
+			fs->rates[i] = NAN;
+		else
+			fs->rates[i] = (new - old) * r->scale / secs;
+	}
+}
+
+/* Use the raw counters of 'slot' in place of rates */
+static void fc_port_totals(struct fc_port_sample *fs, int slot)
+{
+	const struct fc_rate	*r;
+	u64			v;
+	int			i;
+
+	for (i = 0; i < fs->table->nr_rates; i++) {
+		r = fs->table->rates + i;
+		v = fc_stat(&fs->stats[slot], r);
+		fs->rates[i] = v == FC_STAT_UNSUPPORTED ? NAN : v * r->scale;
+	}
+}
+
+/* Fill 'hosts' with the names of all FC hosts, or just 'host_name' */
+static int fc_port_hosts(char *host_name, struct fc_port_sample **hosts,
+    int open_stats)
+{
+	struct fc_port_sample	*fs = NULL, *tmp;
+	struct dirent		*entry;
+	DIR			*dir;
+	int			nr = 0, err;
+
+	if (strcmp(host_name, "all")) {
+		fs = calloc(1, sizeof(*fs));
+		if (!fs)
+			return -ENOMEM;
+
+		err = fc_port_sampler_open(fs, host_name, open_stats);
+		if (err) {
+			free(fs);
+			return err;
+		}
+
+		*hosts = fs;
+		return 1;
+	}
+
+	dir = opendir(SYSFS_FC_HOST_PATH);
+	if (!dir)
+		return -ENODEV;
+
+	for_each_dir(entry, dir) {
+		tmp = realloc(fs, (nr + 1) * sizeof(*fs));
+		if (!tmp)
+			break;
+		fs = tmp;
+
+		if (!fc_port_sampler_open(fs + nr, entry->d_name, open_stats))
+			nr++;
+	}
+	closedir(dir);
+
+	*hosts = fs;
+
+	return nr ? nr : -ENODEV;
+}
+
+/**
+ * watch_fc_port_stats() will print the statistics of one or all FC hosts
+ * once, or their per second rates every 'interval_ms' milliseconds. When
+ * sampling, the counter files are opened once and re-read with pread() on
+ * every tick, a single print reads them the plain way.
+ */
+int watch_fc_port_stats(char *host_name, unsigned int interval_ms,
+    unsigned int count)
+{
+	struct fc_port_sample	*hosts = NULL;
+	struct fc_device_info	*fc_dev;
+	const char		*names[1];
+	unsigned int		n;
+	u64			t[2];
+	int			nr, i, tfd = -1, cur = 0, err = 0;
+
+	print_trace_enter();
+
+	nr = fc_port_hosts(host_name, &hosts, interval_ms != 0);
+	if (nr < 0) {
+		print_err("No FC host found for '%s'", host_name);
+		free(hosts);
+		return nr;
+	}
+
+	if (cmd_opt_isset("reset")) {
+		for (i = 0; i < nr; i++)
+			reset_fc_port_stats(hosts[i].name);
+	}
+
+	if (!interval_ms) {
+		for (i = 0; i < nr; i++) {
+			fc_dev = alloc_fc_dev();
+			if (!fc_dev) {
+				err = -ENOMEM;
+				break;
+			}
+
+			get_fc_dev_stats(hosts[i].name, fc_dev);
+			print_fc_port_stats(fc_dev);
+			put_fc_dev(fc_dev);
+		}
+		goto out;
+	}
+
+	tfd = interval_timer_start(interval_ms);
+	if (tfd < 0) {
+		err = tfd;
+		goto out;
+	}
+
+	for (i = 0; i < nr; i++)
+		fc_port_sample(hosts + i, cur);
+	t[cur] = now_ms();
+
+	for (n = 0; !count || n < count; n++) {
+		err = interval_timer_wait(tfd);
+		if (err < 0)
+			break;
+		err = 0;
+
+		cur ^= 1;
+		for (i = 0; i < nr; i++)
+			fc_port_sample(hosts + i, cur);
+		t[cur] = now_ms();
+
+		print_fc_rates_header(&fc_rate_table, "fc_port_rates",
+		    fc_host_cols, NUM_ENTRIES(fc_host_cols), 0);
+		for (i = 0; i < nr; i++) {
+			fc_port_rates(hosts + i, cur, t[cur] - t[cur ^ 1]);
+			names[0] = hosts[i].name;
+			print_fc_rates(&fc_rate_table, fc_host_cols,
+			    NUM_ENTRIES(fc_host_cols), names, hosts[i].rates, 0);
+		}
+		out_flush();
+	}
+
+out:
+	if (tfd >= 0)
+		close(tfd);
+	for (i = 0; i < nr; i++)
+		fc_port_sampler_close(hosts + i);
+	free(hosts);
+
+	return err;
+}
+
+/*
+ * Remote port statistics
+ *
+ * A host may log in to hundreds of remote ports, each with a statistics
+ * directory of its own. Every counter file is opened once, and the
+ * preads of one tick are spread over the threads of parallel_for_each().
+ */
+#define FC_RPORT_DEF_LINES	20
+
+struct fc_rport_set {
+	struct fc_rport_sample	*rports;
+	int			nr;
+	int			class_fd;	/* SYSFS_FC_RPRT_PATH */
+	int			slot;		/* sample being taken */
+	struct fc_rate_group	*hosts;
+	int			nr_hosts;
+	struct fc_rate_group	*targets;
+	int			nr_targets;
+};
+
+/* The set the rport workers run on */
+static struct fc_rport_set *fc_rport_active;
+
+static const struct fc_rate_col fc_rport_cols[] = {
+	{ "Rport",	"rport",	16 },
+	{ "Host",	"host",		8 },
+	{ "Target",	"target",	18 },
+};
+
+static const struct fc_rate_col fc_rport_host_cols[] = {
+	{ "Host",	"host",		8 },
+};
+
+static const struct fc_rate_col fc_rport_target_cols[] = {
+	{ "Target",	"target",	18 },
+};
+
+static void fc_rport_open(void *arg)
+{
+	struct fc_rport_sample	*rs = arg;
+	int			dfd;
+
+	dfd = openat(fc_rport_active->class_fd, rs->port.name,
+	    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0) {
+		snprintf(rs->port_name, sizeof(rs->port_name), "unknown");
+		rs->port.table = &fc_rport_rate_table;
+		return;
+	}
+
+	if (sysfs_read_at(dfd, "port_name", rs->port_name,
+	    sizeof(rs->port_name)) <= 0)
+		snprintf(rs->port_name, sizeof(rs->port_name), "unknown");
+
+	fc_stats_open(&rs->port, dfd, &fc_rport_rate_table);
+	close(dfd);
+}
+
+static void fc_rport_sample(void *arg)
+{
+	struct fc_rport_sample *rs = arg;
+
+	if (rs->port.fds)
+		fc_port_sample(&rs->port, fc_rport_active->slot);
+}
+
+/*
+ * Pick the rports of 'filter': "all", every rport of "hostN", or a
+ * single "rport-H:B-N". The owning host is part of the rport name.
+ */
+static int fc_rport_find(struct fc_rport_set *set, const char *filter)
+{
+	struct fc_rport_sample	*tmp;
+	struct dirent		*entry;
+	char			prefix[32];
+	const char		*p;
+	DIR			*dir;
+	int			alloc = 0, fd;
+
+	prefix[0] = '\0';
+	if (!strncmp(filter, "host", 4))
+		snprintf(prefix, sizeof(prefix), "rport-%s:", filter + 4);
+
+	fd = open(SYSFS_FC_RPRT_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return -ENODEV;
+
+	dir = fdopendir(dup(fd));
+	if (!dir) {
+		close(fd);
+		return -ENODEV;
+	}
+	set->class_fd = fd;
+
+	for_each_dir(entry, dir) {
+		if (strncmp(entry->d_name, "rport-", 6))
+			continue;
+		if (prefix[0] && strncmp(entry->d_name, prefix, strlen(prefix)))
+			continue;
+		if (!prefix[0] && strcmp(filter, "all") &&
+		    strcmp(filter, entry->d_name))
+			continue;
+
+		if (set->nr == alloc) {
+			alloc = alloc ? alloc * 2 : 64;
+			tmp = realloc(set->rports, alloc * sizeof(*tmp));
+			if (!tmp)
+				break;
+			set->rports = tmp;
+		}
+
+		tmp = set->rports + set->nr++;
+		memset(tmp, 0, sizeof(*tmp));
+		snprintf(tmp->port.name, sizeof(tmp->port.name), "%.*s",
+		    (int)sizeof(tmp->port.name) - 1, entry->d_name);
+		p = entry->d_name + 6;
+		snprintf(tmp->host_name, sizeof(tmp->host_name), "host%.*s",
+		    (int)strcspn(p, ":"), p);
+	}
+	closedir(dir);
+
+	return set->nr ? 0 : -ENODEV;
+}
+
+/* hostN sorts by N: shorter names first, then by digits */
+static int fc_rport_cmp_host(const void *a, const void *b)
+{
+	const struct fc_rport_sample *x = *(struct fc_rport_sample **)a;
+	const struct fc_rport_sample *y = *(struct fc_rport_sample **)b;
+	size_t lx = strlen(x->host_name), ly = strlen(y->host_name);
+
+	if (lx != ly)
+		return lx < ly ? -1 : 1;
+	return strcmp(x->host_name, y->host_name);
+}
+
+static int fc_rport_cmp_target(const void *a, const void *b)
+{
+	const struct fc_rport_sample *x = *(struct fc_rport_sample **)a;
+	const struct fc_rport_sample *y = *(struct fc_rport_sample **)b;
+
+	return strcmp(x->port_name, y->port_name);
+}
+
+/*
+ * Number the distinct hosts, or target WWPNs, of the set once: a sort
+ * brings the members of a group together, so each tick only has to add
+ * the rates of an rport to the group its index points at.
+ */
+static int fc_rport_group(struct fc_rport_set *set, int by_target,
+    struct fc_rate_group **groups)
+{
+	struct fc_rport_sample	**order;
+	struct fc_rate_group	*g = NULL;
+	const char		*name, *prev = NULL;
+	int			i, nr = 0;
+
+	*groups = NULL;
+	order = malloc(set->nr * sizeof(*order));
+	if (!order)
+		return -ENOMEM;
+	*groups = calloc(set->nr, sizeof(**groups));
+	if (!*groups) {
+		free(order);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < set->nr; i++)
+		order[i] = set->rports + i;
+	qsort(order, set->nr, sizeof(*order),
+	    by_target ? fc_rport_cmp_target : fc_rport_cmp_host);
+
+	for (i = 0; i < set->nr; i++) {
+		name = by_target ? order[i]->port_name : order[i]->host_name;
+		if (!prev || strcmp(prev, name)) {
+			g = *groups + nr++;
+			g->name = name;
+			g->rates = malloc(fc_rport_rate_table.nr_rates *
+			    sizeof(*g->rates));
+			if (!g->rates) {
+				while (nr--)
+					free((*groups)[nr].rates);
+				free(*groups);
+				*groups = NULL;
+				free(order);
+				return -ENOMEM;
+			}
+			prev = name;
+		}
+		g->nr_rports++;
+		if (by_target)
+			order[i]->target = nr - 1;
+		else
+			order[i]->host = nr - 1;
+	}
+	free(order);
+
+	return nr;
+}
+
+static void fc_rport_sum(struct fc_rate_group *groups, int nr_groups,
+    struct fc_rport_sample *rports, int nr, int by_target)
+{
+	struct fc_rate_group	*g;
+	double			v;
+	int			i, j;
+
+	for (i = 0; i < nr_groups; i++) {
+		for (j = 0; j < fc_rport_rate_table.nr_rates; j++)
+			groups[i].rates[j] = NAN;
+	}
+
+	/* A group total is unsupported only if no member supports it */
+	for (i = 0; i < nr; i++) {
+		if (!rports[i].port.rates)
+			continue;
+		g = groups + (by_target ? rports[i].target : rports[i].host);
+		for (j = 0; j < fc_rport_rate_table.nr_rates; j++) {
+			v = rports[i].port.rates[j];
+			if (isnan(v))
+				continue;
+			g->rates[j] = isnan(g->rates[j]) ? v : g->rates[j] + v;
+		}
+	}
+}
+
+static double fc_rport_rank_val(const struct fc_rport_sample *rs, int idx)
+{
+	double v = rs->port.rates ? rs->port.rates[idx] : NAN;
+
+	return isnan(v) ? -1 : v;
+}
+
+/* Most congestion notifications first, then link integrity, delivery */
+static int fc_rport_cmp_rank(const void *a, const void *b)
+{
+	const struct fc_rport_sample *x = *(struct fc_rport_sample **)a;
+	const struct fc_rport_sample *y = *(struct fc_rport_sample **)b;
+	static const int keys[] = {
+		FC_RPORT_RANK_CN, FC_RPORT_RANK_LI, FC_RPORT_RANK_DN
+	};
+	double vx, vy;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(keys); i++) {
+		vx = fc_rport_rank_val(x, keys[i]);
+		vy = fc_rport_rank_val(y, keys[i]);
+		if (vx != vy)
+			return vx > vy ? -1 : 1;
+	}
+
+	return strcmp(x->port.name, y->port.name);
+}
+
+static void fc_rport_print(struct fc_rport_set *set,
+    struct fc_rport_sample **rank, int lines, int totals)
+{
+	const struct fc_rate_table	*t = &fc_rport_rate_table;
+	const char			*names[3];
+	int				i;
+
+	qsort(rank, set->nr, sizeof(*rank), fc_rport_cmp_rank);
+	if (lines > set->nr)
+		lines = set->nr;
+
+	print_fc_rates_header(t, "fc_rports", fc_rport_cols,
+	    NUM_ENTRIES(fc_rport_cols), totals);
+	for (i = 0; i < lines; i++) {
+		if (!rank[i]->port.rates)
+			continue;
+		names[0] = rank[i]->port.name;
+		names[1] = rank[i]->host_name;
+		names[2] = rank[i]->port_name;
+		print_fc_rates(t, fc_rport_cols, NUM_ENTRIES(fc_rport_cols),
+		    names, rank[i]->port.rates, totals);
+	}
+
+	fc_rport_sum(set->hosts, set->nr_hosts, set->rports, set->nr, 0);
+	print_fc_rates_header(t, "fc_rport_hosts", fc_rport_host_cols,
+	    NUM_ENTRIES(fc_rport_host_cols), totals);
+	for (i = 0; i < set->nr_hosts; i++) {
+		names[0] = set->hosts[i].name;
+		print_fc_rates(t, fc_rport_host_cols,
+		    NUM_ENTRIES(fc_rport_host_cols), names, set->hosts[i].rates,
+		    totals);
+	}
+
+	fc_rport_sum(set->targets, set->nr_targets, set->rports, set->nr, 1);
+	print_fc_rates_header(t, "fc_rport_targets", fc_rport_target_cols,
+	    NUM_ENTRIES(fc_rport_target_cols), totals);
+	for (i = 0; i < set->nr_targets; i++) {
+		names[0] = set->targets[i].name;
+		print_fc_rates(t, fc_rport_target_cols,
+		    NUM_ENTRIES(fc_rport_target_cols), names,
+		    set->targets[i].rates, totals);
+	}
+	out_flush();
+}
+
+static void fc_rport_set_free(struct fc_rport_set *set)
+{
+	int i;
+
+	for (i = 0; i < set->nr; i++) {
+		if (set->rports[i].port.fds)
+			fc_port_sampler_close(&set->rports[i].port);
+	}
+	for (i = 0; i < set->nr_hosts; i++)
+		free(set->hosts[i].rates);
+	for (i = 0; i < set->nr_targets; i++)
+		free(set->targets[i].rates);
+	free(set->hosts);
+	free(set->targets);
+	free(set->rports);
+	if (set->class_fd >= 0)
+		close(set->class_fd);
+}
+
+static int fc_rport_lines(int nr, unsigned int interval_ms)
+{
+	char	*val, *end;
+	long	v;
+
+	val = cmd_opt_value("lines");
+	if (!val)
+		return interval_ms ? FC_RPORT_DEF_LINES : nr;
+
+	v = strtol(val, &end, 0);
+	if (*end || v <= 0 || v > INT_MAX) {
+		print_err("Invalid number of lines '%s'", val);
+		return -EINVAL;
+	}
+
+	return v;
+}
+
+/**
+ * watch_fc_rport_stats() will print the FPIN counters of the remote
+ * ports of 'filter' ("all", "hostN" or an rport name) once, or their per
+ * second rates every 'interval_ms' milliseconds. Remote ports are ranked
+ * by congestion, and totals per host and per target WWPN follow.
+ */
+int watch_fc_rport_stats(char *filter, unsigned int interval_ms,
+    unsigned int count)
+{
+	struct fc_rport_set	set = { .class_fd = -1 };
+	struct fc_rport_sample	**rank = NULL;
+	unsigned int		n;
+	u64			t[2];
+	int			i, j, lines, jobs, tfd = -1, err, emfile = 0;
+
+	print_trace_enter();
+
+	jobs = scan_jobs_opt(16);
+	if (jobs < 0)
+		return jobs;
+
+	err = fc_rport_find(&set, filter);
+	if (err) {
+		print_err("No FC remote port found for '%s'", filter);
+		goto out;
+	}
+
+	lines = fc_rport_lines(set.nr, interval_ms);
+	if (lines < 0) {
+		err = lines;
+		goto out;
+	}
+
+	/* Each rport keeps a file open per counter, make room for them */
+	raise_nofile_limit((unsigned long)set.nr *
+	    fc_rport_rate_table.nr_rates + 64);
+	fc_rport_active = &set;
+	parallel_for_each(set.rports, set.nr, sizeof(*set.rports),
+	    fc_rport_open, jobs);
+
+	for (i = 0; i < set.nr; i++) {
+		for (j = 0; set.rports[i].port.fds &&
+		    j < fc_rport_rate_table.nr_rates; j++)
+			emfile |= set.rports[i].port.fds[j] == -EMFILE;
+	}
+	if (emfile)
+		print_err("Too many open files, some counters are not shown");
+
+	rank = malloc(set.nr * sizeof(*rank));
+	if (!rank) {
+		err = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < set.nr; i++)
+		rank[i] = set.rports + i;
+
+	set.nr_hosts = fc_rport_group(&set, 0, &set.hosts);
+	set.nr_targets = fc_rport_group(&set, 1, &set.targets);
+	if (set.nr_hosts < 0 || set.nr_targets < 0) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	set.slot = 0;
+	parallel_for_each(set.rports, set.nr, sizeof(*set.rports),
+	    fc_rport_sample, jobs);
+	t[0] = now_ms();
+
+	if (!interval_ms) {
+		for (i = 0; i < set.nr; i++) {
+			if (set.rports[i].port.rates)
+				fc_port_totals(&set.rports[i].port, 0);
+		}
+		fc_rport_print(&set, rank, lines, 1);
+		goto out;
+	}
+
+	tfd = interval_timer_start(interval_ms);
+	if (tfd < 0) {
+		err = tfd;
+		goto out;
+	}
+
+	for (n = 0; !count || n < count; n++) {
+		err = interval_timer_wait(tfd);
+		if (err < 0)
+			break;
+		err = 0;
+
+		set.slot ^= 1;
+		parallel_for_each(set.rports, set.nr, sizeof(*set.rports),
+		    fc_rport_sample, jobs);
+		t[set.slot] = now_ms();
+
+		for (i = 0; i < set.nr; i++) {
+			if (set.rports[i].port.rates)
+				fc_port_rates(&set.rports[i].port, set.slot,
+				    t[set.slot] - t[set.slot ^ 1]);
+		}
+		fc_rport_print(&set, rank, lines, 0);
+	}
+
+out:
+	if (tfd >= 0)
+		close(tfd);
+	free(rank);
+	fc_rport_set_free(&set);
+
+	return err;
+}
@@ -113,95 +113,255 @@ void get_driver_info(struct fc_device_info *fc_dev_p)
 		free(pci_driver_path);
 }
 
-void get_rport_info(struct fc_rport_info *fc_rprt)
+/* Read one rport attribute, NULL if the kernel does not provide it */
+static char *rport_attr(int dfd, const char *attr)
 {
-	char	temp_path[256];
-	char	temp_val[32];
-	char 	rport_path[64];
+	char buf[64];
+
+	if (sysfs_read_at(dfd, attr, buf, sizeof(buf)) < 0)
+		return NULL;
+
+	return strdup(buf);
+}
+
+/**
+ * get_rport_info() will fill the attributes of one remote port, read
+ * relative to the open /sys/class/fc_remote_ports directory 'class_fd'
+ */
+int get_rport_info(int class_fd, struct fc_rport_info *fc_rprt)
+{
+	char	buf[32];
+	int	dfd;
 
 	print_trace_enter();
 
-	snprintf(rport_path, sizeof(rport_path) ,"%s/%s", SYSFS_FC_RPRT_PATH,
-	    fc_rprt->rport_name);
+	dfd = openat(class_fd, fc_rprt->rport_name,
+	    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return -errno;
 
-	print_debug("Rport Path: %s Rport Name: %s len %ld\n",
-	    rport_path, fc_rprt->rport_name, strlen(rport_path));
+	fc_rprt->node_name = rport_attr(dfd, "node_name");
+	fc_rprt->port_name = rport_attr(dfd, "port_name");
+	fc_rprt->port_id = rport_attr(dfd, "port_id");
+	fc_rprt->roles = rport_attr(dfd, "roles");
+	fc_rprt->port_state = rport_attr(dfd, "port_state");
+	fc_rprt->fast_io_fail_tmo = rport_attr(dfd, "fast_io_fail_tmo");
 
-	/* Extract Node Name */
-	memset(temp_path, 0, sizeof(temp_path));
-	snprintf(temp_path, sizeof(temp_path), "%s/node_name", rport_path);
-	snprintf(temp_val, sizeof(temp_val), open_sysfs_stats_file(temp_path));
-	fc_rprt->node_name = strdup(temp_val);
+	fc_rprt->dev_loss_tmo = -1;
+	if (sysfs_read_at(dfd, "dev_loss_tmo", buf, sizeof(buf)) > 0)
+		fc_rprt->dev_loss_tmo = atoi(buf);
 
-	/*  Extract Port ID */
-	memset(temp_path, 0, sizeof(temp_path));
-	snprintf(temp_path, sizeof(temp_path), "%s/port_id", rport_path);
-	snprintf(temp_val, sizeof(temp_val), open_sysfs_stats_file(temp_path));
-	fc_rprt->port_id = strdup(temp_val);
+	fc_rprt->target_id = -1;
+	if (sysfs_read_at(dfd, "scsi_target_id", buf, sizeof(buf)) > 0)
+		fc_rprt->target_id = atoi(buf);
 
-	/* Extract Port Name */
-	memset(temp_path, 0, sizeof(temp_path));
-	snprintf(temp_path, sizeof(temp_path), "%s/port_name", rport_path);
-	snprintf(temp_val, sizeof(temp_val), open_sysfs_stats_file(temp_path));
-	fc_rprt->port_name = strdup(temp_val);
+	close(dfd);
 
-	/* Extract Port State */
-	memset(temp_path, 0, sizeof(temp_path));
-	snprintf(temp_path, sizeof(temp_path), "%s/port_state", rport_path);
-	snprintf(temp_val, sizeof(temp_val), open_sysfs_stats_file(temp_path));
-	fc_rprt->port_state = strdup(temp_val);
-
-	/* Extract Rport Roles */
-	memset(temp_path, 0, sizeof(temp_path));
-	snprintf(temp_path, sizeof(temp_path), "%s/roles", rport_path);
-	snprintf(temp_val, sizeof(temp_val), open_sysfs_stats_file(temp_path));
-	fc_rprt->roles = strdup(temp_val);
+	return 0;
 }
 
-int list_rport_adapters(struct fc_device_info *fc_dev)
+static void put_rport_info(struct fc_rport_info *fc_rprt)
 {
-	struct fc_rport_info *fc_rprt;
-	struct dirent	*entry;
-	DIR		*dir;
-	char		rport_path[64];
-
-	print_trace_enter();
+	free(fc_rprt->rport_path);
+	free(fc_rprt->rport_name);
+	free(fc_rprt->node_name);
+	free(fc_rprt->port_name);
+	free(fc_rprt->port_id);
+	free(fc_rprt->roles);
+	free(fc_rprt->maxframe_size);
+	free(fc_rprt->supported_classes);
+	free(fc_rprt->fast_io_fail_tmo);
+	free(fc_rprt->port_state);
+}
 
-	if (!fc_dev) {
-		print_info("Unable to allocate memory");
-		return -EINVAL;
+/*
+ * The owning host is the last "hostN" component of the rport device
+ * link, e.g. ../../devices/pci0000:00/.../host3/rport-3:0-1/...; the
+ * rport name carries the same number should the link not be readable.
+ */
+static int rport_host_no(int class_fd, const char *name)
+{
+	char	link[PATH_MAX];
+	char	*p, *end;
+	ssize_t	len;
+	long	n;
+	int	host_no = -1;
+
+	len = readlinkat(class_fd, name, link, sizeof(link) - 1);
+	if (len > 0) {
+		link[len] = '\0';
+		for (p = link; (p = strstr(p, "/host")); p++) {
+			n = strtol(p + 5, &end, 10);
+			if (end != p + 5 && *end == '/' && n >= 0 && n < INT_MAX)
+				host_no = n;
+		}
 	}
 
-	snprintf(rport_path, sizeof(rport_path), "%s/device",
-	    fc_dev->sys_dev_path);
+	if (host_no < 0 && sscanf(name, "rport-%d:", &host_no) != 1)
+		host_no = -1;
 
-	dir = opendir(rport_path);
-	if (unlikely(!dir)) {
-		print_err("No Remote Ports found for this adapter");
-		fc_dev->no_rports = 0;
-		return 0;
-	}
+	return host_no;
+}
+
+/**
+ * fc_rport_index_build() will list /sys/class/fc_remote_ports once and
+ * bucket the remote ports by owning host: the rports of hostN end up
+ * next to each other in one array, found through host_start[N]. Only the
+ * device link of each rport is read here, their attributes are read when
+ * the rports of a host are first looked up.
+ */
+int fc_rport_index_build(struct fc_rport_index *idx)
+{
+	struct fc_rport_info	*all = NULL, *tmp;
+	struct dirent		*entry;
+	DIR			*dir;
+	int			*fill;
+	int			nr = 0, alloc = 0, max_host = -1, i, fd;
 
 	print_trace_enter();
 
-	print_fc_rport_header();
+	memset(idx, 0, sizeof(*idx));
+	idx->class_fd = -1;
 
-	for_each_dir(entry, dir) {
-		fc_rprt = malloc(sizeof(struct fc_rport_info));
-		if (strncmp(entry->d_name, "rport", 5) == 0) {
-			print_trace_enter();
+	fd = open(SYSFS_FC_RPRT_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return -ENODEV;
 
-			fc_rprt->rport_name = strdup(entry->d_name);
+	dir = fdopendir(dup(fd));
+	if (!dir) {
+		close(fd);
+		return -ENODEV;
+	}
 
-			get_rport_info(fc_rprt);
-			print_fc_rport_info(fc_rprt);
+	for_each_dir(entry, dir) {
+		if (strncmp(entry->d_name, "rport-", 6))
 			continue;
+
+		if (nr == alloc) {
+			alloc = alloc ? alloc * 2 : 64;
+			tmp = realloc(all, alloc * sizeof(*all));
+			if (!tmp)
+				break;
+			all = tmp;
 		}
-		if (fc_rprt)
-			free(fc_rprt);
+
+		tmp = all + nr;
+		memset(tmp, 0, sizeof(*tmp));
+		tmp->host_no = rport_host_no(fd, entry->d_name);
+		if (tmp->host_no < 0)
+			continue;
+		if (sscanf(entry->d_name, "rport-%*d:%d-", &tmp->channel) != 1)
+			tmp->channel = 0;
+		tmp->rport_name = strdup(entry->d_name);
+		if (!tmp->rport_name)
+			break;
+		if (tmp->host_no > max_host)
+			max_host = tmp->host_no;
+		nr++;
 	}
 	closedir(dir);
 
+	idx->class_fd = fd;
+	idx->nr_hosts = max_host + 1;
+	idx->host_start = calloc(idx->nr_hosts + 1, sizeof(int));
+	idx->host_read = calloc(idx->nr_hosts + 1, 1);
+	idx->rports = malloc((nr ? nr : 1) * sizeof(*idx->rports));
+	fill = calloc(idx->nr_hosts + 1, sizeof(int));
+	if (!idx->host_start || !idx->host_read || !idx->rports || !fill) {
+		for (i = 0; i < nr; i++)
+			free(all[i].rport_name);
+		free(all);
+		free(fill);
+		fc_rport_index_free(idx);
+		return -ENOMEM;
+	}
+
+	/* Counting sort by host number keeps this linear in the rports */
+	for (i = 0; i < nr; i++)
+		idx->host_start[all[i].host_no + 1]++;
+	for (i = 0; i < idx->nr_hosts; i++)
+		idx->host_start[i + 1] += idx->host_start[i];
+	for (i = 0; i < nr; i++) {
+		idx->rports[idx->host_start[all[i].host_no] +
+		    fill[all[i].host_no]++] = all[i];
+	}
+	idx->nr_rports = nr;
+
+	free(fill);
+	free(all);
+
+	return 0;
+}
+
+/**
+ * fc_rport_index_host() will return the rports of host 'host_no' and
+ * their number in 'nr', reading their attributes on first use
+ */
+struct fc_rport_info *fc_rport_index_host(struct fc_rport_index *idx,
+    int host_no, int *nr)
+{
+	struct fc_rport_info	*rp;
+	int			i;
+
+	print_trace_enter();
+
+	*nr = 0;
+	if (host_no < 0 || host_no >= idx->nr_hosts)
+		return NULL;
+
+	rp = idx->rports + idx->host_start[host_no];
+	*nr = idx->host_start[host_no + 1] - idx->host_start[host_no];
+
+	if (!idx->host_read[host_no]) {
+		for (i = 0; i < *nr; i++)
+			get_rport_info(idx->class_fd, rp + i);
+		idx->host_read[host_no] = 1;
+	}
+
+	return rp;
+}
+
+void fc_rport_index_free(struct fc_rport_index *idx)
+{
+	int i;
+
+	for (i = 0; idx->rports && i < idx->nr_rports; i++)
+		put_rport_info(idx->rports + i);
+	free(idx->rports);
+	free(idx->host_start);
+	free(idx->host_read);
+	if (idx->class_fd >= 0)
+		close(idx->class_fd);
+	memset(idx, 0, sizeof(*idx));
+	idx->class_fd = -1;
+}
+
+int list_rport_adapters(struct fc_device_info *fc_dev)
+{
+	struct fc_rport_index	idx;
+	struct fc_rport_info	*fc_rprt;
+	int			host_no, nr, i;
+
+	print_trace_enter();
+
+	if (!fc_dev || !fc_dev->host_name ||
+	    sscanf(fc_dev->host_name, "host%d", &host_no) != 1)
+		return -EINVAL;
+
+	if (fc_rport_index_build(&idx)) {
+		print_err("No Remote Ports found for this adapter");
+		fc_dev->no_rports = 0;
+		return 0;
+	}
+
+	fc_rprt = fc_rport_index_host(&idx, host_no, &nr);
+
+	print_fc_rport_header();
+	for (i = 0; i < nr; i++)
+		print_fc_rport_info(fc_rprt + i);
+
+	fc_rport_index_free(&idx);
+
 	return 0;
 }
 
@@ -498,9 +658,10 @@ int list_fc_adapters(struct fc_device_info *fc_dev)
 
 int get_fc_dev_stats(char *device_name, struct fc_device_info *fc_dev)
 {
-	char	scsi_path[256];
-	char	path[1024], sym_name[64] = { 0 };
-	char	*end;
+	const struct out_field	*f;
+	char	path[1024];
+	char	*val;
+	int	i;
 
 	print_trace_enter();
 
@@ -508,145 +669,20 @@ int get_fc_dev_stats(char *device_name, struct fc_device_info *fc_dev)
 
 	fc_dev->host_name = strdup(device_name);
 
-	snprintf(scsi_path, sizeof(scsi_path), "%s/%s/%s", SYSFS_FC_HOST_PATH,
-		device_name, "statistics");
-
-	/* /sys/class/fc_host/host0/statistics/lip_count */
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "lip_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.lip_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "tx_frames");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.tx_frames = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "tx_words");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.tx_words = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "rx_frames");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.rx_frames = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "rx_words");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.rx_words = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "cn_sig_alarm");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.cn_sig_alarm = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "cn_sig_warn");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.cn_sig_warn = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "error_frames");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.error_frames = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "dumped_frames");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.dumped_frames = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "invalid_crc_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.invalid_crc_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "invalid_tx_word_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.invalid_tx_word_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "link_failure_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.link_failure_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "loss_of_signal_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.loss_of_signal_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "loss_of_sync_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.loss_of_sync_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "nos_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.nos_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_cn");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_cn = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_cn_credit_stall");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_cn_credit_stall = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_cn_device_specific");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_cn_device_specific = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_cn_lost_credit");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_cn_lost_credit = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_cn_oversubscription");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_cn_oversubscription = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li_device_specific");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li_device_specific = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li_failure_unknown");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li_failure_unknown = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li_invalid_crc_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li_invalid_crc_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li_invalid_tx_word_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li_invalid_tx_word_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li_link_failure_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li_link_failure_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li_loss_of_signals_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li_loss_of_signals_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li_loss_of_sync_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li_loss_of_sync_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_li_prim_seq_err_count");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_li_prim_seq_err_count = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_dn");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_dn = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_dn_device_specific");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_dn_device_specific = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_dn_timeout");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_dn_timeout = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_dn_unable_to_route");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_dn_unable_to_route = strtol(sym_name, &end, 0);
-
-	snprintf(path, sizeof(path), "%s/%s", scsi_path, "fpin_dn_unknown");
-	snprintf(sym_name, sizeof(sym_name), open_sysfs_stats_file(path));
-	fc_dev->stats.fpin_dn_unknown = strtol(sym_name, &end, 0);
+	/*
+	 * Every counter lives in its own file named after the field, e.g.
+	 * /sys/class/fc_host/host0/statistics/lip_count, so walk the
+	 * statistics table instead of spelling each one out.
+	 */
+	for (i = 0; i < fc_stats_table.nr_fields; i++) {
+		f = &fc_stats_table.fields[i];
+
+		snprintf(path, sizeof(path), "%s/%s/statistics/%s",
+		    SYSFS_FC_HOST_PATH, device_name, f->key);
+		val = open_sysfs_stats_file(path);
+		*(u64 *)((char *)&fc_dev->stats + f->offset) =
+		    val ? strtoull(val, NULL, 0) : 0;
+	}
 
 	return 0;
 }
@@ -718,28 +754,84 @@ int get_fcport_error_count(char **argv, struct fc_device_info *fc_dev)
 }
 
 /**
- * Issue Scan comand to a Fibre Channel device
+ * scan_fc_hosts() will rescan the FC hosts named in 'argv', or every FC
+ * host for "all", all at the same time. With --lip a LIP is issued first
+ * and the port is given time to come back online.
  */
-int scsi_scan_fcport_dev(char **argv, struct fc_device_info *fc_dev)
+int scan_fc_hosts(int argc, char **argv)
 {
-	int	err = 0;
-	char	dev_path[256];
+	struct scan_job	*jobs, *job;
+	struct dirent	*entry = NULL;
+	char		path[64];
+	DIR		*dir = NULL;
+	int		i, nr = 0, alloc = argc, max_jobs, err;
 
-	if (strlen(argv[3]) < 4)
-		return -EIO;
+	print_trace_enter();
 
-	fc_dev = alloc_fc_dev();
-	if (!fc_dev)
-		return -ENODEV;
+	if (argc < 1) {
+		print_info("Please provide FC host names or 'all' to scan");
+		return -EINVAL;
+	}
 
-	fc_dev->host_name = strdup(argv[3]);
+	if (!strcmp(argv[0], "all")) {
+		dir = opendir(SYSFS_FC_HOST_PATH);
+		if (!dir) {
+			print_err("No FC host found");
+			return -ENODEV;
+		}
+		alloc = 64;
+	}
 
-	snprintf(dev_path, sizeof(dev_path), "%s/%s", SYSFS_FC_HOST_PATH,
-	    fc_dev->host_name);
+	jobs = calloc(alloc, sizeof(*jobs));
+	if (!jobs) {
+		if (dir)
+			closedir(dir);
+		return -ENOMEM;
+	}
 
-	fc_dev->sys_dev_path = strdup(dev_path);
+	for (i = 0; ; i++) {
+		if (dir) {
+			entry = readdir(dir);
+			if (!entry)
+				break;
+			if (entry->d_name[0] == '.')
+				continue;
+		} else if (i == argc) {
+			break;
+		}
 
-	put_fc_dev(fc_dev);
+		if (nr == alloc) {
+			job = realloc(jobs, alloc * 2 * sizeof(*jobs));
+			if (!job)
+				break;
+			jobs = job;
+			alloc *= 2;
+		}
+
+		job = jobs + nr;
+		memset(job, 0, sizeof(*job));
+		snprintf(job->host_name, sizeof(job->host_name), "%.15s",
+		    dir ? entry->d_name : argv[i]);
+		snprintf(path, sizeof(path), "%s/%s", SYSFS_FC_HOST_PATH,
+		    job->host_name);
+		if (sscanf(job->host_name, "host%d", &job->host_no) != 1 ||
+		    access(path, F_OK)) {
+			print_err("%s is not an FC host", job->host_name);
+			continue;
+		}
+		snprintf(job->chtl, sizeof(job->chtl), "- - -");
+		job->lip = cmd_opt_isset("lip");
+		nr++;
+	}
+	if (dir)
+		closedir(dir);
+
+	max_jobs = scan_jobs_opt(nr);
+	if (max_jobs < 0)
+		err = max_jobs;
+	else
+		err = nr ? scan_run(jobs, nr, max_jobs) : -ENODEV;
+	free(jobs);
 
 	return err;
 }
@@ -0,0 +1,586 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scsi.h"
+#include "scsi_fcp.h"
+#include "scsi_print.h"
+
+/*
+ * NPIV virtual ports
+ *
+ * A vport is created by writing "WWPN:WWNN" to vport_create of its
+ * physical fc_host and shows up as /sys/class/fc_vports/vport-H:C-N.
+ * The write returns once the vport exists, its fabric login goes on in
+ * the background until vport_state turns Active. A batch writes all the
+ * vports of a parent first and then polls them together, parents are
+ * handled in parallel.
+ */
+#define VPORT_DEF_JOBS		16
+#define VPORT_POLL_MIN_MS	50
+#define VPORT_POLL_MAX_MS	1000
+#define VPORT_WAIT_MS		60000
+
+/* The jobs of one physical port, run in turn by the same thread */
+struct fc_vport_batch {
+	struct fc_vport_job	*jobs;
+	int			nr;
+	int			create;
+};
+
+/* Read one vport attribute, NULL if the kernel does not provide it */
+static char *vport_attr(int dfd, const char *attr)
+{
+	char buf[128];
+
+	if (sysfs_read_at(dfd, attr, buf, sizeof(buf)) < 0)
+		return NULL;
+
+	return strdup(buf);
+}
+
+/* The SCSI host a vport created is a child device of the vport */
+static void vport_host(int dfd, char *host, size_t len)
+{
+	struct dirent	*entry;
+	DIR		*dir;
+	int		fd, n;
+
+	snprintf(host, len, "-");
+
+	fd = dup(dfd);
+	if (fd < 0)
+		return;
+	dir = fdopendir(fd);
+	if (!dir) {
+		close(fd);
+		return;
+	}
+
+	for_each_dir(entry, dir) {
+		if (sscanf(entry->d_name, "host%d", &n) == 1 &&
+		    strlen(entry->d_name) < len) {
+			strcpy(host, entry->d_name);
+			break;
+		}
+	}
+	closedir(dir);
+}
+
+static void put_vport_info(struct fc_vport_info *vp)
+{
+	free(vp->vport_name);
+	free(vp->port_name);
+	free(vp->node_name);
+	free(vp->vport_state);
+	free(vp->vport_type);
+	free(vp->symbolic_name);
+}
+
+static int vport_cmp(const void *a, const void *b)
+{
+	const struct fc_vport_info	*x = a, *y = b;
+	int				nx = -1, ny = -1;
+
+	if (x->parent_no != y->parent_no)
+		return x->parent_no < y->parent_no ? -1 : 1;
+
+	sscanf(x->vport_name, "vport-%*d:%*d-%d", &nx);
+	sscanf(y->vport_name, "vport-%*d:%*d-%d", &ny);
+	if (nx != ny)
+		return nx < ny ? -1 : 1;
+
+	return strcmp(x->vport_name, y->vport_name);
+}
+
+/*
+ * fc_vport_read_all() will read every vport of the system in one pass
+ * over /sys/class/fc_vports, sorted by parent. Returns their number.
+ */
+static int fc_vport_read_all(struct fc_vport_info **vports)
+{
+	struct fc_vport_info	*all = NULL, *tmp;
+	struct dirent		*entry;
+	DIR			*dir;
+	int			nr = 0, alloc = 0, dfd, err = 0;
+
+	print_trace_enter();
+
+	*vports = NULL;
+	dir = opendir(SYSFS_FC_VPORT_PATH);
+	if (!dir)
+		return errno == ENOENT ? 0 : -errno;
+
+	for_each_dir(entry, dir) {
+		if (strncmp(entry->d_name, "vport-", 6))
+			continue;
+
+		if (nr == alloc) {
+			alloc = alloc ? alloc * 2 : 16;
+			tmp = realloc(all, alloc * sizeof(*all));
+			if (!tmp) {
+				err = -ENOMEM;
+				break;
+			}
+			all = tmp;
+		}
+
+		dfd = openat(dirfd(dir), entry->d_name,
+		    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dfd < 0)
+			continue;
+
+		tmp = all + nr++;
+		memset(tmp, 0, sizeof(*tmp));
+		tmp->vport_name = strdup(entry->d_name);
+		if (sscanf(entry->d_name, "vport-%d:", &tmp->parent_no) != 1)
+			tmp->parent_no = -1;
+		snprintf(tmp->parent, sizeof(tmp->parent), "host%d",
+		    tmp->parent_no);
+		tmp->port_name = vport_attr(dfd, "port_name");
+		tmp->node_name = vport_attr(dfd, "node_name");
+		tmp->vport_state = vport_attr(dfd, "vport_state");
+		tmp->vport_type = vport_attr(dfd, "vport_type");
+		tmp->symbolic_name = vport_attr(dfd, "symbolic_name");
+		vport_host(dfd, tmp->host_name, sizeof(tmp->host_name));
+		close(dfd);
+
+		if (!tmp->vport_name) {
+			put_vport_info(tmp);
+			nr--;
+		}
+	}
+	closedir(dir);
+
+	if (err) {
+		while (nr--)
+			put_vport_info(all + nr);
+		free(all);
+		return err;
+	}
+
+	if (nr)
+		qsort(all, nr, sizeof(*all), vport_cmp);
+	*vports = all;
+
+	return nr;
+}
+
+static void fc_vport_free_all(struct fc_vport_info *vports, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++)
+		put_vport_info(vports + i);
+	free(vports);
+}
+
+/**
+ * list_fc_vports() will list the NPIV vports with their parent and the
+ * SCSI host each of them created
+ */
+int list_fc_vports(void)
+{
+	struct fc_vport_info	*vports;
+	int			nr, i;
+
+	print_trace_enter();
+
+	nr = fc_vport_read_all(&vports);
+	if (nr < 0) {
+		print_err("Can not read %s (%s)", SYSFS_FC_VPORT_PATH,
+		    strerror(-nr));
+		return nr;
+	}
+
+	if (!nr && out_is_text()) {
+		print_info("No FC vports found");
+		return 0;
+	}
+
+	print_fc_vport_header();
+	for (i = 0; i < nr; i++)
+		print_fc_vport_info(vports + i);
+
+	fc_vport_free_all(vports, nr);
+
+	return 0;
+}
+
+/* 0x2100001b32a9d3e0, 21:00:00:1b:32:a9:d3:e0 -> 2100001b32a9d3e0 */
+static int vport_wwn(const char *in, char *out)
+{
+	int n = 0;
+
+	if (in[0] == '0' && (in[1] == 'x' || in[1] == 'X'))
+		in += 2;
+
+	for (; *in; in++) {
+		if (*in == ':')
+			continue;
+		if (!isxdigit((unsigned char)*in) || n == 16)
+			return -EINVAL;
+		out[n++] = tolower((unsigned char)*in);
+	}
+	out[n] = '\0';
+
+	return n == 16 ? 0 : -EINVAL;
+}
+
+static int vport_same_wwn(const char *sysfs_val, const char *wwn)
+{
+	char buf[20];
+
+	return sysfs_val && !vport_wwn(sysfs_val, buf) && !strcmp(buf, wwn);
+}
+
+static int vport_job_wwpn_cmp(const void *key, const void *elem)
+{
+	const struct fc_vport_job *job = elem;
+
+	return strcmp(key, job->wwpn);
+}
+
+/*
+ * vport_scan() will look up the pending jobs of batch 'b' in one pass
+ * over the vports class, setting 'present' and vport_name of the jobs
+ * whose vport exists. The jobs of a batch share a
+ * parent and are sorted by WWPN.
+ */
+static void vport_scan(struct fc_vport_batch *b)
+{
+	struct fc_vport_job	*job;
+	struct dirent		*entry;
+	DIR			*dir;
+	char			attr[PATH_MAX], buf[32], wwpn[20];
+	int			i, p;
+
+	for (i = 0; i < b->nr; i++) {
+		if (b->jobs[i].err == -EINPROGRESS)
+			b->jobs[i].present = 0;
+	}
+
+	dir = opendir(SYSFS_FC_VPORT_PATH);
+	if (!dir)
+		return;
+
+	for_each_dir(entry, dir) {
+		if (sscanf(entry->d_name, "vport-%d:", &p) != 1 ||
+		    p != b->jobs[0].parent_no ||
+		    strlen(entry->d_name) >= sizeof(job->vport_name))
+			continue;
+
+		snprintf(attr, sizeof(attr), "%s/port_name", entry->d_name);
+		if (sysfs_read_at(dirfd(dir), attr, buf, sizeof(buf)) <= 0 ||
+		    vport_wwn(buf, wwpn))
+			continue;
+
+		job = bsearch(wwpn, b->jobs, b->nr, sizeof(*job),
+		    vport_job_wwpn_cmp);
+		if (job && job->err == -EINPROGRESS) {
+			strcpy(job->vport_name, entry->d_name);
+			job->present = 1;
+		}
+	}
+	closedir(dir);
+}
+
+/* Returns 1 once the job is done, its result filled in */
+static int vport_poll(struct fc_vport_job *job, int create)
+{
+	char	attr[PATH_MAX], state[32];
+
+	if (!job->present) {
+		if (create)
+			return 0;
+		job->err = 0;
+		snprintf(job->result, sizeof(job->result), "deleted");
+		return 1;
+	}
+	if (!create)
+		return 0;
+
+	snprintf(attr, sizeof(attr), "%s/%s/vport_state", SYSFS_FC_VPORT_PATH,
+	    job->vport_name);
+	if (sysfs_read_at(AT_FDCWD, attr, state, sizeof(state)) <= 0)
+		return 0;
+
+	/* Keep the state around in case the wait times out */
+	snprintf(job->result, sizeof(job->result), "%s", state);
+
+	if (!strcmp(state, "Initializing") || !strcmp(state, "Unknown") ||
+	    !strcmp(state, "Linkdown"))
+		return 0;
+
+	job->err = strcmp(state, "Active") ? -EIO : 0;
+
+	return 1;
+}
+
+static void vport_batch_run(void *arg)
+{
+	struct fc_vport_batch	*b = arg;
+	struct fc_vport_job	*job;
+	unsigned int		delay = VPORT_POLL_MIN_MS;
+	char			attr[PATH_MAX], val[40];
+	int			i, pending = 0;
+	u64			start = now_ms();
+
+	snprintf(attr, sizeof(attr), "%s/%s/%s", SYSFS_FC_HOST_PATH,
+	    b->jobs[0].parent, b->create ? "vport_create" : "vport_delete");
+
+	for (i = 0; i < b->nr; i++) {
+		job = b->jobs + i;
+		if (job->result[0])		/* exists, absent */
+			continue;
+
+		snprintf(val, sizeof(val), "%s:%s", job->wwpn, job->wwnn);
+		job->err = sysfs_write_at(AT_FDCWD, attr, val);
+		if (job->err) {
+			job->ms = now_ms() - start;
+			snprintf(job->result, sizeof(job->result), "%s",
+			    strerror(-job->err));
+			continue;
+		}
+		job->err = -EINPROGRESS;
+		pending++;
+	}
+
+	while (pending && now_ms() - start < VPORT_WAIT_MS) {
+		vport_scan(b);
+		for (i = 0; i < b->nr; i++) {
+			job = b->jobs + i;
+			if (job->err != -EINPROGRESS || !vport_poll(job, b->create))
+				continue;
+			job->ms = now_ms() - start;
+			pending--;
+		}
+		if (pending) {
+			sleep_ms(delay);
+			delay = min(delay * 2, VPORT_POLL_MAX_MS);
+		}
+	}
+
+	for (i = 0; i < b->nr; i++) {
+		job = b->jobs + i;
+		if (job->err != -EINPROGRESS)
+			continue;
+		job->err = -ETIMEDOUT;
+		job->ms = now_ms() - start;
+		if (job->result[0]) {
+			strcpy(val, job->result);
+			snprintf(job->result, sizeof(job->result),
+			    "timeout (%.20s)", val);
+		} else {
+			snprintf(job->result, sizeof(job->result), "timeout");
+		}
+	}
+}
+
+static int vport_job_cmp(const void *a, const void *b)
+{
+	const struct fc_vport_job *x = a, *y = b;
+
+	if (x->parent_no != y->parent_no)
+		return x->parent_no < y->parent_no ? -1 : 1;
+
+	return strcmp(x->wwpn, y->wwpn);
+}
+
+/*
+ * Spec file: one vport per line, "hostN WWPN WWNN" with the parent fc_host
+ * first. Empty lines and lines starting with # are skipped.
+ */
+static int vport_read_spec(char *file, struct fc_vport_job **jobs)
+{
+	struct fc_vport_job	*all = NULL, *tmp, *job;
+	char			line[256], host[32], wwpn[64], wwnn[64], c;
+	FILE			*fp;
+	int			nr = 0, alloc = 0, lineno = 0, i, err = 0;
+
+	fp = fopen(file, "r");
+	if (!fp) {
+		err = -errno;
+		print_err("Can not open %s (%s)", file, strerror(-err));
+		return err;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if (line[0] == '#' || line[strspn(line, " \t\n")] == '\0')
+			continue;
+
+		if (nr == alloc) {
+			alloc = alloc ? alloc * 2 : 16;
+			tmp = realloc(all, alloc * sizeof(*all));
+			if (!tmp) {
+				err = -ENOMEM;
+				break;
+			}
+			all = tmp;
+		}
+		job = all + nr;
+		memset(job, 0, sizeof(*job));
+
+		if (sscanf(line, "%31s %63s %63s %c", host, wwpn, wwnn, &c) != 3 ||
+		    sscanf(host, "host%d%c", &job->parent_no, &c) != 1 ||
+		    job->parent_no < 0 || vport_wwn(wwpn, job->wwpn) ||
+		    vport_wwn(wwnn, job->wwnn)) {
+			print_err("%s:%d: expected \"hostN WWPN WWNN\"", file,
+			    lineno);
+			err = -EINVAL;
+			break;
+		}
+		snprintf(job->parent, sizeof(job->parent), "host%d",
+		    job->parent_no);
+
+		for (i = 0; i < nr; i++) {
+			if (!strcmp(all[i].wwpn, job->wwpn)) {
+				print_err("%s:%d: WWPN %s is listed twice", file,
+				    lineno, wwpn);
+				err = -EINVAL;
+				break;
+			}
+		}
+		if (err)
+			break;
+		nr++;
+	}
+	fclose(fp);
+
+	if (err) {
+		free(all);
+		return err;
+	}
+
+	*jobs = all;
+
+	return nr;
+}
+
+/**
+ * fc_vport_batch() will create or delete all vports listed in the spec
+ * file 'file' and wait until they are logged in or gone. Vports which
+ * already are in the requested state are left alone.
+ */
+int fc_vport_batch(char *file, int create)
+{
+	struct fc_vport_batch	*batches = NULL;
+	struct fc_vport_info	*vports = NULL;
+	struct fc_vport_job	*jobs = NULL, *job;
+	int			nr, nr_vports, nr_batches = 0, i, v, jobs_max;
+	int			failed = 0, err = 0;
+	u64			start = now_ms();
+
+	print_trace_enter();
+
+	jobs_max = scan_jobs_opt(VPORT_DEF_JOBS);
+	if (jobs_max < 0)
+		return jobs_max;
+
+	nr = vport_read_spec(file, &jobs);
+	if (nr <= 0) {
+		if (!nr)
+			print_err("No vports listed in %s", file);
+		return nr ? nr : -EINVAL;
+	}
+
+	nr_vports = fc_vport_read_all(&vports);
+	if (nr_vports < 0) {
+		err = nr_vports;
+		goto out;
+	}
+
+	for (i = 0; i < nr; i++) {
+		job = jobs + i;
+		for (v = 0; v < nr_vports; v++)
+			if (vports[v].parent_no == job->parent_no &&
+			    vport_same_wwn(vports[v].port_name, job->wwpn))
+				break;
+
+		if (v < nr_vports) {
+			snprintf(job->vport_name, sizeof(job->vport_name),
+			    "%s", vports[v].vport_name);
+			if (create)
+				snprintf(job->result, sizeof(job->result),
+				    "exists (%s)", vports[v].vport_state ?
+				    vports[v].vport_state : "-");
+		} else if (!create) {
+			snprintf(job->result, sizeof(job->result), "absent");
+		}
+	}
+
+	qsort(jobs, nr, sizeof(*jobs), vport_job_cmp);
+
+	batches = calloc(nr, sizeof(*batches));
+	if (!batches) {
+		err = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < nr; i++) {
+		if (!i || jobs[i].parent_no != jobs[i - 1].parent_no) {
+			batches[nr_batches].jobs = jobs + i;
+			batches[nr_batches].create = create;
+			nr_batches++;
+		}
+		batches[nr_batches - 1].nr++;
+	}
+
+	parallel_for_each(batches, nr_batches, sizeof(*batches),
+	    vport_batch_run, jobs_max);
+
+	print_fc_vport_job_header();
+	for (i = 0; i < nr; i++) {
+		if (jobs[i].err)
+			failed++;
+		print_fc_vport_job(jobs + i);
+	}
+
+	if (out_is_text())
+		print_info("\n %d of %d vports %s on %d parents in %llu ms",
+		    nr - failed, nr, create ? "created" : "deleted",
+		    nr_batches, (unsigned long long)(now_ms() - start));
+
+	err = failed ? -EIO : 0;
+out:
+	fc_vport_free_all(vports, nr_vports > 0 ? nr_vports : 0);
+	free(batches);
+	free(jobs);
+
+	return err;
+}
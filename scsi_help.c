@@ -45,48 +45,48 @@ void general_help(void)
 {
 	print_trace_enter();
 
-	printf("\n");
-	printf("%-.4s%s - %s\n", space, SCSI_TOOL_NAME, SCSI_TOOL_VERSION);
-	printf("\n");
+	out_printf("\n");
+	out_printf("%-.4s%s - %s\n", space, SCSI_TOOL_NAME, SCSI_TOOL_VERSION);
+	out_printf("\n");
 
 	usage();
 
-	printf("\n");
-	printf("%-.4sFollowing commands are implemented:\n", space);
-	printf("%-.4s%-.64s\n", space, dash);
+	out_printf("\n");
+	out_printf("%-.4sFollowing commands are implemented:\n", space);
+	out_printf("%-.4s%-.64s\n", space, dash);
 
 	list_builtins();
 
-	printf("\n");
-	printf("%-.4sSee '%s help <command>' for each command\n", space,
+	out_printf("\n");
+	out_printf("%-.4sSee '%s help <command>' for each command\n", space,
 	    SCSI_TOOL_NAME);
-	printf("\n");
+	out_printf("\n");
 }
 
 void usage(void)
 {
 	print_trace_enter();
 
-	printf("%-.4sUsage:\n", space);
-	printf("%-.4s%-.6s\n", space, dash);
-	printf("%-.4s%s <command> <sub-command> [<device>]\n", space, SCSI_TOOL_NAME);
-	printf("\n");
-	printf("%-.4sWhere:\n", space);
-	printf("%-.4s%-.6s\n", space, dash);
-	printf("%-.4sThe '<sub-command>' is command specific options supported by the tool\n", space);
-	printf("%-.4sThe '<device>' may be either\n", space);
-	printf("\n");
-	printf("%-.6s- A Fibre Channel Device\n", space);
-	printf("\n");
-	printf("%-.6s- An iSCSI Device\n", space);
-	printf("\n");
-	printf("%-.6s- One of the\n", space);
-	printf("%-.8s- SCSI generic device (ex: /dev/sdX)\n", space);
-	printf("%-.8s- SCSI disk device (ex: /dev/sgX)\n", space);
-	printf("%-.8s- NVMe Block device (ex: /dev/nvmeXnY)\n", space);
-	printf("%-.8s- NVMe generic Block device (ex: /dev/ngX)\n", space);
-	printf("%-.8s- Device Mapper stacking device (ex: /dev/dm-X)\n", space);
-	printf("%-.8s- RAID Array device (ex: /dev/mdXYZ)\n", space);
+	out_printf("%-.4sUsage:\n", space);
+	out_printf("%-.4s%-.6s\n", space, dash);
+	out_printf("%-.4s%s <command> <sub-command> [<device>]\n", space, SCSI_TOOL_NAME);
+	out_printf("\n");
+	out_printf("%-.4sWhere:\n", space);
+	out_printf("%-.4s%-.6s\n", space, dash);
+	out_printf("%-.4sThe '<sub-command>' is command specific options supported by the tool\n", space);
+	out_printf("%-.4sThe '<device>' may be either\n", space);
+	out_printf("\n");
+	out_printf("%-.6s- A Fibre Channel Device\n", space);
+	out_printf("\n");
+	out_printf("%-.6s- An iSCSI Device\n", space);
+	out_printf("\n");
+	out_printf("%-.6s- One of the\n", space);
+	out_printf("%-.8s- SCSI generic device (ex: /dev/sdX)\n", space);
+	out_printf("%-.8s- SCSI disk device (ex: /dev/sgX)\n", space);
+	out_printf("%-.8s- NVMe Block device (ex: /dev/nvmeXnY)\n", space);
+	out_printf("%-.8s- NVMe generic Block device (ex: /dev/ngX)\n", space);
+	out_printf("%-.8s- Device Mapper stacking device (ex: /dev/dm-X)\n", space);
+	out_printf("%-.8s- RAID Array device (ex: /dev/mdXYZ)\n", space);
 
 }
 
@@ -94,16 +94,16 @@ void print_list_help(void)
 {
 	print_trace_enter();
 
-	printf(" %-*s %s", padding, "list", "List Block Devices, FC Adapters");
-	printf("\n");
+	out_printf(" %-*s %s", padding, "list", "List Block Devices, FC Adapters");
+	out_printf("\n");
 }
 
 void print_stats_help(void)
 {
 	print_trace_enter();
 
-	printf("%-*s %s", padding, "stats", "Show statistics for Block Devices, FC Adapters");
-	printf("\n");
+	out_printf("%-*s %s", padding, "stats", "Show statistics for Block Devices, FC Adapters");
+	out_printf("\n");
 }
 
 int help_cmd(int argc, char **argv)
@@ -112,7 +112,7 @@ int help_cmd(int argc, char **argv)
 
 	if (argc > 2) {
 		if (!argv[2]) {
-			printf("Enter one of the supported sub-command\n");
+			out_printf("Enter one of the supported sub-command\n");
 			return 0;
 		}
 
@@ -134,7 +134,7 @@ void version_cmd(void)
 {
 	print_trace_enter();
 
-	printf(" %s - %s\n", SCSI_TOOL_NAME, SCSI_TOOL_VERSION);
-	printf("\n");
-	printf(" %-*s %s\n", padding, "version", "Shows the program version");
+	out_printf(" %s - %s\n", SCSI_TOOL_NAME, SCSI_TOOL_VERSION);
+	out_printf("\n");
+	out_printf(" %-*s %s\n", padding, "version", "Shows the program version");
 }
@@ -98,7 +98,6 @@ struct iscsi_dev_info {
 	char	*host_name;
 	char	*session_name;
 	char	*connection_name;
-	char	*transport_name;
 
 	/* TargetName, Target address, Target Port */
 	char	*target_name;
@@ -121,20 +120,127 @@ struct iscsi_dev_info {
 	struct 	iscsi_session	 *session;
 };
 
+/* One iSCSI session, joined to its host, connections and LUNs */
+struct iscsi_sess_info {
+	char	session_name[16];	/* sessionN */
+	int	sid;
+	int	host_no;
+	char	host_name[16];
+	char	*transport;		/* iscsi_transport name, borrowed */
+	char	*targetname;
+	char	*state;
+	char	*ifacename;
+	int	recovery_tmo;
+	int	tpgt;
+	char	*conn_address;		/* of the first connection, borrowed */
+	char	*conn_port;
+	int	conn_start;		/* index of the first connection */
+	int	nr_conns;
+	int	lun_start;		/* index of the first LUN */
+	int	nr_luns;
+};
+
+struct iscsi_conn_info {
+	char	connection_name[24];	/* connectionN:C */
+	int	sid;
+	int	cid;
+	char	*address;
+	char	*port;
+	char	*state;
+	char	*persistent_address;
+	char	*persistent_port;
+};
+
+struct iscsi_lun_info {
+	char	*session_name;		/* borrowed from the session */
+	int	host;			/* host, channel, target, lun */
+	int	channel;
+	int	target;
+	int	lun;
+	int	sid;
+	char	*state;
+	char	*disk_name;
+};
+
+/* Also read the state and the disk name of every LUN */
+#define ISCSI_INDEX_LUNS	0x1
+
+/*
+ * All sessions of the system sorted by session id, with their connections
+ * and LUNs sorted the same way: the connections of a session are
+ * conns[conn_start] up to conns[conn_start + nr_conns], likewise for LUNs.
+ */
+struct iscsi_index {
+	struct iscsi_sess_info	*sessions;
+	int			nr_sessions;
+	struct iscsi_conn_info	*conns;
+	int			nr_conns;
+	struct iscsi_lun_info	*luns;
+	int			nr_luns;
+	char			**transports;	/* by host number */
+	int			nr_hosts;	/* highest host number + 1 */
+};
+
+/* Where the NIC of a session sits, for list iscsi_numa */
+struct iscsi_numa_info {
+	char	session_name[16];
+	char	host_name[16];
+	char	*transport;		/* borrowed from the index */
+	char	*ifacename;
+	char	*targetname;
+	char	netdev[16];
+	char	ipaddress[48];
+	char	hwaddress[24];
+	char	pci[16];		/* PCI function of the NIC or HBA */
+	int	numa_node;
+	int	nr_irqs;
+	char	irq_cpus[32];
+	char	irq_nodes[16];
+	char	locality[12];
+	int	nr_luns;
+	char	disks[32];
+};
+
+/* One state change seen by watch iscsi */
+struct iscsi_event {
+	char	time[16];		/* HH:MM:SS.mmm, local time */
+	char	object[24];		/* sessionN or connectionN:C */
+	char	attr[16];
+	char	old[24];
+	char	new[24];
+	char	note[64];
+};
+
+/* Outages of one session, from leaving LOGGED_IN until it is back */
+struct iscsi_outage {
+	char	session_name[16];
+	char	*targetname;		/* borrowed from the index */
+	char	state[24];		/* when the watch ended */
+	int	recovery_tmo;
+	int	outages;
+	int	exceeded;		/* outages longer than recovery_tmo */
+	u64	last_ms;
+	u64	max_ms;
+	u64	total_ms;
+};
+
+int iscsi_index_build(struct iscsi_index *, int);
+struct iscsi_sess_info *iscsi_index_session(struct iscsi_index *, int);
+void iscsi_index_free(struct iscsi_index *);
+
 int get_iscsi_info(struct iscsi_dev_info *);
 int get_iscsi_session_info(struct iscsi_dev_info *);
 int get_session_scsi_disks(struct iscsi_dev_info *);
 int get_iscsi_connection_info(struct iscsi_dev_info *);
 int get_iscsi_disk_hctl(struct iscsi_dev_info *);
 int show_iscsi_details(char **, struct scsi_device_list *);
+int watch_iscsi_sessions(unsigned int, unsigned int);
 int get_iscsi_error_count(char **, struct iscsi_dev_info *);
 int scsi_scan_iscsi_dev(char **, struct iscsi_dev_info *);
 int set_iscsi_dev_offline(char **, struct iscsi_dev_info *);
 int set_iscsi_dev_online(char **, struct iscsi_dev_info *);
 int set_iscsi_alias(char **, struct iscsi_dev_info *);
 
-int get_iscsi_transport(struct iscsi_dev_info *);
-int fill_connection_info(struct iscsi_dev_info *);
-int fill_session_info(struct iscsi_dev_info *);
 int list_iscsi_devs(struct iscsi_dev_info *);
+int list_iscsi_numa(void);
 #endif
@@ -0,0 +1,419 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ifaddrs.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "scsi.h"
+#include "scsi_iscsi.h"
+#include "scsi_numa.h"
+#include "scsi_print.h"
+
+/*
+ * NUMA locality of iSCSI sessions
+ *
+ * The NIC of a session is the netdev of its iSCSI host, or the interface
+ * owning the host's local ipaddress for software iSCSI without an iface
+ * binding, or the PCI function of the HBA itself for offload hosts.
+ * Bonds and VLANs are followed down to the first lower device on PCI.
+ * Hosts and NICs are looked up once, however many sessions share them.
+ */
+
+#define NUMA_LOWER_DEPTH	4
+
+struct numa_host {
+	int	read;
+	char	netdev[16];
+	char	ipaddress[48];
+	char	hwaddress[24];
+	int	nic;			/* index in the NIC cache, -1 if none */
+};
+
+struct numa_nic {
+	char	key[PATH_MAX];		/* PCI device path */
+	char	pci[16];
+	int	node;
+	int	nr_irqs;
+	u64	irq_nodes;
+	char	irq_cpus[32];
+};
+
+struct numa_ctx {
+	struct iscsi_index	idx;
+	struct numa_host	*hosts;
+	struct numa_nic		*nics;
+	int			nr_nics;
+	struct ifaddrs		*ifa;
+	int			ifa_read;
+	u64			io_nodes;	/* nodes of --cpus, 0 if unset */
+};
+
+/* Drivers report an unset parameter as "", "<NULL>" or "(null)" */
+static int numa_param_set(const char *val)
+{
+	return val[0] && strcmp(val, "<NULL>") && strcmp(val, "(null)");
+}
+
+/* Interface holding local address 'addr', for hosts without netdev */
+static void numa_ifname(struct numa_ctx *c, const char *addr, char *name,
+    size_t len)
+{
+	struct ifaddrs		*p;
+	unsigned char		want[sizeof(struct in6_addr)];
+	const void		*have;
+	int			family = strchr(addr, ':') ? AF_INET6 : AF_INET;
+
+	if (inet_pton(family, addr, want) != 1)
+		return;
+
+	if (!c->ifa_read) {
+		c->ifa_read = 1;
+		if (getifaddrs(&c->ifa))
+			c->ifa = NULL;
+	}
+
+	for (p = c->ifa; p; p = p->ifa_next) {
+		if (!p->ifa_addr || p->ifa_addr->sa_family != family)
+			continue;
+
+		if (family == AF_INET)
+			have = &((struct sockaddr_in *)p->ifa_addr)->sin_addr;
+		else
+			have = &((struct sockaddr_in6 *)p->ifa_addr)->sin6_addr;
+
+		if (!memcmp(have, want, family == AF_INET ?
+		    sizeof(struct in_addr) : sizeof(struct in6_addr))) {
+			snprintf(name, len, "%s", p->ifa_name);
+			return;
+		}
+	}
+}
+
+/* PCI function of a netdev, going down bonds and VLANs */
+static int numa_net_pci(const char *netdev, char *path, int depth)
+{
+	struct dirent	*dent;
+	DIR		*dir;
+	char		link[PATH_MAX];
+	int		err = -ENODEV;
+
+	snprintf(link, sizeof(link), "%s/%s/device", SYSFS_NET_PATH, netdev);
+	if (!pci_dev_path(link, path))
+		return 0;
+
+	if (depth >= NUMA_LOWER_DEPTH)
+		return -ENODEV;
+
+	snprintf(link, sizeof(link), "%s/%s", SYSFS_NET_PATH, netdev);
+	dir = opendir(link);
+	if (!dir)
+		return -ENODEV;
+
+	for_each_dir(dent, dir) {
+		if (strncmp(dent->d_name, "lower_", 6))
+			continue;
+
+		err = numa_net_pci(dent->d_name + 6, path, depth + 1);
+		if (!err)
+			break;
+	}
+	closedir(dir);
+
+	return err;
+}
+
+static int numa_nic_get(struct numa_ctx *c, const char *path)
+{
+	struct numa_nic	*nic, *nics;
+	struct cpu_mask	cpus;
+	int		i;
+
+	for (i = 0; i < c->nr_nics; i++) {
+		if (!strcmp(c->nics[i].key, path))
+			return i;
+	}
+
+	nics = realloc(c->nics, (c->nr_nics + 1) * sizeof(*nics));
+	if (!nics)
+		return -1;
+	c->nics = nics;
+
+	nic = nics + c->nr_nics;
+	memset(nic, 0, sizeof(*nic));
+	snprintf(nic->key, sizeof(nic->key), "%s", path);
+	snprintf(nic->pci, sizeof(nic->pci), "%s", strrchr(path, '/') + 1);
+	nic->node = dev_numa_node(path);
+	nic->nr_irqs = dev_irq_cpus(path, &cpus);
+	nic->irq_nodes = nic->nr_irqs ? numa_nodes_of(&cpus) : 0;
+	cpulist_format(&cpus, nic->irq_cpus, sizeof(nic->irq_cpus));
+
+	return c->nr_nics++;
+}
+
+static struct numa_host *numa_host_get(struct numa_ctx *c, int host_no)
+{
+	struct numa_host	*h = c->hosts + host_no;
+	char			path[PATH_MAX], link[PATH_MAX];
+	int			dfd, err = -ENODEV;
+
+	if (h->read)
+		return h;
+	h->read = 1;
+	h->nic = -1;
+
+	snprintf(path, sizeof(path), "%s/host%d", SYSFS_ISCSI_HOST_PATH,
+	    host_no);
+	dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd >= 0) {
+		if (sysfs_read_at(dfd, "netdev", h->netdev,
+		    sizeof(h->netdev)) < 0 || !numa_param_set(h->netdev))
+			h->netdev[0] = '\0';
+		if (sysfs_read_at(dfd, "ipaddress", h->ipaddress,
+		    sizeof(h->ipaddress)) < 0 ||
+		    !numa_param_set(h->ipaddress))
+			h->ipaddress[0] = '\0';
+		if (sysfs_read_at(dfd, "hwaddress", h->hwaddress,
+		    sizeof(h->hwaddress)) < 0 ||
+		    !numa_param_set(h->hwaddress))
+			h->hwaddress[0] = '\0';
+		close(dfd);
+	}
+
+	if (!h->netdev[0] && h->ipaddress[0])
+		numa_ifname(c, h->ipaddress, h->netdev, sizeof(h->netdev));
+
+	if (h->netdev[0])
+		err = numa_net_pci(h->netdev, path, 0);
+
+	/* Offload HBAs are the NIC themselves */
+	if (err) {
+		snprintf(link, sizeof(link), "%s/host%d/device",
+		    SYSFS_SCSI_HOST_PATH, host_no);
+		err = pci_dev_path(link, path);
+	}
+
+	if (!err)
+		h->nic = numa_nic_get(c, path);
+
+	return h;
+}
+
+static const char *numa_locality(struct numa_ctx *c, struct numa_nic *nic)
+{
+	u64 node;
+
+	if (!nic)
+		return "unknown";
+
+	if (numa_nr_nodes() <= 1)
+		return "local";
+
+	if (nic->node < 0 || nic->node >= NUMA_MAX_NODES)
+		return "unknown";
+
+	node = 1ULL << nic->node;
+
+	if (c->io_nodes && !(c->io_nodes & node))
+		return "remote";
+	if (nic->irq_nodes && !(nic->irq_nodes & node))
+		return "irq-remote";
+	if (nic->irq_nodes & ~node)
+		return "irq-split";
+
+	return "local";
+}
+
+/* "sdb,sdc,+14" when the disks do not all fit */
+static void numa_disks(struct numa_ctx *c, struct iscsi_sess_info *s,
+    char *buf, size_t len)
+{
+	struct iscsi_lun_info	*lun;
+	size_t			pos = 0, need;
+	int			i, shown = 0, nr = 0;
+	char			more[16];
+
+	buf[0] = '\0';
+	for (i = 0; i < s->nr_luns; i++) {
+		lun = c->idx.luns + s->lun_start + i;
+		if (!lun->disk_name)
+			continue;
+		nr++;
+
+		need = strlen(lun->disk_name) + (pos ? 1 : 0);
+		if (shown < nr - 1 || pos + need + 5 >= len)
+			continue;
+
+		pos += snprintf(buf + pos, len - pos, "%s%s", pos ? "," : "",
+		    lun->disk_name);
+		shown++;
+	}
+
+	if (shown < nr) {
+		snprintf(more, sizeof(more), "%s+%d", pos ? "," : "",
+		    nr - shown);
+		snprintf(buf + pos, len - pos, "%s", more);
+	} else if (!nr) {
+		snprintf(buf, len, "-");
+	}
+}
+
+static int numa_io_nodes(struct numa_ctx *c)
+{
+	struct cpu_mask	cpus;
+	char		*val = cmd_opt_value("cpus");
+
+	if (!val)
+		return 0;
+
+	if (cpulist_parse(val, &cpus) || cpu_mask_empty(&cpus)) {
+		print_err("Invalid CPU list '%s', ex: 0-15,32-47", val);
+		return -EINVAL;
+	}
+
+	c->io_nodes = numa_nodes_of(&cpus);
+
+	return 0;
+}
+
+/**
+ * list_iscsi_numa() will show for every iSCSI session the NIC carrying
+ * it, the NUMA node and interrupt CPUs of that NIC and the disks of the
+ * session, flagging sessions whose NIC or NIC interrupts are on another
+ * node than the CPUs doing the I/O (--cpus) or than the NIC itself
+ */
+int list_iscsi_numa(void)
+{
+	struct numa_ctx		c;
+	struct iscsi_numa_info	info;
+	struct iscsi_sess_info	*s;
+	struct numa_host	*h;
+	struct numa_nic		*nic;
+	int			i, flagged = 0, err;
+
+	print_trace_enter();
+
+	memset(&c, 0, sizeof(c));
+
+	err = numa_io_nodes(&c);
+	if (err)
+		return err;
+
+	err = iscsi_index_build(&c.idx, ISCSI_INDEX_LUNS);
+	if (err || !c.idx.nr_sessions) {
+		print_info("\n No iSCSI sessions found \n");
+		goto out;
+	}
+
+	c.hosts = calloc(c.idx.nr_hosts, sizeof(*c.hosts));
+	if (!c.hosts) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	print_command_label("iSCSI NUMA");
+	print_iscsi_numa_header();
+
+	for (i = 0; i < c.idx.nr_sessions; i++) {
+		s = c.idx.sessions + i;
+
+		memset(&info, 0, sizeof(info));
+		snprintf(info.session_name, sizeof(info.session_name), "%s",
+		    s->session_name);
+		snprintf(info.host_name, sizeof(info.host_name), "%s",
+		    s->host_name);
+		info.transport = s->transport;
+		info.ifacename = s->ifacename;
+		info.targetname = s->targetname;
+		info.nr_luns = s->nr_luns;
+		info.numa_node = -1;
+		numa_disks(&c, s, info.disks, sizeof(info.disks));
+
+		h = NULL;
+		nic = NULL;
+		if (s->host_no >= 0 && s->host_no < c.idx.nr_hosts) {
+			h = numa_host_get(&c, s->host_no);
+			if (h->nic >= 0)
+				nic = c.nics + h->nic;
+		}
+
+		snprintf(info.netdev, sizeof(info.netdev), "%s",
+		    h && h->netdev[0] ? h->netdev : "-");
+		if (h) {
+			memcpy(info.ipaddress, h->ipaddress,
+			    sizeof(info.ipaddress));
+			memcpy(info.hwaddress, h->hwaddress,
+			    sizeof(info.hwaddress));
+		}
+		if (nic) {
+			memcpy(info.pci, nic->pci, sizeof(info.pci));
+			info.numa_node = nic->node;
+			info.nr_irqs = nic->nr_irqs;
+			memcpy(info.irq_cpus, nic->irq_cpus,
+			    sizeof(info.irq_cpus));
+			nodelist_format(nic->irq_nodes, info.irq_nodes,
+			    sizeof(info.irq_nodes));
+		} else {
+			snprintf(info.pci, sizeof(info.pci), "-");
+			snprintf(info.irq_cpus, sizeof(info.irq_cpus), "-");
+			snprintf(info.irq_nodes, sizeof(info.irq_nodes), "-");
+		}
+		snprintf(info.locality, sizeof(info.locality), "%s",
+		    numa_locality(&c, nic));
+
+		if (strcmp(info.locality, "local") &&
+		    strcmp(info.locality, "unknown"))
+			flagged++;
+
+		print_iscsi_numa(&info);
+	}
+
+	if (out_is_text() && flagged)
+		out_printf("\n%d of %d sessions cross NUMA nodes\n", flagged,
+		    c.idx.nr_sessions);
+
+out:
+	if (c.ifa)
+		freeifaddrs(c.ifa);
+	free(c.nics);
+	free(c.hosts);
+	iscsi_index_free(&c.idx);
+
+	return err;
+}
@@ -42,243 +42,607 @@
 #include "scsi_print.h"
 
 /*
- * Fill out Transport information for the iscsi host
+ * iSCSI index
+ *
+ * Sessions, connections and LUNs are each listed once from their sysfs
+ * class and joined on the session id, instead of walking the device tree
+ * below every host. The owning host of a session and the session of a
+ * LUN come from their class links, ".../hostH/sessionN/...". Attributes
+ * of sessions and connections are read on a pool of threads.
  */
-int get_iscsi_transport(struct iscsi_dev_info *iscsi_info)
+#define ISCSI_INDEX_JOBS	16
+
+/* Number N of the last "/<prefix>N/" component of the class link 'name' */
+static int iscsi_link_no(int dfd, const char *name, const char *prefix)
 {
-	struct dirent	*entry;
-	DIR		*dir;
-	char		path[1024] = { 0 };
+	char	link[PATH_MAX];
+	char	*p, *end;
+	size_t	plen = strlen(prefix);
+	ssize_t	len;
+	long	n;
+	int	no = -1;
+
+	len = readlinkat(dfd, name, link, sizeof(link) - 1);
+	if (len <= 0)
+		return -1;
+	link[len] = '\0';
+
+	for (p = link; (p = strstr(p, prefix)); p++) {
+		n = strtol(p + plen, &end, 10);
+		if (end != p + plen && *end == '/' && n >= 0 && n < INT_MAX)
+			no = n;
+	}
 
-	print_trace_enter();
+	return no;
+}
 
-	sprintf(path, "/sys/class/iscsi_transport");
+/* Read one attribute, NULL if the kernel does not provide it */
+static char *iscsi_attr(int dfd, const char *attr)
+{
+	char buf[256];
 
-	dir = opendir(path);
-	if (unlikely(!dir)) {
-		print_debug("\n No iSCSI Transport configured, Check connection \n");
-		return -EINVAL;
+	if (sysfs_read_at(dfd, attr, buf, sizeof(buf)) < 0)
+		return NULL;
+
+	return strdup(buf);
+}
+
+/* Like iscsi_attr(), but "-" for an attribute this kernel lacks */
+static char *iscsi_attr_str(int dfd, const char *attr)
+{
+	char *str = iscsi_attr(dfd, attr);
+
+	return str ? str : strdup("-");
+}
+
+/* open_sysfs_stats_file() that never hands back NULL */
+static char *iscsi_sysfs_str(char *path)
+{
+	char *str = open_sysfs_stats_file(path);
+
+	return str ? str : "";
+}
+
+static int iscsi_attr_int(int dfd, const char *attr)
+{
+	char buf[32];
+
+	if (sysfs_read_at(dfd, attr, buf, sizeof(buf)) <= 0)
+		return -1;
+
+	return atoi(buf);
+}
+
+static void iscsi_read_session(void *arg)
+{
+	struct iscsi_sess_info	*s = arg;
+	char			path[PATH_MAX];
+	int			dfd;
+
+	snprintf(path, sizeof(path), "%s/%s", SYSFS_ISCSI_SESS_PATH,
+	    s->session_name);
+	dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return;
+
+	s->targetname = iscsi_attr(dfd, "targetname");
+	s->state = iscsi_attr(dfd, "state");
+	s->ifacename = iscsi_attr(dfd, "ifacename");
+	s->recovery_tmo = iscsi_attr_int(dfd, "recovery_tmo");
+	s->tpgt = iscsi_attr_int(dfd, "tpgt");
+	close(dfd);
+}
+
+static void iscsi_read_conn(void *arg)
+{
+	struct iscsi_conn_info	*c = arg;
+	char			path[PATH_MAX];
+	int			dfd;
+
+	snprintf(path, sizeof(path), "%s/%s", SYSFS_ISCSI_CONN_PATH,
+	    c->connection_name);
+	dfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return;
+
+	c->address = iscsi_attr(dfd, "address");
+	c->port = iscsi_attr(dfd, "port");
+	c->state = iscsi_attr(dfd, "state");
+	c->persistent_address = iscsi_attr(dfd, "persistent_address");
+	c->persistent_port = iscsi_attr(dfd, "persistent_port");
+	close(dfd);
+}
+
+static void iscsi_read_lun(void *arg)
+{
+	struct iscsi_lun_info	*l = arg;
+	char			path[PATH_MAX], buf[32];
+
+	snprintf(path, sizeof(path), "%s/%d:%d:%d:%d/device/state",
+	    SYSFS_SCSI_DEV_PATH, l->host, l->channel, l->target, l->lun);
+	if (sysfs_read_at(AT_FDCWD, path, buf, sizeof(buf)) > 0)
+		l->state = strdup(buf);
+}
+
+static int iscsi_sess_cmp(const void *a, const void *b)
+{
+	const struct iscsi_sess_info *x = a, *y = b;
+
+	return x->sid < y->sid ? -1 : x->sid > y->sid;
+}
+
+static int iscsi_conn_cmp(const void *a, const void *b)
+{
+	const struct iscsi_conn_info *x = a, *y = b;
+
+	if (x->sid != y->sid)
+		return x->sid < y->sid ? -1 : 1;
+
+	return x->cid < y->cid ? -1 : x->cid > y->cid;
+}
+
+static int iscsi_hctl_cmp(const void *a, const void *b)
+{
+	const struct iscsi_lun_info *x = a, *y = b;
+
+	if (x->host != y->host)
+		return x->host < y->host ? -1 : 1;
+	if (x->channel != y->channel)
+		return x->channel < y->channel ? -1 : 1;
+	if (x->target != y->target)
+		return x->target < y->target ? -1 : 1;
+
+	return x->lun < y->lun ? -1 : x->lun > y->lun;
+}
+
+static int iscsi_lun_cmp(const void *a, const void *b)
+{
+	const struct iscsi_lun_info *x = a, *y = b;
+
+	if (x->sid != y->sid)
+		return x->sid < y->sid ? -1 : 1;
+
+	return iscsi_hctl_cmp(a, b);
+}
+
+/* Grow '*array' of 'size' byte entries so that one more fits */
+static int iscsi_grow(void *array, int nr, int *alloc, size_t size)
+{
+	void	**p = array;
+	void	*tmp;
+
+	if (nr < *alloc)
+		return 0;
+
+	tmp = realloc(*p, (*alloc ? *alloc * 2 : 64) * size);
+	if (!tmp)
+		return -ENOMEM;
+	*p = tmp;
+	*alloc = *alloc ? *alloc * 2 : 64;
+
+	return 0;
+}
+
+/*
+ * iscsi_host_transport() will name the iscsi_transport class of a host
+ * from its proc_name: "iscsi_tcp" is "tcp", "ib_iser" is "iser",
+ * offload drivers like "bnx2i" register under their own name. 'names'
+ * holds the registered transports, read once.
+ */
+static void iscsi_host_transport(const char *proc_name, char **names,
+    int nr, char *buf, size_t size)
+{
+	size_t	len = strlen(proc_name), n;
+	int	i;
+
+	for (i = 0; i < nr; i++) {
+		n = strlen(names[i]);
+		if (n <= len && !strcmp(proc_name + len - n, names[i]) &&
+		    (n == len || proc_name[len - n - 1] == '_')) {
+			snprintf(buf, size, "%s", names[i]);
+			return;
+		}
 	}
+	snprintf(buf, size, "%s", proc_name);
+}
+
+static int iscsi_read_transports(char ***names)
+{
+	struct dirent	*entry;
+	DIR		*dir;
+	char		**tmp;
+	int		nr = 0;
+
+	*names = NULL;
+	dir = opendir(SYSFS_ISCSI_TRANSPORT_PATH);
+	if (!dir)
+		return 0;
 
 	for_each_dir(entry, dir) {
-		if (!strncmp(entry->d_name, "tcp", 3)) {
-			iscsi_info->transport_name = strdup(entry->d_name);
+		tmp = realloc(*names, (nr + 1) * sizeof(char *));
+		if (!tmp)
 			break;
-		}
+		*names = tmp;
+		(*names)[nr] = strdup(entry->d_name);
+		if ((*names)[nr])
+			nr++;
 	}
 	closedir(dir);
 
-	return 0;
+	return nr;
 }
 
-int list_iscsi_devs(struct iscsi_dev_info *iscsi_info)
+static int iscsi_index_sessions(struct iscsi_index *idx)
 {
-	struct dirent	*entry;
-	DIR		*dir;
-	int		count = 0;
-
-	print_trace_enter();
+	struct iscsi_sess_info	*s;
+	struct dirent		*entry;
+	DIR			*dir;
+	char			path[PATH_MAX], buf[64], name[64];
+	char			**names;
+	int			alloc = 0, i, sid, nr_names;
 
-	count = get_device_count(SYSFS_ISCSI_HOST_PATH);
-	if (count < 0)
+	dir = opendir(SYSFS_ISCSI_SESS_PATH);
+	if (!dir)
 		return -ENODEV;
 
-	print_debug("%s: Count %d ", SYSFS_ISCSI_HOST_PATH, count);
+	for_each_dir(entry, dir) {
+		if (sscanf(entry->d_name, "session%d", &sid) != 1 ||
+		    strlen(entry->d_name) >= sizeof(s->session_name))
+			continue;
+		if (iscsi_grow(&idx->sessions, idx->nr_sessions, &alloc,
+		    sizeof(*s))) {
+			closedir(dir);
+			return -ENOMEM;
+		}
 
-	dir = opendir(SYSFS_ISCSI_HOST_PATH);
-	if (unlikely(!dir)) {
-		print_info("\n No iSCSI host configured \n");
-		return -EINVAL;
+		s = idx->sessions + idx->nr_sessions;
+		memset(s, 0, sizeof(*s));
+		strcpy(s->session_name, entry->d_name);
+		s->sid = sid;
+		s->host_no = iscsi_link_no(dirfd(dir), entry->d_name, "/host");
+		if (s->host_no < 0)
+			continue;
+		snprintf(s->host_name, sizeof(s->host_name), "host%d",
+		    s->host_no);
+		s->recovery_tmo = -1;
+		s->tpgt = -1;
+		if (s->host_no >= idx->nr_hosts)
+			idx->nr_hosts = s->host_no + 1;
+		idx->nr_sessions++;
 	}
+	closedir(dir);
 
-	print_command_label("iSCSI");
+	if (idx->nr_sessions)
+		qsort(idx->sessions, idx->nr_sessions, sizeof(*s),
+		    iscsi_sess_cmp);
+
+	parallel_for_each(idx->sessions, idx->nr_sessions, sizeof(*s),
+	    iscsi_read_session, ISCSI_INDEX_JOBS);
+
+	/* Few hosts carry many sessions, read each transport once */
+	idx->transports = calloc(idx->nr_hosts + 1, sizeof(char *));
+	if (!idx->transports)
+		return -ENOMEM;
+
+	nr_names = iscsi_read_transports(&names);
+	for (i = 0; i < idx->nr_sessions; i++) {
+		s = idx->sessions + i;
+		if (!idx->transports[s->host_no]) {
+			snprintf(path, sizeof(path), "%s/%s/proc_name",
+			    SYSFS_SCSI_HOST_PATH, s->host_name);
+			if (sysfs_read_at(AT_FDCWD, path, buf, sizeof(buf)) < 0)
+				strcpy(name, "-");
+			else
+				iscsi_host_transport(buf, names, nr_names,
+				    name, sizeof(name));
+			idx->transports[s->host_no] = strdup(name);
+		}
+		s->transport = idx->transports[s->host_no];
+	}
 
-	print_iscsi_dev_header();
+	for (i = 0; i < nr_names; i++)
+		free(names[i]);
+	free(names);
 
-	for_each_dir(entry, dir) {
-		iscsi_info = alloc_iscsi_dev();
-		if (!iscsi_info)
-			return -EINVAL;
+	return 0;
+}
 
-		iscsi_info->host_name = strdup(entry->d_name);
-		iscsi_info->sys_dev_path = strdup(SYSFS_ISCSI_HOST_PATH);
+static int iscsi_index_conns(struct iscsi_index *idx)
+{
+	struct iscsi_sess_info	*s;
+	struct iscsi_conn_info	*c;
+	struct dirent		*entry;
+	DIR			*dir;
+	int			alloc = 0, i, sid, cid;
 
-		print_debug("Path: %s Name: %s \n",
-		    iscsi_info->session_path, iscsi_info->session_name);
+	dir = opendir(SYSFS_ISCSI_CONN_PATH);
+	if (!dir)
+		return 0;
 
-		/*  fill in transport information */
-		get_iscsi_transport(iscsi_info);
+	for_each_dir(entry, dir) {
+		if (sscanf(entry->d_name, "connection%d:%d", &sid, &cid) != 2 ||
+		    strlen(entry->d_name) >= sizeof(c->connection_name))
+			continue;
+		if (iscsi_grow(&idx->conns, idx->nr_conns, &alloc,
+		    sizeof(*c))) {
+			closedir(dir);
+			return -ENOMEM;
+		}
+
+		c = idx->conns + idx->nr_conns++;
+		memset(c, 0, sizeof(*c));
+		strcpy(c->connection_name, entry->d_name);
+		c->sid = sid;
+		c->cid = cid;
+	}
+	closedir(dir);
 
-		fill_session_info(iscsi_info);
+	if (idx->nr_conns)
+		qsort(idx->conns, idx->nr_conns, sizeof(*c), iscsi_conn_cmp);
 
-		/* Fill connection/address/port information */
-		fill_connection_info (iscsi_info);
+	parallel_for_each(idx->conns, idx->nr_conns, sizeof(*c),
+	    iscsi_read_conn, ISCSI_INDEX_JOBS);
 
-		print_list_iscsi_dev(iscsi_info);
-		put_iscsi_dev(iscsi_info);
+	for (i = 0; i < idx->nr_conns; i++) {
+		c = idx->conns + i;
+		s = iscsi_index_session(idx, c->sid);
+		if (!s)
+			continue;
+		if (!s->nr_conns++) {
+			s->conn_start = i;
+			s->conn_address = c->address;
+			s->conn_port = c->port;
+		}
 	}
-	closedir(dir);
 
-	return count;
+	return 0;
 }
 
-/*
- * Fill out Transport information for the iscsi host
- */
-int fill_connection_info(struct iscsi_dev_info *iscsi_info)
+/* Name the sd disks of the LUNs, the LUNs are sorted by H:C:T:L here */
+static void iscsi_index_disks(struct iscsi_index *idx)
 {
-	DIR		*dir;
-	struct dirent	*entry;
-	char		session_path[1024] = { 0 };
-	char		connection_path[2048] = { 0 };
-	char		str[256] = { 0 };
+	struct iscsi_lun_info	key, *lun;
+	struct dirent		*entry;
+	DIR			*dir;
+	char			link[PATH_MAX], *p;
+	ssize_t			len;
 
-	print_trace_enter();
+	dir = opendir(SYSFS_BLOCK_PATH);
+	if (!dir)
+		return;
 
-	print_debug("Host: %s Path: %s \n", iscsi_info->host_name,
-	    iscsi_info->sys_dev_path);
+	for_each_dir(entry, dir) {
+		if (strncmp(entry->d_name, "sd", 2))
+			continue;
 
-	print_debug("Path: %s Session: %s \n", iscsi_info->session_path,
-	    iscsi_info->session_name);
+		len = readlinkat(dirfd(dir), entry->d_name, link,
+		    sizeof(link) - 1);
+		if (len <= 0)
+			continue;
+		link[len] = '\0';
 
-	/* Extract Connection Information */
-	sprintf(session_path, "/sys/class/iscsi_host/%s/device/%s",
-	    iscsi_info->host_name, iscsi_info->session_name);
+		/* ".../H:C:T:L/block/sdX" */
+		p = strstr(link, "/block/");
+		if (!p)
+			continue;
+		*p = '\0';
+		p = strrchr(link, '/');
+		if (!p || sscanf(p + 1, "%d:%d:%d:%d", &key.host, &key.channel,
+		    &key.target, &key.lun) != 4)
+			continue;
 
-	dir = opendir(session_path);
-	if (unlikely(!dir)) {
-		print_info(" No iSCSI Connections found for %s \n",
-			iscsi_info->session_name);
-		return 0;
+		lun = bsearch(&key, idx->luns, idx->nr_luns, sizeof(key),
+		    iscsi_hctl_cmp);
+		if (lun && !lun->disk_name)
+			lun->disk_name = strdup(entry->d_name);
 	}
+	closedir(dir);
+}
+
+static int iscsi_index_luns(struct iscsi_index *idx, int flags)
+{
+	struct iscsi_sess_info	*s;
+	struct iscsi_lun_info	*l;
+	struct dirent		*entry;
+	DIR			*dir;
+	char			*is_iscsi;
+	int			alloc = 0, i, h, c, t, n, sid;
+
+	dir = opendir(SYSFS_SCSI_DEV_PATH);
+	if (!dir)
+		return 0;
 
-	print_debug("Path: %s Session: %s \n", session_path,
-	    iscsi_info->session_name);
+	/* Only devices of iSCSI hosts need their link read */
+	is_iscsi = calloc(idx->nr_hosts + 1, 1);
+	if (!is_iscsi) {
+		closedir(dir);
+		return -ENOMEM;
+	}
+	for (i = 0; i < idx->nr_sessions; i++)
+		is_iscsi[idx->sessions[i].host_no] = 1;
 
 	for_each_dir(entry, dir) {
-		print_trace_enter();
-		if (!strncmp(entry->d_name, "connection", 10)) {
-			iscsi_info->connection_name = strdup(entry->d_name);
-			iscsi_info->connection_count++;
-			sprintf(connection_path, "%s/%s", session_path,
-			    iscsi_info->connection_name);
-			iscsi_info->connection_path = strdup(connection_path);
-			print_debug("Path: %s connection %s \n",
-				iscsi_info->connection_path,
-				iscsi_info->session_name);
+		if (sscanf(entry->d_name, "%d:%d:%d:%d", &h, &c, &t, &n) != 4 ||
+		    h < 0 || h >= idx->nr_hosts || !is_iscsi[h])
 			continue;
+
+		sid = iscsi_link_no(dirfd(dir), entry->d_name, "/session");
+		s = iscsi_index_session(idx, sid);
+		if (!s)
+			continue;
+		if (iscsi_grow(&idx->luns, idx->nr_luns, &alloc, sizeof(*l))) {
+			free(is_iscsi);
+			closedir(dir);
+			return -ENOMEM;
 		}
+
+		l = idx->luns + idx->nr_luns++;
+		memset(l, 0, sizeof(*l));
+		l->session_name = s->session_name;
+		l->host = h;
+		l->channel = c;
+		l->target = t;
+		l->lun = n;
+		l->sid = sid;
 	}
 	closedir(dir);
+	free(is_iscsi);
 
-	/* /sys/class/iscsi_session/session1/targetname */
-	memset(session_path, 0, sizeof(session_path));
-	sprintf(session_path, "/sys/class/iscsi_session/%s/%s",
-	    iscsi_info->session_name, "targetname");
-	sprintf(str, open_sysfs_stats_file(session_path));
-	iscsi_info->target_name = strdup(str);
-
-	print_debug("Path: %s Target Name:  %s \n",
-	    iscsi_info->connection_path, iscsi_info->target_name);
-
-	/* /sys/class/iscsi_connection/connection1:0/address */
-	memset(session_path, 0, sizeof(session_path));
-	sprintf(connection_path, "/sys/class/iscsi_connection/%s/%s",
-	    iscsi_info->connection_name, "address");
-	memset(str, 0, sizeof(str));
-	sprintf(str, open_sysfs_stats_file(connection_path));
-	iscsi_info->conn_address = strdup(str);
-
-	print_debug("Path: %s IP Add: %s \n",
-	    iscsi_info->connection_path, iscsi_info->conn_address);
-
-	/* /sys/class/iscsi_connection/connection1:0/port */
-	memset(session_path, 0, sizeof(session_path));
-	sprintf(connection_path, "/sys/class/iscsi_connection/%s/%s",
-	    iscsi_info->connection_name, "port");
-	memset(str, 0, sizeof(str));
-	sprintf(str, open_sysfs_stats_file(connection_path));
-	iscsi_info->conn_port = strdup(str);
-
-	print_debug("Path: %s Conn Port : %s \n",
-	    iscsi_info->connection_path, iscsi_info->conn_port);
+	if (!idx->nr_luns)
+		return 0;
+
+	if (flags & ISCSI_INDEX_LUNS) {
+		qsort(idx->luns, idx->nr_luns, sizeof(*l), iscsi_hctl_cmp);
+		iscsi_index_disks(idx);
+		parallel_for_each(idx->luns, idx->nr_luns, sizeof(*l),
+		    iscsi_read_lun, ISCSI_INDEX_JOBS);
+	}
+	qsort(idx->luns, idx->nr_luns, sizeof(*l), iscsi_lun_cmp);
+
+	for (i = 0; i < idx->nr_luns; i++) {
+		s = iscsi_index_session(idx, idx->luns[i].sid);
+		if (!s->nr_luns++)
+			s->lun_start = i;
+	}
 
 	return 0;
 }
 
-/*
- * Take input structure with host_name and fill up
- * Session related information
+/**
+ * iscsi_index_build() will read all iSCSI sessions with their connections
+ * and LUNs, 'flags' ISCSI_INDEX_LUNS adds the state and the disk name of
+ * each LUN
  */
-int fill_session_info(struct iscsi_dev_info *iscsi_info)
+int iscsi_index_build(struct iscsi_index *idx, int flags)
 {
-	DIR		*dir;
-	struct dirent	*entry;
-	char	host_path[512] = { 0};
-	char	iscsi_dev_path[1024] = { 0 };
+	int err;
 
 	print_trace_enter();
 
-	sprintf(host_path, "%s/%s/device", iscsi_info->sys_dev_path,
-		iscsi_info->host_name);
+	memset(idx, 0, sizeof(*idx));
 
-	dir = opendir(host_path);
-	if (unlikely(!dir)) {
-		print_info(" No iSCSI Sessions found for %s \n",
-			iscsi_info->host_name);
-		return 0;
+	err = iscsi_index_sessions(idx);
+	if (!err)
+		err = iscsi_index_conns(idx);
+	if (!err)
+		err = iscsi_index_luns(idx, flags);
+	if (err)
+		iscsi_index_free(idx);
+
+	return err;
+}
+
+/**
+ * iscsi_index_session() will look up session 'sid', NULL if unknown
+ */
+struct iscsi_sess_info *iscsi_index_session(struct iscsi_index *idx, int sid)
+{
+	struct iscsi_sess_info key;
+
+	if (!idx->nr_sessions)
+		return NULL;
+
+	key.sid = sid;
+
+	return bsearch(&key, idx->sessions, idx->nr_sessions, sizeof(key),
+	    iscsi_sess_cmp);
+}
+
+void iscsi_index_free(struct iscsi_index *idx)
+{
+	int i;
+
+	for (i = 0; i < idx->nr_sessions; i++) {
+		free(idx->sessions[i].targetname);
+		free(idx->sessions[i].state);
+		free(idx->sessions[i].ifacename);
 	}
+	for (i = 0; i < idx->nr_conns; i++) {
+		free(idx->conns[i].address);
+		free(idx->conns[i].port);
+		free(idx->conns[i].state);
+		free(idx->conns[i].persistent_address);
+		free(idx->conns[i].persistent_port);
+	}
+	for (i = 0; i < idx->nr_luns; i++) {
+		free(idx->luns[i].state);
+		free(idx->luns[i].disk_name);
+	}
+	for (i = 0; idx->transports && i < idx->nr_hosts; i++)
+		free(idx->transports[i]);
+	free(idx->transports);
+	free(idx->sessions);
+	free(idx->conns);
+	free(idx->luns);
+	memset(idx, 0, sizeof(*idx));
+}
 
-	print_debug(" %s %s \n", host_path, iscsi_info->host_name);
+/**
+ * list_iscsi_devs() will list every iSCSI session with its host, first
+ * connection and number of LUNs, and with --luns the LUNs themselves
+ */
+int list_iscsi_devs(struct iscsi_dev_info *iscsi_info __attribute__((unused)))
+{
+	struct iscsi_index	idx;
+	int			luns = cmd_opt_isset("luns"), i, err;
 
-	for_each_dir(entry, dir) {
-		print_trace_enter();
-		if (!strncmp(entry->d_name, "session", 7)) {
-			iscsi_info->session_name = strdup(entry->d_name);
-			print_debug("(%s) %s: %s \n", __func__, host_path,
-			    iscsi_info->session_name);
-			sprintf(iscsi_dev_path, "%s/%s", host_path,
-				iscsi_info->session_name);
-			iscsi_info->session_path = strdup(iscsi_dev_path);
-			iscsi_info->session_count++;
-			print_debug("(%s) %s: %s \n", __func__,
-			    iscsi_info->session_path, iscsi_info->session_name);
-			break;
-		}
+	print_trace_enter();
+
+	err = iscsi_index_build(&idx, luns ? ISCSI_INDEX_LUNS : 0);
+	if (err) {
+		print_info("\n No iSCSI sessions found \n");
+		return err;
 	}
-	closedir(dir);
 
-	print_debug(" Session Path %s, Session Name %s ",
-		iscsi_info->session_path, iscsi_info->session_name);
+	print_command_label("iSCSI");
 
-	return 0;
+	print_iscsi_dev_header();
+	for (i = 0; i < idx.nr_sessions; i++)
+		print_list_iscsi_dev(idx.sessions + i);
+
+	if (luns && idx.nr_luns) {
+		if (out_is_text())
+			out_printf("\n");
+		print_iscsi_lun_header();
+		for (i = 0; i < idx.nr_luns; i++)
+			print_iscsi_lun(idx.luns + i);
+	}
+
+	err = idx.nr_sessions;
+	iscsi_index_free(&idx);
+
+	return err;
 }
 
+/**
+ * show_iscsi_details() will show every session of the iSCSI host argv[3]
+ * with all of its connections
+ */
 int show_iscsi_details(char **argv, struct scsi_device_list *s_dev)
 {
 	struct	iscsi_dev_info		*iscsi_info = s_dev->iscsi_info;
-	struct	iscsi_session		*sess;
-	struct	iscsi_connection	*conn;
-	char	host_path[1024] = { 0};
-	int	err = 0;
+	struct	iscsi_session		sess;
+	struct	iscsi_connection	conn;
+	struct	iscsi_index		idx;
+	struct	iscsi_sess_info		*s;
+	char	path[PATH_MAX];
+	int	host_no, i, c, found = 0, err = 0;
 
 	print_trace_enter();
 
-	/* Allocate memory for session info */
-	sess = malloc(sizeof(struct iscsi_session));
-	if (!sess) {
-		err = -ENODEV;
-		goto sess_err_out;
+	if (!argv[3] || sscanf(argv[3], "host%d", &host_no) != 1) {
+		print_info("Please provide an iSCSI host, ex: host3");
+		return -EINVAL;
 	}
-	iscsi_info->session = sess;
 
-	/* Allocate memory for connection info */
-	conn = malloc(sizeof(struct iscsi_connection));
-	if (!conn) {
-		err = -ENODEV;
-		goto conn_err_out;
+	err = iscsi_index_build(&idx, 0);
+	if (err) {
+		print_info(" No iSCSI Sessions found for %s \n", argv[3]);
+		return err;
 	}
-	iscsi_info->connection = conn;
+
+	iscsi_info->session = &sess;
+	iscsi_info->connection = &conn;
 
 	/* copy host name from the input arg */
 	iscsi_info->host_name = strdup(argv[3]);
@@ -287,27 +651,44 @@ int show_iscsi_details(char **argv, struct scsi_device_list *s_dev)
 	print_debug("Show details for %s: %s",
 	    argv[2], iscsi_info->host_name);
 
-	snprintf(host_path, sizeof(host_path), "%s/%s/device", iscsi_info->sys_dev_path,
-		iscsi_info->host_name);
-
-	/* Fill Session Path and Session Name */
-	fill_session_info(iscsi_info);
-
-	/* Get Session Information */
-	get_iscsi_session_info(iscsi_info);
+	for (i = 0; i < idx.nr_sessions; i++) {
+		s = idx.sessions + i;
+		if (s->host_no != host_no)
+			continue;
+		found++;
+
+		free(iscsi_info->session_name);
+		free(iscsi_info->session_path);
+		snprintf(path, sizeof(path), "%s/%s/device/%s",
+		    iscsi_info->sys_dev_path, s->host_name, s->session_name);
+		iscsi_info->session_name = strdup(s->session_name);
+		iscsi_info->session_path = strdup(path);
+		iscsi_info->session_count++;
+
+		/* Get Session Information */
+		memset(&sess, 0, sizeof(sess));
+		get_iscsi_session_info(iscsi_info);
+
+		/* Get Connection Information */
+		for (c = s->conn_start; c < s->conn_start + s->nr_conns; c++) {
+			free(iscsi_info->connection_name);
+			iscsi_info->connection_name =
+			    strdup(idx.conns[c].connection_name);
+			iscsi_info->connection_count++;
 
-	/* Fill Connection Path and Name */
-	fill_connection_info(iscsi_info);
+			memset(&conn, 0, sizeof(conn));
+			get_iscsi_connection_info(iscsi_info);
+		}
+	}
 
-	/* Get Connection Information */
-	get_iscsi_connection_info(iscsi_info);
+	if (!found) {
+		print_info(" No iSCSI Sessions found for %s \n", argv[3]);
+		err = -ENODEV;
+	}
 
-conn_err_out:
-	if (conn)
-		free(conn);
-sess_err_out:
-	if (sess)
-		free(sess);
+	iscsi_info->session = NULL;
+	iscsi_info->connection = NULL;
+	iscsi_index_free(&idx);
 
 	return err;
 }
@@ -320,6 +701,7 @@ int get_iscsi_disk_hctl(struct iscsi_dev_info *iscsi_dev)
 	char		disk_path[2048];
 	char		disk_name[64];
 	char		disk_state[64];
+	char		*entry;
 
 	print_trace_enter();
 
@@ -355,8 +737,8 @@ int get_iscsi_disk_hctl(struct iscsi_dev_info *iscsi_dev)
 
 		snprintf(iscsi_disk_path, sizeof(iscsi_disk_path), "%s/%s/%s",
 		    iscsi_dev->session_disk_path, dent->d_name, "type");
-		snprintf(iscsi_disk_type, sizeof(iscsi_disk_type),
-		    open_sysfs_stats_file(iscsi_disk_path));
+		snprintf(iscsi_disk_type, sizeof(iscsi_disk_type), "%s",
+		    iscsi_sysfs_str(iscsi_disk_path));
 		disk_type = strtoull(iscsi_disk_type, &end, 0);
 
 		print_debug("%s: %s = %s ( %s )\n", __func__, iscsi_disk_path,
@@ -376,8 +758,9 @@ int get_iscsi_disk_hctl(struct iscsi_dev_info *iscsi_dev)
 				snprintf(disk_path, sizeof(disk_path),
 				    "/sys/class/scsi_disk/%s/device/block",
 				    dent->d_name);
-				snprintf(disk_name, sizeof(disk_name),
-				    get_device_entry(disk_path));
+				entry = get_device_entry(disk_path);
+				snprintf(disk_name, sizeof(disk_name), "%s",
+				    entry ? entry : "unknown");
 				print_debug(" disk Path %s, disk name %s\n",
 				    disk_path, disk_name);
 
@@ -386,15 +769,13 @@ int get_iscsi_disk_hctl(struct iscsi_dev_info *iscsi_dev)
 				snprintf(disk_path, sizeof(disk_path),
 				    "/sys/class/scsi_disk/%s/device/state",
 				    dent->d_name);
-				snprintf(disk_state, sizeof(disk_state),
-				    open_sysfs_stats_file(disk_path));
+				snprintf(disk_state, sizeof(disk_state), "%s",
+				    iscsi_sysfs_str(disk_path));
 				print_debug(" Disk Name: %s, Disk State: %s \n",
 				    disk_name, disk_state);
 
-				print_iscsi_scsi_disk(iscsi_dev);
-				printf(" \tAttached Scsi Disk: %s\tState: %s \n",
-				    disk_name, disk_state);
-				printf("\n");
+				print_iscsi_scsi_disk(iscsi_dev, disk_name,
+				    disk_state);
 			}
 		}
 	}
@@ -445,9 +826,7 @@ int get_iscsi_session_info(struct iscsi_dev_info *iscsi_dev)
 	DIR		*dir;
 	char	disk_attached_path[4096] = { 0 };
 	char	session_path[1024] = { 0 };
-	char	session_str[2048] = { 0 };
-	char	str[256] = { 0 };
-	char	*end;
+	int	dfd;
 	struct	iscsi_session *sess = iscsi_dev->session;
 
 	print_trace_enter();
@@ -455,138 +834,33 @@ int get_iscsi_session_info(struct iscsi_dev_info *iscsi_dev)
 	snprintf(session_path, sizeof(session_path), "%s/%s",
 	    SYSFS_ISCSI_SESS_PATH, iscsi_dev->session_name);
 
-	/* /sys/class/iscsi_session/session1/initiatorname */
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "initiatorname");
-	snprintf(str, sizeof(str), open_sysfs_stats_file(session_str));
-	sess->initiatorname = strdup(str);
-
-	/* /sys/class/iscsi_session/session1/targetname */
-	memset(str, 0, sizeof(str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "targetname");
-	snprintf(str, sizeof(str), open_sysfs_stats_file(session_str));
-	sess->targetname = strdup(str);
-
-	/* sys/class/iscsi_session/session1/port */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "target_id");
-	sess->target_id = strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/state */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "state");
-	memset(str, 0, sizeof(str));
-	snprintf(str, sizeof(str), open_sysfs_stats_file(session_str));
-	sess->state = strdup(str);
-
-	/* /sys/class/iscsi_session/session1/target_state */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "target_state");
-	memset(str, 0, sizeof(str));
-	snprintf(str, sizeof(str), open_sysfs_stats_file(session_str));
-	sess->target_state = strdup(str);
-
-	/* /sys/class/iscsi_session/session1/abort_tmo */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "abort_tmo");
-	sess->abort_tmo =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/creator */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "creator");
-	sess->creator = strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/data_pdu_in_order */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "data_pdu_in_order");
-	sess->data_pdu_in_order =
-	       strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/data_seq_in_order */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "data_seq_in_order");
-	sess->data_seq_in_order =
-	       strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/erl */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "erl");
-	sess->err_level =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/fast_abort */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "fast_abort");
-	sess->fast_abort =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/first_burst_len */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "first_burst_len");
-	sess->first_burst_len =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/targetname */
-	memset(session_str, 0, sizeof(session_str));
-	memset(str, 0, sizeof(str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "ifacename");
-	snprintf(str, sizeof(str), open_sysfs_stats_file(session_str));
-	sess->ifacename = strdup(str);
-
-	/* /sys/class/iscsi_session/session1/immediate_data */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "immediate_data");
-	sess->immediate_data =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/initial_r2t */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "initial_r2t");
-	sess->initial_r2t =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/lun_reset_tmo */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "lu_reset_tmo");
-	sess->lu_reset_tmo =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/max_burst_len */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "max_burst_len");
-	sess->max_burst_len =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/max_outstanding_r2t */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "max_outstanding_r2t");
-	sess->max_outstanding_r2t =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
-
-	/* /sys/class/iscsi_session/session1/recovery_tmo */
-	memset(session_str, 0, sizeof(session_str));
-	snprintf(session_str, sizeof(session_str), "%s/%s", session_path,
-	    "recovery_tmo");
-	sess->recovery_tmo =
-	    strtoull(open_sysfs_stats_file(session_str), &end, 0);
+	/* Attributes missing on this kernel are left NULL or -1 */
+	dfd = open(session_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return -ENODEV;
+
+	sess->initiatorname = iscsi_attr_str(dfd, "initiatorname");
+	sess->targetname = iscsi_attr_str(dfd, "targetname");
+	sess->target_id = iscsi_attr_int(dfd, "target_id");
+	sess->state = iscsi_attr_str(dfd, "state");
+	sess->target_state = iscsi_attr_str(dfd, "target_state");
+	sess->abort_tmo = iscsi_attr_int(dfd, "abort_tmo");
+	sess->creator = iscsi_attr_int(dfd, "creator");
+	sess->data_pdu_in_order = iscsi_attr_int(dfd, "data_pdu_in_order");
+	sess->data_seq_in_order = iscsi_attr_int(dfd, "data_seq_in_order");
+	sess->err_level = iscsi_attr_int(dfd, "erl");
+	sess->fast_abort = iscsi_attr_int(dfd, "fast_abort");
+	sess->first_burst_len = iscsi_attr_int(dfd, "first_burst_len");
+	sess->ifacename = iscsi_attr_str(dfd, "ifacename");
+	sess->immediate_data = iscsi_attr_int(dfd, "immediate_data");
+	sess->initial_r2t = iscsi_attr_int(dfd, "initial_r2t");
+	sess->lu_reset_tmo = iscsi_attr_int(dfd, "lu_reset_tmo");
+	sess->max_burst_len = iscsi_attr_int(dfd, "max_burst_len");
+	sess->max_outstanding_r2t = iscsi_attr_int(dfd, "max_outstanding_r2t");
+	sess->recovery_tmo = iscsi_attr_int(dfd, "recovery_tmo");
+	sess->tgt_reset_tmo = iscsi_attr_int(dfd, "tgt_reset_tmo");
+	sess->tpgt = iscsi_attr_int(dfd, "tpgt");
+	close(dfd);
 
 	dir = opendir(iscsi_dev->session_path);
 	if (unlikely(!dir))
@@ -615,8 +889,10 @@ int get_iscsi_session_info(struct iscsi_dev_info *iscsi_dev)
 		}
 	}
 
-	print_debug(" Session str %s , InitiatorName %s targetname %s",
-		session_str, sess->initiatorname, sess->targetname);
+	closedir(dir);
+
+	print_debug(" Session %s , InitiatorName %s targetname %s",
+		session_path, sess->initiatorname, sess->targetname);
 
 	return 0;
 }
@@ -624,77 +900,31 @@ int get_iscsi_session_info(struct iscsi_dev_info *iscsi_dev)
 int get_iscsi_connection_info(struct iscsi_dev_info *iscsi_dev)
 {
 	char	conn_path[1024] = { 0 };
-	char	conn_str[2048] = { 0 };
-	char	str[256] = { 0 };
-	char	*end;
+	int	dfd;
 	struct	iscsi_connection *conn = iscsi_dev->connection;
 
 	print_trace_enter();
 
-	sprintf(conn_path, "%s/%s", SYSFS_ISCSI_CONN_PATH,
+	snprintf(conn_path, sizeof(conn_path), "%s/%s", SYSFS_ISCSI_CONN_PATH,
 		iscsi_dev->connection_name);
 
-	/* /sys/class/iscsi_connection/connection1:0/address */
-	sprintf(conn_str, "%s/%s", conn_path, "address");
-	sprintf(str, open_sysfs_stats_file(conn_str));
-	conn->address = strdup(str);
-
-	/* /sys/class/iscsi_connection/connection1:0/max_recv_dlength */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "max_recv_dlength");
-	conn->max_recv_dlength =
-	       strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/max_xmit_dlength */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "max_xmit_dlength");
-	conn->max_xmit_dlength =
-	       strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/data_digest */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "data_digest");
-	conn->data_digest = strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/exp_statsn */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "exp_statsn");
-	conn->exp_statsn = strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/header_digest */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "header_digest");
-	conn->header_digest = strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/persistent_address */
-	sprintf(conn_str, "%s/%s", conn_path, "persistent_address");
-	sprintf(str, open_sysfs_stats_file(conn_str));
-	conn->persistent_address = strdup(str);
-
-	/* /sys/class/iscsi_connection/connection1:0/persistent_port */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "persistent_port");
-	conn->persistent_port = strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/ping_tmo */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "ping_tmo");
-	conn->ping_tmo = strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/port */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "port");
-	conn->port = strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/recv_tmo */
-	memset(conn_str, 0, sizeof(conn_str));
-	sprintf(conn_str, "%s/%s", conn_path, "recv_tmo");
-	conn->recv_tmo = strtoull(open_sysfs_stats_file(conn_str), &end, 0);
-
-	/* /sys/class/iscsi_connection/connection1:0/state */
-	sprintf(conn_str, "%s/%s", conn_path, "state");
-	sprintf(str, open_sysfs_stats_file(conn_str));
-	conn->state = strdup(str);
+	dfd = open(conn_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return -ENODEV;
+
+	conn->address = iscsi_attr_str(dfd, "address");
+	conn->max_recv_dlength = iscsi_attr_int(dfd, "max_recv_dlength");
+	conn->max_xmit_dlength = iscsi_attr_int(dfd, "max_xmit_dlength");
+	conn->data_digest = iscsi_attr_int(dfd, "data_digest");
+	conn->exp_statsn = iscsi_attr_int(dfd, "exp_statsn");
+	conn->header_digest = iscsi_attr_int(dfd, "header_digest");
+	conn->persistent_address = iscsi_attr_str(dfd, "persistent_address");
+	conn->persistent_port = iscsi_attr_int(dfd, "persistent_port");
+	conn->ping_tmo = iscsi_attr_int(dfd, "ping_tmo");
+	conn->port = iscsi_attr_int(dfd, "port");
+	conn->recv_tmo = iscsi_attr_int(dfd, "recv_tmo");
+	conn->state = iscsi_attr_str(dfd, "state");
+	close(dfd);
 
 	print_iscsi_header("Connection", iscsi_dev->connection_name);
 
@@ -752,15 +982,15 @@ int get_iscsi_info(struct iscsi_dev_info *iscsi_dev)
 	iscsi_dev->connection = connection;
 
 	sprintf(iscsi_dev_path, "%s/%s", iscsi_sysfs_host_path, "hwaddress");
-	sprintf(str, open_sysfs_stats_file(iscsi_dev_path));
+	snprintf(str, sizeof(str), "%s", iscsi_sysfs_str(iscsi_dev_path));
 	host->hwaddress = strdup(str);
 
 	sprintf(iscsi_dev_path, "%s/%s", iscsi_sysfs_host_path, "ipaddress");
-	sprintf(str, open_sysfs_stats_file(iscsi_dev_path));
+	snprintf(str, sizeof(str), "%s", iscsi_sysfs_str(iscsi_dev_path));
 	host->ipaddress = strdup(str);
 
 	sprintf(iscsi_dev_path, "%s/%s", iscsi_sysfs_host_path, "netdev");
-	sprintf(str, open_sysfs_stats_file(iscsi_dev_path));
+	snprintf(str, sizeof(str), "%s", iscsi_sysfs_str(iscsi_dev_path));
 	host->netdev = strdup(str);
 
 	/* Extract Session Information */
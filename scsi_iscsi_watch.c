@@ -0,0 +1,419 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+
+#include "scsi.h"
+#include "scsi_iscsi.h"
+#include "scsi_print.h"
+
+/*
+ * iSCSI session watcher
+ *
+ * The session 'state' and 'target_state' and the connection 'state' of
+ * every session stay open for the whole watch. Each round polls them for
+ * POLLPRI, which sysfs raises when a driver notifies an attribute, and
+ * otherwise waits at most the interval; then every attribute is read
+ * again with pread() on its open file. The iSCSI transport does not
+ * notify these attributes today, so the interval is the resolution of
+ * the outage times.
+ */
+
+#define WATCH_ISCSI_INTERVAL	100	/* ms between two rounds */
+#define WATCH_ISCSI_UP		"LOGGED_IN"
+#define WATCH_ISCSI_GONE	"gone"
+
+struct watch_attr {
+	int		sess;		/* index in the session table */
+	const char	*class_path;
+	const char	*object;	/* sessionN or connectionN:C */
+	const char	*attr;
+	int		fd;		/* -1 when out of files */
+	char		value[24];
+};
+
+struct watch_sess {
+	int	state;			/* index of its state attr */
+	u64	down_since;		/* monotonic ms, 0 when up */
+	int	down_at_start;
+	int	expired;		/* recovery_tmo ran out meanwhile */
+};
+
+struct iscsi_watch {
+	struct iscsi_index	idx;
+	struct watch_attr	*attrs;
+	int			nr_attrs;
+	struct watch_sess	*sess;
+	struct iscsi_outage	*outages;
+	struct pollfd		*pfds;
+	int			nr_pfds;
+};
+
+static volatile sig_atomic_t watch_stop;
+
+static void watch_signal(int sig __attribute__((unused)))
+{
+	watch_stop = 1;
+}
+
+static void watch_time(char *buf, size_t len)
+{
+	struct timespec	ts;
+	struct tm	tm;
+	char		hms[16];
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	localtime_r(&ts.tv_sec, &tm);
+	strftime(hms, sizeof(hms), "%H:%M:%S", &tm);
+	snprintf(buf, len, "%.8s.%03u", hms,
+	    (unsigned int)(ts.tv_nsec / 1000000) % 1000);
+}
+
+/* Read an attribute again, "gone" once its session was removed */
+static void watch_read(struct watch_attr *a, char *buf, size_t len)
+{
+	char	path[PATH_MAX];
+	ssize_t	n;
+	int	fd = a->fd;
+
+	if (fd < 0) {
+		snprintf(path, sizeof(path), "%s/%s/%s", a->class_path,
+		    a->object, a->attr);
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+	}
+
+	n = fd < 0 ? -1 : pread(fd, buf, len - 1, 0);
+	if (fd >= 0 && fd != a->fd)
+		close(fd);
+
+	if (n < 0) {
+		snprintf(buf, len, "%s", WATCH_ISCSI_GONE);
+		return;
+	}
+
+	buf[n] = '\0';
+	if (n && buf[n - 1] == '\n')
+		buf[n - 1] = '\0';
+}
+
+static void watch_event(struct watch_attr *a, const char *attr,
+    const char *old, const char *new, const char *note)
+{
+	struct iscsi_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	watch_time(ev.time, sizeof(ev.time));
+	snprintf(ev.object, sizeof(ev.object), "%s", a->object);
+	snprintf(ev.attr, sizeof(ev.attr), "%s", attr);
+	snprintf(ev.old, sizeof(ev.old), "%s", old);
+	snprintf(ev.new, sizeof(ev.new), "%s", new);
+	snprintf(ev.note, sizeof(ev.note), "%s", note);
+
+	print_iscsi_event(&ev);
+	out_flush();
+}
+
+/**
+ * watch_session_state() will account a change of the session state seen
+ * at 't': leaving LOGGED_IN starts an outage, coming back ends it
+ */
+static void watch_session_state(struct iscsi_watch *w, struct watch_attr *a,
+    const char *old, u64 t)
+{
+	struct watch_sess	*ws = w->sess + a->sess;
+	struct iscsi_outage	*o = w->outages + a->sess;
+	char			note[64] = "";
+	u64			ms;
+
+	if (strcmp(a->value, WATCH_ISCSI_UP)) {
+		if (!ws->down_since)
+			ws->down_since = t;
+		watch_event(a, a->attr, old, a->value, note);
+		return;
+	}
+
+	if (!ws->down_since) {
+		watch_event(a, a->attr, old, a->value, note);
+		return;
+	}
+
+	ms = t - ws->down_since;
+	o->outages++;
+	o->last_ms = ms;
+	o->total_ms += ms;
+	if (ms > o->max_ms)
+		o->max_ms = ms;
+
+	if (o->recovery_tmo >= 0 && ms > o->recovery_tmo * 1000ULL) {
+		o->exceeded++;
+		snprintf(note, sizeof(note), "down %s%llu ms, over %d s tmo",
+		    ws->down_at_start ? ">=" : "", ms, o->recovery_tmo);
+	} else {
+		snprintf(note, sizeof(note), "down %s%llu ms, tmo %d s",
+		    ws->down_at_start ? ">=" : "", ms, o->recovery_tmo);
+	}
+	watch_event(a, a->attr, old, a->value, note);
+
+	ws->down_since = 0;
+	ws->down_at_start = 0;
+	ws->expired = 0;
+}
+
+/* Read every attribute and report what changed since the last round */
+static void watch_round(struct iscsi_watch *w, u64 t)
+{
+	struct watch_attr	*a;
+	struct watch_sess	*ws;
+	struct iscsi_outage	*o;
+	char			val[sizeof(a->value)];
+	char			old[sizeof(a->value)];
+	int			i;
+
+	for (i = 0; i < w->nr_attrs; i++) {
+		a = w->attrs + i;
+		watch_read(a, val, sizeof(val));
+		if (!strcmp(val, a->value))
+			continue;
+
+		memcpy(old, a->value, sizeof(old));
+		memcpy(a->value, val, sizeof(val));
+
+		if (!strcmp(val, WATCH_ISCSI_GONE) && a->fd >= 0) {
+			close(a->fd);
+			a->fd = -1;
+		}
+
+		if (w->sess[a->sess].state == i)
+			watch_session_state(w, a, old, t);
+		else
+			watch_event(a, a->attr, old, val, "");
+	}
+
+	/* Past recovery_tmo the kernel fails the I/O queued on the session */
+	for (i = 0; i < w->idx.nr_sessions; i++) {
+		ws = w->sess + i;
+		o = w->outages + i;
+		if (ws->state < 0 || !ws->down_since || ws->down_at_start ||
+		    ws->expired || o->recovery_tmo < 0 ||
+		    t - ws->down_since <= o->recovery_tmo * 1000ULL)
+			continue;
+
+		ws->expired = 1;
+		a = w->attrs + ws->state;
+		watch_event(a, "recovery_tmo", a->value, "expired",
+		    "queued I/O is failed");
+	}
+}
+
+static int watch_add(struct iscsi_watch *w, int sess, const char *class_path,
+    const char *object, const char *attr)
+{
+	struct watch_attr	*a = w->attrs + w->nr_attrs;
+	char			path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/%s/%s", class_path, object, attr);
+	a->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (a->fd < 0 && errno != EMFILE && errno != ENFILE) {
+		print_debug("%s: %s", path, strerror(errno));
+		return -errno;
+	}
+
+	a->sess = sess;
+	a->class_path = class_path;
+	a->object = object;
+	a->attr = attr;
+	watch_read(a, a->value, sizeof(a->value));
+	w->nr_attrs++;
+
+	if (a->fd >= 0) {
+		w->pfds[w->nr_pfds].fd = a->fd;
+		w->pfds[w->nr_pfds].events = POLLPRI;
+		w->nr_pfds++;
+	}
+
+	return 0;
+}
+
+static int watch_setup(struct iscsi_watch *w, u64 t)
+{
+	struct iscsi_sess_info	*s;
+	struct watch_attr	*a;
+	int			i, j, nr;
+
+	nr = w->idx.nr_sessions * 2 + w->idx.nr_conns;
+	w->attrs = calloc(nr, sizeof(*w->attrs));
+	w->pfds = calloc(nr, sizeof(*w->pfds));
+	w->sess = calloc(w->idx.nr_sessions, sizeof(*w->sess));
+	w->outages = calloc(w->idx.nr_sessions, sizeof(*w->outages));
+	if (!w->attrs || !w->pfds || !w->sess || !w->outages)
+		return -ENOMEM;
+
+	raise_nofile_limit(nr + 64);
+
+	for (i = 0; i < w->idx.nr_sessions; i++) {
+		s = w->idx.sessions + i;
+
+		snprintf(w->outages[i].session_name,
+		    sizeof(w->outages[i].session_name), "%s", s->session_name);
+		w->outages[i].targetname = s->targetname;
+		w->outages[i].recovery_tmo = s->recovery_tmo;
+
+		w->sess[i].state = -1;
+		if (watch_add(w, i, SYSFS_ISCSI_SESS_PATH, s->session_name,
+		    "state"))
+			continue;
+
+		w->sess[i].state = w->nr_attrs - 1;
+		a = w->attrs + w->sess[i].state;
+		if (strcmp(a->value, WATCH_ISCSI_UP)) {
+			w->sess[i].down_since = t;
+			w->sess[i].down_at_start = 1;
+			watch_event(a, "state", "-", a->value, "down at start");
+		}
+
+		/* Older kernels have no target_state */
+		watch_add(w, i, SYSFS_ISCSI_SESS_PATH, s->session_name,
+		    "target_state");
+
+		for (j = 0; j < s->nr_conns; j++)
+			watch_add(w, i, SYSFS_ISCSI_CONN_PATH,
+			    w->idx.conns[s->conn_start + j].connection_name,
+			    "state");
+	}
+
+	return 0;
+}
+
+static void watch_free(struct iscsi_watch *w)
+{
+	int i;
+
+	for (i = 0; w->attrs && i < w->nr_attrs; i++) {
+		if (w->attrs[i].fd >= 0)
+			close(w->attrs[i].fd);
+	}
+	free(w->attrs);
+	free(w->pfds);
+	free(w->sess);
+	free(w->outages);
+	iscsi_index_free(&w->idx);
+}
+
+/**
+ * watch_iscsi_sessions() will report every state change of the iSCSI
+ * sessions and connections, checking them every 'interval_ms'
+ * milliseconds (0 for the default) for 'count' rounds or until
+ * interrupted. The outages of each session are then summed up against
+ * its recovery_tmo.
+ */
+int watch_iscsi_sessions(unsigned int interval_ms, unsigned int count)
+{
+	struct iscsi_watch	w;
+	struct iscsi_outage	*o;
+	struct sigaction	sa;
+	unsigned int		n;
+	int			i, err, shown = 0;
+
+	print_trace_enter();
+
+	memset(&w, 0, sizeof(w));
+	if (!interval_ms)
+		interval_ms = WATCH_ISCSI_INTERVAL;
+
+	err = iscsi_index_build(&w.idx, 0);
+	if (err) {
+		print_err("No iSCSI sessions found");
+		return err;
+	}
+
+	if (!w.idx.nr_sessions) {
+		print_err("No iSCSI sessions found");
+		err = -ENODEV;
+		goto out;
+	}
+
+	if (out_is_text())
+		out_printf("Watching %d iSCSI sessions and %d connections "
+		    "every %u ms, Ctrl-C to stop\n", w.idx.nr_sessions,
+		    w.idx.nr_conns, interval_ms);
+	print_iscsi_event_header();
+	out_flush();
+
+	err = watch_setup(&w, now_ms());
+	if (err)
+		goto out;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = watch_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	for (n = 0; !watch_stop && (!count || n < count); n++) {
+		if (poll(w.pfds, w.nr_pfds, interval_ms) < 0 &&
+		    errno != EINTR) {
+			err = -errno;
+			break;
+		}
+		if (watch_stop)
+			break;
+
+		watch_round(&w, now_ms());
+	}
+
+	print_iscsi_outage_header();
+	for (i = 0; i < w.idx.nr_sessions; i++) {
+		o = w.outages + i;
+		if (!o->outages && !w.sess[i].down_since)
+			continue;
+
+		snprintf(o->state, sizeof(o->state), "%s",
+		    w.attrs[w.sess[i].state].value);
+		print_iscsi_outage(o);
+		shown++;
+	}
+	if (!shown && out_is_text())
+		out_printf("No outage on %d sessions\n", w.idx.nr_sessions);
+
+out:
+	watch_free(&w);
+
+	return err;
+}
@@ -0,0 +1,487 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scsi.h"
+#include "scsi_numa.h"
+#include "scsi_print.h"
+
+/*
+ * blk-mq queue maps
+ *
+ * Each hardware queue of a disk lists the CPUs submitting to it in
+ * /sys/block/X/mq/N/cpu_list. An online CPU found in no queue has its
+ * I/O pushed to a queue of other CPUs, a queue without online CPUs
+ * holds tags nobody uses, and queues serving very different numbers of
+ * CPUs make some CPUs wait for tags while others have plenty. A CPU
+ * shows up in several queues when the driver has more than one map
+ * (read or poll queues), the queue sizes are then not compared.
+ */
+
+#define MQ_MATRIX_COLS	64
+
+struct mq_queue {
+	struct mq_queue_info	info;
+	struct cpu_mask		cpus;
+};
+
+struct mq_disk {
+	struct mq_map_info	info;
+	struct mq_queue		*queues;
+	int			nr_queues;
+	int			err;
+};
+
+static struct cpu_mask	mq_online;
+static int		mq_nr_online;
+static int		mq_cpu_end;	/* last online CPU + 1 */
+
+/* Online CPUs and NUMA nodes are read once, before any thread starts */
+static int mq_setup(void)
+{
+	mq_nr_online = cpu_online_mask(&mq_online);
+	if (mq_nr_online < 0) {
+		print_err("Can not read the online CPUs (%s)",
+		    strerror(-mq_nr_online));
+		return mq_nr_online;
+	}
+	for (mq_cpu_end = CPU_MASK_BITS; mq_cpu_end > 0 &&
+	    !cpu_mask_test(&mq_online, mq_cpu_end - 1); mq_cpu_end--)
+		;
+	numa_nr_nodes();
+
+	return 0;
+}
+
+static int mq_queue_cmp(const void *a, const void *b)
+{
+	const struct mq_queue *x = a, *y = b;
+
+	return x->info.hctx < y->info.hctx ? -1 : x->info.hctx > y->info.hctx;
+}
+
+static int mq_read_queue(int mqfd, const char *name, struct mq_queue *q)
+{
+	char	buf[4096];
+	int	fd, err;
+
+	fd = openat(mqfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	err = sysfs_read_at(fd, "cpu_list", buf, sizeof(buf));
+	if (err >= 0)
+		err = cpulist_parse(buf, &q->cpus);
+	if (!err && sysfs_read_at(fd, "nr_tags", buf, sizeof(buf)) > 0)
+		q->info.nr_tags = atoi(buf);
+	if (!err && sysfs_read_at(fd, "nr_reserved_tags", buf,
+	    sizeof(buf)) > 0)
+		q->info.nr_reserved_tags = atoi(buf);
+	close(fd);
+
+	return err < 0 ? err : 0;
+}
+
+/* Hardware queues of the disk, sorted by number */
+static int mq_read_queues(struct mq_disk *d)
+{
+	struct mq_queue	*q;
+	struct dirent	*dent;
+	DIR		*dir;
+	char		path[PATH_MAX], *end;
+	long		hctx;
+	int		size = 0;
+
+	snprintf(path, sizeof(path), "%s/%s/mq", SYSFS_BLOCK_PATH,
+	    d->info.disk_name);
+	dir = opendir(path);
+	if (!dir)
+		return -errno;
+
+	for_each_dir(dent, dir) {
+		hctx = strtol(dent->d_name, &end, 10);
+		if (*end || end == dent->d_name || hctx < 0 || hctx > INT_MAX)
+			continue;
+
+		if (d->nr_queues == size) {
+			size = size ? size * 2 : 16;
+			q = realloc(d->queues, size * sizeof(*q));
+			if (!q) {
+				closedir(dir);
+				return -ENOMEM;
+			}
+			d->queues = q;
+		}
+
+		q = d->queues + d->nr_queues;
+		memset(q, 0, sizeof(*q));
+		if (mq_read_queue(dirfd(dir), dent->d_name, q))
+			continue;
+
+		q->info.hctx = hctx;
+		snprintf(q->info.disk_name, sizeof(q->info.disk_name), "%s",
+		    d->info.disk_name);
+		d->nr_queues++;
+	}
+	closedir(dir);
+
+	if (!d->nr_queues)
+		return -ENOENT;
+
+	qsort(d->queues, d->nr_queues, sizeof(*d->queues), mq_queue_cmp);
+
+	return 0;
+}
+
+static void mq_status(struct mq_map_info *m, int uneven)
+{
+	const char	*flags[4];
+	size_t		pos = 0;
+	int		i, nr = 0;
+
+	if (strcmp(m->unmapped, "-"))
+		flags[nr++] = "cpus-unmapped";
+	if (m->idle_queues)
+		flags[nr++] = "idle-queues";
+	if (uneven)
+		flags[nr++] = "uneven";
+	if (m->cross_node)
+		flags[nr++] = "cross-node";
+
+	/* All four flags fit in status */
+	snprintf(m->status, sizeof(m->status), "ok");
+	for (i = 0; i < nr; i++)
+		pos += snprintf(m->status + pos, sizeof(m->status) - pos,
+		    "%s%s", i ? "," : "", flags[i]);
+}
+
+/*
+ * Fold the queues into the summary of the disk: which online CPUs no
+ * queue serves, how many online CPUs each queue serves and how many
+ * queues a single CPU is in.
+ */
+static void mq_summarize(struct mq_disk *d)
+{
+	struct mq_map_info	*m = &d->info;
+	struct mq_queue		*q;
+	struct cpu_mask		online, mapped;
+	u16			*hits;
+	u64			nodes;
+	int			i, cpu, lo = INT_MAX, hi = 0, uneven;
+	size_t			w;
+
+	hits = calloc(mq_cpu_end + 1, sizeof(*hits));
+	memset(&mapped, 0, sizeof(mapped));
+
+	m->nr_hw_queues = d->nr_queues;
+	m->nr_cpus = mq_nr_online;
+	m->nr_tags = 0;
+
+	for (i = 0; i < d->nr_queues; i++) {
+		q = d->queues + i;
+
+		for (w = 0; w < ARRAY_SIZE(online.bits); w++) {
+			online.bits[w] = q->cpus.bits[w] & mq_online.bits[w];
+			mapped.bits[w] |= online.bits[w];
+		}
+
+		q->info.nr_cpus = cpu_mask_weight(&online);
+		nodes = numa_nodes_of(&online);
+		nodelist_format(nodes, q->info.nodes, sizeof(q->info.nodes));
+		cpulist_format(&q->cpus, q->info.cpu_list,
+		    sizeof(q->info.cpu_list));
+
+		if (!q->info.nr_cpus) {
+			m->idle_queues++;
+		} else {
+			lo = min(lo, q->info.nr_cpus);
+			hi = q->info.nr_cpus > hi ? q->info.nr_cpus : hi;
+		}
+
+		/* Keeping nodes apart needs a queue per node at least */
+		if (__builtin_popcountll(nodes) > 1 &&
+		    d->nr_queues >= numa_nr_nodes())
+			m->cross_node++;
+
+		if (!m->nr_tags || q->info.nr_tags < m->nr_tags)
+			m->nr_tags = q->info.nr_tags;
+
+		for (cpu = 0; hits && cpu < mq_cpu_end; cpu++) {
+			if (!cpu_mask_test(&online, cpu))
+				continue;
+			if (hits[cpu]++ == m->nr_maps)
+				m->nr_maps++;
+		}
+	}
+	free(hits);
+
+	for (w = 0; w < ARRAY_SIZE(online.bits); w++)
+		online.bits[w] = mq_online.bits[w] & ~mapped.bits[w];
+	cpulist_format(&online, m->unmapped, sizeof(m->unmapped));
+
+	if (!hi)
+		snprintf(m->cpus_per_queue, sizeof(m->cpus_per_queue), "-");
+	else if (lo == hi)
+		snprintf(m->cpus_per_queue, sizeof(m->cpus_per_queue), "%d",
+		    lo);
+	else
+		snprintf(m->cpus_per_queue, sizeof(m->cpus_per_queue), "%d-%d",
+		    lo, hi);
+
+	/* Spreading CPUs evenly leaves at most one CPU of difference */
+	uneven = m->nr_maps == 1 && hi - lo > 1;
+	mq_status(m, uneven);
+}
+
+static int mq_read_disk(struct mq_disk *d)
+{
+	char	path[PATH_MAX], buf[32];
+	int	fd, err;
+
+	err = mq_read_queues(d);
+	if (err)
+		return err;
+
+	snprintf(path, sizeof(path), "%s/%s/queue", SYSFS_BLOCK_PATH,
+	    d->info.disk_name);
+	fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd >= 0) {
+		if (sysfs_read_at(fd, "nr_requests", buf, sizeof(buf)) > 0)
+			d->info.nr_requests = atoi(buf);
+		if (sysfs_read_at(fd, "rq_affinity", buf, sizeof(buf)) > 0)
+			d->info.rq_affinity = atoi(buf);
+		close(fd);
+	}
+
+	mq_summarize(d);
+
+	return 0;
+}
+
+/* Runs on a pooled thread, only the summary is kept */
+static void mq_disk_work(void *arg)
+{
+	struct mq_disk *d = arg;
+
+	d->err = mq_read_disk(d);
+	free(d->queues);
+	d->queues = NULL;
+}
+
+static int mq_disk_cmp(const void *a, const void *b)
+{
+	const struct mq_disk *x = a, *y = b;
+
+	return dev_name_cmp(x->info.disk_name, y->info.disk_name);
+}
+
+/**
+ * list_mq() will show how the online CPUs map to the hardware queues of
+ * every blk-mq disk, flagging disks with unmapped CPUs, queues without
+ * CPUs, uneven queues or queues spanning NUMA nodes
+ */
+int list_mq(void)
+{
+	struct mq_disk	*disks = NULL, *p;
+	struct dirent	*dent;
+	DIR		*dir;
+	char		path[PATH_MAX];
+	int		nr = 0, size = 0, jobs, i, shown = 0, flagged = 0;
+	int		err = 0;
+
+	print_trace_enter();
+
+	jobs = scan_jobs_opt(16);
+	if (jobs < 0)
+		return jobs;
+
+	err = mq_setup();
+	if (err)
+		return err;
+
+	dir = opendir(SYSFS_BLOCK_PATH);
+	if (!dir)
+		return -ENODEV;
+
+	for_each_dir(dent, dir) {
+		snprintf(path, sizeof(path), "%s/mq", dent->d_name);
+		if (strlen(dent->d_name) >= sizeof(disks->info.disk_name) ||
+		    faccessat(dirfd(dir), path, F_OK, 0))
+			continue;
+
+		if (nr == size) {
+			size = size ? size * 2 : 64;
+			p = realloc(disks, size * sizeof(*disks));
+			if (!p) {
+				err = -ENOMEM;
+				break;
+			}
+			disks = p;
+		}
+
+		memset(disks + nr, 0, sizeof(*disks));
+		strcpy(disks[nr].info.disk_name, dent->d_name);
+		nr++;
+	}
+	closedir(dir);
+
+	if (err || !nr) {
+		if (!err)
+			print_info("\n No blk-mq devices found \n");
+		goto out;
+	}
+
+	parallel_for_each(disks, nr, sizeof(*disks), mq_disk_work, jobs);
+	qsort(disks, nr, sizeof(*disks), mq_disk_cmp);
+
+	print_command_label("blk-mq");
+	print_mq_map_header();
+
+	for (i = 0; i < nr; i++) {
+		if (disks[i].err)
+			continue;
+
+		print_mq_map(&disks[i].info);
+		shown++;
+		if (strcmp(disks[i].info.status, "ok"))
+			flagged++;
+	}
+
+	if (out_is_text() && flagged)
+		out_printf("\n%d of %d devices have unmapped or uneven "
+		    "queue maps\n", flagged, shown);
+
+out:
+	free(disks);
+
+	return err;
+}
+
+/*
+ * One row per queue and one column per CPU up to the last online one,
+ * in blocks of MQ_MATRIX_COLS CPUs: 'x' an online CPU of the queue, 'o'
+ * an offline one, '!' under an online CPU which is in no queue.
+ */
+static void mq_print_matrix(struct mq_disk *d)
+{
+	struct cpu_mask	mapped;
+	int		last = mq_cpu_end ? mq_cpu_end - 1 : 0, base, cpu, end, i;
+	size_t		w;
+
+	memset(&mapped, 0, sizeof(mapped));
+	for (i = 0; i < d->nr_queues; i++) {
+		for (w = 0; w < ARRAY_SIZE(mapped.bits); w++)
+			mapped.bits[w] |= d->queues[i].cpus.bits[w];
+	}
+
+	out_printf("\nCPU map of %s ('x' CPU submits to the queue, "
+	    "'o' offline, '!' CPU in no queue)\n", d->info.disk_name);
+
+	for (base = 0; base <= last; base += MQ_MATRIX_COLS) {
+		end = min(base + MQ_MATRIX_COLS - 1, last);
+
+		out_printf("\n%-11s", "CPU");
+		for (cpu = base; cpu <= end; cpu++)
+			out_char(cpu % 10 ? ' ' : '0' + (cpu / 10) % 10);
+		out_printf("\n%-11s", "");
+		for (cpu = base; cpu <= end; cpu++)
+			out_char('0' + cpu % 10);
+		out_char('\n');
+
+		for (i = 0; i < d->nr_queues; i++) {
+			out_printf("Queue %-5d", d->queues[i].info.hctx);
+			for (cpu = base; cpu <= end; cpu++) {
+				if (!cpu_mask_test(&d->queues[i].cpus, cpu))
+					out_char('.');
+				else
+					out_char(cpu_mask_test(&mq_online, cpu) ?
+					    'x' : 'o');
+			}
+			out_char('\n');
+		}
+
+		if (strcmp(d->info.unmapped, "-")) {
+			out_printf("%-11s", "none");
+			for (cpu = base; cpu <= end; cpu++)
+				out_char(cpu_mask_test(&mq_online, cpu) &&
+				    !cpu_mask_test(&mapped, cpu) ? '!' : ' ');
+			out_char('\n');
+		}
+	}
+}
+
+/**
+ * show_disk_mq() will show the hardware queues of disk 'name' with their
+ * CPUs and tags, and in text mode the CPU by queue matrix
+ */
+int show_disk_mq(char *name)
+{
+	struct mq_disk	d;
+	int		i, err;
+
+	print_trace_enter();
+
+	err = mq_setup();
+	if (err)
+		return err;
+
+	memset(&d, 0, sizeof(d));
+	snprintf(d.info.disk_name, sizeof(d.info.disk_name), "%s", name);
+
+	err = mq_read_disk(&d);
+	if (err) {
+		print_err("No blk-mq queues found for %s (%s)", name,
+		    strerror(-err));
+		goto out;
+	}
+
+	print_mq_map_header();
+	print_mq_map(&d.info);
+
+	print_mq_queue_header();
+	for (i = 0; i < d.nr_queues; i++)
+		print_mq_queue(&d.queues[i].info);
+
+	if (out_is_text())
+		mq_print_matrix(&d);
+
+out:
+	free(d.queues);
+
+	return err;
+}
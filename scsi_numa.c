@@ -0,0 +1,425 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scsi.h"
+#include "scsi_numa.h"
+
+/*
+ * CPU lists are the "0-3,8,10-11" strings of sysfs and /proc/irq. The
+ * CPUs of each NUMA node are read once from SYSFS_NODE_PATH, a system
+ * without NUMA shows up as a single node 0 holding every CPU.
+ */
+
+static struct cpu_mask	numa_cpus[NUMA_MAX_NODES];
+static int		numa_nodes = -1;
+
+/**
+ * cpulist_parse() will set the CPUs of list 's' in 'm', returning
+ * -EINVAL on a malformed list
+ */
+int cpulist_parse(const char *s, struct cpu_mask *m)
+{
+	char	*end;
+	long	lo, hi;
+
+	memset(m, 0, sizeof(*m));
+
+	while (*s && *s != '\n') {
+		lo = strtol(s, &end, 10);
+		if (end == s || lo < 0)
+			return -EINVAL;
+
+		hi = lo;
+		if (*end == '-') {
+			s = end + 1;
+			hi = strtol(s, &end, 10);
+			if (end == s || hi < lo)
+				return -EINVAL;
+		}
+
+		for (; lo <= hi && lo < CPU_MASK_BITS; lo++)
+			cpu_mask_set(m, lo);
+
+		s = end;
+		if (*s == ',')
+			s++;
+		else if (*s && *s != '\n')
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * cpulist_format() will write 'm' back as a CPU list, "-" when empty,
+ * ending with "+" if 'len' was too short
+ */
+int cpulist_format(const struct cpu_mask *m, char *buf, size_t len)
+{
+	size_t	pos = 0;
+	int	cpu, last, n;
+
+	if (!len)
+		return 0;
+	buf[0] = '\0';
+
+	for (cpu = 0; cpu < CPU_MASK_BITS; cpu++) {
+		if (!cpu_mask_test(m, cpu))
+			continue;
+
+		for (last = cpu; cpu_mask_test(m, last + 1); last++)
+			;
+
+		if (last == cpu)
+			n = snprintf(buf + pos, len - pos, "%s%d",
+			    pos ? "," : "", cpu);
+		else
+			n = snprintf(buf + pos, len - pos, "%s%d-%d",
+			    pos ? "," : "", cpu, last);
+
+		if (n < 0 || (size_t)n >= len - pos) {
+			if (len >= 2) {
+				buf[len - 2] = '+';
+				buf[len - 1] = '\0';
+			}
+			return -ENOSPC;
+		}
+		pos += n;
+		cpu = last;
+	}
+
+	if (!pos)
+		snprintf(buf, len, "-");
+
+	return 0;
+}
+
+int cpu_mask_empty(const struct cpu_mask *m)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(m->bits); i++) {
+		if (m->bits[i])
+			return 0;
+	}
+
+	return 1;
+}
+
+int cpu_mask_weight(const struct cpu_mask *m)
+{
+	size_t	i;
+	int	n = 0;
+
+	for (i = 0; i < ARRAY_SIZE(m->bits); i++)
+		n += __builtin_popcountll(m->bits[i]);
+
+	return n;
+}
+
+/**
+ * cpu_online_mask() will read the online CPUs into 'm', returning how
+ * many there are or a negative errno
+ */
+int cpu_online_mask(struct cpu_mask *m)
+{
+	char	path[PATH_MAX], buf[4096];
+	int	err;
+
+	snprintf(path, sizeof(path), "%s/online", SYSFS_CPU_PATH);
+	err = load_sysfs_path(path, buf, sizeof(buf));
+	if (err < 0)
+		return err;
+
+	if (cpulist_parse(buf, m) || cpu_mask_empty(m))
+		return -EINVAL;
+
+	return cpu_mask_weight(m);
+}
+
+static void numa_load(void)
+{
+	struct dirent	*dent;
+	DIR		*dir;
+	char		path[PATH_MAX], buf[4096];
+	int		node, i;
+
+	numa_nodes = 0;
+
+	dir = opendir(SYSFS_NODE_PATH);
+	if (dir) {
+		for_each_dir(dent, dir) {
+			if (sscanf(dent->d_name, "node%d", &node) != 1 ||
+			    node < 0 || node >= NUMA_MAX_NODES)
+				continue;
+
+			snprintf(path, sizeof(path), "%s/%s/cpulist",
+			    SYSFS_NODE_PATH, dent->d_name);
+			if (load_sysfs_path(path, buf, sizeof(buf)) < 0 ||
+			    cpulist_parse(buf, numa_cpus + node))
+				continue;
+
+			if (node >= numa_nodes)
+				numa_nodes = node + 1;
+		}
+		closedir(dir);
+	}
+
+	if (numa_nodes)
+		return;
+
+	/* No NUMA, every CPU is on node 0 */
+	for (i = 0; i < CPU_MASK_BITS / 64; i++)
+		numa_cpus[0].bits[i] = ~0ULL;
+	numa_nodes = 1;
+}
+
+/* Number of NUMA nodes, 1 on a system without NUMA */
+int numa_nr_nodes(void)
+{
+	if (numa_nodes < 0)
+		numa_load();
+
+	return numa_nodes;
+}
+
+/**
+ * numa_nodes_of() will return the set of nodes holding the CPUs of 'm',
+ * bit N standing for node N
+ */
+u64 numa_nodes_of(const struct cpu_mask *m)
+{
+	u64	nodes = 0;
+	int	node;
+	size_t	i;
+
+	for (node = 0; node < numa_nr_nodes(); node++) {
+		for (i = 0; i < ARRAY_SIZE(m->bits); i++) {
+			if (m->bits[i] & numa_cpus[node].bits[i]) {
+				nodes |= 1ULL << node;
+				break;
+			}
+		}
+	}
+
+	return nodes;
+}
+
+void nodelist_format(u64 nodes, char *buf, size_t len)
+{
+	struct cpu_mask m;
+
+	/* A node set is a CPU set of at most 64 entries */
+	memset(&m, 0, sizeof(m));
+	m.bits[0] = nodes;
+	cpulist_format(&m, buf, len);
+}
+
+/**
+ * dev_numa_node() will read the NUMA node of device 'devpath', -1 when
+ * unknown or when the system has no NUMA
+ */
+int dev_numa_node(const char *devpath)
+{
+	char	path[PATH_MAX], buf[16];
+
+	snprintf(path, sizeof(path), "%s/numa_node", devpath);
+	if (load_sysfs_path(path, buf, sizeof(buf)) < 0)
+		return -1;
+
+	return atoi(buf);
+}
+
+/* Node of 'cpu', -1 if no node holds it */
+int cpu_node(int cpu)
+{
+	int node;
+
+	for (node = 0; node < numa_nr_nodes(); node++) {
+		if (cpu_mask_test(numa_cpus + node, cpu))
+			return node;
+	}
+
+	return -1;
+}
+
+static int pci_name_valid(const char *name)
+{
+	unsigned int	d, b, s, f;
+	int		n = 0;
+
+	return sscanf(name, "%x:%x:%x.%x%n", &d, &b, &s, &f, &n) == 4 &&
+	    !name[n];
+}
+
+/**
+ * pci_dev_path() will resolve 'link' and climb up to the PCI function
+ * above it, a virtio, SCSI host or NVMe controller device sits below its
+ * PCI function
+ */
+int pci_dev_path(const char *link, char *path)
+{
+	char *slash;
+
+	if (!realpath(link, path))
+		return -errno;
+
+	while ((slash = strrchr(path, '/')) && slash != path) {
+		if (pci_name_valid(slash + 1))
+			return 0;
+		*slash = '\0';
+	}
+
+	return -ENODEV;
+}
+
+/**
+ * irq_affinity() will read the CPUs interrupt 'irq' may go to and the
+ * ones it really goes to, the latter being the allowed ones when the
+ * kernel does not tell
+ */
+int irq_affinity(int irq, struct cpu_mask *allowed, struct cpu_mask *effective)
+{
+	char	path[PATH_MAX], buf[4096];
+
+	snprintf(path, sizeof(path), "%s/%d/smp_affinity_list",
+	    PROC_IRQ_PATH, irq);
+	if (load_sysfs_path(path, buf, sizeof(buf)) < 0)
+		return -ENOENT;
+	if (cpulist_parse(buf, allowed))
+		return -EINVAL;
+
+	snprintf(path, sizeof(path), "%s/%d/effective_affinity_list",
+	    PROC_IRQ_PATH, irq);
+	if (load_sysfs_path(path, buf, sizeof(buf)) < 0 || !buf[0] ||
+	    cpulist_parse(buf, effective) || cpu_mask_empty(effective))
+		*effective = *allowed;
+
+	return 0;
+}
+
+static int irq_cmp(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * dev_irqs() will return how many MSI interrupts PCI device 'devpath'
+ * has, or 1 for a legacy interrupt, with their numbers sorted in '*irqs'
+ * which the caller frees
+ */
+int dev_irqs(const char *devpath, int **irqs)
+{
+	struct dirent	*dent;
+	DIR		*dir;
+	char		path[PATH_MAX], buf[16];
+	int		nr = 0, size = 0, irq, *p;
+
+	*irqs = NULL;
+
+	snprintf(path, sizeof(path), "%s/msi_irqs", devpath);
+	dir = opendir(path);
+	if (dir) {
+		for_each_dir(dent, dir) {
+			irq = atoi(dent->d_name);
+			if (irq <= 0)
+				continue;
+
+			if (nr == size) {
+				size = size ? size * 2 : 32;
+				p = realloc(*irqs, size * sizeof(*p));
+				if (!p)
+					break;
+				*irqs = p;
+			}
+			(*irqs)[nr++] = irq;
+		}
+		closedir(dir);
+	}
+
+	if (nr) {
+		qsort(*irqs, nr, sizeof(**irqs), irq_cmp);
+		return nr;
+	}
+
+	snprintf(path, sizeof(path), "%s/irq", devpath);
+	if (load_sysfs_path(path, buf, sizeof(buf)) < 0)
+		return 0;
+
+	irq = atoi(buf);
+	if (irq <= 0)
+		return 0;
+
+	free(*irqs);
+	*irqs = malloc(sizeof(**irqs));
+	if (!*irqs)
+		return 0;
+	**irqs = irq;
+
+	return 1;
+}
+
+/**
+ * dev_irq_cpus() will collect the CPUs serving the MSI, or else the
+ * legacy interrupt of PCI device 'devpath', returning how many
+ * interrupts were found
+ */
+int dev_irq_cpus(const char *devpath, struct cpu_mask *cpus)
+{
+	struct cpu_mask	allowed, effective;
+	int		*irqs, nr, i, found = 0;
+	size_t		w;
+
+	memset(cpus, 0, sizeof(*cpus));
+
+	nr = dev_irqs(devpath, &irqs);
+	for (i = 0; i < nr; i++) {
+		if (irq_affinity(irqs[i], &allowed, &effective))
+			continue;
+
+		for (w = 0; w < ARRAY_SIZE(cpus->bits); w++)
+			cpus->bits[w] |= effective.bits[w];
+		found++;
+	}
+	free(irqs);
+
+	return found;
+}
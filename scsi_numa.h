@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SCSI_NUMA_H
+#define _SCSI_NUMA_H
+
+#include "scsi.h"
+
+#define CPU_MASK_BITS		4096
+#define NUMA_MAX_NODES		64	/* node sets are kept in a u64 */
+
+struct cpu_mask {
+	u64	bits[CPU_MASK_BITS / 64];
+};
+
+static inline void cpu_mask_set(struct cpu_mask *m, int cpu)
+{
+	if (cpu >= 0 && cpu < CPU_MASK_BITS)
+		m->bits[cpu / 64] |= 1ULL << (cpu % 64);
+}
+
+static inline int cpu_mask_test(const struct cpu_mask *m, int cpu)
+{
+	return cpu >= 0 && cpu < CPU_MASK_BITS &&
+	    (m->bits[cpu / 64] >> (cpu % 64)) & 1;
+}
+
+int cpulist_parse(const char *, struct cpu_mask *);
+int cpulist_format(const struct cpu_mask *, char *, size_t);
+int cpu_mask_empty(const struct cpu_mask *);
+int cpu_mask_weight(const struct cpu_mask *);
+int cpu_online_mask(struct cpu_mask *);
+
+int numa_nr_nodes(void);
+u64 numa_nodes_of(const struct cpu_mask *);
+void nodelist_format(u64, char *, size_t);
+
+int cpu_node(int);
+
+int pci_dev_path(const char *, char *);
+int dev_numa_node(const char *);
+int irq_affinity(int, struct cpu_mask *, struct cpu_mask *);
+int dev_irqs(const char *, int **);
+int dev_irq_cpus(const char *, struct cpu_mask *);
+#endif
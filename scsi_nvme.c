@@ -0,0 +1,513 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scsi.h"
+#include "scsi_print.h"
+
+/*
+ * NVMe subsystem topology
+ *
+ * /sys/class/nvme-subsystem/nvme-subsysX lists the controllers (nvmeY)
+ * of a subsystem and, with native multipath, its namespace heads
+ * (nvmeXnZ). Each controller in /sys/class/nvme holds its path to a
+ * head as the hidden nvmeXcYnZ, whose name carries the instance of the
+ * subsystem, controller and head, so a path finds its namespace through
+ * an index instead of a search. Without multipath a controller holds
+ * plain nvmeYnZ namespaces, each being its own single path.
+ */
+
+#define NVME_IMBALANCE	2	/* optimized paths of one controller vs another */
+
+struct nvme_topo {
+	struct nvme_subsys_info	*subsys;
+	struct nvme_ctrl_info	*ctrls;
+	struct nvme_ns_info	*ns;
+	struct nvme_path_info	*paths;
+	int			nr_subsys, size_subsys;
+	int			nr_ctrls, size_ctrls;
+	int			nr_ns, size_ns;
+	int			nr_paths, size_paths;
+	int			*ns_index;	/* head instance to ns, -1 */
+	int			ns_index_size;
+};
+
+/* A zeroed new entry at the end of the array at 'arrp', NULL on ENOMEM */
+static void *nvme_add(void *arrp, int *nr, int *size, size_t elem)
+{
+	void	*base, *p;
+
+	memcpy(&base, arrp, sizeof(base));
+	if (*nr == *size) {
+		p = realloc(base, (*size ? *size * 2 : 16) * elem);
+		if (!p)
+			return NULL;
+		base = p;
+		memcpy(arrp, &base, sizeof(base));
+		*size = *size ? *size * 2 : 16;
+	}
+
+	p = (char *)base + (size_t)(*nr)++ * elem;
+	memset(p, 0, elem);
+
+	return p;
+}
+
+/* Reads 'attr' without the padding of NVMe identify strings, "-" if none */
+static void nvme_read_attr(int dfd, const char *attr, char *buf, int len)
+{
+	if (sysfs_read_str_at(dfd, attr, buf, len) <= 0)
+		snprintf(buf, len, "-");
+}
+
+static int nvme_read_int(int dfd, const char *attr)
+{
+	char val[32];
+
+	if (sysfs_read_at(dfd, attr, val, sizeof(val)) <= 0)
+		return -1;
+	return atoi(val);
+}
+
+/* Indexes namespace 'ns' of the current subsystem by head 'instance' */
+static int nvme_index_ns(struct nvme_topo *t, int instance, int ns)
+{
+	int	size, *p;
+
+	if (instance >= t->ns_index_size) {
+		size = instance < 64 ? 128 : instance * 2;
+		p = realloc(t->ns_index, size * sizeof(*p));
+		if (!p)
+			return -ENOMEM;
+		memset(p + t->ns_index_size, 0xff,
+		    (size - t->ns_index_size) * sizeof(*p));
+		t->ns_index = p;
+		t->ns_index_size = size;
+	}
+	t->ns_index[instance] = ns;
+
+	return 0;
+}
+
+static struct nvme_ns_info *nvme_add_ns(struct nvme_topo *t, int dfd,
+    const char *name, int subsys, int instance)
+{
+	struct nvme_ns_info	*ns;
+	char			attr[64];
+
+	ns = nvme_add(&t->ns, &t->nr_ns, &t->size_ns, sizeof(*ns));
+	if (!ns)
+		return NULL;
+
+	ns->subsys = subsys;
+	ns->instance = instance;
+	snprintf(ns->name, sizeof(ns->name), "%.15s", name);
+	snprintf(attr, sizeof(attr), "%.32s/nsid", name);
+	ns->nsid = nvme_read_int(dfd, attr);
+
+	return ns;
+}
+
+/* A path of namespace 'ns' through controller 'c', 'dfd' being 'c' */
+static int nvme_add_path(struct nvme_topo *t, int dfd, const char *name,
+    struct nvme_ctrl_info *c, struct nvme_ns_info *ns)
+{
+	struct nvme_path_info	*p;
+	char			attr[64];
+	int			live;
+
+	p = nvme_add(&t->paths, &t->nr_paths, &t->size_paths, sizeof(*p));
+	if (!p)
+		return -ENOMEM;
+
+	p->subsys = c->subsys;
+	p->ns = ns->instance;
+	p->ctrl = c->instance;
+	memcpy(p->ns_name, ns->name, sizeof(p->ns_name));
+	p->nsid = ns->nsid;
+	snprintf(p->name, sizeof(p->name), "%.23s", name);
+	memcpy(p->ctrl_name, c->name, sizeof(p->ctrl_name));
+	memcpy(p->ctrl_state, c->state, sizeof(p->ctrl_state));
+
+	/* Controllers without ANA have neither, their paths are all equal */
+	snprintf(attr, sizeof(attr), "%.32s/ana_state", name);
+	nvme_read_attr(dfd, attr, p->ana_state, sizeof(p->ana_state));
+	snprintf(attr, sizeof(attr), "%.32s/ana_grpid", name);
+	p->ana_grpid = nvme_read_int(dfd, attr);
+
+	live = !strcmp(c->state, "live");
+	ns->nr_paths++;
+	c->nr_paths++;
+	if (live && (!strcmp(p->ana_state, "optimized") ||
+	    !strcmp(p->ana_state, "-"))) {
+		ns->nr_live++;
+		ns->nr_optimized++;
+		c->nr_optimized++;
+	} else if (live && !strcmp(p->ana_state, "non-optimized")) {
+		ns->nr_live++;
+	}
+
+	return 0;
+}
+
+/* Controller 'name' of subsystem 's' with its paths */
+static int nvme_read_ctrl(struct nvme_topo *t, int nvme_fd, const char *name,
+    struct nvme_subsys_info *s)
+{
+	struct nvme_ctrl_info	*c;
+	struct nvme_ns_info	*ns;
+	struct dirent		*dent;
+	DIR			*dir;
+	int			dfd, x, y, z, end, err = 0;
+
+	dfd = openat(nvme_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return 0;
+
+	c = nvme_add(&t->ctrls, &t->nr_ctrls, &t->size_ctrls, sizeof(*c));
+	if (!c) {
+		close(dfd);
+		return -ENOMEM;
+	}
+
+	c->subsys = s->instance;
+	sscanf(name, "nvme%d", &c->instance);
+	snprintf(c->name, sizeof(c->name), "%.15s", name);
+	nvme_read_attr(dfd, "transport", c->transport, sizeof(c->transport));
+	nvme_read_attr(dfd, "address", c->address, sizeof(c->address));
+	nvme_read_attr(dfd, "state", c->state, sizeof(c->state));
+	c->queue_count = nvme_read_int(dfd, "queue_count");
+	c->sqsize = nvme_read_int(dfd, "sqsize");
+	c->kato = nvme_read_int(dfd, "kato");
+	s->nr_ctrls++;
+
+	dir = fdopendir(dfd);
+	if (!dir) {
+		close(dfd);
+		return 0;
+	}
+
+	for_each_dir(dent, dir) {
+		end = 0;
+		if (sscanf(dent->d_name, "nvme%dc%dn%d%n", &x, &y, &z,
+		    &end) == 3 && !dent->d_name[end]) {
+			/* A hidden path, of the head nvmeXnZ */
+			if (x != s->instance || z >= t->ns_index_size ||
+			    t->ns_index[z] < 0)
+				continue;
+			ns = t->ns + t->ns_index[z];
+		} else if (sscanf(dent->d_name, "nvme%dn%d%n", &y, &z,
+		    &end) == 2 && !dent->d_name[end]) {
+			/* No multipath, the namespace is the path */
+			ns = nvme_add_ns(t, dirfd(dir), dent->d_name,
+			    s->instance, z);
+			if (!ns) {
+				err = -ENOMEM;
+				break;
+			}
+		} else {
+			continue;
+		}
+
+		err = nvme_add_path(t, dirfd(dir), dent->d_name, c, ns);
+		if (err)
+			break;
+	}
+	closedir(dir);
+
+	return err;
+}
+
+/* Paths through a controller which is not live or ANA inaccessible degrade */
+static void nvme_ns_status(struct nvme_ns_info *ns)
+{
+	if (!ns->nr_paths)
+		snprintf(ns->status, sizeof(ns->status), "no-path");
+	else if (!ns->nr_optimized)
+		snprintf(ns->status, sizeof(ns->status), "no-optimized");
+	else if (ns->nr_live < ns->nr_paths)
+		snprintf(ns->status, sizeof(ns->status), "degraded");
+	else
+		snprintf(ns->status, sizeof(ns->status), "ok");
+}
+
+static void nvme_flag(struct nvme_subsys_info *s, const char *flag)
+{
+	size_t len = strlen(s->status);
+
+	if (strstr(s->status, flag))
+		return;
+	snprintf(s->status + len, sizeof(s->status) - len, "%s%s",
+	    len ? "," : "", flag);
+}
+
+/*
+ * Sums up the controllers and namespaces of 's', from index 'ctrl' and
+ * 'ns' on. Live controllers whose optimized paths differ by more than
+ * NVME_IMBALANCE times leave the I/O of the subsystem on fewer of them.
+ */
+static void nvme_subsys_status(struct nvme_topo *t, struct nvme_subsys_info *s,
+    int ctrl, int ns)
+{
+	struct nvme_ctrl_info	*c;
+	int			i, lo = -1, hi = 0;
+
+	for (i = ctrl; i < t->nr_ctrls; i++) {
+		c = t->ctrls + i;
+		if (strcmp(c->state, "live")) {
+			nvme_flag(s, "ctrl-down");
+			continue;
+		}
+		if (!c->nr_paths)
+			continue;
+		if (lo < 0 || c->nr_optimized < lo)
+			lo = c->nr_optimized;
+		if (c->nr_optimized > hi)
+			hi = c->nr_optimized;
+	}
+	if (hi - lo > 1 && hi > lo * NVME_IMBALANCE)
+		nvme_flag(s, "imbalanced");
+
+	for (i = ns; i < t->nr_ns; i++) {
+		nvme_ns_status(t->ns + i);
+		s->nr_ns++;
+		s->nr_paths += t->ns[i].nr_paths;
+		s->nr_optimized += t->ns[i].nr_optimized;
+		if (strcmp(t->ns[i].status, "ok"))
+			nvme_flag(s, t->ns[i].status);
+	}
+	if (!s->status[0])
+		nvme_flag(s, "ok");
+}
+
+/* Subsystem 'name' with its namespace heads, controllers and paths */
+static int nvme_read_subsys(struct nvme_topo *t, int class_fd, int nvme_fd,
+    const char *name)
+{
+	struct nvme_subsys_info	*s;
+	struct nvme_ns_info	*ns;
+	struct dirent		*dent;
+	DIR			*dir;
+	char			**ctrls = NULL, **p;
+	int			dfd, x, z, end, nr = 0, first_ctrl, first_ns;
+	int			i, err = 0;
+
+	dfd = openat(class_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return 0;
+	dir = fdopendir(dfd);
+	if (!dir) {
+		close(dfd);
+		return 0;
+	}
+
+	s = nvme_add(&t->subsys, &t->nr_subsys, &t->size_subsys, sizeof(*s));
+	if (!s) {
+		closedir(dir);
+		return -ENOMEM;
+	}
+	sscanf(name, "nvme-subsys%d", &s->instance);
+	snprintf(s->name, sizeof(s->name), "%.23s", name);
+	nvme_read_attr(dfd, "subsysnqn", s->nqn, sizeof(s->nqn));
+	nvme_read_attr(dfd, "model", s->model, sizeof(s->model));
+	nvme_read_attr(dfd, "iopolicy", s->iopolicy, sizeof(s->iopolicy));
+
+	first_ctrl = t->nr_ctrls;
+	first_ns = t->nr_ns;
+	if (t->ns_index)
+		memset(t->ns_index, 0xff, t->ns_index_size * sizeof(int));
+
+	/* The heads first, the paths of the controllers point to them */
+	for_each_dir(dent, dir) {
+		end = 0;
+		if (sscanf(dent->d_name, "nvme%dn%d%n", &x, &z, &end) == 2 &&
+		    !dent->d_name[end]) {
+			ns = nvme_add_ns(t, dfd, dent->d_name, s->instance, z);
+			if (!ns || nvme_index_ns(t, z, ns - t->ns)) {
+				err = -ENOMEM;
+				break;
+			}
+		} else if (sscanf(dent->d_name, "nvme%d%n", &x, &end) == 1 &&
+		    !dent->d_name[end]) {
+			p = realloc(ctrls, (nr + 1) * sizeof(*ctrls));
+			if (!p || !(p[nr] = strdup(dent->d_name))) {
+				ctrls = p ? p : ctrls;
+				err = -ENOMEM;
+				break;
+			}
+			ctrls = p;
+			nr++;
+		}
+	}
+
+	for (i = 0; i < nr && !err; i++)
+		err = nvme_read_ctrl(t, nvme_fd, ctrls[i], s);
+
+	if (!err)
+		nvme_subsys_status(t, s, first_ctrl, first_ns);
+
+	for (i = 0; i < nr; i++)
+		free(ctrls[i]);
+	free(ctrls);
+	closedir(dir);
+
+	return err;
+}
+
+static int nvme_subsys_cmp(const void *a, const void *b)
+{
+	const struct nvme_subsys_info *x = a, *y = b;
+
+	return x->instance - y->instance;
+}
+
+static int nvme_ctrl_cmp(const void *a, const void *b)
+{
+	const struct nvme_ctrl_info *x = a, *y = b;
+
+	if (x->subsys != y->subsys)
+		return x->subsys - y->subsys;
+	return x->instance - y->instance;
+}
+
+static int nvme_ns_cmp(const void *a, const void *b)
+{
+	const struct nvme_ns_info *x = a, *y = b;
+
+	if (x->subsys != y->subsys)
+		return x->subsys - y->subsys;
+	if (x->instance != y->instance)
+		return x->instance - y->instance;
+	return strcmp(x->name, y->name);
+}
+
+static int nvme_path_cmp(const void *a, const void *b)
+{
+	const struct nvme_path_info *x = a, *y = b;
+
+	if (x->subsys != y->subsys)
+		return x->subsys - y->subsys;
+	if (x->ns != y->ns)
+		return x->ns - y->ns;
+	return x->ctrl - y->ctrl;
+}
+
+/**
+ * list_nvme_subsys() will show every NVMe subsystem with its controllers,
+ * namespaces and the paths between them, flagging namespaces without an
+ * optimized path and subsystems whose optimized paths pile up on fewer
+ * controllers
+ */
+int list_nvme_subsys(void)
+{
+	struct nvme_topo	t;
+	struct dirent		*dent;
+	DIR			*dir;
+	int			nvme_fd, i, flagged = 0, err = 0;
+
+	print_trace_enter();
+
+	memset(&t, 0, sizeof(t));
+
+	dir = opendir(SYSFS_NVME_SUBSYS_PATH);
+	if (!dir) {
+		print_info("\n No NVMe subsystems found \n");
+		return 0;
+	}
+	nvme_fd = open(SYSFS_NVME_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (nvme_fd < 0) {
+		err = -errno;
+		closedir(dir);
+		return err;
+	}
+
+	for_each_dir(dent, dir) {
+		if (strncmp(dent->d_name, "nvme-subsys", 11))
+			continue;
+		err = nvme_read_subsys(&t, dirfd(dir), nvme_fd, dent->d_name);
+		if (err)
+			break;
+	}
+	close(nvme_fd);
+	closedir(dir);
+
+	if (err || !t.nr_subsys) {
+		if (!err)
+			print_info("\n No NVMe subsystems found \n");
+		goto out;
+	}
+
+	qsort(t.subsys, t.nr_subsys, sizeof(*t.subsys), nvme_subsys_cmp);
+	qsort(t.ctrls, t.nr_ctrls, sizeof(*t.ctrls), nvme_ctrl_cmp);
+	qsort(t.ns, t.nr_ns, sizeof(*t.ns), nvme_ns_cmp);
+	qsort(t.paths, t.nr_paths, sizeof(*t.paths), nvme_path_cmp);
+
+	print_command_label("NVMe");
+	print_nvme_subsys_header();
+	for (i = 0; i < t.nr_subsys; i++) {
+		print_nvme_subsys(t.subsys + i);
+		if (strcmp(t.subsys[i].status, "ok"))
+			flagged++;
+	}
+
+	print_nvme_ctrl_header();
+	for (i = 0; i < t.nr_ctrls; i++)
+		print_nvme_ctrl(t.ctrls + i);
+
+	print_nvme_ns_header();
+	for (i = 0; i < t.nr_ns; i++)
+		print_nvme_ns(t.ns + i);
+
+	print_nvme_path_header();
+	for (i = 0; i < t.nr_paths; i++)
+		print_nvme_path(t.paths + i);
+
+	if (out_is_text() && flagged)
+		out_printf("\n%d of %d NVMe subsystems have missing, "
+		    "non-optimized or imbalanced paths\n", flagged,
+		    t.nr_subsys);
+
+out:
+	free(t.subsys);
+	free(t.ctrls);
+	free(t.ns);
+	free(t.paths);
+	free(t.ns_index);
+
+	return err;
+}
@@ -0,0 +1,582 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdarg.h>
+#include <sys/uio.h>
+
+#include "scsi.h"
+
+static struct {
+	char	buf[OUT_BUF_SIZE];
+	size_t	len;
+
+	int	mode;
+	int	nr_records;	/* records written in this document */
+	int	nr_fields;	/* fields written in the open record */
+	char	section[64];	/* "type" of the following records */
+} out;
+
+void out_set_mode(int mode)
+{
+	out.mode = mode;
+}
+
+int out_get_mode(void)
+{
+	return out.mode;
+}
+
+/*
+ * Write the pending buffer followed by 'extra' with a single writev()
+ * call, restarting on short writes.
+ */
+static void out_writev(const char *extra, size_t extra_len)
+{
+	struct iovec	iov[2];
+	ssize_t		ret;
+	int		cnt = 0, i = 0;
+
+	if (out.len) {
+		iov[cnt].iov_base = out.buf;
+		iov[cnt++].iov_len = out.len;
+	}
+	if (extra_len) {
+		iov[cnt].iov_base = (void *)extra;
+		iov[cnt++].iov_len = extra_len;
+	}
+
+	while (i < cnt) {
+		ret = writev(STDOUT_FILENO, iov + i, cnt - i);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		while (i < cnt && (size_t)ret >= iov[i].iov_len)
+			ret -= iov[i++].iov_len;
+
+		if (i < cnt) {
+			iov[i].iov_base = (char *)iov[i].iov_base + ret;
+			iov[i].iov_len -= ret;
+		}
+	}
+
+	out.len = 0;
+}
+
+/**
+ * out_flush() will push everything rendered so far to stdout. Anything
+ * still sitting in the stdio buffer was printed earlier, so it goes first.
+ */
+void out_flush(void)
+{
+	fflush(stdout);
+
+	if (out.len)
+		out_writev(NULL, 0);
+}
+
+/**
+ * out_finish() will terminate the JSON document, an empty array when no
+ * record was written, and flush everything that is still buffered.
+ */
+void out_finish(void)
+{
+	if (out.mode == OUT_JSON)
+		out_str(out.nr_records ? "\n]\n" : "[]\n");
+
+	out_flush();
+}
+
+/**
+ * out_msg() will print an informational message. With JSON output such
+ * messages go to stderr, so that stdout remains a valid document.
+ */
+void out_msg(const char *fmt, ...)
+{
+	va_list	ap;
+	char	tmp[1024];
+
+	va_start(ap, fmt);
+	vsnprintf(tmp, sizeof(tmp), fmt, ap);
+	va_end(ap);
+
+	if (out.mode == OUT_TEXT) {
+		out_str(tmp);
+		return;
+	}
+
+	out_flush();
+	fputs(tmp, stderr);
+}
+
+void out_write(const char *s, size_t len)
+{
+	if (len <= sizeof(out.buf) - out.len) {
+		memcpy(out.buf + out.len, s, len);
+		out.len += len;
+		return;
+	}
+
+	fflush(stdout);
+	out_writev(s, len);
+}
+
+void out_str(const char *s)
+{
+	if (!s)
+		s = "(null)";
+
+	out_write(s, strlen(s));
+}
+
+void out_char(char c)
+{
+	if (out.len == sizeof(out.buf))
+		out_flush();
+
+	out.buf[out.len++] = c;
+}
+
+void out_repeat(char c, int count)
+{
+	while (count-- > 0)
+		out_char(c);
+}
+
+/**
+ * out_pad() will write a string left aligned in a column of 'width'
+ */
+void out_pad(const char *s, int width)
+{
+	int len;
+
+	if (!s)
+		s = "(null)";
+
+	len = strlen(s);
+	out_write(s, len);
+	out_repeat(' ', width - len);
+}
+
+static int fmt_u64(char *end, u64 v)
+{
+	char *p = end;
+
+	do {
+		*--p = '0' + (v % 10);
+		v /= 10;
+	} while (v);
+
+	return end - p;
+}
+
+void out_u64(u64 v)
+{
+	char	tmp[24];
+	int	len = fmt_u64(tmp + sizeof(tmp), v);
+
+	out_write(tmp + sizeof(tmp) - len, len);
+}
+
+void out_s64(long long v)
+{
+	if (v < 0) {
+		out_char('-');
+		out_u64(-(u64)v);
+		return;
+	}
+
+	out_u64(v);
+}
+
+void out_printf(const char *fmt, ...)
+{
+	va_list	ap;
+	char	*tmp;
+	int	len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(out.buf + out.len, sizeof(out.buf) - out.len, fmt, ap);
+	va_end(ap);
+
+	if (len < 0)
+		return;
+
+	if ((size_t)len < sizeof(out.buf) - out.len) {
+		out.len += len;
+		return;
+	}
+
+	/* Did not fit, render it on the side */
+	tmp = malloc(len + 1);
+	if (!tmp)
+		return;
+
+	va_start(ap, fmt);
+	vsnprintf(tmp, len + 1, fmt, ap);
+	va_end(ap);
+
+	out_write(tmp, len);
+	free(tmp);
+}
+
+/*
+ * Render a single value of a record into 'tmp' and return its length
+ */
+static int out_field_value(const struct out_field *f, const void *rec,
+			   char *tmp, size_t size, const char **str)
+{
+	const char	*p = (const char *)rec + f->offset;
+	const int	*hctl = (const int *)p;
+	char		*end = tmp + size;
+	int		len, i, n;
+	u64		v;
+
+	*str = tmp;
+
+	switch (f->type) {
+	case FIELD_STR:
+		*str = *(char * const *)p;
+		if (!*str)
+			*str = "(null)";
+		return strlen(*str);
+	case FIELD_CHARS:
+		*str = p;
+		return strlen(p);
+	case FIELD_INT:
+		len = fmt_u64(end, *(const int *)p < 0 ?
+		    -(u64)*(const int *)p : (u64)*(const int *)p);
+		if (*(const int *)p < 0)
+			end[-++len] = '-';
+		break;
+	case FIELD_U32:
+		len = fmt_u64(end, *(const uint32_t *)p);
+		break;
+	case FIELD_U64:
+		len = fmt_u64(end, *(const u64 *)p);
+		break;
+	case FIELD_HEX:
+		len = 0;
+		v = *(const u64 *)p;
+		do {
+			end[-++len] = "0123456789abcdef"[v & 0xf];
+			v >>= 4;
+		} while (v);
+		if (*(const u64 *)p) {
+			end[-++len] = 'x';
+			end[-++len] = '0';
+		}
+		break;
+	case FIELD_HCTL:
+	case FIELD_NVME_HCTL:
+		/* Built back to front: ']' lun ':' target ':' bus ':' host '[' */
+		n = (f->type == FIELD_HCTL) ? 4 : 3;
+		len = 0;
+		end[-++len] = ']';
+		for (i = n - 1; i >= 0; i--) {
+			len += fmt_u64(end - len, (unsigned int)hctl[i]);
+			end[-++len] = ':';
+		}
+		if (f->type == FIELD_NVME_HCTL)
+			end[-++len] = 'N';
+		else
+			len--;
+		end[-++len] = '[';
+		break;
+	default:
+		len = 0;
+		break;
+	}
+
+	*str = end - len;
+	return len;
+}
+
+/**
+ * out_table_header() will print column titles and the dashed separator
+ */
+void out_table_header(const struct out_table *t)
+{
+	int i, n;
+
+	if (out.mode != OUT_TEXT)
+		return;
+
+	out_char('\n');
+	for (i = 0, n = 0; i < t->nr_fields; i++) {
+		if (!t->fields[i].title)
+			continue;
+		if (n++)
+			out_char(t->sep);
+		out_pad(t->fields[i].title, t->fields[i].width);
+	}
+	out_char('\n');
+
+	for (i = 0, n = 0; i < t->nr_fields; i++) {
+		if (!t->fields[i].title)
+			continue;
+		if (n++)
+			out_char(t->sep);
+		out_repeat('-', t->fields[i].width ? t->fields[i].width :
+		    (int)strlen(t->fields[i].title));
+	}
+	out_char('\n');
+}
+
+/**
+ * out_table_row() will render one record using the table descriptors
+ */
+void out_table_row(const struct out_table *t, const void *rec)
+{
+	const struct out_field	*f;
+	const char		*str;
+	char			tmp[64];
+	int			i, n, len, width, last;
+
+	if (out.mode != OUT_TEXT) {
+		out_record(t, rec);
+		return;
+	}
+
+	/* OUT_KEY fields have no column */
+	for (last = t->nr_fields - 1; last > 0 && !t->fields[last].title; last--)
+		;
+
+	for (i = 0, n = 0; i <= last; i++) {
+		f = t->fields + i;
+		if (!f->title)
+			continue;
+
+		if (n++)
+			out_char(t->sep);
+
+		len = out_field_value(f, rec, tmp, sizeof(tmp), &str);
+		width = f->width;
+		if (f->suffix)
+			width -= strlen(f->suffix);
+
+		if (f->flags & OUT_RIGHT)
+			out_repeat(' ', width - len);
+		out_write(str, len);
+		if (f->suffix)
+			out_str(f->suffix);
+		if (!(f->flags & OUT_RIGHT) && i < last)
+			out_repeat(' ', width - len);
+	}
+	out_char('\n');
+}
+
+/*
+ * JSON output: every record becomes one object carrying a "type" member
+ * named after the section it was printed in. Objects are written straight
+ * into the output buffer as devices are collected, nothing is kept around.
+ */
+static void out_json_str(const char *s, int len)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char	*p;
+	unsigned char	c;
+
+	out_char('"');
+	for (p = s; p < s + len; p++) {
+		c = *p;
+		if (c == '"' || c == '\\') {
+			out_char('\\');
+			out_char(c);
+		} else if (c < 0x20) {
+			out_str("\\u00");
+			out_char(hex[c >> 4]);
+			out_char(hex[c & 0xf]);
+		} else {
+			out_char(c);
+		}
+	}
+	out_char('"');
+}
+
+static void out_json_key(const char *key)
+{
+	if (out.nr_fields++)
+		out_char(',');
+	out_json_str(key, strlen(key));
+	out_char(':');
+}
+
+/**
+ * out_section() will name the records that follow, ex: "block", "fabric"
+ */
+void out_section(const char *name)
+{
+	size_t i;
+
+	for (i = 0; name[i] && i < sizeof(out.section) - 1; i++) {
+		if (isalnum((unsigned char)name[i]))
+			out.section[i] = tolower((unsigned char)name[i]);
+		else
+			out.section[i] = '_';
+	}
+	out.section[i] = '\0';
+}
+
+void out_record_begin(void)
+{
+	if (out.mode == OUT_TEXT)
+		return;
+
+	if (out.mode == OUT_JSON)
+		out_str(out.nr_records ? ",\n" : "[\n");
+
+	out.nr_records++;
+	out.nr_fields = 0;
+	out_char('{');
+
+	if (out.section[0])
+		out_record_str("type", out.section);
+}
+
+void out_record_end(void)
+{
+	if (out.mode == OUT_TEXT)
+		return;
+
+	out_char('}');
+	if (out.mode == OUT_NDJSON)
+		out_char('\n');
+}
+
+void out_record_str(const char *key, const char *val)
+{
+	if (out.mode == OUT_TEXT)
+		return;
+
+	out_json_key(key);
+	if (val)
+		out_json_str(val, strlen(val));
+	else
+		out_str("null");
+}
+
+void out_record_u64(const char *key, u64 val)
+{
+	if (out.mode == OUT_TEXT)
+		return;
+
+	out_json_key(key);
+	out_u64(val);
+}
+
+void out_record_s64(const char *key, long long val)
+{
+	if (out.mode == OUT_TEXT)
+		return;
+
+	out_json_key(key);
+	out_s64(val);
+}
+
+/* Rates and averages, two decimals are plenty */
+void out_record_f64(const char *key, double val)
+{
+	if (out.mode == OUT_TEXT)
+		return;
+
+	out_json_key(key);
+	out_printf("%.2f", val);
+}
+
+/**
+ * out_record_fields() will add every field of a descriptor table to the
+ * record which is currently open
+ */
+void out_record_fields(const struct out_table *t, const void *rec)
+{
+	const struct out_field	*f;
+	const char		*str;
+	const char		*p;
+	char			tmp[64];
+	int			i, len;
+
+	if (out.mode == OUT_TEXT)
+		return;
+
+	for (i = 0; i < t->nr_fields; i++) {
+		f = t->fields + i;
+		p = (const char *)rec + f->offset;
+
+		out_json_key(f->key);
+
+		switch (f->type) {
+		case FIELD_STR:
+			if (!*(char * const *)p) {
+				out_str("null");
+				break;
+			}
+			/* fall through */
+		case FIELD_CHARS:
+			len = out_field_value(f, rec, tmp, sizeof(tmp), &str);
+			out_json_str(str, len);
+			break;
+		case FIELD_HCTL:
+		case FIELD_NVME_HCTL:
+			/* drop the brackets */
+			len = out_field_value(f, rec, tmp, sizeof(tmp), &str);
+			out_json_str(str + 1, len - 2);
+			break;
+		case FIELD_HEX:
+			out_u64(*(const u64 *)p);
+			break;
+		default:
+			len = out_field_value(f, rec, tmp, sizeof(tmp), &str);
+			out_write(str, len);
+			break;
+		}
+	}
+}
+
+/**
+ * out_record() will write one complete record described by a table
+ */
+void out_record(const struct out_table *t, const void *rec)
+{
+	out_record_begin();
+	out_record_fields(t, rec);
+	out_record_end();
+}
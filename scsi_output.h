@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SCSI_OUTPUT_H
+#define _SCSI_OUTPUT_H
+
+#include <stddef.h>
+#include "utils.h"
+
+/*
+ * All regular output of the tool is rendered into one large buffer which
+ * is written out with writev() when it fills up, when out_flush() is
+ * called explicitly, or when the tool exits.
+ */
+#define OUT_BUF_SIZE		(64 * 1024)
+
+#define OUT_TABLE(_fields, _sep) { _fields, NUM_ENTRIES(_fields), _sep }
+
+enum out_field_type {
+	FIELD_STR = 1,		/* char * member */
+	FIELD_CHARS,		/* char [] member */
+	FIELD_INT,		/* int member */
+	FIELD_U32,		/* uint32_t member */
+	FIELD_U64,		/* u64 member */
+	FIELD_HCTL,		/* int host, bus, target, lun members */
+	FIELD_NVME_HCTL,	/* int bus, target, lun members */
+	FIELD_HEX,		/* u64 member shown in hex as text */
+};
+
+enum out_mode {
+	OUT_TEXT = 0,		/* human readable tables */
+	OUT_JSON,		/* one JSON array of objects */
+	OUT_NDJSON,		/* one JSON object per line */
+};
+
+/* Column flags */
+#define OUT_RIGHT		0x1	/* right align the value */
+
+/*
+ * Describes one column of a table: where the value lives in the record
+ * and how wide the column is. Widths are fixed up front so that rows can
+ * be rendered without any format string parsing.
+ */
+struct out_field {
+	const char	*title;
+	const char	*key;		/* name used for JSON output */
+	int		type;
+	size_t		offset;
+	int		width;
+	int		flags;
+	const char	*suffix;
+};
+
+#define OUT_FIELD(_title, _key, _type, _struct, _member, _width)	\
+	{ _title, _key, _type, offsetof(_struct, _member), _width, 0, NULL }
+
+#define OUT_FIELD_FLAGS(_title, _key, _type, _struct, _member, _width,	\
+			_flags, _sfx)					\
+	{ _title, _key, _type, offsetof(_struct, _member), _width, _flags, _sfx }
+
+/* Field which only shows up in JSON output */
+#define OUT_KEY(_key, _type, _struct, _member)				\
+	{ NULL, _key, _type, offsetof(_struct, _member), 0, 0, NULL }
+
+struct out_table {
+	const struct out_field	*fields;
+	int			nr_fields;
+	char			sep;		/* column separator */
+};
+
+void out_set_mode(int);
+int out_get_mode(void);
+#define out_is_text()	(out_get_mode() == OUT_TEXT)
+
+void out_flush(void);
+void out_finish(void);
+void out_msg(const char *, ...) __attribute__((format(printf, 1, 2)));
+void out_write(const char *, size_t);
+void out_str(const char *);
+void out_char(char);
+void out_pad(const char *, int);
+void out_repeat(char, int);
+void out_u64(u64);
+void out_s64(long long);
+void out_printf(const char *, ...) __attribute__((format(printf, 1, 2)));
+
+void out_table_header(const struct out_table *);
+void out_table_row(const struct out_table *, const void *);
+
+/* Streaming JSON records, no-ops in text mode */
+void out_section(const char *);
+void out_record_begin(void);
+void out_record_str(const char *, const char *);
+void out_record_u64(const char *, u64);
+void out_record_s64(const char *, long long);
+void out_record_f64(const char *, double);
+void out_record_fields(const struct out_table *, const void *);
+void out_record_end(void);
+void out_record(const struct out_table *, const void *);
+#endif
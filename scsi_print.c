@@ -75,9 +75,9 @@ int print_colon_spaced(char *s)
 	p = p + 2;
 	ss = ss + 2;
 
-	printf("%s: %s ===== %s \n", __func__, p, ss);
+	out_printf("%s: %s ===== %s \n", __func__, p, ss);
 
-	printf("%s: %s\n", __func__, p);
+	out_printf("%s: %s\n", __func__, p);
 
 	memcpy(s, p, strlen(p));
 
@@ -104,141 +104,716 @@ static const char *calculate_size(u64 size)
 	return result;
 }
 
+/*
+ * Column layout of the device tables. Widths are fixed here once so that
+ * each row is rendered straight into the output buffer.
+ */
+static const struct out_field disk_fields[] = {
+	OUT_FIELD("BUS ID", "bus_id", FIELD_HCTL, struct scsi_device_info, host, 12),
+	OUT_FIELD("Vendor", "vendor", FIELD_STR, struct scsi_device_info, vendor, 16),
+	OUT_FIELD("Model", "model", FIELD_STR, struct scsi_device_info, model, 16),
+	OUT_FIELD("Revision", "revision", FIELD_STR, struct scsi_device_info, rev, 8),
+	OUT_FIELD("Major", "major", FIELD_U32, struct scsi_device_info, major, 5),
+	OUT_FIELD("Minor", "minor", FIELD_U32, struct scsi_device_info, minor, 5),
+	OUT_FIELD("Disk Type", "disk_type", FIELD_CHARS, struct scsi_device_info, disk_type, 16),
+	OUT_FIELD("Disk Name", "disk_name", FIELD_STR, struct scsi_device_info, disk_name, 8),
+	OUT_FIELD("Device Path", "device_path", FIELD_STR, struct scsi_device_info, disk_path, 24),
+};
+
+static const struct out_field mpath_disk_fields[] = {
+	OUT_FIELD("BUS ID", "bus_id", FIELD_HCTL, struct scsi_device_info, host, 12),
+	OUT_FIELD("Major", "major", FIELD_U32, struct scsi_device_info, major, 5),
+	OUT_FIELD("Minor", "minor", FIELD_U32, struct scsi_device_info, minor, 5),
+	OUT_FIELD("Disk Name", "disk_name", FIELD_STR, struct scsi_device_info, disk_name, 8),
+	OUT_FIELD("Device Path", "device_path", FIELD_STR, struct scsi_device_info, disk_path, 24),
+};
+
+static const struct out_field generic_disk_fields[] = {
+	OUT_FIELD("BUS ID", "bus_id", FIELD_HCTL, struct scsi_device_info, host, 12),
+	OUT_FIELD("Major", "major", FIELD_U32, struct scsi_device_info, major, 5),
+	OUT_FIELD("Minor", "minor", FIELD_U32, struct scsi_device_info, minor, 5),
+	OUT_FIELD("Disk Type", "disk_type", FIELD_CHARS, struct scsi_device_info, disk_type, 16),
+	OUT_FIELD("Disk Name", "disk_name", FIELD_STR, struct scsi_device_info, disk_name, 8),
+	OUT_FIELD("Device Path", "device_path", FIELD_STR, struct scsi_device_info, disk_path, 24),
+};
+
+static const struct out_field nvme_disk_fields[] = {
+	OUT_FIELD("BUS ID", "bus_id", FIELD_NVME_HCTL, struct scsi_device_info, bus, 12),
+	OUT_FIELD("Model", "model", FIELD_STR, struct scsi_device_info, model, 32),
+	OUT_FIELD("Revision", "revision", FIELD_STR, struct scsi_device_info, rev, 12),
+	OUT_FIELD_FLAGS("Major", "major", FIELD_U32, struct scsi_device_info, major, 5,
+	    OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Minor", "minor", FIELD_U32, struct scsi_device_info, minor, 5,
+	    OUT_RIGHT, NULL),
+	OUT_FIELD("Disk Type", "disk_type", FIELD_CHARS, struct scsi_device_info, disk_type, 16),
+	OUT_FIELD("Disk Name", "disk_name", FIELD_STR, struct scsi_device_info, disk_name, 8),
+	OUT_FIELD("Device Path", "device_path", FIELD_STR, struct scsi_device_info, disk_path, 24),
+};
+
+static const struct out_field fc_dev_fields[] = {
+	OUT_FIELD("Host", "host", FIELD_STR, struct fc_device_info, host_name, 8),
+	OUT_FIELD("Model", "model", FIELD_STR, struct fc_device_info, product_name, 8),
+	OUT_FIELD_FLAGS("Speed", "speed", FIELD_STR, struct fc_device_info, port_speed, 8,
+	    0, "GBit"),
+	OUT_FIELD("SerialNum", "serial_num", FIELD_STR, struct fc_device_info, serial_num, 16),
+	OUT_FIELD("DriverVer", "driver_version", FIELD_STR, struct fc_device_info, drv_version, 16),
+	OUT_FIELD("DriverName", "driver_name", FIELD_STR, struct fc_device_info, driver_name, 8),
+	OUT_FIELD("FW_Ver", "fw_version", FIELD_STR, struct fc_device_info, fw_version, 24),
+	OUT_FIELD("Role", "role", FIELD_STR, struct fc_device_info, active_mode, 8),
+	OUT_FIELD("State", "state", FIELD_STR, struct fc_device_info, link_state, 24),
+};
+
+static const struct out_field fc_rport_fields[] = {
+	OUT_FIELD("Rport", "rport", FIELD_STR, struct fc_rport_info, rport_name, 16),
+	OUT_FIELD("Rport_State", "port_state", FIELD_STR, struct fc_rport_info, port_state, 16),
+	OUT_FIELD("Roles", "roles", FIELD_STR, struct fc_rport_info, roles, 32),
+	OUT_FIELD("Rport_Name", "port_name", FIELD_STR, struct fc_rport_info, port_name, 32),
+	OUT_FIELD("Node_Name", "node_name", FIELD_STR, struct fc_rport_info, node_name, 32),
+	OUT_FIELD("Rport_ID", "port_id", FIELD_STR, struct fc_rport_info, port_id, 16),
+	OUT_FIELD("Dev_Loss", "dev_loss_tmo", FIELD_INT, struct fc_rport_info, dev_loss_tmo, 8),
+	OUT_FIELD("Fast_IO_Fail", "fast_io_fail_tmo", FIELD_STR, struct fc_rport_info, fast_io_fail_tmo, 12),
+};
+
+static const struct out_field fc_lun_fields[] = {
+	OUT_FIELD("Rport", "rport", FIELD_STR, struct fc_lun_info, rport_name, 16),
+	OUT_FIELD("Target_WWPN", "port_name", FIELD_STR, struct fc_lun_info, port_name, 20),
+	OUT_FIELD("HCTL", "hctl", FIELD_HCTL, struct fc_lun_info, host, 16),
+	OUT_FIELD("State", "state", FIELD_STR, struct fc_lun_info, state, 10),
+	OUT_FIELD("Disk", "disk", FIELD_STR, struct fc_lun_info, disk_name, 8),
+	OUT_FIELD("SG", "sg", FIELD_STR, struct fc_lun_info, sg_name, 8),
+	OUT_FIELD("Holders", "holders", FIELD_STR, struct fc_lun_info, holders, 16),
+};
+
+static const struct out_field scan_job_fields[] = {
+	OUT_FIELD("Host", "host", FIELD_CHARS, struct scan_job, host_name, 10),
+	OUT_FIELD("Scan", "scan", FIELD_CHARS, struct scan_job, chtl, 12),
+	OUT_FIELD_FLAGS("Time_ms", "ms", FIELD_U64, struct scan_job, ms, 8, OUT_RIGHT, NULL),
+	OUT_FIELD("Result", "result", FIELD_STR, struct scan_job, result, 24),
+};
+
+static const struct out_field scan_change_fields[] = {
+	OUT_FIELD("Change", "change", FIELD_CHARS, struct scan_change, change, 8),
+	OUT_FIELD("HCTL", "hctl", FIELD_HCTL, struct scan_change, host, 16),
+	OUT_FIELD("State", "state", FIELD_STR, struct scan_change, state, 10),
+	OUT_FIELD("Disk", "disk", FIELD_STR, struct scan_change, disk_name, 8),
+};
+
+static const struct out_field fc_vport_fields[] = {
+	OUT_FIELD("Vport", "vport", FIELD_STR, struct fc_vport_info, vport_name, 16),
+	OUT_FIELD("Parent", "parent", FIELD_CHARS, struct fc_vport_info, parent, 8),
+	OUT_FIELD("Host", "host", FIELD_CHARS, struct fc_vport_info, host_name, 8),
+	OUT_FIELD("State", "state", FIELD_STR, struct fc_vport_info, vport_state, 12),
+	OUT_FIELD("Type", "type", FIELD_STR, struct fc_vport_info, vport_type, 18),
+	OUT_FIELD("WWPN", "port_name", FIELD_STR, struct fc_vport_info, port_name, 18),
+	OUT_FIELD("WWNN", "node_name", FIELD_STR, struct fc_vport_info, node_name, 18),
+};
+
+static const struct out_field fc_vport_job_fields[] = {
+	OUT_FIELD("Parent", "parent", FIELD_CHARS, struct fc_vport_job, parent, 8),
+	OUT_FIELD("WWPN", "port_name", FIELD_CHARS, struct fc_vport_job, wwpn, 16),
+	OUT_FIELD("WWNN", "node_name", FIELD_CHARS, struct fc_vport_job, wwnn, 16),
+	OUT_FIELD("Vport", "vport", FIELD_CHARS, struct fc_vport_job, vport_name, 16),
+	OUT_FIELD_FLAGS("Time_ms", "ms", FIELD_U64, struct fc_vport_job, ms, 8, OUT_RIGHT, NULL),
+	OUT_FIELD("Result", "result", FIELD_CHARS, struct fc_vport_job, result, 24),
+};
+
+static const struct out_field tune_attr_fields[] = {
+	OUT_FIELD("Device", "device", FIELD_CHARS, struct tune_attr, dev, 16),
+	OUT_FIELD("Attribute", "attribute", FIELD_CHARS, struct tune_attr, attr, 16),
+	OUT_FIELD_FLAGS("Old", "old", FIELD_CHARS, struct tune_attr, old, 11, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("New", "new", FIELD_CHARS, struct tune_attr, val, 11, OUT_RIGHT, NULL),
+	OUT_FIELD("Result", "result", FIELD_CHARS, struct tune_attr, result, 24),
+};
+
+static const struct out_field mq_map_fields[] = {
+	OUT_FIELD("Device", "device", FIELD_CHARS, struct mq_map_info, disk_name, 12),
+	OUT_FIELD_FLAGS("Queues", "nr_hw_queues", FIELD_INT, struct mq_map_info, nr_hw_queues, 6, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("CPUs", "cpus", FIELD_INT, struct mq_map_info, nr_cpus, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Maps", "maps", FIELD_INT, struct mq_map_info, nr_maps, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("CPUs/Queue", "cpus_per_queue", FIELD_CHARS, struct mq_map_info, cpus_per_queue, 10, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Idle", "idle_queues", FIELD_INT, struct mq_map_info, idle_queues, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Cross", "cross_node_queues", FIELD_INT, struct mq_map_info, cross_node, 5, OUT_RIGHT, NULL),
+	OUT_FIELD("Unmapped CPUs", "unmapped_cpus", FIELD_CHARS, struct mq_map_info, unmapped, 14),
+	OUT_FIELD_FLAGS("Tags", "nr_tags", FIELD_INT, struct mq_map_info, nr_tags, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Requests", "nr_requests", FIELD_INT, struct mq_map_info, nr_requests, 8, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("RQ Aff", "rq_affinity", FIELD_INT, struct mq_map_info, rq_affinity, 6, OUT_RIGHT, NULL),
+	OUT_FIELD("Status", "status", FIELD_CHARS, struct mq_map_info, status, 24),
+};
+
+static const struct out_field irq_audit_fields[] = {
+	OUT_FIELD("Device", "device", FIELD_CHARS, struct irq_audit_info, device, 16),
+	OUT_FIELD("Driver", "driver", FIELD_CHARS, struct irq_audit_info, driver, 10),
+	OUT_FIELD("PCI", "pci", FIELD_CHARS, struct irq_audit_info, pci, 12),
+	OUT_FIELD_FLAGS("Node", "numa_node", FIELD_INT, struct irq_audit_info, numa_node, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("IRQs", "irqs", FIELD_INT, struct irq_audit_info, nr_irqs, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Active", "active_irqs", FIELD_INT, struct irq_audit_info, active_irqs, 6, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Remote", "remote_irqs", FIELD_INT, struct irq_audit_info, remote_irqs, 6, OUT_RIGHT, NULL),
+	OUT_FIELD("IRQ CPUs", "irq_cpus", FIELD_CHARS, struct irq_audit_info, irq_cpus, 16),
+	OUT_FIELD("IRQ Nodes", "irq_nodes", FIELD_CHARS, struct irq_audit_info, irq_nodes, 9),
+	OUT_FIELD_FLAGS("Interrupts", "interrupts", FIELD_U64, struct irq_audit_info, interrupts, 12, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Remote%", "remote_pct", FIELD_INT, struct irq_audit_info, remote_pct, 7, OUT_RIGHT, NULL),
+	OUT_FIELD("Status", "status", FIELD_CHARS, struct irq_audit_info, status, 24),
+};
+
+static const struct out_field irq_vector_fields[] = {
+	OUT_FIELD("Device", "device", FIELD_CHARS, struct irq_vector_info, device, 16),
+	OUT_FIELD_FLAGS("IRQ", "irq", FIELD_INT, struct irq_vector_info, irq, 5, OUT_RIGHT, NULL),
+	OUT_FIELD("Affinity", "affinity", FIELD_CHARS, struct irq_vector_info, affinity, 16),
+	OUT_FIELD("Effective", "effective", FIELD_CHARS, struct irq_vector_info, effective, 10),
+	OUT_FIELD("Nodes", "nodes", FIELD_CHARS, struct irq_vector_info, nodes, 5),
+	OUT_FIELD_FLAGS("Interrupts", "interrupts", FIELD_U64, struct irq_vector_info, interrupts, 12, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Remote%", "remote_pct", FIELD_INT, struct irq_vector_info, remote_pct, 7, OUT_RIGHT, NULL),
+	OUT_FIELD("Placement", "placement", FIELD_CHARS, struct irq_vector_info, placement, 9),
+};
+
+static const struct out_field link_audit_fields[] = {
+	OUT_FIELD("Device", "device", FIELD_CHARS, struct link_audit_info, device, 16),
+	OUT_FIELD("Type", "link_type", FIELD_CHARS, struct link_audit_info, type, 4),
+	OUT_FIELD("Driver", "driver", FIELD_CHARS, struct link_audit_info, driver, 10),
+	OUT_FIELD("Address", "address", FIELD_CHARS, struct link_audit_info, address, 18),
+	OUT_FIELD("Speed", "speed", FIELD_CHARS, struct link_audit_info, speed, 10),
+	OUT_FIELD("Max Speed", "max_speed", FIELD_CHARS, struct link_audit_info, max_speed, 10),
+	OUT_FIELD_FLAGS("Width", "width", FIELD_CHARS, struct link_audit_info, width, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Max Width", "max_width", FIELD_CHARS, struct link_audit_info, max_width, 9, OUT_RIGHT, NULL),
+	OUT_FIELD("Status", "status", FIELD_CHARS, struct link_audit_info, status, 24),
+};
+
+static const struct out_field nvme_subsys_fields[] = {
+	OUT_FIELD("Subsystem", "subsystem", FIELD_CHARS, struct nvme_subsys_info, name, 14),
+	OUT_FIELD("Model", "model", FIELD_CHARS, struct nvme_subsys_info, model, 24),
+	OUT_FIELD("IO Policy", "iopolicy", FIELD_CHARS, struct nvme_subsys_info, iopolicy, 11),
+	OUT_FIELD_FLAGS("Ctrls", "controllers", FIELD_INT, struct nvme_subsys_info, nr_ctrls, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("NS", "namespaces", FIELD_INT, struct nvme_subsys_info, nr_ns, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Paths", "paths", FIELD_INT, struct nvme_subsys_info, nr_paths, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Optimized", "optimized", FIELD_INT, struct nvme_subsys_info, nr_optimized, 9, OUT_RIGHT, NULL),
+	OUT_FIELD("Status", "status", FIELD_CHARS, struct nvme_subsys_info, status, 24),
+	OUT_FIELD("NQN", "nqn", FIELD_CHARS, struct nvme_subsys_info, nqn, 0),
+};
+
+static const struct out_field nvme_ctrl_fields[] = {
+	OUT_FIELD_FLAGS("Subsys", "subsys", FIELD_INT, struct nvme_ctrl_info, subsys, 6, OUT_RIGHT, NULL),
+	OUT_FIELD("Controller", "controller", FIELD_CHARS, struct nvme_ctrl_info, name, 10),
+	OUT_FIELD("Transport", "transport", FIELD_CHARS, struct nvme_ctrl_info, transport, 9),
+	OUT_FIELD("State", "state", FIELD_CHARS, struct nvme_ctrl_info, state, 10),
+	OUT_FIELD_FLAGS("Queues", "queue_count", FIELD_INT, struct nvme_ctrl_info, queue_count, 6, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("SQ Size", "sqsize", FIELD_INT, struct nvme_ctrl_info, sqsize, 7, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("KATO", "kato", FIELD_INT, struct nvme_ctrl_info, kato, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Paths", "paths", FIELD_INT, struct nvme_ctrl_info, nr_paths, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Optimized", "optimized", FIELD_INT, struct nvme_ctrl_info, nr_optimized, 9, OUT_RIGHT, NULL),
+	OUT_FIELD("Address", "address", FIELD_CHARS, struct nvme_ctrl_info, address, 0),
+};
+
+static const struct out_field nvme_ns_fields[] = {
+	OUT_FIELD_FLAGS("Subsys", "subsys", FIELD_INT, struct nvme_ns_info, subsys, 6, OUT_RIGHT, NULL),
+	OUT_FIELD("Namespace", "namespace", FIELD_CHARS, struct nvme_ns_info, name, 10),
+	OUT_FIELD_FLAGS("NSID", "nsid", FIELD_INT, struct nvme_ns_info, nsid, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Paths", "paths", FIELD_INT, struct nvme_ns_info, nr_paths, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Live", "live", FIELD_INT, struct nvme_ns_info, nr_live, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Optimized", "optimized", FIELD_INT, struct nvme_ns_info, nr_optimized, 9, OUT_RIGHT, NULL),
+	OUT_FIELD("Status", "status", FIELD_CHARS, struct nvme_ns_info, status, 12),
+};
+
+static const struct out_field nvme_path_fields[] = {
+	OUT_FIELD("Namespace", "namespace", FIELD_CHARS, struct nvme_path_info, ns_name, 10),
+	OUT_FIELD_FLAGS("NSID", "nsid", FIELD_INT, struct nvme_path_info, nsid, 5, OUT_RIGHT, NULL),
+	OUT_FIELD("Path", "path", FIELD_CHARS, struct nvme_path_info, name, 12),
+	OUT_FIELD("Controller", "controller", FIELD_CHARS, struct nvme_path_info, ctrl_name, 10),
+	OUT_FIELD("Ctrl State", "ctrl_state", FIELD_CHARS, struct nvme_path_info, ctrl_state, 10),
+	OUT_FIELD("ANA State", "ana_state", FIELD_CHARS, struct nvme_path_info, ana_state, 15),
+	OUT_FIELD_FLAGS("ANA Group", "ana_grpid", FIELD_INT, struct nvme_path_info, ana_grpid, 9, OUT_RIGHT, NULL),
+};
+
+static const struct out_field advice_fields[] = {
+	OUT_FIELD("Device", "device", FIELD_CHARS, struct advice_info, name, 10),
+	OUT_FIELD("Class", "class", FIELD_CHARS, struct advice_info, class, 9),
+	OUT_FIELD("Workload", "workload", FIELD_CHARS, struct advice_info, workload, 10),
+	OUT_FIELD("Setting", "setting", FIELD_CHARS, struct advice_info, setting, 14),
+	OUT_FIELD_FLAGS("Current", "current", FIELD_CHARS, struct advice_info, current, 11, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Advised", "advised", FIELD_CHARS, struct advice_info, advised, 11, OUT_RIGHT, NULL),
+	OUT_FIELD("Rationale", "rationale", FIELD_CHARS, struct advice_info, rationale, 0),
+};
+
+static const struct out_field mq_queue_fields[] = {
+	OUT_FIELD("Device", "device", FIELD_CHARS, struct mq_queue_info, disk_name, 12),
+	OUT_FIELD_FLAGS("Queue", "hctx", FIELD_INT, struct mq_queue_info, hctx, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("CPUs", "cpus", FIELD_INT, struct mq_queue_info, nr_cpus, 4, OUT_RIGHT, NULL),
+	OUT_FIELD("Nodes", "nodes", FIELD_CHARS, struct mq_queue_info, nodes, 6),
+	OUT_FIELD_FLAGS("Tags", "nr_tags", FIELD_INT, struct mq_queue_info, nr_tags, 5, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Reserved", "nr_reserved_tags", FIELD_INT, struct mq_queue_info, nr_reserved_tags, 8, OUT_RIGHT, NULL),
+	OUT_FIELD("CPU List", "cpu_list", FIELD_CHARS, struct mq_queue_info, cpu_list, 32),
+};
+
+static const struct out_field iscsi_dev_fields[] = {
+	OUT_FIELD("Host Name", "host", FIELD_CHARS, struct iscsi_sess_info, host_name, 9),
+	OUT_FIELD("Transport", "transport", FIELD_STR, struct iscsi_sess_info, transport, 9),
+	OUT_FIELD("IP Address", "address", FIELD_STR, struct iscsi_sess_info, conn_address, 16),
+	OUT_FIELD("Port", "port", FIELD_STR, struct iscsi_sess_info, conn_port, 5),
+	OUT_FIELD_FLAGS("Conns", "connections", FIELD_INT, struct iscsi_sess_info, nr_conns, 5, OUT_RIGHT, NULL),
+	OUT_FIELD("Session", "session", FIELD_CHARS, struct iscsi_sess_info, session_name, 12),
+	OUT_FIELD("State", "state", FIELD_STR, struct iscsi_sess_info, state, 10),
+	OUT_FIELD_FLAGS("LUNs", "luns", FIELD_INT, struct iscsi_sess_info, nr_luns, 5, OUT_RIGHT, NULL),
+	OUT_FIELD("Target Name", "target_name", FIELD_STR, struct iscsi_sess_info, targetname, 64),
+};
+
+static const struct out_field iscsi_lun_fields[] = {
+	OUT_FIELD("Session", "session", FIELD_STR, struct iscsi_lun_info, session_name, 12),
+	OUT_FIELD("HCTL", "hctl", FIELD_HCTL, struct iscsi_lun_info, host, 16),
+	OUT_FIELD("State", "state", FIELD_STR, struct iscsi_lun_info, state, 10),
+	OUT_FIELD("Disk", "disk", FIELD_STR, struct iscsi_lun_info, disk_name, 8),
+};
+
+static const struct out_field iscsi_numa_fields[] = {
+	OUT_FIELD("Session", "session", FIELD_CHARS, struct iscsi_numa_info, session_name, 12),
+	OUT_FIELD("Host", "host", FIELD_CHARS, struct iscsi_numa_info, host_name, 8),
+	OUT_KEY("transport", FIELD_STR, struct iscsi_numa_info, transport),
+	OUT_KEY("iface", FIELD_STR, struct iscsi_numa_info, ifacename),
+	OUT_FIELD("Netdev", "netdev", FIELD_CHARS, struct iscsi_numa_info, netdev, 10),
+	OUT_KEY("ipaddress", FIELD_CHARS, struct iscsi_numa_info, ipaddress),
+	OUT_KEY("hwaddress", FIELD_CHARS, struct iscsi_numa_info, hwaddress),
+	OUT_FIELD("PCI", "pci", FIELD_CHARS, struct iscsi_numa_info, pci, 12),
+	OUT_FIELD_FLAGS("Node", "numa_node", FIELD_INT, struct iscsi_numa_info, numa_node, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("IRQs", "irqs", FIELD_INT, struct iscsi_numa_info, nr_irqs, 4, OUT_RIGHT, NULL),
+	OUT_FIELD("IRQ CPUs", "irq_cpus", FIELD_CHARS, struct iscsi_numa_info, irq_cpus, 16),
+	OUT_FIELD("IRQ Nodes", "irq_nodes", FIELD_CHARS, struct iscsi_numa_info, irq_nodes, 9),
+	OUT_FIELD("Locality", "locality", FIELD_CHARS, struct iscsi_numa_info, locality, 10),
+	OUT_FIELD_FLAGS("LUNs", "luns", FIELD_INT, struct iscsi_numa_info, nr_luns, 4, OUT_RIGHT, NULL),
+	OUT_FIELD("Disks", "disks", FIELD_CHARS, struct iscsi_numa_info, disks, 24),
+	OUT_KEY("target_name", FIELD_STR, struct iscsi_numa_info, targetname),
+};
+
+static const struct out_field iscsi_event_fields[] = {
+	OUT_FIELD("Time", "time", FIELD_CHARS, struct iscsi_event, time, 12),
+	OUT_FIELD("Object", "object", FIELD_CHARS, struct iscsi_event, object, 18),
+	OUT_FIELD("Attribute", "attribute", FIELD_CHARS, struct iscsi_event, attr, 12),
+	OUT_FIELD("Old", "old", FIELD_CHARS, struct iscsi_event, old, 12),
+	OUT_FIELD("New", "new", FIELD_CHARS, struct iscsi_event, new, 12),
+	OUT_FIELD("Note", "note", FIELD_CHARS, struct iscsi_event, note, 40),
+};
+
+static const struct out_field iscsi_outage_fields[] = {
+	OUT_FIELD("Session", "session", FIELD_CHARS, struct iscsi_outage, session_name, 12),
+	OUT_FIELD("State", "state", FIELD_CHARS, struct iscsi_outage, state, 10),
+	OUT_FIELD_FLAGS("Outages", "outages", FIELD_INT, struct iscsi_outage, outages, 7, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Over", "exceeded", FIELD_INT, struct iscsi_outage, exceeded, 4, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Last_ms", "last_ms", FIELD_U64, struct iscsi_outage, last_ms, 8, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Max_ms", "max_ms", FIELD_U64, struct iscsi_outage, max_ms, 8, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Total_ms", "total_ms", FIELD_U64, struct iscsi_outage, total_ms, 9, OUT_RIGHT, NULL),
+	OUT_FIELD_FLAGS("Tmo_s", "recovery_tmo", FIELD_INT, struct iscsi_outage, recovery_tmo, 5, OUT_RIGHT, NULL),
+	OUT_FIELD("Target Name", "target_name", FIELD_STR, struct iscsi_outage, targetname, 64),
+};
+
+/*
+ * Fields of the enclosure list and of the detail pages ('show' and
+ * 'stats'). The text layout of those pages is kept as is, these only
+ * drive the JSON output.
+ */
+static const struct out_field enclosure_fields[] = {
+	OUT_KEY("bus_id", FIELD_STR, struct scsi_device_info, disk_name),
+	OUT_KEY("vendor", FIELD_STR, struct scsi_device_info, vendor),
+	OUT_KEY("model", FIELD_STR, struct scsi_device_info, model),
+	OUT_KEY("disk_type", FIELD_CHARS, struct scsi_device_info, disk_type),
+	OUT_KEY("device_path", FIELD_STR, struct scsi_device_info, disk_path),
+};
+
+static const struct out_field scsi_detail_fields[] = {
+	OUT_KEY("disk_name", FIELD_STR, struct scsi_device_info, disk_name),
+	OUT_KEY("vendor", FIELD_STR, struct scsi_device_info, vendor),
+	OUT_KEY("model", FIELD_STR, struct scsi_device_info, model),
+	OUT_KEY("size", FIELD_U64, struct scsi_device_info, size),
+	OUT_KEY("disk_type", FIELD_CHARS, struct scsi_device_info, disk_type),
+	OUT_KEY("revision", FIELD_STR, struct scsi_device_info, rev),
+	OUT_KEY("device_path", FIELD_STR, struct scsi_device_info, disk_path),
+	OUT_KEY("max_sectors", FIELD_U64, struct scsi_device_info, max_sectors),
+	OUT_KEY("range", FIELD_INT, struct scsi_device_info, range),
+	OUT_KEY("ext_range", FIELD_INT, struct scsi_device_info, ext_range),
+	OUT_KEY("capability", FIELD_INT, struct scsi_device_info, capability),
+	OUT_KEY("queue_depth", FIELD_INT, struct scsi_device_info, queue_depth),
+	OUT_KEY("queue_type", FIELD_STR, struct scsi_device_info, queue_type),
+	OUT_KEY("cdl_enabled", FIELD_INT, struct scsi_device_info, cdl_enabled),
+	OUT_KEY("cdl_supported", FIELD_INT, struct scsi_device_info, cdl_supported),
+	OUT_KEY("eh_timeout", FIELD_INT, struct scsi_device_info, eh_timeout),
+	OUT_KEY("timeout", FIELD_INT, struct scsi_device_info, timeout),
+	OUT_KEY("dh_state", FIELD_STR, struct scsi_device_info, state),
+	OUT_KEY("iodone_cnt", FIELD_HEX, struct scsi_device_info, iodone_cnt),
+	OUT_KEY("ioerr_cnt", FIELD_HEX, struct scsi_device_info, ioerr_cnt),
+	OUT_KEY("iorequest_cnt", FIELD_HEX, struct scsi_device_info, iorequest_cnt),
+	OUT_KEY("iocounterbits", FIELD_U64, struct scsi_device_info, iocounterbits),
+	OUT_KEY("iotmo_cnt", FIELD_U64, struct scsi_device_info, iotmo_cnt),
+	OUT_KEY("wwid", FIELD_STR, struct scsi_device_info, wwid),
+	OUT_KEY("pci_address", FIELD_STR, struct scsi_device_info, pci_address),
+	OUT_KEY("numa_node", FIELD_INT, struct scsi_device_info, numa_node),
+	OUT_KEY("alignment_offset", FIELD_U64, struct scsi_device_info, alignment_offset),
+	OUT_KEY("discard_alignment", FIELD_U64, struct scsi_device_info, discard_alignment),
+	OUT_KEY("evt_capacity_change_reported", FIELD_INT, struct scsi_device_info,
+	    evt_capacity_change_reported),
+	OUT_KEY("evt_inquiry_change_reported", FIELD_INT, struct scsi_device_info,
+	    evt_inquiry_change_reported),
+	OUT_KEY("evt_lun_change_reported", FIELD_INT, struct scsi_device_info,
+	    evt_lun_change_reported),
+	OUT_KEY("evt_media_change", FIELD_INT, struct scsi_device_info,
+	    evt_media_change),
+	OUT_KEY("evt_mode_parameter_change_reported", FIELD_INT,
+	    struct scsi_device_info, evt_mode_parameter_change_reported),
+	OUT_KEY("evt_soft_threshold_reached", FIELD_INT, struct scsi_device_info,
+	    evt_soft_threshold_reached),
+};
+
+static const struct out_field nvme_detail_fields[] = {
+	OUT_KEY("disk_name", FIELD_STR, struct scsi_device_info, disk_name),
+	OUT_KEY("model", FIELD_STR, struct scsi_device_info, model),
+	OUT_KEY("revision", FIELD_STR, struct scsi_device_info, rev),
+	OUT_KEY("serial", FIELD_STR, struct scsi_device_info, serial),
+	OUT_KEY("device_path", FIELD_STR, struct scsi_device_info, disk_path),
+	OUT_KEY("pci_address", FIELD_STR, struct scsi_device_info, pci_address),
+	OUT_KEY("numa_node", FIELD_INT, struct scsi_device_info, numa_node),
+	OUT_KEY("transport", FIELD_STR, struct scsi_device_info, transport),
+	OUT_KEY("size", FIELD_U64, struct scsi_device_info, size),
+	OUT_KEY("range", FIELD_INT, struct scsi_device_info, range),
+	OUT_KEY("ext_range", FIELD_INT, struct scsi_device_info, ext_range),
+	OUT_KEY("capability", FIELD_INT, struct scsi_device_info, capability),
+	OUT_KEY("queue_count", FIELD_INT, struct scsi_device_info, queue_depth),
+	OUT_KEY("eh_timeout", FIELD_INT, struct scsi_device_info, eh_timeout),
+	OUT_KEY("state", FIELD_STR, struct scsi_device_info, state),
+	OUT_KEY("cntlid", FIELD_INT, struct scsi_device_info, cntlid),
+	OUT_KEY("cntrltype", FIELD_STR, struct scsi_device_info, cntrltype),
+	OUT_KEY("kato", FIELD_INT, struct scsi_device_info, kato),
+	OUT_KEY("sqsize", FIELD_INT, struct scsi_device_info, sqsize),
+	OUT_KEY("uuid", FIELD_CHARS, struct scsi_device_info, uuid),
+	OUT_KEY("nsid", FIELD_CHARS, struct scsi_device_info, nsid),
+	OUT_KEY("wwid", FIELD_STR, struct scsi_device_info, wwid),
+	OUT_KEY("nguid", FIELD_CHARS, struct scsi_device_info, nguid),
+	OUT_KEY("alignment_offset", FIELD_U64, struct scsi_device_info, alignment_offset),
+	OUT_KEY("discard_alignment", FIELD_U64, struct scsi_device_info, discard_alignment),
+	OUT_KEY("dctype", FIELD_STR, struct scsi_device_info, dctype),
+	OUT_KEY("nuse", FIELD_U64, struct scsi_device_info, nuse),
+};
+
+static const struct out_field queue_fields[] = {
+	OUT_KEY("scheduler", FIELD_STR, struct disk_queue_data, scheduler),
+	OUT_KEY("physical_block_size", FIELD_U64, struct disk_queue_data, physical_block_size),
+	OUT_KEY("logical_block_size", FIELD_U64, struct disk_queue_data, logical_block_size),
+	OUT_KEY("minimum_io_size", FIELD_U64, struct disk_queue_data, minimum_io_size),
+	OUT_KEY("optimal_io_size", FIELD_U64, struct disk_queue_data, optimal_io_size),
+	OUT_KEY("zone_append_max_bytes", FIELD_U64, struct disk_queue_data, zone_append_max_bytes),
+	OUT_KEY("zone_write_granularity", FIELD_U64, struct disk_queue_data, zone_write_granularity),
+	OUT_KEY("discard_max_bytes", FIELD_U64, struct disk_queue_data, discard_max_bytes),
+	OUT_KEY("discard_max_hw_bytes", FIELD_U64, struct disk_queue_data, discard_max_hw_bytes),
+	OUT_KEY("discard_zeroes_data", FIELD_U64, struct disk_queue_data, discard_zeroes_data),
+	OUT_KEY("discard_granularity", FIELD_U64, struct disk_queue_data, discard_granularity),
+	OUT_KEY("io_poll", FIELD_U64, struct disk_queue_data, io_poll),
+	OUT_KEY("io_poll_delay", FIELD_U64, struct disk_queue_data, io_poll_delay),
+	OUT_KEY("stable_writes", FIELD_U64, struct disk_queue_data, stable_writes),
+	OUT_KEY("wbt_lat_usec", FIELD_U64, struct disk_queue_data, wbt_lat_usec),
+	OUT_KEY("rq_affinity", FIELD_U64, struct disk_queue_data, rq_affinity),
+	OUT_KEY("dax", FIELD_U64, struct disk_queue_data, dax),
+	OUT_KEY("add_random", FIELD_U64, struct disk_queue_data, add_random),
+	OUT_KEY("fua", FIELD_U64, struct disk_queue_data, fua),
+	OUT_KEY("nomerges", FIELD_U64, struct disk_queue_data, nomerges),
+	OUT_KEY("max_segments", FIELD_U64, struct disk_queue_data, max_segments),
+	OUT_KEY("max_segment_size", FIELD_U64, struct disk_queue_data, max_segment_size),
+	OUT_KEY("zoned", FIELD_U64, struct disk_queue_data, zoned),
+	OUT_KEY("nr_zones", FIELD_U64, struct disk_queue_data, nr_zones),
+	OUT_KEY("nr_requests", FIELD_U64, struct disk_queue_data, nr_requests),
+	OUT_KEY("read_ahead_kb", FIELD_U64, struct disk_queue_data, read_ahead_kb),
+	OUT_KEY("max_sectors_kb", FIELD_U64, struct disk_queue_data, max_sectors_kb),
+	OUT_KEY("max_hw_sectors_kb", FIELD_U64, struct disk_queue_data, max_hw_sectors_kb),
+	OUT_KEY("rotational", FIELD_U64, struct disk_queue_data, rotational),
+	OUT_KEY("write_cache", FIELD_STR, struct disk_queue_data, write_cache),
+	OUT_KEY("write_same_max_bytes", FIELD_U64, struct disk_queue_data, write_same_max_bytes),
+	OUT_KEY("write_zeroes_max_bytes", FIELD_U64, struct disk_queue_data, write_zeroes_max_bytes),
+};
+
+static const struct out_field fc_info_fields[] = {
+	OUT_KEY("host", FIELD_STR, struct fc_device_info, host_name),
+	OUT_KEY("adapter_name", FIELD_STR, struct fc_device_info, product_name),
+	OUT_KEY("model_desc", FIELD_STR, struct fc_device_info, model_desc),
+	OUT_KEY("node_name", FIELD_STR, struct fc_device_info, node_name),
+	OUT_KEY("port_name", FIELD_STR, struct fc_device_info, port_name),
+	OUT_KEY("fabric_name", FIELD_STR, struct fc_device_info, fabric_name),
+	OUT_KEY("serial_num", FIELD_STR, struct fc_device_info, serial_num),
+	OUT_KEY("port_id", FIELD_STR, struct fc_device_info, port_id),
+	OUT_KEY("port_state", FIELD_STR, struct fc_device_info, port_state),
+	OUT_KEY("port_type", FIELD_STR, struct fc_device_info, port_type),
+	OUT_KEY("driver_name", FIELD_STR, struct fc_device_info, driver_name),
+	OUT_KEY("driver_version", FIELD_STR, struct fc_device_info, drv_version),
+	OUT_KEY("fw_version", FIELD_STR, struct fc_device_info, fw_version),
+	OUT_KEY("supported_speeds", FIELD_STR, struct fc_device_info, supported_speed),
+	OUT_KEY("supported_classes", FIELD_STR, struct fc_device_info, supported_class),
+	OUT_KEY("symbolic_name", FIELD_STR, struct fc_device_info, symbolic_name),
+	OUT_KEY("dev_loss_tmo", FIELD_INT, struct fc_device_info, dev_loss_tmo),
+	OUT_KEY("link_state", FIELD_STR, struct fc_device_info, link_state),
+	OUT_KEY("active_mode", FIELD_STR, struct fc_device_info, active_mode),
+	OUT_KEY("max_npiv_vports", FIELD_INT, struct fc_device_info, max_npiv_vports),
+	OUT_KEY("npiv_vports_inuse", FIELD_INT, struct fc_device_info, npiv_vports_inuse),
+	OUT_KEY("rports", FIELD_INT, struct fc_device_info, no_rports),
+};
+
+static const struct out_field disk_stats_fields[] = {
+	OUT_KEY("read_ios", FIELD_U64, struct disk_stats, ios[0]),
+	OUT_KEY("write_ios", FIELD_U64, struct disk_stats, ios[1]),
+	OUT_KEY("read_merges", FIELD_U64, struct disk_stats, merges[0]),
+	OUT_KEY("write_merges", FIELD_U64, struct disk_stats, merges[1]),
+	OUT_KEY("read_sectors", FIELD_U64, struct disk_stats, sectors[0]),
+	OUT_KEY("write_sectors", FIELD_U64, struct disk_stats, sectors[1]),
+	OUT_KEY("read_ticks", FIELD_U64, struct disk_stats, ticks[0]),
+	OUT_KEY("write_ticks", FIELD_U64, struct disk_stats, ticks[1]),
+	OUT_KEY("io_ticks", FIELD_U64, struct disk_stats, io_ticks),
+	OUT_KEY("time_in_queue", FIELD_U64, struct disk_stats, time_in_queue),
+	OUT_KEY("in_flight", FIELD_U64, struct disk_stats, in_flight),
+};
+
+/*
+ * The keys match the attribute names under
+ * /sys/class/fc_host/hostX/statistics/, get_fc_dev_stats() reads them
+ * through this table.
+ */
+#define FC_STAT(_name)	OUT_KEY(#_name, FIELD_HEX, struct fc_host_statistics, _name)
+
+static const struct out_field fc_stats_fields[] = {
+	FC_STAT(seconds_since_last_reset),
+	FC_STAT(tx_frames),
+	FC_STAT(tx_words),
+	FC_STAT(rx_frames),
+	FC_STAT(rx_words),
+	FC_STAT(invalid_tx_word_count),
+	FC_STAT(lip_count),
+	FC_STAT(nos_count),
+	FC_STAT(error_frames),
+	FC_STAT(dumped_frames),
+	FC_STAT(link_failure_count),
+	FC_STAT(loss_of_sync_count),
+	FC_STAT(loss_of_signal_count),
+	FC_STAT(prim_seq_protocol_err_count),
+	FC_STAT(invalid_crc_count),
+	FC_STAT(fcp_input_requests),
+	FC_STAT(fcp_output_requests),
+	FC_STAT(fcp_control_requests),
+	FC_STAT(fcp_input_megabytes),
+	FC_STAT(fcp_output_megabytes),
+	FC_STAT(fcp_packet_alloc_failures),
+	FC_STAT(fcp_packet_aborts),
+	FC_STAT(fcp_frame_alloc_failures),
+	FC_STAT(fc_no_free_exch),
+	FC_STAT(fc_no_free_exch_xid),
+	FC_STAT(fc_xid_not_found),
+	FC_STAT(fc_xid_busy),
+	FC_STAT(fc_seq_not_found),
+	FC_STAT(fc_non_bls_resp),
+	FC_STAT(cn_sig_warn),
+	FC_STAT(cn_sig_alarm),
+	FC_STAT(fpin_cn),
+	FC_STAT(fpin_cn_credit_stall),
+	FC_STAT(fpin_cn_device_specific),
+	FC_STAT(fpin_cn_lost_credit),
+	FC_STAT(fpin_cn_oversubscription),
+	FC_STAT(fpin_li),
+	FC_STAT(fpin_li_device_specific),
+	FC_STAT(fpin_li_failure_unknown),
+	FC_STAT(fpin_li_invalid_crc_count),
+	FC_STAT(fpin_li_invalid_tx_word_count),
+	FC_STAT(fpin_li_link_failure_count),
+	FC_STAT(fpin_li_loss_of_signals_count),
+	FC_STAT(fpin_li_loss_of_sync_count),
+	FC_STAT(fpin_li_prim_seq_err_count),
+	FC_STAT(fpin_dn),
+	FC_STAT(fpin_dn_device_specific),
+	FC_STAT(fpin_dn_timeout),
+	FC_STAT(fpin_dn_unable_to_route),
+	FC_STAT(fpin_dn_unknown),
+};
+
+static const struct out_field iscsi_session_fields[] = {
+	OUT_KEY("targetname", FIELD_STR, struct iscsi_session, targetname),
+	OUT_KEY("target_state", FIELD_STR, struct iscsi_session, target_state),
+	OUT_KEY("state", FIELD_STR, struct iscsi_session, state),
+	OUT_KEY("initiatorname", FIELD_STR, struct iscsi_session, initiatorname),
+	OUT_KEY("target_id", FIELD_INT, struct iscsi_session, target_id),
+	OUT_KEY("abort_tmo", FIELD_INT, struct iscsi_session, abort_tmo),
+	OUT_KEY("creator", FIELD_INT, struct iscsi_session, creator),
+	OUT_KEY("data_pdu_in_order", FIELD_INT, struct iscsi_session, data_pdu_in_order),
+	OUT_KEY("data_seq_in_order", FIELD_INT, struct iscsi_session, data_seq_in_order),
+	OUT_KEY("erl", FIELD_INT, struct iscsi_session, err_level),
+	OUT_KEY("fast_abort", FIELD_INT, struct iscsi_session, fast_abort),
+	OUT_KEY("first_burst_len", FIELD_INT, struct iscsi_session, first_burst_len),
+	OUT_KEY("ifacename", FIELD_STR, struct iscsi_session, ifacename),
+	OUT_KEY("immediate_data", FIELD_INT, struct iscsi_session, immediate_data),
+	OUT_KEY("initial_r2t", FIELD_INT, struct iscsi_session, initial_r2t),
+	OUT_KEY("lu_reset_tmo", FIELD_INT, struct iscsi_session, lu_reset_tmo),
+	OUT_KEY("max_burst_len", FIELD_INT, struct iscsi_session, max_burst_len),
+	OUT_KEY("max_outstanding_r2t", FIELD_INT, struct iscsi_session, max_outstanding_r2t),
+	OUT_KEY("recovery_tmo", FIELD_INT, struct iscsi_session, recovery_tmo),
+};
+
+static const struct out_field iscsi_connection_fields[] = {
+	OUT_KEY("state", FIELD_STR, struct iscsi_connection, state),
+	OUT_KEY("address", FIELD_STR, struct iscsi_connection, address),
+	OUT_KEY("port", FIELD_INT, struct iscsi_connection, port),
+	OUT_KEY("ping_tmo", FIELD_INT, struct iscsi_connection, ping_tmo),
+	OUT_KEY("recv_tmo", FIELD_INT, struct iscsi_connection, recv_tmo),
+	OUT_KEY("persistent_address", FIELD_STR, struct iscsi_connection, persistent_address),
+	OUT_KEY("persistent_port", FIELD_INT, struct iscsi_connection, persistent_port),
+	OUT_KEY("header_digest", FIELD_INT, struct iscsi_connection, header_digest),
+	OUT_KEY("data_digest", FIELD_INT, struct iscsi_connection, data_digest),
+	OUT_KEY("exp_statsn", FIELD_INT, struct iscsi_connection, exp_statsn),
+	OUT_KEY("max_recv_dlength", FIELD_INT, struct iscsi_connection, max_recv_dlength),
+	OUT_KEY("max_xmit_dlength", FIELD_INT, struct iscsi_connection, max_xmit_dlength),
+};
+
+static const struct out_table disk_table = OUT_TABLE(disk_fields, '\t');
+static const struct out_table mpath_disk_table = OUT_TABLE(mpath_disk_fields, '\t');
+static const struct out_table generic_disk_table = OUT_TABLE(generic_disk_fields, '\t');
+static const struct out_table nvme_disk_table = OUT_TABLE(nvme_disk_fields, '\t');
+static const struct out_table fc_dev_table = OUT_TABLE(fc_dev_fields, '\t');
+static const struct out_table fc_rport_table = OUT_TABLE(fc_rport_fields, ' ');
+static const struct out_table fc_lun_table = OUT_TABLE(fc_lun_fields, ' ');
+static const struct out_table scan_job_table = OUT_TABLE(scan_job_fields, ' ');
+static const struct out_table scan_change_table = OUT_TABLE(scan_change_fields, ' ');
+static const struct out_table tune_attr_table = OUT_TABLE(tune_attr_fields, ' ');
+static const struct out_table mq_map_table = OUT_TABLE(mq_map_fields, ' ');
+static const struct out_table mq_queue_table = OUT_TABLE(mq_queue_fields, ' ');
+static const struct out_table irq_audit_table = OUT_TABLE(irq_audit_fields, ' ');
+static const struct out_table irq_vector_table = OUT_TABLE(irq_vector_fields, ' ');
+static const struct out_table link_audit_table = OUT_TABLE(link_audit_fields, ' ');
+static const struct out_table nvme_subsys_table = OUT_TABLE(nvme_subsys_fields, ' ');
+static const struct out_table nvme_ctrl_table = OUT_TABLE(nvme_ctrl_fields, ' ');
+static const struct out_table nvme_ns_table = OUT_TABLE(nvme_ns_fields, ' ');
+static const struct out_table nvme_path_table = OUT_TABLE(nvme_path_fields, ' ');
+static const struct out_table advice_table = OUT_TABLE(advice_fields, ' ');
+static const struct out_table fc_vport_table = OUT_TABLE(fc_vport_fields, ' ');
+static const struct out_table fc_vport_job_table = OUT_TABLE(fc_vport_job_fields, ' ');
+static const struct out_table iscsi_dev_table = OUT_TABLE(iscsi_dev_fields, ' ');
+static const struct out_table iscsi_lun_table = OUT_TABLE(iscsi_lun_fields, ' ');
+static const struct out_table iscsi_numa_table = OUT_TABLE(iscsi_numa_fields, ' ');
+static const struct out_table iscsi_event_table = OUT_TABLE(iscsi_event_fields, ' ');
+static const struct out_table iscsi_outage_table = OUT_TABLE(iscsi_outage_fields, ' ');
+static const struct out_table enclosure_table = OUT_TABLE(enclosure_fields, '\t');
+static const struct out_table scsi_detail_table = OUT_TABLE(scsi_detail_fields, 0);
+static const struct out_table nvme_detail_table = OUT_TABLE(nvme_detail_fields, 0);
+static const struct out_table queue_table = OUT_TABLE(queue_fields, 0);
+static const struct out_table fc_info_table = OUT_TABLE(fc_info_fields, 0);
+static const struct out_table disk_stats_table = OUT_TABLE(disk_stats_fields, 0);
+static const struct out_table iscsi_session_table = OUT_TABLE(iscsi_session_fields, 0);
+static const struct out_table iscsi_connection_table = OUT_TABLE(iscsi_connection_fields, 0);
+const struct out_table fc_stats_table = OUT_TABLE(fc_stats_fields, 0);
+
 void print_command_label(char *label)
 {
 	print_trace_enter();
-	printf("\nDisplaying All %s devices on the system.\n", label);
-	printf("%-.64s\n", dash);
+
+	if (!out_is_text()) {
+		out_section(label);
+		return;
+	}
+
+	out_str("\nDisplaying All ");
+	out_str(label);
+	out_str(" devices on the system.\n");
+	out_repeat('-', 64);
+	out_char('\n');
 }
 
 void print_mpath_disk_header(void)
 {
 	print_trace_enter();
 
-	printf("\n");
-	printf("%-12s\t%-5s\t%-5s\t%-8s\t%-24s\n",
-	    "BUS ID", "Major", "Minor", "Disk Name", "Device Path");
-	printf("%-.12s\t%-.5s\t%-.5s\t%-.8s\t%-.24s\n",
-		dash, dash, dash, dash, dash);
+	out_table_header(&mpath_disk_table);
 }
 
 void print_mpath_disk_info(struct scsi_device_info *d_info_p)
 {
 	print_trace_enter();
-	printf("[%d:%d:%d:%d]\t%-5d\t%-5d\t%-8s\t%-24s\n",
-		d_info_p->host, d_info_p->bus, d_info_p->target, d_info_p->lun,
-		d_info_p->major, d_info_p->minor,
-		d_info_p->disk_name, d_info_p->disk_path);
+	out_table_row(&mpath_disk_table, d_info_p);
 }
 
 void print_generic_disk_header(void)
 {
 	print_trace_enter();
 
-	printf("\n");
-	printf("%-12s\t%-5s\t%-5s\t%-16s\t%-8s\t%-24s\n",
-	    "BUS ID ", "Major", "Minor", "Disk Type", "Disk Name", "Device Path");
-	printf("%-.12s\t%-.5s\t%-.5s\t%-.16s\t%-.8s\t%-.24s\n",
-		dash, dash, dash, dash, dash, dash);
+	out_table_header(&generic_disk_table);
 }
 
 void print_generic_disk_info(struct scsi_device_info *d_info_p)
 {
 	print_trace_enter();
-	printf("[%d:%d:%d:%d]\t%-5d\t%-5d\t%-16s\t%-8s\t%-24s\n",
-		d_info_p->host, d_info_p->bus, d_info_p->target, d_info_p->lun,
-		d_info_p->major, d_info_p->minor, d_info_p->disk_type,
-		d_info_p->disk_name, d_info_p->disk_path);
+	out_table_row(&generic_disk_table, d_info_p);
 }
 
 void print_disk_header(void)
 {
 	print_trace_enter();
 
-	printf("\n");
-	printf("%-12s\t%-16s\t%-16s\t%-8s\t%-5s\t%-5s\t%-16s\t%-8s\t%-24s\n",
-	    "BUS ID      ", "Vendor", "Model", "Revision", "Major", "Minor",
-	    "Disk Type", "Disk Name", "Device Path");
-	printf("%-.12s\t%-.16s\t%-.16s\t%-.8s\t%-.5s\t%-.5s\t%-.16s\t%-.8s\t%-.24s\n",
-		dash, dash, dash, dash, dash, dash, dash, dash, dash);
+	out_table_header(&disk_table);
 }
 
 void print_disk_info(struct scsi_device_info *d_info_p)
 {
 	print_trace_enter();
-	printf("[%d:%d:%d:%d]\t%-16s\t%-8s\t%-8s\t%-5d\t%-5d\t%-16s\t%-8s\t%-24s\n",
-		d_info_p->host, d_info_p->bus, d_info_p->target, d_info_p->lun,
-		d_info_p->vendor, d_info_p->model, d_info_p->rev, d_info_p->major,
-		d_info_p->minor, d_info_p->disk_type, d_info_p->disk_name,
-		d_info_p->disk_path);
+	out_table_row(&disk_table, d_info_p);
 }
 
 void print_nvme_disk_header(void)
 {
 	print_trace_enter();
 
-	printf("\n");
-	printf("%-12s\t%-32s\t%-12s\t%-5s\t%-5s\t%-16s\t%-8s\t%-24s\n",
-	    "BUS ID      ", "Model ", "Revision", "Major", "Minor", "Disk Type",
-	    "Disk Name", "Device Path");
-	printf("%-.12s\t%-.32s\t%-.12s\t%-.5s\t%-.5s\t%-.16s\t%-.8s\t%-.24s\n",
-		dash, dash, dash, dash, dash, dash, dash, dash);
+	out_table_header(&nvme_disk_table);
 }
 
 void print_nvme_disk_info(struct scsi_device_info *d_info_p)
 {
 	print_trace_enter();
-	printf("[N:%d:%d:%d]\t%-32s\t%-12s\t%5d\t%5d\t%-16s\t%-8s\t%-24s\n",
-		d_info_p->bus, d_info_p->target, d_info_p->lun,
-		d_info_p->model, d_info_p->rev, d_info_p->major,
-		d_info_p->minor, d_info_p->disk_type, d_info_p->disk_name,
-		d_info_p->disk_path);
+	out_table_row(&nvme_disk_table, d_info_p);
 }
 
 void print_scsi_queue_data(struct disk_queue_data *q_data)
 {
 	print_trace_enter();
-	printf("\n %-.48s\n", dash);
-	printf("\t\tQueue Data\t");
-	printf("\n %-.48s\n\n", dash);
 
-	printf(" Scheduler: \n  %s\n\n", q_data->scheduler);
-	printf(" Physical Block Size	: %s \n",
+	if (!out_is_text()) {
+		out_record_fields(&queue_table, q_data);
+		return;
+	}
+
+	out_printf("\n %-.48s\n", dash);
+	out_printf("\t\tQueue Data\t");
+	out_printf("\n %-.48s\n\n", dash);
+
+	out_printf(" Scheduler: \n  %s\n\n", q_data->scheduler);
+	out_printf(" Physical Block Size	: %s \n",
 	    calculate_size(q_data->physical_block_size));
-	printf(" Logical Block Size	: %s \n",
+	out_printf(" Logical Block Size	: %s \n",
 	    calculate_size(q_data->logical_block_size));
-	printf(" Minimum IO Size	: %s \n",
+	out_printf(" Minimum IO Size	: %s \n",
 	    calculate_size(q_data->minimum_io_size));
-	printf(" Optimal IO Size	: %s \n",
+	out_printf(" Optimal IO Size	: %s \n",
 	    calculate_size(q_data->optimal_io_size));
-	printf(" Zoned Append Max Bytes	: %s \n",
+	out_printf(" Zoned Append Max Bytes	: %s \n",
 	    calculate_size(q_data->zone_append_max_bytes));
-	printf(" Zone Write Granularity	: %s \n",
+	out_printf(" Zone Write Granularity	: %s \n",
 	    calculate_size(q_data->zone_write_granularity));
-	printf(" Discard Max Bytes  	: %s \n",
+	out_printf(" Discard Max Bytes  	: %s \n",
 	    calculate_size(q_data->discard_max_bytes));
-	printf(" Discard max HW bytes  	: %s \n",
+	out_printf(" Discard max HW bytes  	: %s \n",
 	    calculate_size(q_data->discard_max_hw_bytes));
-	printf(" Discard zeroes data  	: %s \n",
+	out_printf(" Discard zeroes data  	: %s \n",
 	    calculate_size(q_data->discard_zeroes_data));
-	printf(" Discard Granularity 	: %s \n\n",
+	out_printf(" Discard Granularity 	: %s \n\n",
 	    calculate_size(q_data->discard_granularity));
-	printf(" IO Poll	:  %-8lld \n", q_data->io_poll);
-	printf(" IO Poll Delay	:  %-8lld \n", q_data->io_poll_delay);
-	printf(" stable_writes	:  %-8lld \n", q_data->stable_writes);
-	printf(" wbt_lat_usec	:  %-8lld \n", q_data->wbt_lat_usec);
-	printf(" rq_affinity	:  %-8lld \n", q_data->rq_affinity);
-	printf(" DAX	  : %-8lld	add_random	 : %-8lld \n",
+	out_printf(" IO Poll	:  %-8lld \n", q_data->io_poll);
+	out_printf(" IO Poll Delay	:  %-8lld \n", q_data->io_poll_delay);
+	out_printf(" stable_writes	:  %-8lld \n", q_data->stable_writes);
+	out_printf(" wbt_lat_usec	:  %-8lld \n", q_data->wbt_lat_usec);
+	out_printf(" rq_affinity	:  %-8lld \n", q_data->rq_affinity);
+	out_printf(" DAX	  : %-8lld	add_random	 : %-8lld \n",
 	    q_data->dax, q_data->add_random);
-	printf(" FUA	  : %-8lld 	nomerges 	 : %-8lld \n",
+	out_printf(" FUA	  : %-8lld 	nomerges 	 : %-8lld \n",
 	    q_data->fua, q_data->nomerges);
-	printf(" Segments : %-8lld	Segment Size	 : %s \n",
+	out_printf(" Segments : %-8lld	Segment Size	 : %s \n",
 	    q_data->max_segments, calculate_size(q_data->max_segment_size));
-	printf(" Zoned	  : %-8lld	nr_zones	 : %-8lld \n",
+	out_printf(" Zoned	  : %-8lld	nr_zones	 : %-8lld \n",
 	    q_data->zoned, q_data->nr_zones);
-	printf(" Readahead : %-8lld 	Write Cache	 : %s\n",
+	out_printf(" Readahead : %-8lld 	Write Cache	 : %s\n",
 	    q_data->read_ahead_kb, q_data->write_cache);
-	printf(" WriteSame : %s \tWrite Zeroes  	 : %s \n",
+	out_printf(" WriteSame : %s \tWrite Zeroes  	 : %s \n",
 	    calculate_size(q_data->write_same_max_bytes),
 	    calculate_size(q_data->write_zeroes_max_bytes));
 }
@@ -246,49 +821,62 @@ void print_scsi_queue_data(struct disk_queue_data *q_data)
 void print_scsi_disk_details(struct scsi_device_info *d_info)
 {
 	print_trace_enter();
-	printf("\n%-.48s\n", dash);
-	printf("	Show Details for %s", d_info->disk_name);
-	printf("\n%-.48s\n", dash);
-	printf("\n");
-	printf(" Vendor		:  %s \n", d_info->vendor);
-	printf(" Model Name	:  %-16s \n", d_info->model);
-	printf(" Size		:  %llu  Sectors, %s \n", d_info->size,
+
+	if (!out_is_text()) {
+		out_section("disk");
+		out_record_begin();
+		out_record_fields(&scsi_detail_table, d_info);
+		print_scsi_queue_data(&d_info->q_data);
+		out_record_end();
+		return;
+	}
+
+	out_printf("\n%-.48s\n", dash);
+	out_printf("	Show Details for %s", d_info->disk_name);
+	out_printf("\n%-.48s\n", dash);
+	out_printf("\n");
+	out_printf(" Vendor		:  %s \n", d_info->vendor);
+	out_printf(" Model Name	:  %-16s \n", d_info->model);
+	out_printf(" Size		:  %llu  Sectors, %s \n", d_info->size,
 	    calculate_size(d_info->q_data.logical_block_size * d_info->size));
-	printf(" Disk Type	:  %s \n", d_info->disk_type);
-	printf(" Revision	:  %s \n", d_info->rev);
-	printf(" Disk Path	:  %s \n", d_info->disk_path);
-	printf(" Max Sectors	:  %llu \n", d_info->max_sectors);
-	printf(" Range		:  %d \n", d_info->range);
-	printf(" Extent Range	:  %d \n", d_info->ext_range);
-	printf(" Capability	:  %#x \n", d_info->capability);
-	printf(" Queue Depth	:  %-8d \n", d_info->queue_depth);
-	printf(" Queue Type	:  %-8s \n", d_info->queue_type);
-	printf(" CDL Enabled	:  %-8d \n", d_info->cdl_enabled);
-	printf(" CDL Supported	:  %-8d \n", d_info->cdl_supported);
-	printf(" EH Timeout	:  %-8d \n", d_info->eh_timeout);
-	printf(" TimeOut	:  %-16d \n", d_info->timeout);
-	printf(" DH State	:  %-8s \n", d_info->state);
-	printf(" IO Done cnt	:  %#llx \n", d_info->iodone_cnt);
-	printf(" IO error cnt	:  %#llx \n", d_info->ioerr_cnt);
-	printf(" IO Request cnt	:  %#llx \n", d_info->iorequest_cnt);
-	printf(" IO Counter bits:  %lld \n", d_info->iocounterbits);
-	printf(" IO Timeout	:  %lld \n", d_info->iotmo_cnt);
-	printf(" WWID		:  %-64s \n", d_info->wwid);
-	printf(" Alignment Offset :  %#llx \n", d_info->alignment_offset);
-	printf(" Discard Alignment:  %#llx \n", d_info->discard_alignment);
-
-	printf("\n Scsi Device Event Notification \n\n");
-	printf(" Capacity Change Reported	:  %d \n",
+	out_printf(" Disk Type	:  %s \n", d_info->disk_type);
+	out_printf(" Revision	:  %s \n", d_info->rev);
+	out_printf(" Disk Path	:  %s \n", d_info->disk_path);
+	out_printf(" Max Sectors	:  %llu \n", d_info->max_sectors);
+	out_printf(" Range		:  %d \n", d_info->range);
+	out_printf(" Extent Range	:  %d \n", d_info->ext_range);
+	out_printf(" Capability	:  %#x \n", d_info->capability);
+	out_printf(" Queue Depth	:  %-8d \n", d_info->queue_depth);
+	out_printf(" Queue Type	:  %-8s \n", d_info->queue_type);
+	out_printf(" CDL Enabled	:  %-8d \n", d_info->cdl_enabled);
+	out_printf(" CDL Supported	:  %-8d \n", d_info->cdl_supported);
+	out_printf(" EH Timeout	:  %-8d \n", d_info->eh_timeout);
+	out_printf(" TimeOut	:  %-16d \n", d_info->timeout);
+	out_printf(" DH State	:  %-8s \n", d_info->state);
+	out_printf(" IO Done cnt	:  %#llx \n", d_info->iodone_cnt);
+	out_printf(" IO error cnt	:  %#llx \n", d_info->ioerr_cnt);
+	out_printf(" IO Request cnt	:  %#llx \n", d_info->iorequest_cnt);
+	out_printf(" IO Counter bits:  %lld \n", d_info->iocounterbits);
+	out_printf(" IO Timeout	:  %lld \n", d_info->iotmo_cnt);
+	out_printf(" WWID		:  %-64s \n", d_info->wwid);
+	out_printf(" PCI Address	:  %s \n",
+	    d_info->pci_address ? d_info->pci_address : "-");
+	out_printf(" NUMA Node	:  %d \n", d_info->numa_node);
+	out_printf(" Alignment Offset :  %#llx \n", d_info->alignment_offset);
+	out_printf(" Discard Alignment:  %#llx \n", d_info->discard_alignment);
+
+	out_printf("\n Scsi Device Event Notification \n\n");
+	out_printf(" Capacity Change Reported	:  %d \n",
 	    d_info->evt_capacity_change_reported);
-	printf(" Inquiry Change Reported	:  %d \n",
+	out_printf(" Inquiry Change Reported	:  %d \n",
 	    d_info->evt_inquiry_change_reported);
-	printf(" LUN Change Reported		:  %d \n",
+	out_printf(" LUN Change Reported		:  %d \n",
 	    d_info->evt_lun_change_reported);
-	printf(" Media Change			:  %d \n",
+	out_printf(" Media Change			:  %d \n",
 	    d_info->evt_media_change);
-	printf(" Mode Parameter Change Reported :  %d \n",
+	out_printf(" Mode Parameter Change Reported :  %d \n",
 	    d_info->evt_mode_parameter_change_reported);
-	printf(" Soft Threshold Reached 	:  %d \n",
+	out_printf(" Soft Threshold Reached 	:  %d \n",
 	    d_info->evt_capacity_change_reported);
 
 	print_scsi_queue_data(&d_info->q_data);
@@ -297,35 +885,49 @@ void print_scsi_disk_details(struct scsi_device_info *d_info)
 void print_nvme_disk_details(struct scsi_device_info *d_info)
 {
 	print_trace_enter();
-	printf("\n%-.48s\n", dash);
-	printf("	Show Details for %s	", d_info->disk_name);
-	printf("\n%-.48s\n", dash);
-	printf(" Model Name	:  %s \n", d_info->model);
-	printf(" Revision	:  %s \n", d_info->rev);
-	printf(" Serial		:  %s \n", d_info->serial);
-	printf(" Disk Path	:  %-8s \n", d_info->disk_path);
-	printf(" PCI Address	:  %s \n", d_info->pci_address);
-	printf(" Transport	:  %s \n", d_info->transport);
-	printf(" Size		:  %llu Sectors, %s \n", d_info->size,
+
+	if (!out_is_text()) {
+		out_section("disk");
+		out_record_begin();
+		out_record_fields(&nvme_detail_table, d_info);
+		print_scsi_queue_data(&d_info->q_data);
+		out_record_end();
+		return;
+	}
+
+	out_printf("\n%-.48s\n", dash);
+	out_printf("	Show Details for %s	", d_info->disk_name);
+	out_printf("\n%-.48s\n", dash);
+	out_printf(" Model Name	:  %s \n", d_info->model);
+	out_printf(" Revision	:  %s \n", d_info->rev);
+	out_printf(" Serial		:  %s \n", d_info->serial);
+	out_printf(" Disk Path	:  %-8s \n", d_info->disk_path);
+	out_printf(" PCI Address	:  %s \n", d_info->pci_address);
+	out_printf(" NUMA Node	:  %d \n", d_info->numa_node);
+	out_printf(" Transport	:  %s \n", d_info->transport);
+	out_printf(" Size		:  %llu Sectors, %s \n", d_info->size,
 	    calculate_size(d_info->q_data.logical_block_size * d_info->size));
-	printf(" Range		:  %d \n", d_info->range);
-	printf(" Extent Range	:  %d \n", d_info->ext_range);
-	printf(" Capability	:  %#x \n", d_info->capability);
-	printf(" Queue Depth	:  %d \n", d_info->queue_depth);
-	printf(" EH Timeout	:  %d \n", d_info->eh_timeout);
-	printf(" State		:  %-8s \n", d_info->state);
-	printf(" Controller ID	:  %d	\n", d_info->cntlid);
-	printf(" Controller Type:  %s   \n", d_info->cntrltype);
-	printf(" KATO		:  %d   \n", d_info->kato);
-	printf(" SQ Size	:  %d	\n", d_info->sqsize);
-	printf(" UUID		:  %-64s \n", d_info->uuid);
-	printf(" NSID		:  %-64s \n", d_info->nsid);
-	printf(" WWID		:  %-64s \n", d_info->wwid);
-	printf(" NGUID		:  %-64s \n", d_info->nguid);
-	printf(" Alignment Offset :  %#llx \n", d_info->alignment_offset);
-	printf(" Discard Alignment:  %#llx \n", d_info->discard_alignment);
-	printf(" Discovery Controller Type	: %s \n", d_info->dctype);
-	printf(" Namespace Utilization		: %llu \n", d_info->nuse);
+	out_printf(" Range		:  %d \n", d_info->range);
+	out_printf(" Extent Range	:  %d \n", d_info->ext_range);
+	out_printf(" Capability	:  %#x \n", d_info->capability);
+	out_printf(" Queue Depth	:  %d \n", d_info->queue_depth);
+	out_printf(" EH Timeout	:  %d \n", d_info->eh_timeout);
+	out_printf(" State		:  %-8s \n", d_info->state);
+	out_printf(" Controller ID	:  %d	\n", d_info->cntlid);
+	out_printf(" Controller Type:  %s   \n", d_info->cntrltype);
+	out_printf(" KATO		:  %d   \n", d_info->kato);
+	out_printf(" SQ Size	:  %d	\n", d_info->sqsize);
+	out_printf(" UUID		:  %-64s \n", d_info->uuid);
+	out_printf(" NSID		:  %-64s \n", d_info->nsid);
+	out_printf(" WWID		:  %-64s \n", d_info->wwid);
+	out_printf(" PCI Address	:  %s \n",
+	    d_info->pci_address ? d_info->pci_address : "-");
+	out_printf(" NUMA Node	:  %d \n", d_info->numa_node);
+	out_printf(" NGUID		:  %-64s \n", d_info->nguid);
+	out_printf(" Alignment Offset :  %#llx \n", d_info->alignment_offset);
+	out_printf(" Discard Alignment:  %#llx \n", d_info->discard_alignment);
+	out_printf(" Discovery Controller Type	: %s \n", d_info->dctype);
+	out_printf(" Namespace Utilization		: %llu \n", d_info->nuse);
 
 	print_scsi_queue_data(&d_info->q_data);
 }
@@ -333,286 +935,778 @@ void print_nvme_disk_details(struct scsi_device_info *d_info)
 void print_fc_info(struct fc_device_info *fc_info_p)
 {
 	print_trace_enter();
-	printf("\n%-.48s\n", dash);
-	printf("	Show Details for FC %s ", fc_info_p->host_name);
-	printf("\n%-.48s\n", dash);
-	printf("\n");
-	printf(" Adapter Name	  : %s \n", fc_info_p->product_name);
-	printf(" Model Desc	  : %s \n", fc_info_p->model_desc);
-	printf(" Host Name	  : %s \n", fc_info_p->host_name);
-	printf(" Node Name	  : %s \n", fc_info_p->node_name);
-	printf(" Port Name	  : %s \n", fc_info_p->port_name);
-	printf(" Fabric Name	  : %s \n", fc_info_p->fabric_name);
-	printf(" Serial Number	  : %s \n", fc_info_p->serial_num);
-	printf(" Port ID	  : %s \n", fc_info_p->port_id);
-	printf(" Port State	  : %s \n", fc_info_p->port_state);
-	printf(" Port Type 	  : %s \n", fc_info_p->port_type);
-	printf(" Driver Attached  : %s \n", fc_info_p->driver_name);
-	printf(" Driver Version	  : %s \n", fc_info_p->drv_version);
-	printf(" Firmware Version : %s \n", fc_info_p->fw_version);
-	printf(" Supported Speed  : %s \n", fc_info_p->supported_speed);
-	printf(" Supported Class  : %s \n", fc_info_p->supported_class);
-	printf(" Symbolic Name	  : %s \n", fc_info_p->symbolic_name);
-	printf(" Dev Loss Timeout : %d \n", fc_info_p->dev_loss_tmo);
-	printf(" Link State	  : %s \n", fc_info_p->link_state);
-	printf(" Active Mode	  : %s \n", fc_info_p->active_mode);
-	printf(" Max NPIV VPorts  : %d \n", fc_info_p->max_npiv_vports);
-	printf(" In Use NPIV Port : %d \n", fc_info_p->npiv_vports_inuse);
-	printf(" R-Ports Found	  : %d\n", fc_info_p->no_rports);
-	printf("\n");
+
+	if (!out_is_text()) {
+		out_section("fc_port");
+		out_record(&fc_info_table, fc_info_p);
+		return;
+	}
+
+	out_printf("\n%-.48s\n", dash);
+	out_printf("	Show Details for FC %s ", fc_info_p->host_name);
+	out_printf("\n%-.48s\n", dash);
+	out_printf("\n");
+	out_printf(" Adapter Name	  : %s \n", fc_info_p->product_name);
+	out_printf(" Model Desc	  : %s \n", fc_info_p->model_desc);
+	out_printf(" Host Name	  : %s \n", fc_info_p->host_name);
+	out_printf(" Node Name	  : %s \n", fc_info_p->node_name);
+	out_printf(" Port Name	  : %s \n", fc_info_p->port_name);
+	out_printf(" Fabric Name	  : %s \n", fc_info_p->fabric_name);
+	out_printf(" Serial Number	  : %s \n", fc_info_p->serial_num);
+	out_printf(" Port ID	  : %s \n", fc_info_p->port_id);
+	out_printf(" Port State	  : %s \n", fc_info_p->port_state);
+	out_printf(" Port Type 	  : %s \n", fc_info_p->port_type);
+	out_printf(" Driver Attached  : %s \n", fc_info_p->driver_name);
+	out_printf(" Driver Version	  : %s \n", fc_info_p->drv_version);
+	out_printf(" Firmware Version : %s \n", fc_info_p->fw_version);
+	out_printf(" Supported Speed  : %s \n", fc_info_p->supported_speed);
+	out_printf(" Supported Class  : %s \n", fc_info_p->supported_class);
+	out_printf(" Symbolic Name	  : %s \n", fc_info_p->symbolic_name);
+	out_printf(" Dev Loss Timeout : %d \n", fc_info_p->dev_loss_tmo);
+	out_printf(" Link State	  : %s \n", fc_info_p->link_state);
+	out_printf(" Active Mode	  : %s \n", fc_info_p->active_mode);
+	out_printf(" Max NPIV VPorts  : %d \n", fc_info_p->max_npiv_vports);
+	out_printf(" In Use NPIV Port : %d \n", fc_info_p->npiv_vports_inuse);
+	out_printf(" R-Ports Found	  : %d\n", fc_info_p->no_rports);
+	out_printf("\n");
 }
 
 void print_fc_dev_header(void)
 {
 	print_trace_enter();
-	printf("\n");
-	printf("%-8s\t%-8s\t%-8s\t%-16s\t%-16s\t%-8s\t%-24s\t%-8s\t%-s \n",
-	    "Host", "Model", "Speed", "SerialNum", "DriverVer", "DriverName",
-	    "FW_Ver", "Role", "State");
-	printf("%-.8s\t%-.8s\t%-.8s\t%-.16s\t%-.16s\t%-.8s\t%-.24s\t%-.8s\t%-.24s \n",
-		dash, dash, dash, dash, dash, dash, dash, dash, dash);
+
+	out_table_header(&fc_dev_table);
 }
 
 void print_list_fc_dev(struct fc_device_info *fc_info_p)
 {
 	print_trace_enter();
-	printf("%-8s\t%-8s\t%-4sGBit\t%-16s\t%-16s\t%-8s\t%-24s\t%-8s\t%-s \n",
-	    fc_info_p->host_name, fc_info_p->product_name, fc_info_p->port_speed,
-	    fc_info_p->serial_num, fc_info_p->drv_version, fc_info_p->driver_name,
-	    fc_info_p->fw_version, fc_info_p->active_mode, fc_info_p->link_state);
+	out_table_row(&fc_dev_table, fc_info_p);
 }
 
 void print_disk_stats(struct disk_stats *d_stats_p, char *disk_name)
 {
 	print_trace_enter();
-	printf("\n %-.48s\n", dash);
-	printf("	IO Statistics for %s", disk_name);
-	printf("\n %-.48s\n", dash);
-	printf("\n");
-	printf(" Read IO	: %llu \n",
+
+	if (!out_is_text()) {
+		out_section("disk_stats");
+		out_record_begin();
+		out_record_str("disk_name", disk_name);
+		out_record_fields(&disk_stats_table, d_stats_p);
+		out_record_u64("msec", d_stats_p->msec);
+		out_record_end();
+		return;
+	}
+
+	out_printf("\n %-.48s\n", dash);
+	out_printf("	IO Statistics for %s", disk_name);
+	out_printf("\n %-.48s\n", dash);
+	out_printf("\n");
+	out_printf(" Read IO	: %llu \n",
 	    (unsigned long long) (d_stats_p->ios[0]));
-	printf(" Write IO	: %llu \n",
+	out_printf(" Write IO	: %llu \n",
 	    (unsigned long long) d_stats_p->ios[1]);
-	printf(" Merged Read 	: %llu \n",
+	out_printf(" Merged Read 	: %llu \n",
 	    (unsigned long long) d_stats_p->merges[0]);
-	printf(" Merged Write	: %llu \n",
+	out_printf(" Merged Write	: %llu \n",
 	    (unsigned long long) d_stats_p->merges[1]);
-	printf(" Read Sectors	: %llu \n",
+	out_printf(" Read Sectors	: %llu \n",
 	    (unsigned long long) d_stats_p->sectors[0]);
-	printf(" Write Sectors	: %llu \n",
+	out_printf(" Write Sectors	: %llu \n",
 	    (unsigned long long) d_stats_p->sectors[1]);
-	printf(" Read IO ticks	: %llu \n",
+	out_printf(" Read IO ticks	: %llu \n",
 	    (unsigned long long) d_stats_p->ticks[0]);
-	printf(" Write IO ticks	: %llu \n",
+	out_printf(" Write IO ticks	: %llu \n",
 	    (unsigned long long) d_stats_p->ticks[1]);
-	printf(" Total IO tikcs	: %llu \n",
+	out_printf(" Total IO tikcs	: %llu \n",
 	    (unsigned long long) d_stats_p->io_ticks);
-	printf(" Time spent in IO queue  : %llu \n",
+	out_printf(" Time spent in IO queue  : %llu \n",
 	    (unsigned long long) d_stats_p->time_in_queue);
-	printf(" Time spent/IO		 : %llu \n",
+	out_printf(" Time spent/IO		 : %llu \n",
 	    (unsigned long long) d_stats_p->msec);
-	printf("\n");
+	out_printf("\n");
+}
+
+int format_disk_rates_header(char *buf, size_t len)
+{
+	return snprintf(buf, len,
+	    "%-12s %9s %9s %9s %9s %8s %8s %8s %8s %9s %9s %7s %6s",
+	    "Device", "r/s", "w/s", "rMB/s", "wMB/s", "rrqm/s", "wrqm/s",
+	    "r_await", "w_await", "rareq-sz", "wareq-sz", "aqu-sz", "%util");
+}
+
+int format_disk_rates(char *buf, size_t len, char *disk_name,
+    struct disk_rates *r)
+{
+	return snprintf(buf, len,
+	    "%-12s %9.2f %9.2f %9.2f %9.2f %8.2f %8.2f %8.2f %8.2f %9.2f %9.2f %7.2f %6.2f",
+	    disk_name, r->ios[0], r->ios[1], r->mb[0], r->mb[1],
+	    r->merges[0], r->merges[1], r->await[0], r->await[1],
+	    r->req_kb[0], r->req_kb[1], r->queue_size, r->util);
+}
+
+void print_disk_rates_header(void)
+{
+	char line[256];
+
+	print_trace_enter();
+
+	if (!out_is_text()) {
+		out_section("disk_rates");
+		return;
+	}
+
+	format_disk_rates_header(line, sizeof(line));
+	out_printf("\n%s\n", line);
+}
+
+/* Rates of 'disk_name', "-" when 'r' is NULL: no earlier sample */
+void print_disk_rates(char *disk_name, struct disk_rates *r)
+{
+	static const char * const keys[] = {
+		"r_s", "w_s", "rmb_s", "wmb_s", "rrqm_s", "wrqm_s", "r_await",
+		"w_await", "rareq_sz", "wareq_sz", "aqu_sz", "util"
+	};
+	char	line[256];
+	size_t	i;
+
+	print_trace_enter();
+
+	if (!r) {
+		if (out_is_text()) {
+			out_printf("%-12s %9s %9s %9s %9s %8s %8s %8s %8s %9s "
+			    "%9s %7s %6s\n", disk_name, "-", "-", "-", "-",
+			    "-", "-", "-", "-", "-", "-", "-", "-");
+			return;
+		}
+		out_record_begin();
+		out_record_str("disk_name", disk_name);
+		for (i = 0; i < ARRAY_SIZE(keys); i++)
+			out_record_str(keys[i], NULL);
+		out_record_end();
+		return;
+	}
+
+	if (!out_is_text()) {
+		out_record_begin();
+		out_record_str("disk_name", disk_name);
+		out_record_f64("r_s", r->ios[0]);
+		out_record_f64("w_s", r->ios[1]);
+		out_record_f64("rmb_s", r->mb[0]);
+		out_record_f64("wmb_s", r->mb[1]);
+		out_record_f64("rrqm_s", r->merges[0]);
+		out_record_f64("wrqm_s", r->merges[1]);
+		out_record_f64("r_await", r->await[0]);
+		out_record_f64("w_await", r->await[1]);
+		out_record_f64("rareq_sz", r->req_kb[0]);
+		out_record_f64("wareq_sz", r->req_kb[1]);
+		out_record_f64("aqu_sz", r->queue_size);
+		out_record_f64("util", r->util);
+		out_record_end();
+		return;
+	}
+
+	format_disk_rates(line, sizeof(line), disk_name, r);
+	out_printf("%s\n", line);
 }
 
 void print_fc_port_stats(struct fc_device_info *fc_dev)
 {
 	print_trace_enter();
 
-	printf("\n%-.48s\n", dash);
-	printf("	FCP Statistics: %s", fc_dev->host_name);
-	printf("\n%-.48s\n", dash);
-	printf("\n");
-	printf(" TX Frames	: %#llx \n", fc_dev->stats.tx_frames);
-	printf(" TX Words	: %#llx \n", fc_dev->stats.tx_words);
-	printf(" RX Frames	: %#llx \n", fc_dev->stats.rx_frames);
-	printf(" RX Words	: %#llx \n", fc_dev->stats.rx_words);
-	printf(" LIP Count	: %#llx \n", fc_dev->stats.lip_count);
-	printf(" NOS Count	: %#llx \n", fc_dev->stats.nos_count);
-	printf(" Error Frames	: %#llx \n", fc_dev->stats.error_frames);
-	printf(" Dumped Frames	: %#llx \n", fc_dev->stats.dumped_frames);
-	printf(" Invald TX Word	: %#llx \n",
+	if (!out_is_text()) {
+		out_section("fc_port_stats");
+		out_record_begin();
+		out_record_str("host", fc_dev->host_name);
+		out_record_fields(&fc_stats_table, &fc_dev->stats);
+		out_record_end();
+		return;
+	}
+
+	out_printf("\n%-.48s\n", dash);
+	out_printf("	FCP Statistics: %s", fc_dev->host_name);
+	out_printf("\n%-.48s\n", dash);
+	out_printf("\n");
+	out_printf(" TX Frames	: %#llx \n", fc_dev->stats.tx_frames);
+	out_printf(" TX Words	: %#llx \n", fc_dev->stats.tx_words);
+	out_printf(" RX Frames	: %#llx \n", fc_dev->stats.rx_frames);
+	out_printf(" RX Words	: %#llx \n", fc_dev->stats.rx_words);
+	out_printf(" LIP Count	: %#llx \n", fc_dev->stats.lip_count);
+	out_printf(" NOS Count	: %#llx \n", fc_dev->stats.nos_count);
+	out_printf(" Error Frames	: %#llx \n", fc_dev->stats.error_frames);
+	out_printf(" Dumped Frames	: %#llx \n", fc_dev->stats.dumped_frames);
+	out_printf(" Invald TX Word	: %#llx \n",
 		fc_dev->stats.invalid_tx_word_count);
-	printf(" Loss of Sync	: %#llx \n",
+	out_printf(" Loss of Sync	: %#llx \n",
 		fc_dev->stats.loss_of_sync_count);
-	printf(" Loss of Signal	: %#llx \n",
+	out_printf(" Loss of Signal	: %#llx \n",
 		fc_dev->stats.loss_of_signal_count);
-	printf(" Link Failure	: %#llx \n",
+	out_printf(" Link Failure	: %#llx \n",
 		fc_dev->stats.link_failure_count);
-	printf(" Invalid CRC	: %#llx \n", fc_dev->stats.invalid_crc_count);
+	out_printf(" Invalid CRC	: %#llx \n", fc_dev->stats.invalid_crc_count);
 
-	printf("\n ----- FPIN Diagnostic Statistics ----- \n");
-	printf("\n");
-	printf(" fpin_dn			: %#llx \n",
+	out_printf("\n ----- FPIN Diagnostic Statistics ----- \n");
+	out_printf("\n");
+	out_printf(" fpin_dn			: %#llx \n",
 		fc_dev->stats.fpin_dn);
-	printf(" fpin_dn_device_specific	: %#llx \n",
+	out_printf(" fpin_dn_device_specific	: %#llx \n",
 		fc_dev->stats.fpin_dn_device_specific);
-	printf(" fpin_dn_timeout		: %#llx \n",
+	out_printf(" fpin_dn_timeout		: %#llx \n",
 		fc_dev->stats.fpin_dn_timeout);
-	printf(" fpin_dn_unable_to_route	: %#llx \n",
+	out_printf(" fpin_dn_unable_to_route	: %#llx \n",
 		fc_dev->stats.fpin_dn_unable_to_route);
-	printf(" fpin_dn_unknown		: %#llx \n",
+	out_printf(" fpin_dn_unknown		: %#llx \n",
 		fc_dev->stats.fpin_dn_unknown);
 
-	printf("\n ----- FPIN Link Integrity Statistics ----- \n");
-	printf("\n");
-	printf(" fpin_li			: %#llx\n",
+	out_printf("\n ----- FPIN Link Integrity Statistics ----- \n");
+	out_printf("\n");
+	out_printf(" fpin_li			: %#llx\n",
 		fc_dev->stats.fpin_li);
-	printf(" fpin_li_device_specific	: %#llx \n",
+	out_printf(" fpin_li_device_specific	: %#llx \n",
 		fc_dev->stats.fpin_li_device_specific);
-	printf(" fpin_li_failure_unknown	: %#llx \n",
+	out_printf(" fpin_li_failure_unknown	: %#llx \n",
 		fc_dev->stats.fpin_li_failure_unknown);
-	printf(" fpin_li_invalid_crc_count	: %#llx \n",
+	out_printf(" fpin_li_invalid_crc_count	: %#llx \n",
 		fc_dev->stats.fpin_li_invalid_crc_count);
-	printf(" fpin_li_invalid_tx_word_count	: %#llx \n",
+	out_printf(" fpin_li_invalid_tx_word_count	: %#llx \n",
 		fc_dev->stats.fpin_li_invalid_tx_word_count);
-	printf(" fpin_li_link_failure_count	: %#llx \n",
+	out_printf(" fpin_li_link_failure_count	: %#llx \n",
 		fc_dev->stats.fpin_li_link_failure_count);
-	printf(" fpin_li_loss_of_signals_count	: %#llx \n",
+	out_printf(" fpin_li_loss_of_signals_count	: %#llx \n",
 		fc_dev->stats.fpin_li_loss_of_signals_count);
-	printf(" fpin_li_loss_of_sync_count	: %#llx \n",
+	out_printf(" fpin_li_loss_of_sync_count	: %#llx \n",
 		fc_dev->stats.fpin_li_loss_of_sync_count);
-	printf(" fpin_li_prim_seq_err_count	: %#llx \n",
+	out_printf(" fpin_li_prim_seq_err_count	: %#llx \n",
 		fc_dev->stats.fpin_li_prim_seq_err_count);
 
-	printf("\n ----- FPIN Congestion Statistics ----- \n");
-	printf("\n");
-	printf(" cn_sig_alarm			: %#llx\n",
+	out_printf("\n ----- FPIN Congestion Statistics ----- \n");
+	out_printf("\n");
+	out_printf(" cn_sig_alarm			: %#llx\n",
 		fc_dev->stats.cn_sig_alarm);
-	printf(" cn_sig_warn			: %#llx\n",
+	out_printf(" cn_sig_warn			: %#llx\n",
 		fc_dev->stats.cn_sig_warn);
-	printf(" fpin_cn			: %#llx\n",
+	out_printf(" fpin_cn			: %#llx\n",
 		fc_dev->stats.fpin_cn);
-	printf(" fpin_cn_device_specific	: %#llx \n",
+	out_printf(" fpin_cn_device_specific	: %#llx \n",
 		fc_dev->stats.fpin_cn_device_specific);
-	printf(" fpin_cn_credit_stall		: %#llx \n",
+	out_printf(" fpin_cn_credit_stall		: %#llx \n",
 		fc_dev->stats.fpin_cn_credit_stall);
-	printf(" fpin_cn_lost_credits		: %#llx \n",
+	out_printf(" fpin_cn_lost_credits		: %#llx \n",
 		fc_dev->stats.fpin_cn_lost_credit);
-	printf(" fpin_cn_oversubscription	: %#llx \n",
+	out_printf(" fpin_cn_oversubscription	: %#llx \n",
 		fc_dev->stats.fpin_cn_oversubscription);
 
-	printf("\n");
+	out_printf("\n");
+}
+
+/*
+ * Rates tables start with one or more name columns, 'totals' prints the
+ * raw counters instead of per second rates.
+ */
+void print_fc_rates_header(const struct fc_rate_table *t, const char *section,
+    const struct fc_rate_col *cols, int nr_cols, int totals)
+{
+	char	title[16];
+	int	i;
+
+	print_trace_enter();
+
+	if (!out_is_text()) {
+		out_section(section);
+		return;
+	}
+
+	out_printf("\n");
+	for (i = 0; i < nr_cols; i++)
+		out_printf("%s%-*s", i ? " " : "", cols[i].width, cols[i].title);
+	for (i = 0; i < t->nr_rates; i++) {
+		snprintf(title, sizeof(title), "%s%s", t->rates[i].title,
+		    totals ? "" : "/s");
+		out_printf(" %9s", title);
+	}
+	out_printf("\n");
+}
+
+void print_fc_rates(const struct fc_rate_table *t,
+    const struct fc_rate_col *cols, int nr_cols, const char **names,
+    double *rates, int totals)
+{
+	int i;
+
+	print_trace_enter();
+
+	if (!out_is_text()) {
+		out_record_begin();
+		for (i = 0; i < nr_cols; i++)
+			out_record_str(cols[i].key, names[i]);
+		for (i = 0; i < t->nr_rates; i++) {
+			if (isnan(rates[i]))
+				out_record_str(t->rates[i].key, NULL);
+			else if (totals)
+				out_record_u64(t->rates[i].key, rates[i]);
+			else
+				out_record_f64(t->rates[i].key, rates[i]);
+		}
+		out_record_end();
+		return;
+	}
+
+	for (i = 0; i < nr_cols; i++)
+		out_printf("%s%-*s", i ? " " : "", cols[i].width, names[i]);
+	for (i = 0; i < t->nr_rates; i++) {
+		if (isnan(rates[i]))
+			out_printf(" %9s", "-");
+		else
+			out_printf(totals ? " %9.0f" : " %9.2f", rates[i]);
+	}
+	out_printf("\n");
 }
 
 void print_fc_rport_header(void)
 {
 	print_trace_enter();
-	printf("\n");
-	printf("%-16s %-16s %-32s %-32s %-32s %-16s\n",
-		"Rport", "Rport_State", "Roles", "Rport_Name", "Node_Name",
-		"Rport_ID");
-	printf("%-.16s %-.16s %-.32s %-.32s %-.32s %-.16s\n",
-		dash, dash, dash, dash, dash, dash);
+
+	if (!out_is_text())
+		out_section("fc_rports");
+	out_table_header(&fc_rport_table);
 }
 
 void print_fc_rport_info(struct fc_rport_info *rprt_p)
 {
 	print_trace_enter();
-	printf("%-16s %-16s %-32s %-32s %-32s %-16s\n",
-		rprt_p->rport_name, rprt_p->port_state, rprt_p->roles,
-		rprt_p->port_name, rprt_p->node_name, rprt_p->port_id);
+	out_table_row(&fc_rport_table, rprt_p);
+}
+
+void print_fc_lun_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("fc_luns");
+	out_table_header(&fc_lun_table);
+}
+
+void print_fc_lun_info(struct fc_lun_info *lun)
+{
+	print_trace_enter();
+	out_table_row(&fc_lun_table, lun);
+}
+
+void print_scan_job_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("scan_hosts");
+	out_table_header(&scan_job_table);
+}
+
+void print_scan_job(struct scan_job *job)
+{
+	print_trace_enter();
+	out_table_row(&scan_job_table, job);
+}
+
+void print_scan_change_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("scan_changes");
+	out_table_header(&scan_change_table);
+}
+
+void print_scan_change(struct scan_change *change)
+{
+	print_trace_enter();
+	out_table_row(&scan_change_table, change);
+}
+
+void print_tune_attr_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("tune");
+	out_table_header(&tune_attr_table);
+}
+
+void print_tune_attr(struct tune_attr *ta)
+{
+	print_trace_enter();
+	out_table_row(&tune_attr_table, ta);
+}
+
+void print_mq_map_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("mq");
+	out_table_header(&mq_map_table);
+}
+
+void print_mq_map(struct mq_map_info *m)
+{
+	print_trace_enter();
+	out_table_row(&mq_map_table, m);
+}
+
+void print_mq_queue_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("mq_queues");
+	out_table_header(&mq_queue_table);
+}
+
+void print_mq_queue(struct mq_queue_info *q)
+{
+	print_trace_enter();
+	out_table_row(&mq_queue_table, q);
+}
+
+void print_irq_audit_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("irq");
+	out_table_header(&irq_audit_table);
+}
+
+void print_irq_audit(struct irq_audit_info *info)
+{
+	print_trace_enter();
+	out_table_row(&irq_audit_table, info);
+}
+
+void print_irq_vector_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("irq_vectors");
+	out_table_header(&irq_vector_table);
+}
+
+void print_irq_vector(struct irq_vector_info *v)
+{
+	print_trace_enter();
+	out_table_row(&irq_vector_table, v);
+}
+
+void print_link_audit_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("links");
+	out_table_header(&link_audit_table);
+}
+
+void print_link_audit(struct link_audit_info *info)
+{
+	print_trace_enter();
+	out_table_row(&link_audit_table, info);
+}
+
+void print_nvme_subsys_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("nvme_subsys");
+	out_table_header(&nvme_subsys_table);
+}
+
+void print_nvme_subsys(struct nvme_subsys_info *s)
+{
+	print_trace_enter();
+	out_table_row(&nvme_subsys_table, s);
+}
+
+void print_nvme_ctrl_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("nvme_ctrls");
+	out_table_header(&nvme_ctrl_table);
+}
+
+void print_nvme_ctrl(struct nvme_ctrl_info *c)
+{
+	print_trace_enter();
+	out_table_row(&nvme_ctrl_table, c);
+}
+
+void print_nvme_ns_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("nvme_namespaces");
+	out_table_header(&nvme_ns_table);
+}
+
+void print_nvme_ns(struct nvme_ns_info *ns)
+{
+	print_trace_enter();
+	out_table_row(&nvme_ns_table, ns);
+}
+
+void print_nvme_path_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("nvme_paths");
+	out_table_header(&nvme_path_table);
+}
+
+void print_nvme_path(struct nvme_path_info *p)
+{
+	print_trace_enter();
+	out_table_row(&nvme_path_table, p);
+}
+
+void print_advice_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("advise");
+	out_table_header(&advice_table);
+}
+
+void print_advice(struct advice_info *a)
+{
+	print_trace_enter();
+	out_table_row(&advice_table, a);
+}
+
+void print_fc_vport_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("fc_vports");
+	out_table_header(&fc_vport_table);
+}
+
+void print_fc_vport_info(struct fc_vport_info *vp)
+{
+	print_trace_enter();
+	out_table_row(&fc_vport_table, vp);
+}
+
+void print_fc_vport_job_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("fc_vport_jobs");
+	out_table_header(&fc_vport_job_table);
+}
+
+void print_fc_vport_job(struct fc_vport_job *job)
+{
+	print_trace_enter();
+	out_table_row(&fc_vport_job_table, job);
 }
 
 void print_iscsi_dev_header(void)
 {
-	/*  Host_Name	Transport	IP_ADD:PORT	Connection	Session		TARGET_NAME	 */
-	/*  ----------	-----------	---------------	-----------	-----------	----------------- */
 	print_trace_enter();
-	printf("\n");
-	printf("%-12s\t%-8s\t%-16s\t%-4s\t%-16s\t%-16s\t%-64s \n",
-	    "Host Name", "Transport", "IP Address", "Port", "Connection", "Session",
-	    "Target Name");
-	printf("%-.12s\t%-.10s\t%-.16s\t%-.6s\t%-.16s\t%-.12s\t%-.64s\n",
-		dash, dash, dash, dash, dash, dash, dash);
+
+	out_table_header(&iscsi_dev_table);
+}
+
+void print_list_iscsi_dev(struct iscsi_sess_info *sess)
+{
+	print_trace_enter();
+	out_table_row(&iscsi_dev_table, sess);
+}
+
+void print_iscsi_lun_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("iscsi_luns");
+	out_table_header(&iscsi_lun_table);
+}
+
+void print_iscsi_lun(struct iscsi_lun_info *lun)
+{
+	print_trace_enter();
+	out_table_row(&iscsi_lun_table, lun);
+}
+
+void print_iscsi_numa_header(void)
+{
+	print_trace_enter();
+	out_table_header(&iscsi_numa_table);
+}
+
+void print_iscsi_numa(struct iscsi_numa_info *info)
+{
+	print_trace_enter();
+	out_table_row(&iscsi_numa_table, info);
+}
+
+void print_iscsi_event_header(void)
+{
+	print_trace_enter();
+
+	if (!out_is_text())
+		out_section("iscsi_events");
+	out_table_header(&iscsi_event_table);
+}
+
+void print_iscsi_event(struct iscsi_event *ev)
+{
+	print_trace_enter();
+	out_table_row(&iscsi_event_table, ev);
 }
 
-void print_list_iscsi_dev(struct iscsi_dev_info *iscsi_info)
+void print_iscsi_outage_header(void)
 {
 	print_trace_enter();
 
-	printf("%-12s\t%-8s\t%-16s\t%-4s\t%-16s\t%-12s\t%-64s \n",
-	    iscsi_info->host_name, iscsi_info->transport_name,
-	    iscsi_info->conn_address, iscsi_info->conn_port,
-	    iscsi_info->connection_name, iscsi_info->session_name,
-	    iscsi_info->target_name);
+	if (!out_is_text())
+		out_section("iscsi_outages");
+	out_table_header(&iscsi_outage_table);
+}
+
+void print_iscsi_outage(struct iscsi_outage *o)
+{
+	print_trace_enter();
+	out_table_row(&iscsi_outage_table, o);
 }
 
 void print_iscsi_header(char *label, char *name)
 {
-	printf("%-.64s \n", dash);
-	printf(" Displaying %s Information for: %s \n",
+	if (!out_is_text()) {
+		out_section(label);
+		return;
+	}
+
+	out_printf("%-.64s \n", dash);
+	out_printf(" Displaying %s Information for: %s \n",
 	    label, name);
-	printf("%-.64s \n", dash);
+	out_printf("%-.64s \n", dash);
 }
 
 void print_iscsi_session_info(struct iscsi_session *sess)
 {
 	print_trace_enter();
 
-	printf(" \n");
-	printf(" Target Name		:\t%-s \n", sess->targetname);
-	printf(" Target State		:\t%-s \n", sess->target_state);
-	printf(" Session State		:\t%-s \n", sess->state);
-	printf(" Abort Timeout		:\t%d \n", sess->abort_tmo);
-	printf(" Creator ID		:\t%-d \n", sess->creator);
-	printf(" Data PDU In Order	:\t%d \n", sess->data_pdu_in_order);
-	printf(" Data SEQ In Order	:\t%d \n", sess->data_seq_in_order);
-	printf(" Error Recovery Level	:\t%d \n", sess->err_level);
-	printf(" Fast Abort		:\t%d \n", sess->fast_abort);
-	printf(" First Burst Len	:\t%d \n", sess->first_burst_len);
-	printf(" ifacename		:\t%s \n", sess->ifacename);
-	printf(" immediate Data		:\t%d \n", sess->immediate_data);
-	printf(" Initial R2T		:\t%d \n", sess->initial_r2t);
-	printf(" Lun Reset Timeout	:\t%d \n", sess->lu_reset_tmo);
-	printf(" Max Burst Len		:\t%d \n", sess->max_burst_len);
-	printf(" Max Outstanding R2T	:\t%d \n", sess->max_outstanding_r2t);
-	printf(" Recovery Timeout	:\t%d \n", sess->recovery_tmo);
-	printf("\n");
+	if (!out_is_text()) {
+		out_record(&iscsi_session_table, sess);
+		return;
+	}
+
+	out_printf(" \n");
+	out_printf(" Target Name		:\t%-s \n", sess->targetname);
+	out_printf(" Target State		:\t%-s \n", sess->target_state);
+	out_printf(" Session State		:\t%-s \n", sess->state);
+	out_printf(" Abort Timeout		:\t%d \n", sess->abort_tmo);
+	out_printf(" Creator ID		:\t%-d \n", sess->creator);
+	out_printf(" Data PDU In Order	:\t%d \n", sess->data_pdu_in_order);
+	out_printf(" Data SEQ In Order	:\t%d \n", sess->data_seq_in_order);
+	out_printf(" Error Recovery Level	:\t%d \n", sess->err_level);
+	out_printf(" Fast Abort		:\t%d \n", sess->fast_abort);
+	out_printf(" First Burst Len	:\t%d \n", sess->first_burst_len);
+	out_printf(" ifacename		:\t%s \n", sess->ifacename);
+	out_printf(" immediate Data		:\t%d \n", sess->immediate_data);
+	out_printf(" Initial R2T		:\t%d \n", sess->initial_r2t);
+	out_printf(" Lun Reset Timeout	:\t%d \n", sess->lu_reset_tmo);
+	out_printf(" Max Burst Len		:\t%d \n", sess->max_burst_len);
+	out_printf(" Max Outstanding R2T	:\t%d \n", sess->max_outstanding_r2t);
+	out_printf(" Recovery Timeout	:\t%d \n", sess->recovery_tmo);
+	out_printf("\n");
 }
 
 void print_iscsi_connection_info(struct iscsi_connection *conn)
 {
 	print_trace_enter();
 
-	printf(" \n");
-	printf(" State			:\t%s \n", conn->state);
-	printf(" Port			:\t%d \n", conn->port);
-	printf(" Ping Timeout		:\t%-d \n", conn->ping_tmo);
-	printf(" Recv Timeout		:\t%d \n", conn->recv_tmo);
-	printf(" Persistent Addr	:\t%si \n", conn->persistent_address);
-	printf(" Persistent Port	:\t%d \n", conn->persistent_port);
-	printf(" Header Digest		:\t%d \n", conn->header_digest);
-	printf(" Data Digest		:\t%d \n", conn->data_digest);
-	printf(" Expected StatSN	:\t%d \n", conn->exp_statsn);
-	printf(" Max Recv datalen	:\t%d \n", conn->max_recv_dlength);
-	printf(" Max Xmit datalen	:\t%d \n", conn->max_xmit_dlength);
-	printf(" Address		:\t%s \n", conn->address);
-	printf(" \n\n");
+	if (!out_is_text()) {
+		out_record(&iscsi_connection_table, conn);
+		return;
+	}
+
+	out_printf(" \n");
+	out_printf(" State			:\t%s \n", conn->state);
+	out_printf(" Port			:\t%d \n", conn->port);
+	out_printf(" Ping Timeout		:\t%-d \n", conn->ping_tmo);
+	out_printf(" Recv Timeout		:\t%d \n", conn->recv_tmo);
+	out_printf(" Persistent Addr	:\t%si \n", conn->persistent_address);
+	out_printf(" Persistent Port	:\t%d \n", conn->persistent_port);
+	out_printf(" Header Digest		:\t%d \n", conn->header_digest);
+	out_printf(" Data Digest		:\t%d \n", conn->data_digest);
+	out_printf(" Expected StatSN	:\t%d \n", conn->exp_statsn);
+	out_printf(" Max Recv datalen	:\t%d \n", conn->max_recv_dlength);
+	out_printf(" Max Xmit datalen	:\t%d \n", conn->max_xmit_dlength);
+	out_printf(" Address		:\t%s \n", conn->address);
+	out_printf(" \n\n");
 }
 
-void print_iscsi_scsi_disk(struct iscsi_dev_info *iscsi_dev)
+void print_iscsi_scsi_disk(struct iscsi_dev_info *iscsi_dev, char *disk_name,
+    char *disk_state)
 {
+	struct iscsi_session *sess = iscsi_dev->session;
+
 	print_trace_enter();
-	printf(" Scsi%02d channel: %02d  Id: %02d Lun: %02d \n",
-		iscsi_dev->session->scsi_channel, iscsi_dev->session->scsi_bus,
-		iscsi_dev->session->scsi_id, iscsi_dev->session->scsi_lun);
+
+	if (!out_is_text()) {
+		out_record_begin();
+		out_record_str("host", iscsi_dev->host_name);
+		out_record_s64("channel", sess->scsi_channel);
+		out_record_s64("bus", sess->scsi_bus);
+		out_record_s64("id", sess->scsi_id);
+		out_record_s64("lun", sess->scsi_lun);
+		out_record_str("disk_name", disk_name);
+		out_record_str("state", disk_state);
+		out_record_end();
+		return;
+	}
+
+	out_printf(" Scsi%02d channel: %02d  Id: %02d Lun: %02d \n",
+		sess->scsi_channel, sess->scsi_bus, sess->scsi_id,
+		sess->scsi_lun);
+	out_printf(" \tAttached Scsi Disk: %s\tState: %s \n",
+	    disk_name, disk_state);
+	out_printf("\n");
 }
 
 void print_enclosure_header(void)
 {
 	print_trace_enter();
 
-	printf("\n");
-	printf("%-12s\t%-16s\t%-16s\t%-16s\t%-16s\n",
+	if (!out_is_text())
+		return;
+
+	out_printf("\n");
+	out_printf("%-12s\t%-16s\t%-16s\t%-16s\t%-16s\n",
 	    " BUS ID", "Vendor", "Model", "Device Type", "Device Path");
-	printf("%-.12s\t%-.16s\t%-.16s\t%-.16s\t%-.16s\n",
+	out_printf("%-.12s\t%-.16s\t%-.16s\t%-.16s\t%-.16s\n",
 		dash, dash, dash, dash, dash);
 }
 
 void print_enclosure_info(struct scsi_device_info *d_info_p)
 {
 	print_trace_enter();
-	printf("[%-s]\t%-16s\t%-16s\t%-16s\t%-16s \n",
+
+	if (!out_is_text()) {
+		out_record(&enclosure_table, d_info_p);
+		return;
+	}
+
+	out_printf("[%-s]\t%-16s\t%-16s\t%-16s\t%-16s \n",
 		d_info_p->disk_name, d_info_p->vendor, d_info_p->model,
 		d_info_p->disk_type, d_info_p->disk_path);
 }
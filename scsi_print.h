@@ -52,6 +52,14 @@ void print_command_label(char *);
 void print_disk_header(void);
 void print_disk_info(struct scsi_device_info *);
 void print_disk_stats(struct disk_stats *, char *);
+int format_disk_rates_header(char *, size_t);
+int format_disk_rates(char *, size_t, char *, struct disk_rates *);
+void print_disk_rates_header(void);
+void print_fc_rates_header(const struct fc_rate_table *, const char *,
+    const struct fc_rate_col *, int, int);
+void print_fc_rates(const struct fc_rate_table *, const struct fc_rate_col *,
+    int, const char **, double *, int);
+void print_disk_rates(char *, struct disk_rates *);
 void print_mpath_disk_header(void);
 void print_mpath_disk_info(struct scsi_device_info *);
 void print_nvme_disk_header(void);
@@ -69,14 +77,57 @@ void print_enclosure_info(struct scsi_device_info *);
 void print_fc_info(struct fc_device_info *);
 void print_fc_rport_header(void);
 void print_fc_rport_info(struct fc_rport_info *);
+void print_fc_lun_header(void);
+void print_fc_lun_info(struct fc_lun_info *);
+void print_scan_job_header(void);
+void print_scan_job(struct scan_job *);
+void print_scan_change_header(void);
+void print_scan_change(struct scan_change *);
+void print_tune_attr_header(void);
+void print_tune_attr(struct tune_attr *);
+void print_mq_map_header(void);
+void print_mq_map(struct mq_map_info *);
+void print_mq_queue_header(void);
+void print_mq_queue(struct mq_queue_info *);
+void print_irq_audit_header(void);
+void print_irq_audit(struct irq_audit_info *);
+void print_irq_vector_header(void);
+void print_irq_vector(struct irq_vector_info *);
+void print_link_audit_header(void);
+void print_link_audit(struct link_audit_info *);
+void print_nvme_subsys_header(void);
+void print_nvme_subsys(struct nvme_subsys_info *);
+void print_nvme_ctrl_header(void);
+void print_nvme_ctrl(struct nvme_ctrl_info *);
+void print_nvme_ns_header(void);
+void print_nvme_ns(struct nvme_ns_info *);
+void print_nvme_path_header(void);
+void print_nvme_path(struct nvme_path_info *);
+void print_advice_header(void);
+void print_advice(struct advice_info *);
+void print_fc_vport_header(void);
+void print_fc_vport_info(struct fc_vport_info *);
+void print_fc_vport_job_header(void);
+void print_fc_vport_job(struct fc_vport_job *);
 void print_fc_dev_header(void);
 void print_list_fc_dev(struct fc_device_info *);
 void print_fc_port_stats(struct fc_device_info *);
 
 void print_iscsi_dev_header();
 void print_iscsi_header(char *, char *);
-void print_list_iscsi_dev(struct iscsi_dev_info *);
+void print_list_iscsi_dev(struct iscsi_sess_info *);
+void print_iscsi_lun_header(void);
+void print_iscsi_lun(struct iscsi_lun_info *);
+void print_iscsi_numa_header(void);
+void print_iscsi_numa(struct iscsi_numa_info *);
+void print_iscsi_event_header(void);
+void print_iscsi_event(struct iscsi_event *);
+void print_iscsi_outage_header(void);
+void print_iscsi_outage(struct iscsi_outage *);
 void print_iscsi_session_info(struct iscsi_session *);
 void print_iscsi_connection_info(struct iscsi_connection *);
-void print_iscsi_scsi_disk(struct iscsi_dev_info *);
+void print_iscsi_scsi_disk(struct iscsi_dev_info *, char *, char *);
+
+/* One entry per attribute under /sys/class/fc_host/hostX/statistics/ */
+extern const struct out_table fc_stats_table;
 #endif
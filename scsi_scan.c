@@ -0,0 +1,531 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "scsi.h"
+#include "scsi_print.h"
+
+/*
+ * Host rescans
+ *
+ * A write to scsi_host/hostN/scan only returns once the host has been
+ * probed, so rescanning many hosts one after the other adds up all their
+ * probe times. The hosts are scanned on a pool of threads instead. Devices
+ * may keep coming and going for a while after the writes returned (a LIP
+ * makes the remote ports log in again), so /sys/class/scsi_device is then
+ * polled with a growing delay until it stops changing.
+ */
+#define SCAN_MAX_JOBS		16
+#define SCAN_DEF_JOBS		8
+#define SCAN_POLL_MIN_MS	20
+#define SCAN_POLL_MAX_MS	1000
+#define SCAN_QUIET_MS		250	/* no change for this long */
+#define SCAN_LIP_QUIET_MS	2000
+#define SCAN_SETTLE_MAX_MS	60000
+#define SCAN_LIP_ONLINE_MS	30000
+#define SCAN_LIP_DOWN_MS	5000	/* for the LIP to show */
+
+struct scan_hctl {
+	int	host, channel, target, lun;
+};
+
+struct scan_inventory {
+	struct scan_hctl	*devs;
+	int			nr;
+	int			alloc;
+};
+
+/* LIPs and link failures the FC port of a host has counted */
+static u64 scan_lip_events(const char *host_name)
+{
+	static const char * const counters[] = {
+		"lip_count", "link_failure_count"
+	};
+	char	attr[96], val[32];
+	u64	sum = 0;
+	size_t	i;
+
+	for (i = 0; i < ARRAY_SIZE(counters); i++) {
+		snprintf(attr, sizeof(attr), "%s/%s/statistics/%s",
+		    SYSFS_FC_HOST_PATH, host_name, counters[i]);
+		if (sysfs_read_at(AT_FDCWD, attr, val, sizeof(val)) > 0)
+			sum += strtoull(val, NULL, 0);
+	}
+
+	return sum;
+}
+
+/*
+ * scan_wait_online() will wait for the FC port of a host to go through
+ * the LIP issued after 'events' were counted and come back online. The
+ * port is still Online right after the write, so the LIP has to show
+ * first: the port leaving Online, or its LIP or link failure count
+ * moving. Drivers which finish a LIP quicker than the first poll and
+ * keep no counters never show it, they are trusted after
+ * SCAN_LIP_DOWN_MS.
+ */
+static int scan_wait_online(const char *host_name, u64 events)
+{
+	char		attr[64], state[32];
+	unsigned int	delay = SCAN_POLL_MIN_MS;
+	u64		start = now_ms();
+	int		online, down = 0;
+
+	snprintf(attr, sizeof(attr), "%s/%s/port_state", SYSFS_FC_HOST_PATH,
+	    host_name);
+
+	while (now_ms() - start < SCAN_LIP_ONLINE_MS) {
+		online = sysfs_read_at(AT_FDCWD, attr, state,
+		    sizeof(state)) > 0 && !strcmp(state, "Online");
+		if (!down)
+			down = !online || scan_lip_events(host_name) != events ||
+			    now_ms() - start >= SCAN_LIP_DOWN_MS;
+		if (down && online)
+			return 0;
+		sleep_ms(delay);
+		delay = min(delay * 2, SCAN_POLL_MAX_MS);
+	}
+
+	return -ETIMEDOUT;
+}
+
+static void scan_one(void *arg)
+{
+	struct scan_job	*job = arg;
+	char		attr[64];
+	u64		start = now_ms(), events;
+
+	if (job->lip) {
+		snprintf(attr, sizeof(attr), "%s/%s/issue_lip",
+		    SYSFS_FC_HOST_PATH, job->host_name);
+		events = scan_lip_events(job->host_name);
+		job->err = sysfs_write_at(AT_FDCWD, attr, "1");
+		if (!job->err)
+			job->err = scan_wait_online(job->host_name, events);
+	}
+
+	if (!job->err) {
+		snprintf(attr, sizeof(attr), "%s/%s/scan",
+		    SYSFS_SCSI_HOST_PATH, job->host_name);
+		job->err = sysfs_write_at(AT_FDCWD, attr, job->chtl);
+	}
+
+	job->ms = now_ms() - start;
+	job->result = job->err ? strerror(-job->err) : "done";
+}
+
+static int scan_hctl_cmp(const void *a, const void *b)
+{
+	const struct scan_hctl *x = a, *y = b;
+
+	if (x->host != y->host)
+		return x->host < y->host ? -1 : 1;
+	if (x->channel != y->channel)
+		return x->channel < y->channel ? -1 : 1;
+	if (x->target != y->target)
+		return x->target < y->target ? -1 : 1;
+	if (x->lun != y->lun)
+		return x->lun < y->lun ? -1 : 1;
+
+	return 0;
+}
+
+static int scan_job_cmp(const void *a, const void *b)
+{
+	const struct scan_job *x = a, *y = b;
+
+	return x->host_no - y->host_no;
+}
+
+/* The SCSI devices of the hosts set in 'hosts', sorted by HCTL */
+static int scan_inventory_read(struct scan_inventory *inv, const char *hosts,
+    int nr_hosts)
+{
+	struct scan_hctl	d, *tmp;
+	struct dirent		*entry;
+	DIR			*dir;
+
+	inv->nr = 0;
+
+	dir = opendir(SYSFS_SCSI_DEV_PATH);
+	if (!dir)
+		return -errno;
+
+	for_each_dir(entry, dir) {
+		if (sscanf(entry->d_name, "%d:%d:%d:%d", &d.host, &d.channel,
+		    &d.target, &d.lun) != 4)
+			continue;
+		if (d.host < 0 || d.host >= nr_hosts || !hosts[d.host])
+			continue;
+
+		if (inv->nr == inv->alloc) {
+			inv->alloc = inv->alloc ? inv->alloc * 2 : 256;
+			tmp = realloc(inv->devs, inv->alloc * sizeof(*tmp));
+			if (!tmp) {
+				closedir(dir);
+				return -ENOMEM;
+			}
+			inv->devs = tmp;
+		}
+		inv->devs[inv->nr++] = d;
+	}
+	closedir(dir);
+
+	qsort(inv->devs, inv->nr, sizeof(*inv->devs), scan_hctl_cmp);
+
+	return 0;
+}
+
+static int scan_inventory_same(struct scan_inventory *a,
+    struct scan_inventory *b)
+{
+	return a->nr == b->nr &&
+	    !memcmp(a->devs, b->devs, a->nr * sizeof(*a->devs));
+}
+
+/*
+ * Poll until the device list has not changed for 'quiet_ms', polling
+ * faster again whenever it changes. Returns the settle time in ms.
+ */
+static u64 scan_settle(struct scan_inventory *cur, struct scan_inventory *tmp,
+    const char *hosts, int nr_hosts, unsigned int quiet_ms)
+{
+	struct scan_inventory	swap;
+	unsigned int		delay = SCAN_POLL_MIN_MS;
+	u64			start = now_ms(), changed = start;
+
+	scan_inventory_read(cur, hosts, nr_hosts);
+
+	while (now_ms() - changed < quiet_ms &&
+	    now_ms() - start < SCAN_SETTLE_MAX_MS) {
+		sleep_ms(delay);
+		if (scan_inventory_read(tmp, hosts, nr_hosts))
+			break;
+
+		if (scan_inventory_same(cur, tmp)) {
+			delay = min(delay * 2, SCAN_POLL_MAX_MS);
+			continue;
+		}
+
+		swap = *cur;
+		*cur = *tmp;
+		*tmp = swap;
+		changed = now_ms();
+		delay = SCAN_POLL_MIN_MS;
+	}
+
+	return changed - start;
+}
+
+static void scan_print_change(const char *change, struct scan_hctl *d)
+{
+	struct scan_change	c;
+	struct dirent		*entry;
+	char			path[128], state[32];
+	DIR			*dir;
+
+	memset(&c, 0, sizeof(c));
+	snprintf(c.change, sizeof(c.change), "%s", change);
+	c.host = d->host;
+	c.channel = d->channel;
+	c.target = d->target;
+	c.lun = d->lun;
+
+	/* Only devices which are still there have a state and a disk */
+	snprintf(path, sizeof(path), "%s/%d:%d:%d:%d/device/state",
+	    SYSFS_SCSI_DEV_PATH, d->host, d->channel, d->target, d->lun);
+	if (sysfs_read_at(AT_FDCWD, path, state, sizeof(state)) > 0)
+		c.state = state;
+
+	snprintf(path, sizeof(path), "%s/%d:%d:%d:%d/device/block",
+	    SYSFS_SCSI_DEV_PATH, d->host, d->channel, d->target, d->lun);
+	dir = opendir(path);
+	if (dir) {
+		for_each_dir(entry, dir) {
+			c.disk_name = strdup(entry->d_name);
+			break;
+		}
+		closedir(dir);
+	}
+
+	print_scan_change(&c);
+	free(c.disk_name);
+}
+
+/* Both lists are sorted, one merge walk finds what changed */
+static void scan_print_diff(struct scan_inventory *old,
+    struct scan_inventory *new)
+{
+	int i = 0, j = 0, cmp;
+
+	print_scan_change_header();
+
+	while (i < old->nr || j < new->nr) {
+		if (i == old->nr)
+			cmp = 1;
+		else if (j == new->nr)
+			cmp = -1;
+		else
+			cmp = scan_hctl_cmp(old->devs + i, new->devs + j);
+
+		if (cmp < 0)
+			scan_print_change("removed", old->devs + i++);
+		else if (cmp > 0)
+			scan_print_change("added", new->devs + j++);
+		else
+			i++, j++;
+	}
+}
+
+/*
+ * Stale devices are deleted before the scan so that it can bring them
+ * back if they answer again; they show up as removed otherwise.
+ */
+static void scan_delete_offline(struct scan_inventory *inv)
+{
+	struct scan_hctl	*d;
+	char			path[96], state[32];
+	int			i, err;
+
+	for (i = 0; i < inv->nr; i++) {
+		d = inv->devs + i;
+
+		snprintf(path, sizeof(path), "%s/%d:%d:%d:%d/device/state",
+		    SYSFS_SCSI_DEV_PATH, d->host, d->channel, d->target, d->lun);
+		if (sysfs_read_at(AT_FDCWD, path, state, sizeof(state)) <= 0 ||
+		    strcmp(state, "offline"))
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%d:%d:%d:%d/device/delete",
+		    SYSFS_SCSI_DEV_PATH, d->host, d->channel, d->target, d->lun);
+		err = sysfs_write_at(AT_FDCWD, path, "1");
+		if (err)
+			print_err("Can not delete %d:%d:%d:%d (%s)", d->host,
+			    d->channel, d->target, d->lun, strerror(-err));
+	}
+}
+
+/**
+ * scan_jobs_opt() will return the --jobs limit on concurrent host scans,
+ * 'def' if it is not given, or a negative errno if it is invalid
+ */
+int scan_jobs_opt(int def)
+{
+	char	*val, *end;
+	long	v;
+
+	val = cmd_opt_value("jobs");
+	if (!val)
+		return min(def, SCAN_MAX_JOBS);
+
+	v = strtol(val, &end, 0);
+	if (*end || v <= 0 || v > SCAN_MAX_JOBS) {
+		print_err("Invalid number of jobs '%s' (1-%d)", val,
+		    SCAN_MAX_JOBS);
+		return -EINVAL;
+	}
+
+	return v;
+}
+
+/* "C T L" of a scan write: numbers or "-" wildcards */
+static int scan_chtl_valid(char **argv)
+{
+	char	*end;
+	int	i;
+
+	for (i = 0; i < 3; i++) {
+		if (!strcmp(argv[i], "-"))
+			continue;
+		if (strtoul(argv[i], &end, 10) > UINT_MAX || *end ||
+		    end == argv[i])
+			return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * scan_scsi_hosts() will rescan the SCSI hosts named in 'argv', or every
+ * SCSI host if none is named. Host names may be followed by a channel,
+ * target and LUN, each a number or "-", to probe just those addresses.
+ */
+int scan_scsi_hosts(int argc, char **argv)
+{
+	struct scan_job	*jobs, *tmp;
+	struct dirent	*entry;
+	char		chtl[48] = "- - -";
+	DIR		*dir;
+	int		i, nr = 0, nr_names, max_jobs, alloc, err;
+
+	print_trace_enter();
+
+	for (nr_names = 0; nr_names < argc; nr_names++) {
+		if (strncmp(argv[nr_names], "host", 4))
+			break;
+	}
+
+	if (argc - nr_names == 3 && scan_chtl_valid(argv + nr_names)) {
+		snprintf(chtl, sizeof(chtl), "%.15s %.15s %.15s",
+		    argv[nr_names], argv[nr_names + 1], argv[nr_names + 2]);
+	} else if (argc != nr_names) {
+		print_err("Expected [hostN ...] [<channel> <target> <lun>], "
+		    "each a number or '-'");
+		return -EINVAL;
+	}
+
+	alloc = nr_names ? nr_names : 64;
+	jobs = calloc(alloc, sizeof(*jobs));
+	if (!jobs)
+		return -ENOMEM;
+
+	if (nr_names) {
+		for (i = 0; i < nr_names; i++) {
+			snprintf(jobs[nr].host_name, sizeof(jobs[nr].host_name),
+			    "%.15s", argv[i]);
+			nr++;
+		}
+	} else {
+		dir = opendir(SYSFS_SCSI_HOST_PATH);
+		if (!dir) {
+			free(jobs);
+			print_err("No SCSI host found");
+			return -ENODEV;
+		}
+
+		for_each_dir(entry, dir) {
+			if (nr == alloc) {
+				tmp = realloc(jobs, alloc * 2 * sizeof(*jobs));
+				if (!tmp)
+					break;
+				jobs = tmp;
+				alloc *= 2;
+			}
+			memset(jobs + nr, 0, sizeof(*jobs));
+			snprintf(jobs[nr].host_name, sizeof(jobs[nr].host_name),
+			    "%.15s", entry->d_name);
+			nr++;
+		}
+		closedir(dir);
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (sscanf(jobs[i].host_name, "host%d", &jobs[i].host_no) != 1) {
+			print_err("%s is not a SCSI host", jobs[i].host_name);
+			free(jobs);
+			return -EINVAL;
+		}
+		snprintf(jobs[i].chtl, sizeof(jobs[i].chtl), "%s", chtl);
+	}
+
+	max_jobs = scan_jobs_opt(SCAN_DEF_JOBS);
+	if (max_jobs < 0)
+		err = max_jobs;
+	else
+		err = nr ? scan_run(jobs, nr, max_jobs) : -ENODEV;
+	free(jobs);
+
+	return err;
+}
+
+/**
+ * scan_run() will run the rescans of 'jobs' concurrently, at most
+ * 'max_jobs' at a time, wait for the device list of the scanned hosts to
+ * settle and report the time taken per host and the devices which were
+ * added or removed
+ */
+int scan_run(struct scan_job *jobs, int nr, int max_jobs)
+{
+	struct scan_inventory	before = { 0 }, after = { 0 }, tmp = { 0 };
+	char			*hosts;
+	unsigned int		quiet_ms = SCAN_QUIET_MS;
+	int			i, nr_hosts = 0, err;
+	u64			start, settle;
+
+	print_trace_enter();
+
+	qsort(jobs, nr, sizeof(*jobs), scan_job_cmp);
+	for (i = 0; i < nr; i++) {
+		nr_hosts = jobs[i].host_no >= nr_hosts ?
+		    jobs[i].host_no + 1 : nr_hosts;
+		if (jobs[i].lip)
+			quiet_ms = SCAN_LIP_QUIET_MS;
+	}
+
+	hosts = calloc(nr_hosts + 1, 1);
+	if (!hosts)
+		return -ENOMEM;
+	for (i = 0; i < nr; i++)
+		hosts[jobs[i].host_no] = 1;
+
+	err = scan_inventory_read(&before, hosts, nr_hosts);
+	if (err) {
+		print_err("Can not list SCSI devices (%s)", strerror(-err));
+		goto out;
+	}
+
+	if (cmd_opt_isset("delete-offline"))
+		scan_delete_offline(&before);
+
+	start = now_ms();
+	parallel_for_each(jobs, nr, sizeof(*jobs), scan_one, max_jobs);
+	settle = scan_settle(&after, &tmp, hosts, nr_hosts, quiet_ms);
+
+	print_scan_job_header();
+	for (i = 0; i < nr; i++)
+		print_scan_job(jobs + i);
+
+	scan_print_diff(&before, &after);
+
+	if (out_is_text())
+		out_printf("\n%d host(s) scanned in %llu ms, settled after "
+		    "%llu ms\n", nr, now_ms() - start, settle);
+
+	for (i = 0; i < nr; i++) {
+		if (jobs[i].err)
+			err = jobs[i].err;
+	}
+
+out:
+	free(before.devs);
+	free(after.devs);
+	free(tmp.devs);
+	free(hosts);
+
+	return err;
+}
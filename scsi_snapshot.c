@@ -0,0 +1,947 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <time.h>
+#include <sys/uio.h>
+
+#include "scsi.h"
+#include "scsi_snapshot.h"
+
+#define SNAP_VAL_LEN		512
+
+/*
+ * An attribute of a device class, 'path' is relative to the directory of
+ * the device and 'name' is what a diff reports.
+ */
+struct snap_attr {
+	const char	*name;
+	const char	*path;
+};
+
+struct snap_class {
+	int			type;
+	const char		*label;
+	const char		*dir;
+	const char		*prefix;	/* entries to pick up */
+	int			block;		/* has dev and device links */
+	int			id_attr;	/* identity, -1 for none */
+	const struct snap_attr	*attrs;
+	int			nr_attrs;
+};
+
+static const struct snap_attr disk_attrs[] = {
+	{ "wwid",		"device/wwid" },
+	{ "vendor",		"device/vendor" },
+	{ "model",		"device/model" },
+	{ "revision",		"device/rev" },
+	{ "state",		"device/state" },
+	{ "size",		"size" },
+	{ "queue_depth",	"device/queue_depth" },
+	{ "timeout",		"device/timeout" },
+	{ "eh_timeout",		"device/eh_timeout" },
+	{ "scheduler",		"queue/scheduler" },
+	{ "nr_requests",	"queue/nr_requests" },
+	{ "read_ahead_kb",	"queue/read_ahead_kb" },
+	{ "max_sectors_kb",	"queue/max_sectors_kb" },
+	{ "rotational",		"queue/rotational" },
+	{ "write_cache",	"queue/write_cache" },
+	{ "logical_block_size",	"queue/logical_block_size" },
+};
+
+static const struct snap_attr nvme_attrs[] = {
+	{ "wwid",		"wwid" },
+	{ "nsid",		"nsid" },
+	{ "model",		"device/model" },
+	{ "revision",		"device/firmware_rev" },
+	{ "serial",		"device/serial" },
+	{ "state",		"device/state" },
+	{ "transport",		"device/transport" },
+	{ "size",		"size" },
+	{ "scheduler",		"queue/scheduler" },
+	{ "nr_requests",	"queue/nr_requests" },
+	{ "read_ahead_kb",	"queue/read_ahead_kb" },
+	{ "max_sectors_kb",	"queue/max_sectors_kb" },
+	{ "write_cache",	"queue/write_cache" },
+	{ "logical_block_size",	"queue/logical_block_size" },
+};
+
+static const struct snap_attr dm_attrs[] = {
+	{ "dm_name",		"dm/name" },
+	{ "dm_uuid",		"dm/uuid" },
+	{ "suspended",		"dm/suspended" },
+	{ "size",		"size" },
+	{ "nr_requests",	"queue/nr_requests" },
+	{ "read_ahead_kb",	"queue/read_ahead_kb" },
+	{ "max_sectors_kb",	"queue/max_sectors_kb" },
+};
+
+static const struct snap_attr fc_host_attrs[] = {
+	{ "port_name",		"port_name" },
+	{ "node_name",		"node_name" },
+	{ "port_id",		"port_id" },
+	{ "port_state",		"port_state" },
+	{ "port_type",		"port_type" },
+	{ "speed",		"speed" },
+	{ "supported_speeds",	"supported_speeds" },
+	{ "fabric_name",	"fabric_name" },
+	{ "symbolic_name",	"symbolic_name" },
+	{ "dev_loss_tmo",	"dev_loss_tmo" },
+	{ "npiv_vports_inuse",	"npiv_vports_inuse" },
+	{ "tgtid_bind_type",	"tgtid_bind_type" },
+};
+
+static const struct snap_attr fc_rport_attrs[] = {
+	{ "port_name",		"port_name" },
+	{ "node_name",		"node_name" },
+	{ "port_id",		"port_id" },
+	{ "port_state",		"port_state" },
+	{ "roles",		"roles" },
+	{ "scsi_target_id",	"scsi_target_id" },
+	{ "dev_loss_tmo",	"dev_loss_tmo" },
+	{ "fast_io_fail_tmo",	"fast_io_fail_tmo" },
+	{ "supported_classes",	"supported_classes" },
+};
+
+static const struct snap_attr iscsi_session_attrs[] = {
+	{ "targetname",		"targetname" },
+	{ "tpgt",		"tpgt" },
+	{ "state",		"state" },
+	{ "target_state",	"target_state" },
+	{ "ifacename",		"ifacename" },
+	{ "initiatorname",	"initiatorname" },
+	{ "recovery_tmo",	"recovery_tmo" },
+	{ "abort_tmo",		"abort_tmo" },
+	{ "lu_reset_tmo",	"lu_reset_tmo" },
+	{ "tgt_reset_tmo",	"tgt_reset_tmo" },
+	{ "fast_abort",		"fast_abort" },
+};
+
+static const struct snap_attr iscsi_conn_attrs[] = {
+	{ "state",		"state" },
+	{ "address",		"address" },
+	{ "port",		"port" },
+	{ "persistent_address",	"persistent_address" },
+	{ "persistent_port",	"persistent_port" },
+	{ "header_digest",	"header_digest" },
+	{ "data_digest",	"data_digest" },
+	{ "max_recv_dlength",	"max_recv_dlength" },
+	{ "max_xmit_dlength",	"max_xmit_dlength" },
+	{ "ping_tmo",		"ping_tmo" },
+	{ "recv_tmo",		"recv_tmo" },
+};
+
+#define SNAP_CLASS(_type, _label, _dir, _prefix, _block, _id, _attrs)	\
+	{ _type, _label, _dir, _prefix, _block, _id, _attrs,		\
+	  NUM_ENTRIES(_attrs) }
+
+/*
+ * Kernel names of block devices are handed out again after a reboot or
+ * rescan, their WWID or dm uuid tells whether it is the same device.
+ */
+static const struct snap_class snap_classes[] = {
+	SNAP_CLASS(SNAP_DISK, "disk", SYSFS_BLOCK_PATH, "sd", 1, 0,
+	    disk_attrs),
+	SNAP_CLASS(SNAP_NVME, "nvme", SYSFS_BLOCK_PATH, "nvme", 1, 0,
+	    nvme_attrs),
+	SNAP_CLASS(SNAP_DM, "multipath", SYSFS_BLOCK_PATH, "dm-", 1, 1,
+	    dm_attrs),
+	SNAP_CLASS(SNAP_FC_HOST, "fc_host", SYSFS_FC_HOST_PATH, "host", 0, -1,
+	    fc_host_attrs),
+	SNAP_CLASS(SNAP_FC_RPORT, "fc_rport", SYSFS_FC_RPRT_PATH, "rport-", 0,
+	    -1, fc_rport_attrs),
+	SNAP_CLASS(SNAP_ISCSI_SESSION, "iscsi_session", SYSFS_ISCSI_SESS_PATH,
+	    "session", 0, -1, iscsi_session_attrs),
+	SNAP_CLASS(SNAP_ISCSI_CONN, "iscsi_conn", SYSFS_ISCSI_CONN_PATH,
+	    "connection", 0, -1, iscsi_conn_attrs),
+};
+
+static const struct snap_class *snap_class_of(int type)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(snap_classes); i++) {
+		if (snap_classes[i].type == type)
+			return snap_classes + i;
+	}
+
+	return NULL;
+}
+
+/* 64 bit FNV-1a */
+#define SNAP_HASH_INIT		0xcbf29ce484222325ULL
+
+static u64 snap_hash(u64 h, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	while (len--) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+static u64 snap_key_hash(int type, const char *name)
+{
+	u16 t = type;
+
+	return snap_hash(snap_hash(SNAP_HASH_INIT, &t, sizeof(t)),
+	    name, strlen(name));
+}
+
+/*
+ * The writer side: records are collected into a growing array and strings
+ * are interned into the string table, so that the same vendor, model or
+ * state string is only stored once no matter how many LUNs carry it.
+ */
+struct snap_builder {
+	struct snap_record	*recs;
+	u32			nr_recs;
+	u32			max_recs;
+
+	char			*str;
+	u32			str_len;
+	u32			str_size;
+
+	u32			*slots;		/* string offsets, 0 is free */
+	u32			nr_slots;
+	u32			nr_strs;
+};
+
+static int snap_str_grow_index(struct snap_builder *b)
+{
+	u32	nr = b->nr_slots ? b->nr_slots * 2 : 1024;
+	u32	*slots, i, j, off;
+
+	slots = calloc(nr, sizeof(*slots));
+	if (!slots)
+		return -ENOMEM;
+
+	for (i = 0; i < b->nr_slots; i++) {
+		off = b->slots[i];
+		if (!off)
+			continue;
+
+		j = snap_hash(SNAP_HASH_INIT, b->str + off,
+		    strlen(b->str + off)) & (nr - 1);
+		while (slots[j])
+			j = (j + 1) & (nr - 1);
+		slots[j] = off;
+	}
+
+	free(b->slots);
+	b->slots = slots;
+	b->nr_slots = nr;
+
+	return 0;
+}
+
+/**
+ * snap_str_add() will return the string table offset of 's', adding it
+ * to the table if it is not there yet.
+ */
+static int snap_str_add(struct snap_builder *b, const char *s, u32 *off)
+{
+	size_t	len = strlen(s);
+	u32	i;
+	char	*str;
+
+	if (!len) {
+		*off = 0;
+		return 0;
+	}
+
+	if ((b->nr_strs + 1) * 2 > b->nr_slots && snap_str_grow_index(b))
+		return -ENOMEM;
+
+	i = snap_hash(SNAP_HASH_INIT, s, len) & (b->nr_slots - 1);
+	for (; b->slots[i]; i = (i + 1) & (b->nr_slots - 1)) {
+		if (!strcmp(b->str + b->slots[i], s)) {
+			*off = b->slots[i];
+			return 0;
+		}
+	}
+
+	if (b->str_len + len + 1 > b->str_size) {
+		u32 size = b->str_size * 2;
+
+		while (b->str_len + len + 1 > size)
+			size *= 2;
+
+		str = realloc(b->str, size);
+		if (!str)
+			return -ENOMEM;
+		b->str = str;
+		b->str_size = size;
+	}
+
+	*off = b->str_len;
+	memcpy(b->str + b->str_len, s, len + 1);
+	b->str_len += len + 1;
+
+	b->slots[i] = *off;
+	b->nr_strs++;
+
+	return 0;
+}
+
+static struct snap_record *snap_new_record(struct snap_builder *b)
+{
+	struct snap_record *recs;
+
+	if (b->nr_recs == b->max_recs) {
+		u32 max = b->max_recs ? b->max_recs * 2 : 256;
+
+		recs = realloc(b->recs, max * sizeof(*recs));
+		if (!recs)
+			return NULL;
+		b->recs = recs;
+		b->max_recs = max;
+	}
+
+	recs = b->recs + b->nr_recs++;
+	memset(recs, 0, sizeof(*recs));
+
+	return recs;
+}
+
+static void snap_strip(char *val, int len)
+{
+	while (len > 0 && isspace((unsigned char)val[len - 1]))
+		val[--len] = '\0';
+}
+
+/**
+ * snap_collect_dev() will read one device directory into a record
+ */
+static int snap_collect_dev(struct snap_builder *b,
+    const struct snap_class *c, int dfd, const char *name)
+{
+	struct snap_record	*rec;
+	char			val[SNAP_VAL_LEN];
+	char			*p;
+	u64			h;
+	int			i, len;
+
+	rec = snap_new_record(b);
+	if (!rec)
+		return -ENOMEM;
+
+	rec->type = c->type;
+	rec->nr_attrs = c->nr_attrs;
+	for (i = 0; i < 4; i++)
+		rec->hctl[i] = -1;
+
+	if (snap_str_add(b, name, &rec->name))
+		return -ENOMEM;
+
+	if (c->block) {
+		/* dev is "major:minor", device links to H:C:T:L for SCSI */
+		if (sysfs_read_at(dfd, "dev", val, sizeof(val)) > 0)
+			sscanf(val, "%u:%u", &rec->major, &rec->minor);
+
+		len = readlinkat(dfd, "device", val, sizeof(val) - 1);
+		if (len > 0) {
+			val[len] = '\0';
+			p = strrchr(val, '/');
+			if (sscanf(p ? p + 1 : val, "%d:%d:%d:%d", &rec->hctl[0],
+			    &rec->hctl[1], &rec->hctl[2], &rec->hctl[3]) != 4) {
+				for (i = 0; i < 4; i++)
+					rec->hctl[i] = -1;
+			}
+		}
+	}
+
+	h = snap_hash(SNAP_HASH_INIT, rec->hctl, sizeof(rec->hctl));
+	h = snap_hash(h, &rec->major, sizeof(rec->major));
+	h = snap_hash(h, &rec->minor, sizeof(rec->minor));
+
+	for (i = 0; i < c->nr_attrs; i++) {
+		len = sysfs_read_at(dfd, c->attrs[i].path, val, sizeof(val));
+		if (len < 0)
+			len = 0;
+		val[len] = '\0';
+		snap_strip(val, len);
+
+		if (snap_str_add(b, val, &rec->attrs[i]))
+			return -ENOMEM;
+
+		/* include the terminator so that "ab","c" != "a","bc" */
+		h = snap_hash(h, val, strlen(val) + 1);
+	}
+	rec->hash = h;
+
+	return 0;
+}
+
+static int snap_collect_class(struct snap_builder *b,
+    const struct snap_class *c)
+{
+	struct dirent	*entry;
+	DIR		*dir;
+	int		dfd, err = 0;
+	size_t		plen = strlen(c->prefix);
+
+	print_trace_enter();
+
+	dir = opendir(c->dir);
+	if (!dir)
+		return 0;	/* transport not loaded, nothing to record */
+
+	for_each_dir(entry, dir) {
+		if (strncmp(entry->d_name, c->prefix, plen))
+			continue;
+
+		dfd = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY);
+		if (dfd < 0)
+			continue;
+
+		err = snap_collect_dev(b, c, dfd, entry->d_name);
+		close(dfd);
+		if (err)
+			break;
+	}
+	closedir(dir);
+
+	return err;
+}
+
+static int snap_write_all(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t	ret;
+	int	i = 0;
+
+	while (i < cnt) {
+		ret = writev(fd, iov + i, cnt - i);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+
+		while (i < cnt && (size_t)ret >= iov[i].iov_len)
+			ret -= iov[i++].iov_len;
+
+		if (i < cnt) {
+			iov[i].iov_base = (char *)iov[i].iov_base + ret;
+			iov[i].iov_len -= ret;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * snapshot_save() will collect the inventory of the host and write it to
+ * 'file'. The snapshot is written next to it and renamed into place, so
+ * an interrupted save never leaves a truncated snapshot behind.
+ */
+int snapshot_save(char *file)
+{
+	struct snap_builder	b;
+	struct snap_header	hdr;
+	struct iovec		iov[3];
+	char			tmp[PATH_MAX];
+	size_t			i;
+	int			fd, err = 0;
+
+	print_trace_enter();
+
+	memset(&b, 0, sizeof(b));
+	b.str_size = 4096;
+	b.str = malloc(b.str_size);
+	if (!b.str)
+		return -ENOMEM;
+	b.str[0] = '\0';
+	b.str_len = 1;
+
+	for (i = 0; i < ARRAY_SIZE(snap_classes) && !err; i++)
+		err = snap_collect_class(&b, snap_classes + i);
+	if (err)
+		goto out;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+	hdr.version = SNAP_VERSION;
+	hdr.byte_order = SNAP_BYTE_ORDER;
+	hdr.hdr_size = sizeof(hdr);
+	hdr.rec_size = sizeof(struct snap_record);
+	hdr.nr_records = b.nr_recs;
+	hdr.created = time(NULL);
+	hdr.rec_offset = sizeof(hdr);
+	hdr.str_offset = hdr.rec_offset + (u64)b.nr_recs * hdr.rec_size;
+	hdr.str_size = b.str_len;
+	gethostname(hdr.hostname, sizeof(hdr.hostname) - 1);
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		err = -errno;
+		print_err("Can not create %s (%s)", tmp, strerror(-err));
+		goto out;
+	}
+
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = b.recs;
+	iov[1].iov_len = (size_t)b.nr_recs * sizeof(struct snap_record);
+	iov[2].iov_base = b.str;
+	iov[2].iov_len = b.str_len;
+
+	err = snap_write_all(fd, iov, 3);
+	if (!err && fsync(fd))
+		err = -errno;
+	close(fd);
+
+	if (!err && rename(tmp, file))
+		err = -errno;
+	if (err) {
+		print_err("Can not write %s (%s)", file, strerror(-err));
+		unlink(tmp);
+		goto out;
+	}
+
+	print_info(" Saved %u records (%u strings) to %s\n",
+	    b.nr_recs, b.nr_strs + 1, file);
+out:
+	free(b.recs);
+	free(b.str);
+	free(b.slots);
+
+	return err;
+}
+
+/*
+ * The reader side works on the mmap()ed file, nothing is copied.
+ */
+struct snap_file {
+	void				*map;
+	size_t				size;
+	const struct snap_header	*hdr;
+	const struct snap_record	*recs;
+	const char			*str;
+};
+
+static const char *snap_str(const struct snap_file *sf, u32 off)
+{
+	return off < sf->hdr->str_size ? sf->str + off : "";
+}
+
+static void snap_close(struct snap_file *sf)
+{
+	if (sf->map)
+		munmap(sf->map, sf->size);
+	sf->map = NULL;
+}
+
+static int snap_open(const char *file, struct snap_file *sf)
+{
+	const struct snap_header	*hdr;
+	struct stat			st;
+	u32				i;
+	int				fd;
+
+	print_trace_enter();
+
+	memset(sf, 0, sizeof(*sf));
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		print_err("Can not open %s (%s)", file, strerror(errno));
+		return -EIO;
+	}
+
+	if (fstat(fd, &st) || (size_t)st.st_size < sizeof(*hdr)) {
+		close(fd);
+		goto invalid;
+	}
+
+	sf->size = st.st_size;
+	sf->map = mmap(NULL, sf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (sf->map == MAP_FAILED) {
+		sf->map = NULL;
+		print_err("Can not map %s (%s)", file, strerror(errno));
+		return -EIO;
+	}
+
+	hdr = sf->hdr = sf->map;
+	if (memcmp(hdr->magic, SNAP_MAGIC, sizeof(hdr->magic)))
+		goto invalid;
+
+	if (hdr->byte_order != SNAP_BYTE_ORDER ||
+	    hdr->version != SNAP_VERSION) {
+		print_err("%s: unsupported snapshot version or byte order",
+		    file);
+		snap_close(sf);
+		return -EINVAL;
+	}
+
+	if (hdr->hdr_size != sizeof(*hdr) ||
+	    hdr->rec_size != sizeof(struct snap_record) ||
+	    hdr->rec_offset > sf->size ||
+	    (u64)hdr->nr_records * hdr->rec_size > sf->size - hdr->rec_offset ||
+	    hdr->str_offset > sf->size ||
+	    hdr->str_size > sf->size - hdr->str_offset || !hdr->str_size)
+		goto invalid;
+
+	sf->recs = (const struct snap_record *)((char *)sf->map +
+	    hdr->rec_offset);
+	sf->str = (const char *)sf->map + hdr->str_offset;
+
+	if (sf->str[hdr->str_size - 1] != '\0')
+		goto invalid;
+
+	for (i = 0; i < hdr->nr_records; i++) {
+		if (!snap_class_of(sf->recs[i].type) ||
+		    sf->recs[i].nr_attrs > SNAP_MAX_ATTRS)
+			goto invalid;
+	}
+
+	return 0;
+
+invalid:
+	print_err("%s is not a valid snapshot", file);
+	snap_close(sf);
+	return -EINVAL;
+}
+
+/* The identity of a record, "" when its class or the device has none */
+static const char *snap_rec_id(const struct snap_file *sf,
+    const struct snap_record *rec)
+{
+	const struct snap_class *c = snap_class_of(rec->type);
+
+	if (c->id_attr < 0 || c->id_attr >= rec->nr_attrs)
+		return "";
+
+	return snap_str(sf, rec->attrs[c->id_attr]);
+}
+
+static const char *snap_rec_key(const struct snap_file *sf,
+    const struct snap_record *rec, int by_id)
+{
+	return by_id ? snap_rec_id(sf, rec) : snap_str(sf, rec->name);
+}
+
+/*
+ * Index of the records of the old snapshot by type and name, or by type
+ * and identity, open addressing with record index + 1 in each slot.
+ * Records without an identity are left out of the latter.
+ */
+struct snap_index {
+	u32	*slots;
+	u32	mask;
+	int	by_id;
+};
+
+static int snap_index_build(struct snap_index *idx, const struct snap_file *sf,
+    int by_id)
+{
+	const struct snap_record	*rec;
+	const char			*key;
+	u32				nr = 16, i, j;
+
+	while (nr < sf->hdr->nr_records * 2)
+		nr <<= 1;
+
+	idx->slots = calloc(nr, sizeof(*idx->slots));
+	if (!idx->slots)
+		return -ENOMEM;
+	idx->mask = nr - 1;
+	idx->by_id = by_id;
+
+	for (i = 0; i < sf->hdr->nr_records; i++) {
+		rec = sf->recs + i;
+		key = snap_rec_key(sf, rec, by_id);
+		if (!*key)
+			continue;
+		j = snap_key_hash(rec->type, key) & idx->mask;
+		while (idx->slots[j])
+			j = (j + 1) & idx->mask;
+		idx->slots[j] = i + 1;
+	}
+
+	return 0;
+}
+
+/* Records already matched, flagged in 'seen', are skipped */
+static const struct snap_record *snap_index_find(const struct snap_index *idx,
+    const struct snap_file *sf, int type, const char *key,
+    const unsigned char *seen, u32 *pos)
+{
+	const struct snap_record	*rec;
+	u32				j;
+
+	if (!*key)
+		return NULL;
+
+	j = snap_key_hash(type, key) & idx->mask;
+	for (; idx->slots[j]; j = (j + 1) & idx->mask) {
+		rec = sf->recs + idx->slots[j] - 1;
+		if (rec->type == type && !seen[idx->slots[j] - 1] &&
+		    !strcmp(snap_rec_key(sf, rec, idx->by_id), key)) {
+			*pos = idx->slots[j] - 1;
+			return rec;
+		}
+	}
+
+	return NULL;
+}
+
+static void snap_print_file(const char *label, const char *file,
+    const struct snap_file *sf)
+{
+	char	when[64];
+	time_t	t = sf->hdr->created;
+
+	if (!out_is_text())
+		return;
+
+	strftime(when, sizeof(when), "%F %T", localtime(&t));
+	out_printf(" %s: %s (%.*s, %s, %u records)\n", label, file,
+	    (int)sizeof(sf->hdr->hostname), sf->hdr->hostname, when,
+	    sf->hdr->nr_records);
+}
+
+static void snap_print_hctl(const struct snap_record *rec)
+{
+	if (rec->hctl[0] < 0)
+		return;
+
+	out_printf("\t[%d:%d:%d:%d]", rec->hctl[0], rec->hctl[1],
+	    rec->hctl[2], rec->hctl[3]);
+}
+
+static void snap_print_dev(const char *change, const struct snap_class *c,
+    const struct snap_file *sf, const struct snap_record *rec)
+{
+	const char *key = c->nr_attrs ? snap_str(sf, rec->attrs[0]) : "";
+
+	if (!out_is_text()) {
+		out_record_begin();
+		out_record_str("change", change);
+		out_record_str("class", c->label);
+		out_record_str("name", snap_str(sf, rec->name));
+		out_record_str(c->attrs[0].name, key);
+		out_record_end();
+		return;
+	}
+
+	out_printf(" %c %-14s %-16s", *change == 'a' ? '+' : '-', c->label,
+	    snap_str(sf, rec->name));
+	snap_print_hctl(rec);
+	if (*key)
+		out_printf("\t%s", key);
+	out_printf("\n");
+}
+
+static void snap_print_change(const struct snap_class *c, const char *name,
+    const char *attr, const char *old, const char *new)
+{
+	if (!out_is_text()) {
+		out_record_begin();
+		out_record_str("change", "changed");
+		out_record_str("class", c->label);
+		out_record_str("name", name);
+		out_record_str("attr", attr);
+		out_record_str("old", old);
+		out_record_str("new", new);
+		out_record_end();
+		return;
+	}
+
+	out_printf(" ~ %-14s %-16s %s: %s -> %s\n", c->label, name, attr,
+	    *old ? old : "\"\"", *new ? new : "\"\"");
+}
+
+/**
+ * snap_diff_record() will report every value that differs between two
+ * records of the same device
+ */
+static void snap_diff_record(const struct snap_file *a,
+    const struct snap_record *ra, const struct snap_file *b,
+    const struct snap_record *rb)
+{
+	const struct snap_class	*c = snap_class_of(rb->type);
+	const char		*name = snap_str(b, rb->name);
+	char			old[64], new[64];
+	int			i;
+
+	if (strcmp(snap_str(a, ra->name), name))
+		snap_print_change(c, name, "name", snap_str(a, ra->name), name);
+
+	if (memcmp(ra->hctl, rb->hctl, sizeof(ra->hctl))) {
+		snprintf(old, sizeof(old), "%d:%d:%d:%d", ra->hctl[0],
+		    ra->hctl[1], ra->hctl[2], ra->hctl[3]);
+		snprintf(new, sizeof(new), "%d:%d:%d:%d", rb->hctl[0],
+		    rb->hctl[1], rb->hctl[2], rb->hctl[3]);
+		snap_print_change(c, name, "hctl", old, new);
+	}
+
+	if (ra->major != rb->major || ra->minor != rb->minor) {
+		snprintf(old, sizeof(old), "%u:%u", ra->major, ra->minor);
+		snprintf(new, sizeof(new), "%u:%u", rb->major, rb->minor);
+		snap_print_change(c, name, "dev", old, new);
+	}
+
+	for (i = 0; i < c->nr_attrs; i++) {
+		const char *va = i < ra->nr_attrs ? snap_str(a, ra->attrs[i]) : "";
+		const char *vb = i < rb->nr_attrs ? snap_str(b, rb->attrs[i]) : "";
+
+		if (strcmp(va, vb))
+			snap_print_change(c, name, c->attrs[i].name, va, vb);
+	}
+}
+
+/*
+ * snap_match() will find the record of the old snapshot for 'rb': by
+ * kernel name unless both have an identity and it differs, by identity
+ * then. Paths of a multipathed LUN share the WWID, so the name goes
+ * first to keep each of them paired with itself.
+ */
+static const struct snap_record *snap_match(const struct snap_index *ids,
+    const struct snap_index *names, const struct snap_file *a,
+    const struct snap_file *b, const struct snap_record *rb,
+    const unsigned char *seen, u32 *pos)
+{
+	const struct snap_record	*ra;
+	const char			*id = snap_rec_id(b, rb);
+	const char			*old_id;
+
+	ra = snap_index_find(names, a, rb->type, snap_str(b, rb->name), seen,
+	    pos);
+	if (ra) {
+		old_id = snap_rec_id(a, ra);
+		if (!*id || !*old_id || !strcmp(id, old_id))
+			return ra;
+	}
+
+	return snap_index_find(ids, a, rb->type, id, seen, pos);
+}
+
+/**
+ * snapshot_diff() will report devices added, removed and changed between
+ * two snapshots. Block devices are matched by class and WWID or dm uuid,
+ * the others, and devices without one, by class and kernel name, through
+ * hash indexes of the old snapshot. Only records whose hash differs are
+ * compared value by value, so the diff is linear in the number of
+ * records.
+ */
+int snapshot_diff(char *old_file, char *new_file)
+{
+	const struct snap_record	*ra, *rb;
+	struct snap_file		a, b;
+	struct snap_index		ids = { NULL, 0, 1 };
+	struct snap_index		names = { NULL, 0, 0 };
+	unsigned char			*seen = NULL;
+	int				added = 0, removed = 0, changed = 0;
+	u32				i, pos;
+	int				err;
+
+	print_trace_enter();
+
+	err = snap_open(old_file, &a);
+	if (err)
+		return err;
+
+	err = snap_open(new_file, &b);
+	if (err)
+		goto out_a;
+
+	err = snap_index_build(&ids, &a, 1);
+	if (!err)
+		err = snap_index_build(&names, &a, 0);
+	if (err)
+		goto out_b;
+
+	seen = calloc(a.hdr->nr_records + 1, 1);
+	if (!seen) {
+		err = -ENOMEM;
+		goto out_b;
+	}
+
+	out_section("snapshot_diff");
+	snap_print_file("Old", old_file, &a);
+	snap_print_file("New", new_file, &b);
+	if (out_is_text())
+		out_printf("%-.64s\n", dash);
+
+	for (i = 0; i < b.hdr->nr_records; i++) {
+		rb = b.recs + i;
+		ra = snap_match(&ids, &names, &a, &b, rb, seen, &pos);
+		if (!ra) {
+			snap_print_dev("added", snap_class_of(rb->type), &b, rb);
+			added++;
+			continue;
+		}
+
+		seen[pos] = 1;
+		if (ra->hash == rb->hash &&
+		    !strcmp(snap_str(&a, ra->name), snap_str(&b, rb->name)))
+			continue;
+
+		snap_diff_record(&a, ra, &b, rb);
+		changed++;
+	}
+
+	for (i = 0; i < a.hdr->nr_records; i++) {
+		if (seen[i])
+			continue;
+
+		snap_print_dev("removed", snap_class_of(a.recs[i].type), &a,
+		    a.recs + i);
+		removed++;
+	}
+
+	if (out_is_text())
+		out_printf("\n Added: %d, Removed: %d, Changed: %d\n",
+		    added, removed, changed);
+
+	free(seen);
+out_b:
+	free(ids.slots);
+	free(names.slots);
+	snap_close(&b);
+out_a:
+	snap_close(&a);
+
+	return err;
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SCSI_SNAPSHOT_H
+#define _SCSI_SNAPSHOT_H
+
+#include "scsi.h"
+
+#define SNAP_MAGIC		"SCSISNAP"
+#define SNAP_VERSION		1
+#define SNAP_BYTE_ORDER		0x01020304
+
+/* Attribute slots per record, unused slots refer to the empty string */
+#define SNAP_MAX_ATTRS		16
+
+enum snap_rec_type {
+	SNAP_DISK = 1,
+	SNAP_NVME,
+	SNAP_DM,
+	SNAP_FC_HOST,
+	SNAP_FC_RPORT,
+	SNAP_ISCSI_SESSION,
+	SNAP_ISCSI_CONN,
+	SNAP_NR_TYPES
+};
+
+/*
+ * Snapshot file layout, all offsets are from the start of the file:
+ *
+ *	struct snap_header
+ *	struct snap_record	[nr_records]
+ *	string table		[str_size bytes of NUL terminated strings]
+ *
+ * Records have a fixed size so that a snapshot can be mmap()ed and
+ * indexed in place. Every string is stored once in the string table and
+ * referred to by its offset in there, offset 0 is the empty string.
+ * Integers are stored in host byte order, 'byte_order' catches files
+ * carried over to a host of the other endianness.
+ */
+struct snap_header {
+	char	magic[8];
+	u32	version;
+	u32	byte_order;
+	u32	hdr_size;
+	u32	rec_size;
+	u32	nr_records;
+	u32	reserved;
+	u64	created;		/* seconds since the Epoch */
+	u64	rec_offset;
+	u64	str_offset;
+	u64	str_size;
+	char	hostname[64];
+};
+
+struct snap_record {
+	u16	type;			/* enum snap_rec_type */
+	u16	nr_attrs;
+	u32	name;			/* kernel name, ex: sda, host3 */
+	u64	hash;			/* over all values of the record */
+	int	hctl[4];		/* -1 when not a SCSI device */
+	u32	major;
+	u32	minor;
+	u32	attrs[SNAP_MAX_ATTRS];
+};
+
+int snapshot_save(char *);
+int snapshot_diff(char *, char *);
+#endif
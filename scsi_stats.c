@@ -0,0 +1,498 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "scsi.h"
+#include "scsi_print.h"
+
+#define SECTOR_SIZE		512
+
+/**
+ * interval_timer_start() will arm a periodic timer on CLOCK_MONOTONIC.
+ * The kernel keeps the period, so the sampling does not drift with the
+ * time spent collecting and printing in between.
+ */
+int interval_timer_start(unsigned int interval_ms)
+{
+	struct itimerspec	its;
+	int			fd;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	its.it_interval.tv_sec = interval_ms / 1000;
+	its.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+	its.it_value = its.it_interval;
+
+	if (timerfd_settime(fd, 0, &its, NULL)) {
+		close(fd);
+		return -errno;
+	}
+
+	return fd;
+}
+
+/**
+ * interval_timer_wait() will block until the next tick and return the
+ * number of periods elapsed since the last call, more than one if we
+ * fell behind. A signal caught meanwhile ends the wait with -EINTR.
+ */
+int interval_timer_wait(int fd)
+{
+	u64	ticks;
+	ssize_t	ret;
+
+	ret = read(fd, &ticks, sizeof(ticks));
+	if (ret < 0 && errno == EINTR)
+		return -EINTR;
+
+	if (ret != sizeof(ticks))
+		return -EIO;
+
+	return ticks;
+}
+
+/* Milliseconds on CLOCK_MONOTONIC, for the time between two samples */
+u64 now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+/* Sleep 'ms' milliseconds, for polling sysfs until something settles */
+void sleep_ms(unsigned int ms)
+{
+	struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+	while (nanosleep(&ts, &ts) && errno == EINTR)
+		;
+}
+
+/**
+ * calc_disk_rates() will derive the iostat style figures for the 'ms'
+ * milliseconds between two samples of the same device
+ */
+void calc_disk_rates(struct disk_stats *old, struct disk_stats *new, u64 ms,
+    struct disk_rates *r)
+{
+	double	secs = ms ? ms / 1000.0 : 1;
+	u64	ios, sectors, ticks;
+	int	i;
+
+	for (i = 0; i < 2; i++) {
+		ios = new->ios[i] - old->ios[i];
+		sectors = new->sectors[i] - old->sectors[i];
+		ticks = new->ticks[i] - old->ticks[i];
+
+		r->ios[i] = ios / secs;
+		r->mb[i] = sectors * SECTOR_SIZE / (1024.0 * 1024.0) / secs;
+		r->merges[i] = (new->merges[i] - old->merges[i]) / secs;
+		r->await[i] = ios ? (double)ticks / ios : 0;
+		r->req_kb[i] = ios ? sectors * SECTOR_SIZE / 1024.0 / ios : 0;
+	}
+
+	r->queue_size = (new->time_in_queue - old->time_in_queue) / 1000.0 / secs;
+	r->util = (new->io_ticks - old->io_ticks) / 10.0 / secs;
+	if (r->util > 100)
+		r->util = 100;
+}
+
+/*
+ * Sample /sys/block/X/stat through an fd kept open for the whole run,
+ * pread() at offset 0 makes sysfs regenerate the values.
+ */
+static int sample_disk_stats(int fd, char *buf, int len, struct disk_stats *ds)
+{
+	ssize_t ret;
+
+	ret = pread(fd, buf, len - 1, 0);
+	if (ret <= 0)
+		return -EIO;
+	buf[ret] = '\0';
+
+	return parse_disk_stats(buf, ds) < 11 ? -EIO : 0;
+}
+
+/**
+ * watch_disk_stats() will print the rates of a disk every 'interval_ms'
+ * milliseconds, 'count' times or until interrupted when 'count' is 0.
+ * Everything is set up front, a tick does one pread() and no allocation.
+ */
+int watch_disk_stats(char *disk_name, unsigned int interval_ms,
+    unsigned int count)
+{
+	struct disk_stats	ds[2];
+	struct disk_rates	rates;
+	char			path[256];
+	char			buf[256];
+	u64			t[2];
+	unsigned int		n;
+	int			fd, tfd, cur = 0;
+	int			err = 0;
+
+	print_trace_enter();
+
+	snprintf(path, sizeof(path), "%s/%s/stat", SYSFS_BLOCK_PATH, disk_name);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		print_err("Can not open %s (%s)", path, strerror(errno));
+		return -ENODEV;
+	}
+
+	tfd = interval_timer_start(interval_ms);
+	if (tfd < 0) {
+		print_err("Can not start the interval timer (%s)",
+		    strerror(-tfd));
+		close(fd);
+		return tfd;
+	}
+
+	err = sample_disk_stats(fd, buf, sizeof(buf), &ds[cur]);
+	t[cur] = now_ms();
+
+	print_disk_rates_header();
+
+	for (n = 0; !err && (!count || n < count); n++) {
+		err = interval_timer_wait(tfd);
+		if (err < 0)
+			break;
+
+		cur ^= 1;
+		err = sample_disk_stats(fd, buf, sizeof(buf), &ds[cur]);
+		if (err)
+			break;
+		t[cur] = now_ms();
+
+		calc_disk_rates(&ds[cur ^ 1], &ds[cur], t[cur] - t[cur ^ 1],
+		    &rates);
+		print_disk_rates(disk_name, &rates);
+		out_flush();
+	}
+
+	if (err)
+		print_err("Can not read statistics of %s", disk_name);
+
+	close(tfd);
+	close(fd);
+
+	return err;
+}
+
+static u32 dev_hash(dev_t dev)
+{
+	u64 h = ((u64)major(dev) << 32 | minor(dev)) * 0x9e3779b97f4a7c15ULL;
+
+	return h >> 32;
+}
+
+static struct disk_sample *disk_sampler_find(struct disk_sampler *s, dev_t dev)
+{
+	u32 i;
+
+	for (i = dev_hash(dev) & s->mask; s->index[i]; i = (i + 1) & s->mask) {
+		if (s->disks[s->index[i] - 1].dev == dev)
+			return s->disks + s->index[i] - 1;
+	}
+
+	return NULL;
+}
+
+static int disk_sample_cmp(const void *a, const void *b)
+{
+	const struct disk_sample *x = a, *y = b;
+
+	return dev_name_cmp(x->name, y->name);
+}
+
+/**
+ * disk_sampler_open() will find every block device under /sys/block,
+ * sorted by name, and index them by dev_t. Partitions also show up in
+ * /proc/diskstats, they simply do not match the index.
+ */
+struct disk_sampler *disk_sampler_open(void)
+{
+	struct disk_sampler	*s;
+	struct dirent		*entry;
+	DIR			*dir;
+	char			val[32];
+	unsigned int		maj, min;
+	int			nr = 0, max = 0, dfd;
+	u32			size = 16, i;
+
+	print_trace_enter();
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return NULL;
+	s->fd = -1;
+
+	dir = opendir(SYSFS_BLOCK_PATH);
+	if (!dir)
+		goto err_out;
+
+	for_each_dir(entry, dir) {
+		struct disk_sample *d;
+
+		dfd = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY);
+		if (dfd < 0)
+			continue;
+
+		if (sysfs_read_at(dfd, "dev", val, sizeof(val)) <= 0 ||
+		    sscanf(val, "%u:%u", &maj, &min) != 2) {
+			close(dfd);
+			continue;
+		}
+		close(dfd);
+
+		if (nr == max) {
+			max = max ? max * 2 : 64;
+			d = realloc(s->disks, max * sizeof(*d));
+			if (!d) {
+				closedir(dir);
+				goto err_out;
+			}
+			s->disks = d;
+		}
+
+		d = s->disks + nr++;
+		memset(d, 0, sizeof(*d));
+		snprintf(d->name, sizeof(d->name), "%.*s",
+		    (int)sizeof(d->name) - 1, entry->d_name);
+		d->dev = makedev(maj, min);
+	}
+	closedir(dir);
+	s->nr_disks = nr;
+
+	if (nr)
+		qsort(s->disks, nr, sizeof(*s->disks), disk_sample_cmp);
+
+	while (size < (u32)nr * 2)
+		size <<= 1;
+	s->index = calloc(size, sizeof(*s->index));
+	if (!s->index)
+		goto err_out;
+	s->mask = size - 1;
+
+	for (nr = 0; nr < s->nr_disks; nr++) {
+		i = dev_hash(s->disks[nr].dev) & s->mask;
+		while (s->index[i])
+			i = (i + 1) & s->mask;
+		s->index[i] = nr + 1;
+	}
+
+	s->fd = open("/proc/diskstats", O_RDONLY | O_CLOEXEC);
+	if (s->fd < 0)
+		goto err_out;
+
+	/* Roughly 128 bytes a line, grown on demand if that was short */
+	s->buf_size = 4096 + s->nr_disks * 256;
+	s->buf = malloc(s->buf_size);
+	if (!s->buf)
+		goto err_out;
+
+	return s;
+
+err_out:
+	disk_sampler_close(s);
+	return NULL;
+}
+
+void disk_sampler_close(struct disk_sampler *s)
+{
+	if (!s)
+		return;
+
+	if (s->fd >= 0)
+		close(s->fd);
+	free(s->buf);
+	free(s->index);
+	free(s->disks);
+	free(s);
+}
+
+/**
+ * disk_sampler_read() will read /proc/diskstats in one go and store the
+ * counters of every known device into sample 'slot'
+ */
+int disk_sampler_read(struct disk_sampler *s, int slot)
+{
+	struct disk_sample	*d;
+	const char		*p, *end;
+	unsigned int		maj, min;
+	size_t			len = 0;
+	ssize_t			ret;
+	char			*buf;
+	int			i;
+
+	for (;;) {
+		ret = pread(s->fd, s->buf + len, s->buf_size - len - 1, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -EIO;
+		}
+		if (!ret)
+			break;
+
+		len += ret;
+		if (len < s->buf_size - 1)
+			continue;
+
+		/* More devices than at start up, make room once */
+		buf = realloc(s->buf, s->buf_size * 2);
+		if (!buf)
+			return -ENOMEM;
+		s->buf = buf;
+		s->buf_size *= 2;
+	}
+	s->buf[len] = '\0';
+
+	for (i = 0; i < s->nr_disks; i++)
+		s->disks[i].valid[slot] = 0;
+
+	for (p = s->buf; *p; p = end + 1) {
+		maj = parse_u64(&p);
+		min = parse_u64(&p);
+
+		end = strchr(p, '\n');
+		if (!end)
+			end = p + strlen(p) - 1;
+
+		d = disk_sampler_find(s, makedev(maj, min));
+		if (!d)
+			continue;
+
+		/* skip the device name */
+		while (*p == ' ')
+			p++;
+		while (*p && *p != ' ' && *p != '\n')
+			p++;
+
+		d->valid[slot] = parse_disk_stats(p, &d->ds[slot]) == 11;
+	}
+
+	return 0;
+}
+
+/**
+ * watch_all_disk_stats() will print the counters of every block device
+ * once, or their rates every 'interval_ms' milliseconds when given. One
+ * read of /proc/diskstats samples the whole host.
+ */
+int watch_all_disk_stats(unsigned int interval_ms, unsigned int count)
+{
+	struct disk_sampler	*s;
+	struct disk_sample	*d;
+	struct disk_rates	rates;
+	u64			t[2];
+	unsigned int		n;
+	int			tfd = -1, cur = 0, err, i;
+
+	print_trace_enter();
+
+	s = disk_sampler_open();
+	if (!s) {
+		print_err("Can not sample /proc/diskstats");
+		return -ENODEV;
+	}
+
+	err = disk_sampler_read(s, cur);
+	t[cur] = now_ms();
+
+	if (!interval_ms) {
+		for (i = 0; !err && i < s->nr_disks; i++) {
+			d = s->disks + i;
+			if (d->valid[cur])
+				print_disk_stats(&d->ds[cur], d->name);
+		}
+		goto out;
+	}
+
+	tfd = interval_timer_start(interval_ms);
+	if (tfd < 0) {
+		err = tfd;
+		goto out;
+	}
+
+	for (n = 0; !err && (!count || n < count); n++) {
+		err = interval_timer_wait(tfd);
+		if (err < 0)
+			break;
+
+		cur ^= 1;
+		err = disk_sampler_read(s, cur);
+		if (err)
+			break;
+		t[cur] = now_ms();
+
+		print_disk_rates_header();
+		for (i = 0; i < s->nr_disks; i++) {
+			d = s->disks + i;
+			if (!d->valid[cur])
+				continue;
+
+			/* Back after missing a read, no rate against it yet */
+			if (!d->valid[cur ^ 1]) {
+				print_disk_rates(d->name, NULL);
+				continue;
+			}
+
+			calc_disk_rates(&d->ds[cur ^ 1], &d->ds[cur],
+			    t[cur] - t[cur ^ 1], &rates);
+			print_disk_rates(d->name, &rates);
+		}
+		out_flush();
+	}
+
+out:
+	if (err < 0)
+		print_err("Can not read /proc/diskstats (%s)", strerror(-err));
+
+	if (tfd >= 0)
+		close(tfd);
+	disk_sampler_close(s);
+
+	return err;
+}
@@ -63,6 +63,105 @@ int load_sysfs_path(char *path, char *buf, int len)
 	return 0;
 }
 
+/**
+ * sysfs_read_at() will read attribute 'attr' relative to an already open
+ * sysfs directory, so walking many attributes of one device costs a
+ * single path lookup each. Returns the length of the value with the
+ * trailing newline stripped, or a negative errno.
+ */
+int sysfs_read_at(int dirfd, const char *attr, char *buf, int len)
+{
+	int	fd, count;
+
+	fd = openat(dirfd, attr, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+
+	do {
+		count = read(fd, buf, len - 1);
+	} while (count < 0 && errno == EINTR);
+	close(fd);
+
+	if (count < 0)
+		return -EIO;
+
+	if (count && buf[count - 1] == '\n')
+		count--;
+	buf[count] = '\0';
+
+	return count;
+}
+
+/**
+ * sysfs_read_str_at() will read attribute 'attr' like sysfs_read_at()
+ * and drop the trailing spaces SCSI inquiry and NVMe identify strings
+ * are padded with. 'buf' is left empty when the read fails.
+ */
+int sysfs_read_str_at(int dirfd, const char *attr, char *buf, int len)
+{
+	int	n;
+
+	n = sysfs_read_at(dirfd, attr, buf, len);
+	if (n < 0) {
+		buf[0] = '\0';
+		return n;
+	}
+
+	while (n > 0 && buf[n - 1] == ' ')
+		buf[--n] = '\0';
+
+	return n;
+}
+
+/**
+ * sysfs_write_at() will write 'val' to attribute 'attr' relative to an
+ * open sysfs directory, or AT_FDCWD for a full path. The kernel handles
+ * a sysfs store in a single write, its result is returned as 0 or a
+ * negative errno.
+ */
+int sysfs_write_at(int dirfd, const char *attr, const char *val)
+{
+	ssize_t	len = strlen(val), ret;
+	int	fd, err = 0;
+
+	fd = openat(dirfd, attr, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	do {
+		ret = write(fd, val, len);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0)
+		err = -errno;
+	else if (ret != len)
+		err = -EIO;
+	close(fd);
+
+	return err;
+}
+
+/**
+ * parse_u64() will parse one decimal number starting at *p, skipping
+ * leading blanks, and leave *p right after it. Counter files are parsed
+ * on every sampling tick, so this avoids the locale and format handling
+ * of the scanf family.
+ */
+u64 parse_u64(const char **p)
+{
+	const char	*s = *p;
+	u64		v = 0;
+
+	while (*s == ' ' || *s == '\t')
+		s++;
+
+	while (*s >= '0' && *s <= '9')
+		v = v * 10 + (*s++ - '0');
+
+	*p = s;
+
+	return v;
+}
+
 /*
  * Check if there are any files present before we
  * go parse values
@@ -155,6 +254,7 @@ err_out:
 
 char *get_device_entry(char *path)
 {
+	static char	name[NAME_MAX + 1];
 	struct dirent	*dent;
 	DIR		*dir;
 
@@ -162,17 +262,20 @@ char *get_device_entry(char *path)
 	if (!dir)
 		return NULL;
 
+	/* d_name dies with the DIR stream, so copy it out first */
 	for (dent = readdir(dir); dent; dent = readdir(dir)) {
 		if (dent->d_type != DT_DIR)
 			continue;
 
 		if (!strncmp(dent->d_name, "sd", 2)) {
 			print_debug("%s Entry Name %s \n", path, dent->d_name);
+			snprintf(name, sizeof(name), "%s", dent->d_name);
 			closedir(dir);
-			return dent->d_name;
+			return name;
 		}
 	}
 
+	closedir(dir);
 	return "unknown";
 }
 
@@ -43,6 +43,7 @@
 #include "scsi_print.h"
 #include "scsi_fcp.h"
 #include "scsi_iscsi.h"
+#include "scsi_snapshot.h"
 
 static unsigned padding = 15;
 
@@ -56,6 +57,13 @@ static struct supported_cmds cmd_str[] = {
 	{ "stats",	cmd_stats,	"Show statistics of a device" },
 	{ "show",	cmd_show,	"Show details" },
 	{ "scan",	cmd_scan,	"Scan a system for device" },
+	{ "snapshot",	cmd_snapshot,	"Save or compare inventory snapshots" },
+	{ "top",	cmd_top,	"Live view of the busiest block devices" },
+	{ "tune",	cmd_tune,	"Change timeouts of many devices at once" },
+	{ "fc",		cmd_fc,		"Manage Fibre Channel NPIV vports" },
+	{ "watch",	cmd_watch,	"Report state changes as they happen" },
+	{ "audit",	cmd_audit,	"Check devices for misplaced resources" },
+	{ "advise",	cmd_advise,	"Recommend block queue settings" },
 };
 
 static struct supported_sub_cmds sub_cmd_str[] = {
@@ -70,6 +78,11 @@ static struct supported_sub_cmds sub_cmd_str[] = {
 	{ "list",	"controller",	"List disk controllers from the host" },
 	{ "list",	"generic",	"List generic disk from the host" },
 	{ "list",	"multipath",	"List multipath disk from the host" },
+	{ "list",	"fc_luns",	"List LUNs behind FC remote ports" },
+	{ "list",	"fc_vports",	"List NPIV vports and their parent HBAs" },
+	{ "list",	"iscsi_numa",	"List the NIC and NUMA node of iSCSI sessions" },
+	{ "list",	"mq",		"List how CPUs map to blk-mq hardware queues" },
+	{ "list",	"nvme_subsys",	"List NVMe subsystems, controllers and paths" },
 
 	/* subcommand options for show */
 	{ "show",	"disk",		"Show details of a disk" },
@@ -79,6 +92,7 @@ static struct supported_sub_cmds sub_cmd_str[] = {
 	/* Subcommand options for scan */
 	{ "scan",	"block",	"Rescan system for block devices" },
 	{ "scan",	"fc_hba",	"Rescan system for FC adapters" },
+	{ "scan",	"hostN",	"Rescan one SCSI host, optionally <C> <T> <L>" },
 
 	/* subcommand options for reset */
 	{ "reset",	"adapter",	"Reset a given adapter" },
@@ -89,25 +103,168 @@ static struct supported_sub_cmds sub_cmd_str[] = {
 	/* subcommand options for stats */
 	{ "stats",	"disk",		"Show statistics for block device" },
 	{ "stats",	"fc_port",	"Show statistics for Fiber Channel port" },
+	{ "stats",	"fc_rport",	"Show FPIN statistics for FC remote ports" },
+
+	/* subcommand options for snapshot */
+	{ "snapshot",	"save",		"Save the device inventory to a file" },
+	{ "snapshot",	"diff",		"Compare two inventory snapshots" },
+
+	/* subcommand options for tune */
+	{ "tune",	"fc",		"Set FC remote port timeouts" },
+	{ "tune",	"disk",		"Set SCSI disk command timeouts" },
+	{ "tune",	"iscsi",	"Set iSCSI session recovery timeouts" },
+	{ "tune",	"nvme",		"Set NVMe-oF controller timeouts and iopolicy" },
+	{ "tune",	"rollback",	"Restore values saved with --save" },
+
+	/* subcommand options for fc */
+	{ "fc",		"vport",	"Create or delete the vports of a spec file" },
+
+	/* subcommand options for watch */
+	{ "watch",	"iscsi",	"Time iSCSI session and connection state changes" },
+
+	/* subcommand options for audit */
+	{ "audit",	"irq",		"Check the interrupt placement of HBAs and NVMe" },
+	{ "audit",	"links",	"Check PCIe and FC links for running below capability" },
+
+	/* subcommand options for advise */
+	{ "advise",	"disk",		"Recommend queue settings from device class and load" },
+};
+
+static struct supported_opts opt_str[] = {
+	{ "stream",	0,	"Render each device as soon as it is collected", 0, NULL },
+	{ "json",	0,	"Print the output as one JSON array", 0, NULL },
+	{ "ndjson",	0,	"Print the output as one JSON object per line", 0, NULL },
+	{ "interval",	1,	"Sample statistics every <ms> milliseconds", 0, NULL },
+	{ "count",	1,	"Stop after <n> samples", 0, NULL },
+	{ "sort",	1,	"Rank by util, iops, mb or await", 0, NULL },
+	{ "lines",	1,	"Number of devices to show", 0, NULL },
+	{ "reset",	0,	"Reset the statistics first", 0, NULL },
+	{ "luns",	0,	"Also show the LUNs behind the port or session", 0, NULL },
+	{ "lip",	0,	"Issue a LIP before scanning FC hosts", 0, NULL },
+	{ "jobs",	1,	"Number of hosts or devices handled at the same time", 0, NULL },
+	{ "delete-offline", 0,	"Delete offline devices before scanning", 0, NULL },
+	{ "dev-loss-tmo", 1,	"Seconds before a lost FC remote port is removed", 0, NULL },
+	{ "fast-io-fail-tmo", 1, "Seconds before I/O to a lost FC remote port or NVMe controller fails, or off", 0, NULL },
+	{ "timeout",	1,	"SCSI command timeout in seconds", 0, NULL },
+	{ "eh-timeout",	1,	"SCSI error handler command timeout in seconds", 0, NULL },
+	{ "recovery-tmo", 1,	"Seconds an iSCSI session may take to recover", 0, NULL },
+	{ "abort-tmo",	1,	"iSCSI task abort timeout in seconds", 0, NULL },
+	{ "lu-reset-tmo", 1,	"iSCSI LUN reset timeout in seconds", 0, NULL },
+	{ "tgt-reset-tmo", 1,	"iSCSI target reset timeout in seconds", 0, NULL },
+	{ "ctrl-loss-tmo", 1,	"Seconds a lost NVMe controller is reconnected, or off", 0, NULL },
+	{ "reconnect-delay", 1,	"Seconds between NVMe controller reconnects", 0, NULL },
+	{ "iopolicy",	1,	"NVMe multipath policy: numa, round-robin or queue-depth", 0, NULL },
+	{ "where",	1,	"Only tune devices matching key=pattern,...", 0, NULL },
+	{ "save",	1,	"Save the old values to a rollback file", 0, NULL },
+	{ "cpus",	1,	"CPUs running the I/O, flags NICs on other nodes", 0, NULL },
+	{ "mq",		0,	"Also show the blk-mq hardware queues of the disk", 0, NULL },
+	{ "vectors",	0,	"Also list every interrupt vector", 0, NULL },
 };
 
+static struct supported_opts *find_cmd_opt(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(opt_str); i++) {
+		if (strcmp(opt, opt_str[i].opt) == 0)
+			return opt_str + i;
+	}
+
+	return NULL;
+}
+
+/**
+ * parse_cmd_options() will pick "--option [value]" arguments out of the
+ * command line, so that sub-commands keep seeing their positional
+ * arguments at the usual argv index.
+ */
+int parse_cmd_options(int *argc, char **argv)
+{
+	struct supported_opts *p;
+	char	*name, *eq;
+	int	i, n = 2;
+
+	print_trace_enter();
+
+	for (i = 2; i < *argc; i++) {
+		if (strncmp(argv[i], "--", 2) != 0 || argv[i][2] == '\0') {
+			argv[n++] = argv[i];
+			continue;
+		}
+
+		name = argv[i] + 2;
+		eq = strchr(name, '=');
+		if (eq)
+			*eq = '\0';
+
+		p = find_cmd_opt(name);
+		if (!p) {
+			print_err("Unknown option '--%s'", name);
+			return -EINVAL;
+		}
+
+		p->is_set = 1;
+
+		if (!p->has_arg)
+			continue;
+
+		if (eq) {
+			p->value = eq + 1;
+		} else if (i + 1 < *argc) {
+			p->value = argv[++i];
+		} else {
+			print_err("Option '--%s' requires a value", name);
+			return -EINVAL;
+		}
+
+		print_debug("Option '%s' = '%s'", p->opt, p->value);
+	}
+
+	if (n < *argc)
+		argv[n] = NULL;
+	*argc = n;
+
+	return 0;
+}
+
+int cmd_opt_isset(const char *opt)
+{
+	struct supported_opts *p = find_cmd_opt(opt);
+
+	return p ? p->is_set : 0;
+}
+
+char *cmd_opt_value(const char *opt)
+{
+	struct supported_opts *p = find_cmd_opt(opt);
+
+	return (p && p->is_set) ? p->value : NULL;
+}
+
 /**
  * list_subcommands() will iterate through the array to find command and display
- * supported subcommands.
+ * supported subcommands. The list is plain text, so with JSON output the
+ * missing sub command is reported as an error instead.
  */
-void list_subcommands(const char *cmd)
+int list_subcommands(const char *cmd)
 {
 	size_t  i;
 	struct supported_sub_cmds *p;
 
+	if (!out_is_text()) {
+		print_err("'%s' needs a sub command with JSON output, see '%s help %s'",
+		    cmd, SCSI_TOOL_NAME, cmd);
+		return -EINVAL;
+	}
+
 	for (i = 0; i < ARRAY_SIZE(sub_cmd_str); i++) {
 		p = sub_cmd_str + i;
 
 		/* Search for the first occurance of the command */
 		if (strcmp(cmd, p->cmd) == 0) {
-			printf("\n%-.2sFollowing Sub-Commands are supported for '%s'\n",
+			out_printf("\n%-.2sFollowing Sub-Commands are supported for '%s'\n",
 			    space, cmd);
-			printf("%-.2s%-.64s\n", space, dash);
+			out_printf("%-.2s%-.64s\n", space, dash);
 			break;
 		}
 	}
@@ -117,10 +274,12 @@ void list_subcommands(const char *cmd)
 
 		/*  Print sub-command and description as a list */
 		if (strcmp(cmd, p->cmd) == 0)
-			printf("%-.2s%-*s%-.4s%s\n", space, padding, p->sub_cmd,
+			out_printf("%-.2s%-*s%-.4s%s\n", space, padding, p->sub_cmd,
 			    space, p->sub_cmd_desc);
 	}
-	printf("\n");
+	out_printf("\n");
+
+	return 0;
 }
 
 /**
@@ -133,7 +292,7 @@ void list_builtins()
 
 	for (i = 0; i < ARRAY_SIZE(cmd_str); i++) {
 		struct supported_cmds *p = cmd_str + i;
-		printf("%-.4s%-*s%-.4s%s\n", space, padding, p->cmds, space, p->cmd_desc);
+		out_printf("%-.4s%-*s%-.4s%s\n", space, padding, p->cmds, space, p->cmd_desc);
 	}
 }
 
@@ -209,9 +368,13 @@ int validate_subcommand(char **argv)
 /**
  * handle_cmd_errors() will handle erros with the issued command
  */
-void handle_cmd_errors(char **argv, struct scsi_device_list *s_dev)
+int handle_cmd_errors(char **argv, struct scsi_device_list *s_dev)
 {
-	list_subcommands(argv[1]);
+	int err;
+
+	err = list_subcommands(argv[1]);
+	if (err < 0)
+		return err;
 
 	list_enclosure(s_dev->disk_info);
 
@@ -224,6 +387,8 @@ void handle_cmd_errors(char **argv, struct scsi_device_list *s_dev)
 	list_fc_adapters(s_dev->fc_info);
 
 	list_iscsi_devs(s_dev->iscsi_info);
+
+	return 0;
 }
 
 /**
@@ -300,6 +465,31 @@ int cmd_list(int argc, char **argv, struct scsi_device_list *s_dev)
 			if (err < 0)
 				goto err_out;
 		}
+		if (!strcmp(argv[2], "fc_luns")) {
+			err = list_fc_luns(-1);
+			if (err < 0)
+				goto err_out;
+		}
+		if (!strcmp(argv[2], "fc_vports")) {
+			err = list_fc_vports();
+			if (err < 0)
+				goto err_out;
+		}
+		if (!strcmp(argv[2], "iscsi_numa")) {
+			err = list_iscsi_numa();
+			if (err < 0)
+				goto err_out;
+		}
+		if (!strcmp(argv[2], "mq")) {
+			err = list_mq();
+			if (err < 0)
+				goto err_out;
+		}
+		if (!strcmp(argv[2], "nvme_subsys")) {
+			err = list_nvme_subsys();
+			if (err < 0)
+				goto err_out;
+		}
 		if (!strcmp(argv[2], "generic")) {
 			err = list_generic_devs(s_dev->disk_info);
 			if (err < 0)
@@ -324,7 +514,7 @@ int cmd_list(int argc, char **argv, struct scsi_device_list *s_dev)
 				goto err_out;
 		}
 	} else {
-		handle_cmd_errors(argv, s_dev);
+		err = handle_cmd_errors(argv, s_dev);
 	}
 
 	return err;
@@ -491,7 +681,7 @@ int cmd_reset(int argc, char **argv, struct scsi_device_list *s_dev)
 			print_debug("issue LIP for %s", argv[3]);
 		}
 	} else {
-		handle_cmd_errors(argv, s_dev);
+		return handle_cmd_errors(argv, s_dev);
 	}
 
 	return 0;
@@ -500,11 +690,53 @@ err_out:
 	return err;
 }
 
+/* --count <n>, 0 when not given */
+static int get_count_opt(unsigned int *count)
+{
+	char		*val, *end;
+	unsigned long	v;
+
+	*count = 0;
+	val = cmd_opt_value("count");
+	if (val) {
+		v = strtoul(val, &end, 0);
+		if (*end || !v || v > UINT_MAX) {
+			print_err("Invalid count '%s'", val);
+			return -EINVAL;
+		}
+		*count = v;
+	}
+
+	return 0;
+}
+
+/**
+ * get_interval_opts() will validate --interval <ms> and --count <n>, a
+ * count of 0 means sampling until interrupted
+ */
+static int get_interval_opts(unsigned int *interval, unsigned int *count)
+{
+	char		*val, *end;
+	unsigned long	v;
+
+	val = cmd_opt_value("interval");
+	v = val ? strtoul(val, &end, 0) : 0;
+	if (!val || *end || !v || v > UINT_MAX) {
+		print_err("Invalid interval '%s', expected milliseconds",
+		    val ? val : "");
+		return -EINVAL;
+	}
+	*interval = v;
+
+	return get_count_opt(count);
+}
+
 /**
  * cmd_stats() will show statistical data about a device
  */
 int cmd_stats(int argc, char **argv, struct scsi_device_list *s_dev)
 {
+	unsigned int	interval, count;
 	int	len, err = -EINVAL;
 	char	disk_str[32] = { 0 };
 
@@ -529,6 +761,27 @@ int cmd_stats(int argc, char **argv, struct scsi_device_list *s_dev)
 
 		snprintf(disk_str, len,  "%s", argv[3]);
 
+		if (strncmp(argv[2], "disk", 4) == 0 &&
+		    strcmp(argv[3], "all") == 0) {
+			interval = count = 0;
+			if (cmd_opt_isset("interval")) {
+				err = get_interval_opts(&interval, &count);
+				if (err < 0)
+					return err;
+			}
+
+			return watch_all_disk_stats(interval, count);
+		}
+
+		if (strncmp(argv[2], "disk", 4) == 0 &&
+		    cmd_opt_isset("interval")) {
+			err = get_interval_opts(&interval, &count);
+			if (err < 0)
+				return err;
+
+			return watch_disk_stats(disk_str, interval, count);
+		}
+
 		if (strncmp(argv[2], "disk", 4) == 0) {
 			print_trace_enter();
 
@@ -548,6 +801,30 @@ int cmd_stats(int argc, char **argv, struct scsi_device_list *s_dev)
 			put_scsi_dev(s_dev->disk_info);
 		}
 
+		if (strncmp(argv[2], "fc_port", 7) == 0 &&
+		    (cmd_opt_isset("interval") || cmd_opt_isset("reset") ||
+		     strcmp(argv[3], "all") == 0)) {
+			interval = count = 0;
+			if (cmd_opt_isset("interval")) {
+				err = get_interval_opts(&interval, &count);
+				if (err < 0)
+					return err;
+			}
+
+			return watch_fc_port_stats(disk_str, interval, count);
+		}
+
+		if (strncmp(argv[2], "fc_rport", 8) == 0) {
+			interval = count = 0;
+			if (cmd_opt_isset("interval")) {
+				err = get_interval_opts(&interval, &count);
+				if (err < 0)
+					return err;
+			}
+
+			return watch_fc_rport_stats(disk_str, interval, count);
+		}
+
 		if (strncmp(argv[2], "fc_port", 7) == 0) {
 			print_trace_enter();
 
@@ -569,7 +846,7 @@ int cmd_stats(int argc, char **argv, struct scsi_device_list *s_dev)
 
 		}
 	} else {
-		handle_cmd_errors(argv, s_dev);
+		return handle_cmd_errors(argv, s_dev);
 	}
 
 	return 0;
@@ -580,7 +857,7 @@ int cmd_stats(int argc, char **argv, struct scsi_device_list *s_dev)
  */
 int cmd_show(int argc, char **argv, struct scsi_device_list *s_dev)
 {
-	int err = 0;
+	int err = 0, host_no;
 	char device_str[16] = { 0 };
 
 	print_trace_enter();
@@ -615,6 +892,12 @@ int cmd_show(int argc, char **argv, struct scsi_device_list *s_dev)
 				return err;
 
 			put_scsi_dev(s_dev->disk_info);
+
+			if (cmd_opt_isset("mq")) {
+				err = show_disk_mq(argv[3]);
+				if (err < 0)
+					return err;
+			}
 		}
 
 		if (strncmp(argv[2], "fc_port", 7) == 0) {
@@ -629,6 +912,13 @@ int cmd_show(int argc, char **argv, struct scsi_device_list *s_dev)
 				return err;
 
 			put_fc_dev(s_dev->fc_info);
+
+			if (cmd_opt_isset("luns") &&
+			    sscanf(argv[3], "host%d", &host_no) == 1) {
+				err = list_fc_luns(host_no);
+				if (err < 0)
+					return err;
+			}
 		}
 
 		if (strncmp(argv[2], "enclosure", 9) == 0) {
@@ -660,7 +950,7 @@ int cmd_show(int argc, char **argv, struct scsi_device_list *s_dev)
 		}
 	} else {
 		print_trace_enter();
-		handle_cmd_errors(argv, s_dev);
+		err = handle_cmd_errors(argv, s_dev);
 	}
 
 	return err;
@@ -675,16 +965,21 @@ int cmd_scan(int argc, char **argv, struct scsi_device_list *s_dev)
 
 	print_trace_enter();
 
-	if (argc < 2) {
+	if (argc > 2) {
 		print_trace_enter();
+
+		/* scan hostN [C T L] */
+		if (strncmp(argv[2], "host", 4) == 0 && isdigit(argv[2][4]))
+			return scan_scsi_hosts(argc - 2, argv + 2);
+
 		err = validate_subcommand(argv);
 		if (err < 0)
 			return err;
 
-		if (strncmp(argv[2], "disk", 4) == 0)
-			err = scsi_scan_disk_dev(argv, s_dev->disk_info);
-		else if (strncmp(argv[2], "fc_port", 7) == 0)
-			err = scsi_scan_fcport_dev(argv, s_dev->fc_info);
+		if (strncmp(argv[2], "block", 5) == 0)
+			err = scan_scsi_hosts(argc - 3, argv + 3);
+		else if (strncmp(argv[2], "fc_hba", 6) == 0)
+			err = scan_fc_hosts(argc - 3, argv + 3);
 		else if  (strncmp(argv[2], "iscsi", 5) == 0)
 			err = scsi_scan_iscsi_dev(argv, s_dev->iscsi_info);
 		else
@@ -700,6 +995,189 @@ int cmd_scan(int argc, char **argv, struct scsi_device_list *s_dev)
 	return 0;
 }
 
+/**
+ * cmd_snapshot() will save the device inventory of the host to a file, or
+ * report what changed between two such files
+ */
+int cmd_snapshot(int argc, char **argv,
+    struct scsi_device_list *s_dev __attribute__((unused)))
+{
+	int err = 0;
+
+	print_trace_enter();
+
+	if (argc < 4)
+		return list_subcommands(argv[1]);
+
+	err = validate_subcommand(argv);
+	if (err < 0)
+		return err;
+
+	if (strcmp(argv[2], "save") == 0)
+		return snapshot_save(argv[3]);
+
+	if (argc < 5 || argv[4] == NULL) {
+		print_info("Please provide the old and the new snapshot file");
+		return -EINVAL;
+	}
+
+	return snapshot_diff(argv[3], argv[4]);
+}
+
+/**
+ * cmd_tune() will change timeouts of all matching FC remote ports, SCSI
+ * disks, iSCSI sessions or NVMe controllers, or restore them from a
+ * rollback file
+ */
+int cmd_tune(int argc, char **argv,
+    struct scsi_device_list *s_dev __attribute__((unused)))
+{
+	int err = 0;
+
+	print_trace_enter();
+
+	if (argc < 3)
+		return list_subcommands(argv[1]);
+
+	err = validate_subcommand(argv);
+	if (err < 0)
+		return err;
+
+	if (strcmp(argv[2], "fc") == 0)
+		return tune_fc();
+
+	if (strcmp(argv[2], "disk") == 0)
+		return tune_disk();
+
+	if (strcmp(argv[2], "iscsi") == 0)
+		return tune_iscsi();
+
+	if (strcmp(argv[2], "nvme") == 0)
+		return tune_nvme();
+
+	if (argc < 4 || argv[3] == NULL) {
+		print_info("Please provide the rollback file");
+		return -EINVAL;
+	}
+
+	return tune_rollback(argv[3]);
+}
+
+/**
+ * cmd_fc() will create or delete a batch of NPIV vports
+ */
+int cmd_fc(int argc, char **argv,
+    struct scsi_device_list *s_dev __attribute__((unused)))
+{
+	int err = 0;
+
+	print_trace_enter();
+
+	if (argc < 3)
+		return list_subcommands(argv[1]);
+
+	err = validate_subcommand(argv);
+	if (err < 0)
+		return err;
+
+	if (argc < 5 || (strcmp(argv[3], "create") && strcmp(argv[3], "delete"))) {
+		print_info("Usage: %s fc vport <create|delete> <spec file>",
+		    argv[0]);
+		return -EINVAL;
+	}
+
+	return fc_vport_batch(argv[4], strcmp(argv[3], "create") == 0);
+}
+
+/**
+ * cmd_watch() will report state changes of iSCSI sessions until
+ * interrupted
+ */
+int cmd_watch(int argc, char **argv,
+    struct scsi_device_list *s_dev __attribute__((unused)))
+{
+	unsigned int	interval = 0, count;
+	int		err;
+
+	print_trace_enter();
+
+	if (argc < 3)
+		return list_subcommands(argv[1]);
+
+	err = validate_subcommand(argv);
+	if (err < 0)
+		return err;
+
+	if (cmd_opt_isset("interval"))
+		err = get_interval_opts(&interval, &count);
+	else
+		err = get_count_opt(&count);
+	if (err < 0)
+		return err;
+
+	return watch_iscsi_sessions(interval, count);
+}
+
+/**
+ * cmd_audit() will check the devices of the host for resources placed
+ * away from them
+ */
+int cmd_audit(int argc, char **argv,
+    struct scsi_device_list *s_dev __attribute__((unused)))
+{
+	int err;
+
+	print_trace_enter();
+
+	if (argc < 3)
+		return list_subcommands(argv[1]);
+
+	err = validate_subcommand(argv);
+	if (err < 0)
+		return err;
+
+	if (!strcmp(argv[2], "links"))
+		return audit_links();
+
+	return audit_irq();
+}
+
+/**
+ * cmd_advise() will recommend queue settings for one disk, or all of
+ * them when no disk or "all" is given
+ */
+int cmd_advise(int argc, char **argv,
+    struct scsi_device_list *s_dev __attribute__((unused)))
+{
+	char	*name = NULL;
+	int	err;
+
+	print_trace_enter();
+
+	if (argc < 3)
+		return list_subcommands(argv[1]);
+
+	err = validate_subcommand(argv);
+	if (err < 0)
+		return err;
+
+	if (argc > 3 && strcmp(argv[3], "all"))
+		name = argv[3];
+
+	return advise_disk(name);
+}
+
+/**
+ * cmd_top() will keep showing the busiest block devices until interrupted
+ */
+int cmd_top(int argc __attribute__((unused)), char **argv __attribute__((unused)),
+    struct scsi_device_list *s_dev __attribute__((unused)))
+{
+	print_trace_enter();
+
+	return show_top_disks();
+}
+
 /**
  * parse_cmd() will check each command and call apropriate hook for a command
  * action
@@ -748,6 +1226,27 @@ int parse_cmd(int argc, char **argv, struct scsi_device_list *s_dev)
 	if (strncmp(cmd, "errors", 6) == 0)
 		err = cmd_errors(argc, argv, s_dev);
 
+	if (strncmp(cmd, "snapshot", 8) == 0)
+		err = cmd_snapshot(argc, argv, s_dev);
+
+	if (strncmp(cmd, "top", 3) == 0)
+		err = cmd_top(argc, argv, s_dev);
+
+	if (strncmp(cmd, "tune", 4) == 0)
+		err = cmd_tune(argc, argv, s_dev);
+
+	if (strcmp(cmd, "fc") == 0)
+		err = cmd_fc(argc, argv, s_dev);
+
+	if (strncmp(cmd, "watch", 5) == 0)
+		err = cmd_watch(argc, argv, s_dev);
+
+	if (strncmp(cmd, "audit", 5) == 0)
+		err = cmd_audit(argc, argv, s_dev);
+
+	if (strncmp(cmd, "advise", 6) == 0)
+		err = cmd_advise(argc, argv, s_dev);
+
 	if (err < 0)
 		print_debug("%s: '%s' Command Failed %d ", argv[1], argv[2], err);
 
@@ -775,6 +1274,7 @@ int handle_cmd(int argc, char **argv)
 		ret = -EINVAL;
 		goto err_out;
 	}
+	memset(sdev, 0, sizeof(*sdev));
 	sdev->scsi_tool_name = strdup(SCSI_TOOL_NAME);
 	sdev->scsi_tool_version = strdup(SCSI_TOOL_VERSION);
 
@@ -789,6 +1289,15 @@ int handle_cmd(int argc, char **argv)
 		goto err_out;
 	} 
 
+	ret = parse_cmd_options(&argc, argv);
+	if (ret < 0)
+		goto err_out;
+
+	if (cmd_opt_isset("ndjson"))
+		out_set_mode(OUT_NDJSON);
+	else if (cmd_opt_isset("json"))
+		out_set_mode(OUT_JSON);
+
 	ret = parse_cmd(argc, argv, sdev);
 	if (ret < 0) {
 		if (ret == -ENODEV) {
@@ -820,6 +1329,12 @@ int main(int argc, char **argv)
 
 	print_trace_enter();
 
+	/*
+	 * Push out whatever is still buffered and close an open JSON array,
+	 * on every exit path
+	 */
+	atexit(out_finish);
+
 	if (argc < 2) {
 		general_help();
 		return 0;
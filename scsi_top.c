@@ -0,0 +1,405 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <termios.h>
+
+#include "scsi.h"
+#include "scsi_print.h"
+
+#define TOP_LINE_LEN		256
+#define TOP_DEF_LINES		20
+#define TOP_HDR_LINES		3	/* title, blank, column titles */
+
+enum top_sort_key {
+	TOP_SORT_UTIL = 0,
+	TOP_SORT_IOPS,
+	TOP_SORT_MB,
+	TOP_SORT_AWAIT,
+};
+
+static const char *top_sort_names[] = {
+	[TOP_SORT_UTIL]		= "util",
+	[TOP_SORT_IOPS]		= "iops",
+	[TOP_SORT_MB]		= "mb",
+	[TOP_SORT_AWAIT]	= "await",
+};
+
+/* Block devices worth ranking, partitions and loop devices are left out */
+static const char *top_prefixes[] = { "sd", "nvme", "dm-", "md" };
+
+struct top_entry {
+	double			key;
+	int			disk;
+	struct disk_rates	rates;
+};
+
+/*
+ * What is currently on the terminal, so that a refresh only rewrites the
+ * lines which changed.
+ */
+struct top_screen {
+	char	(*lines)[TOP_LINE_LEN];
+	int	max_lines;
+	int	nr_lines;
+	int	tty;
+};
+
+static volatile sig_atomic_t top_stop;
+
+static void top_signal(int sig __attribute__((unused)))
+{
+	top_stop = 1;
+}
+
+static double top_key(int sort, struct disk_rates *r)
+{
+	double ios = r->ios[0] + r->ios[1];
+
+	switch (sort) {
+	case TOP_SORT_IOPS:
+		return ios;
+	case TOP_SORT_MB:
+		return r->mb[0] + r->mb[1];
+	case TOP_SORT_AWAIT:
+		return ios ? (r->await[0] * r->ios[0] +
+		    r->await[1] * r->ios[1]) / ios : 0;
+	default:
+		return r->util;
+	}
+}
+
+static void top_swap(struct top_entry *a, struct top_entry *b)
+{
+	struct top_entry t = *a;
+
+	*a = *b;
+	*b = t;
+}
+
+/**
+ * top_select() will move the 'k' entries with the largest key to the
+ * front of the array in no particular order, in linear time on average.
+ */
+static void top_select(struct top_entry *e, int nr, int k)
+{
+	int	lo = 0, hi = nr - 1, i, j;
+	double	pivot;
+
+	if (k <= 0 || k >= nr)
+		return;
+
+	while (lo < hi) {
+		pivot = e[lo + (hi - lo) / 2].key;
+		i = lo;
+		j = hi;
+
+		while (i <= j) {
+			while (e[i].key > pivot)
+				i++;
+			while (e[j].key < pivot)
+				j--;
+			if (i <= j)
+				top_swap(e + i++, e + j--);
+		}
+
+		if (k - 1 <= j)
+			hi = j;
+		else if (k - 1 >= i)
+			lo = i;
+		else
+			break;
+	}
+}
+
+/* Only the few selected entries are put in order, insertion sort it is */
+static void top_sort(struct top_entry *e, int nr)
+{
+	struct top_entry	t;
+	int			i, j;
+
+	for (i = 1; i < nr; i++) {
+		t = e[i];
+		for (j = i; j > 0 && e[j - 1].key < t.key; j--)
+			e[j] = e[j - 1];
+		e[j] = t;
+	}
+}
+
+static void top_draw_line(struct top_screen *scr, int row, const char *line)
+{
+	if (!scr->tty) {
+		out_str(line);
+		out_char('\n');
+		return;
+	}
+
+	if (row < scr->nr_lines && !strcmp(scr->lines[row], line))
+		return;
+
+	out_printf("\033[%d;1H%s\033[K", row + 1, line);
+	snprintf(scr->lines[row], TOP_LINE_LEN, "%s", line);
+}
+
+/* Wipe lines left over from a longer previous frame */
+static void top_end_frame(struct top_screen *scr, int nr_lines)
+{
+	int row;
+
+	if (scr->tty) {
+		for (row = nr_lines; row < scr->nr_lines; row++)
+			out_printf("\033[%d;1H\033[K", row + 1);
+		scr->nr_lines = nr_lines;
+	} else {
+		out_char('\n');
+	}
+
+	out_flush();
+}
+
+static int top_parse_opts(int *sort, int *lines, unsigned int *interval,
+    unsigned int *count)
+{
+	char	*val, *end;
+	size_t	i;
+	long	v;
+
+	*sort = TOP_SORT_UTIL;
+	val = cmd_opt_value("sort");
+	if (val) {
+		for (i = 0; i < ARRAY_SIZE(top_sort_names); i++) {
+			if (!strcmp(val, top_sort_names[i]))
+				break;
+		}
+		if (i == ARRAY_SIZE(top_sort_names)) {
+			print_err("Invalid sort key '%s' (util, iops, mb, await)",
+			    val);
+			return -EINVAL;
+		}
+		*sort = i;
+	}
+
+	*lines = TOP_DEF_LINES;
+	val = cmd_opt_value("lines");
+	if (val) {
+		v = strtol(val, &end, 0);
+		if (*end || v <= 0 || v > 10000) {
+			print_err("Invalid number of lines '%s'", val);
+			return -EINVAL;
+		}
+		*lines = v;
+	}
+
+	*interval = 1000;
+	*count = 0;
+	val = cmd_opt_value("interval");
+	if (val) {
+		v = strtol(val, &end, 0);
+		if (*end || v <= 0) {
+			print_err("Invalid interval '%s', expected milliseconds",
+			    val);
+			return -EINVAL;
+		}
+		*interval = v;
+	}
+
+	val = cmd_opt_value("count");
+	if (val) {
+		v = strtol(val, &end, 0);
+		if (*end || v <= 0) {
+			print_err("Invalid count '%s'", val);
+			return -EINVAL;
+		}
+		*count = v;
+	}
+
+	return 0;
+}
+
+/**
+ * show_top_disks() will refresh a table of the busiest block devices
+ * every interval. A refresh costs one read of /proc/diskstats, one read
+ * of the timer and one write to the terminal: the busiest devices are
+ * picked with a partial selection, and only lines which changed since
+ * the previous frame are redrawn.
+ */
+int show_top_disks(void)
+{
+	struct disk_sampler	*s;
+	struct disk_sample	*d;
+	struct top_entry	*entries = NULL;
+	struct top_screen	scr;
+	struct sigaction	sa;
+	struct winsize		ws;
+	char			line[TOP_LINE_LEN];
+	unsigned int		interval, count, n;
+	int			*disks = NULL, nr = 0, lines, sort;
+	int			tfd = -1, cur = 0, err, i, k;
+	u64			t[2];
+
+	print_trace_enter();
+
+	err = top_parse_opts(&sort, &lines, &interval, &count);
+	if (err)
+		return err;
+
+	s = disk_sampler_open();
+	if (!s) {
+		print_err("Can not sample /proc/diskstats");
+		return -ENODEV;
+	}
+
+	memset(&scr, 0, sizeof(scr));
+	scr.tty = out_is_text() && isatty(STDOUT_FILENO);
+	if (scr.tty && !ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) &&
+	    ws.ws_row > TOP_HDR_LINES + 1 &&
+	    lines > ws.ws_row - TOP_HDR_LINES - 1)
+		lines = ws.ws_row - TOP_HDR_LINES - 1;
+
+	disks = calloc(s->nr_disks + 1, sizeof(*disks));
+	entries = calloc(s->nr_disks + 1, sizeof(*entries));
+	scr.max_lines = lines + TOP_HDR_LINES;
+	scr.lines = calloc(scr.max_lines, sizeof(*scr.lines));
+	if (!disks || !entries || !scr.lines) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < s->nr_disks; i++) {
+		for (k = 0; k < NUM_ENTRIES(top_prefixes); k++) {
+			if (!strncmp(s->disks[i].name, top_prefixes[k],
+			    strlen(top_prefixes[k]))) {
+				disks[nr++] = i;
+				break;
+			}
+		}
+	}
+
+	tfd = interval_timer_start(interval);
+	if (tfd < 0) {
+		err = tfd;
+		goto out;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = top_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	err = disk_sampler_read(s, cur);
+	t[cur] = now_ms();
+
+	if (scr.tty)
+		out_str("\033[H\033[2J");
+	else if (!out_is_text())
+		print_disk_rates_header();
+
+	for (n = 0; !err && !top_stop && (!count || n < count); n++) {
+		err = interval_timer_wait(tfd);
+		if (err < 0)
+			break;
+
+		cur ^= 1;
+		err = disk_sampler_read(s, cur);
+		if (err)
+			break;
+		t[cur] = now_ms();
+
+		k = 0;
+		for (i = 0; i < nr; i++) {
+			d = s->disks + disks[i];
+			if (!d->valid[cur] || !d->valid[cur ^ 1])
+				continue;
+
+			entries[k].disk = disks[i];
+			calc_disk_rates(&d->ds[cur ^ 1], &d->ds[cur],
+			    t[cur] - t[cur ^ 1], &entries[k].rates);
+			entries[k].key = top_key(sort, &entries[k].rates);
+			k++;
+		}
+
+		top_select(entries, k, lines);
+		if (k > lines)
+			k = lines;
+		top_sort(entries, k);
+
+		if (!out_is_text()) {
+			for (i = 0; i < k; i++)
+				print_disk_rates(s->disks[entries[i].disk].name,
+				    &entries[i].rates);
+			out_flush();
+			continue;
+		}
+
+		snprintf(line, sizeof(line),
+		    "%s top - %d of %d devices by %s, every %u ms",
+		    SCSI_TOOL_NAME, k, nr, top_sort_names[sort], interval);
+		top_draw_line(&scr, 0, line);
+		top_draw_line(&scr, 1, "");
+		format_disk_rates_header(line, sizeof(line));
+		top_draw_line(&scr, 2, line);
+
+		for (i = 0; i < k; i++) {
+			format_disk_rates(line, sizeof(line),
+			    s->disks[entries[i].disk].name, &entries[i].rates);
+			top_draw_line(&scr, TOP_HDR_LINES + i, line);
+		}
+		top_end_frame(&scr, TOP_HDR_LINES + k);
+	}
+
+	if (err == -EINTR)
+		err = 0;
+
+	/* Leave the cursor below the table */
+	if (scr.tty)
+		out_printf("\033[%d;1H\n", scr.nr_lines + 1);
+
+out:
+	if (err < 0)
+		print_err("Can not refresh device statistics (%s)",
+		    strerror(-err));
+
+	if (tfd >= 0)
+		close(tfd);
+	free(scr.lines);
+	free(entries);
+	free(disks);
+	disk_sampler_close(s);
+
+	return err;
+}
@@ -52,9 +52,9 @@ int fc_hba_reset(int argc, char **argv)
 
 	if (argc < 4 || argv[3] == NULL)
 	{
-		printf(" Usage:\n\n");
-		printf(" Missing argument for the sub-command [%s]\n\n", argv[2]);
-		printf(" scsi reset <%s> [<arg>] \n", argv[2]);
+		out_printf(" Usage:\n\n");
+		out_printf(" Missing argument for the sub-command [%s]\n\n", argv[2]);
+		out_printf(" scsi reset <%s> [<arg>] \n", argv[2]);
 		return -EINVAL;
 	}
 
@@ -104,7 +104,7 @@ void pci_bus_rescan()
 	int		fd;
 	char 		d = '1';
 
-	printf("%s: Issuing Rescan for %s\n", __func__, RESCAN_PCI_PATH);
+	out_printf("%s: Issuing Rescan for %s\n", __func__, RESCAN_PCI_PATH);
 	fd = open(RESCAN_PCI_PATH, O_WRONLY);
 	write(fd, &d, 1);
 	close(fd);
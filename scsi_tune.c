@@ -0,0 +1,1159 @@
+// SPDX-License-Identifier: UPL-1.0
+/*
+ * Copyright (c) 2024, Oracle and/or its affiliates.
+ *
+ * The Universal Permissive License (UPL), Version 1.0
+ *
+ * Subject to the condition set forth below, permission is hereby granted to any
+ * person obtaining a copy of this software, associated documentation and/or data
+ * (collectively the "Software"), free of charge and under any and all copyright
+ * rights in the Software, and any and all patent rights owned or freely
+ * licensable by each licensor hereunder covering either (i) the unmodified
+ * Software as contributed to or provided by such licensor, or (ii) the Larger
+ * Works (as defined below), to deal in both
+ *
+ * (a) the Software, and
+ * (b) any piece of software and/or hardware listed in the
+ * lrgrwrks.txt file if one is included with the Software (each a "Larger
+ * Work" to which the Software is contributed by such licensors),
+ *
+ * without restriction, including without limitation the rights to copy, create
+ * derivative works of, display, perform, and distribute the Software and make,
+ * use, sell, offer for sale, import, export, have made, and have sold the
+ * Software and the Larger Work(s), and to sublicense the foregoing rights on
+ * either these or other terms.
+ *
+ * This license is subject to the following condition:
+ * The above copyright notice and either this complete permission notice or at
+ * a minimum a reference to the UPL must be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fnmatch.h>
+
+#include "scsi.h"
+#include "scsi_fcp.h"
+#include "scsi_iscsi.h"
+#include "scsi_print.h"
+
+/*
+ * Bulk timeout tuning
+ *
+ * The current values are first read from all matching devices in
+ * parallel, and attributes which already hold the requested value are
+ * left alone. The old values of the others can be saved to a rollback
+ * file before anything is written. Each device is then written and read
+ * back on a pool of threads.
+ */
+#define TUNE_DEF_JOBS		16
+#define TUNE_MAX_WHERE		8
+
+enum tune_state {
+	TUNE_PENDING,
+	TUNE_UNCHANGED,
+	TUNE_SET,
+	TUNE_FAILED,
+};
+
+/* The attributes of one device, written in turn by the same thread */
+struct tune_item {
+	struct tune_attr	*attrs;
+	int			nr;
+};
+
+struct tune_set {
+	struct tune_attr	*attrs;
+	int			nr;
+	int			alloc;
+	struct tune_item	*items;
+	int			nr_items;
+};
+
+/* An attribute asked for on the command line */
+struct tune_req {
+	const char	*opt;
+	const char	*attr;
+	unsigned long	min;
+	int		off;		/* "off" is a valid value */
+	char		val[24];
+	const char	* const *words;	/* the values of a string attribute */
+};
+
+/* A --where condition, 'pattern' is matched with fnmatch() */
+struct tune_where {
+	char	*key;
+	char	*pattern;
+};
+
+static struct tune_req fc_reqs[] = {
+	{ "dev-loss-tmo",	"dev_loss_tmo",		0, 0, "", NULL },
+	{ "fast-io-fail-tmo",	"fast_io_fail_tmo",	0, 1, "", NULL },
+};
+
+static struct tune_req disk_reqs[] = {
+	{ "timeout",		"timeout",		1, 0, "", NULL },
+	{ "eh-timeout",		"eh_timeout",		1, 0, "", NULL },
+};
+
+/*
+ * Only recovery_tmo is writable in sysfs, iscsid sets the others through
+ * netlink. They are still compared, so that sessions off the profile
+ * show up.
+ */
+static struct tune_req iscsi_reqs[] = {
+	{ "recovery-tmo",	"recovery_tmo",		0, 0, "", NULL },
+	{ "abort-tmo",		"abort_tmo",		1, 0, "", NULL },
+	{ "lu-reset-tmo",	"lu_reset_tmo",		1, 0, "", NULL },
+	{ "tgt-reset-tmo",	"tgt_reset_tmo",	1, 0, "", NULL },
+};
+
+static const char * const nvme_iopolicies[] = {
+	"numa", "round-robin", "queue-depth", NULL,
+};
+
+/*
+ * ctrl_loss_tmo is kept as a number of reconnects and reads back as that
+ * number times reconnect_delay, so reconnect_delay goes first and the
+ * target is rounded up to a multiple of it.
+ */
+static struct tune_req nvme_reqs[] = {
+	{ "reconnect-delay",	"reconnect_delay",	1, 0, "", NULL },
+	{ "ctrl-loss-tmo",	"ctrl_loss_tmo",	0, 1, "", NULL },
+	{ "fast-io-fail-tmo",	"fast_io_fail_tmo",	0, 1, "", NULL },
+	{ "iopolicy",		"iopolicy",		0, 0, "", nvme_iopolicies },
+};
+
+static const char *fc_where_keys[] = {
+	"host", "rport", "port_name", "node_name", "roles", "state",
+};
+
+static const char *disk_where_keys[] = {
+	"name", "vendor", "model",
+};
+
+static const char *iscsi_where_keys[] = {
+	"session", "host", "target", "address", "iface", "transport", "state",
+};
+
+static const char *nvme_where_keys[] = {
+	"ctrl", "subsys", "nqn", "model", "transport", "address", "state",
+};
+
+/* Index of 'val' in the NULL terminated 'words', or -1 */
+static int tune_word(const char * const *words, const char *val)
+{
+	int i;
+
+	for (i = 0; words[i]; i++)
+		if (!strcmp(words[i], val))
+			return i;
+
+	return -1;
+}
+
+/* Returns the number of attributes asked for, or a negative errno */
+static int tune_parse_reqs(struct tune_req *reqs, int nr)
+{
+	unsigned long	v;
+	char		*val, *end;
+	int		i, found = 0;
+
+	for (i = 0; i < nr; i++) {
+		reqs[i].val[0] = '\0';
+		val = cmd_opt_value(reqs[i].opt);
+		if (!val)
+			continue;
+
+		if (reqs[i].off && !strcmp(val, "off")) {
+			strcpy(reqs[i].val, "off");
+		} else if (reqs[i].words) {
+			if (tune_word(reqs[i].words, val) < 0) {
+				print_err("Invalid value '%s' for --%s", val,
+				    reqs[i].opt);
+				return -EINVAL;
+			}
+			snprintf(reqs[i].val, sizeof(reqs[i].val), "%s", val);
+		} else {
+			errno = 0;
+			v = strtoul(val, &end, 10);
+			if (!isdigit(val[0]) || *end || errno || v > INT_MAX ||
+			    v < reqs[i].min) {
+				print_err("Invalid value '%s' for --%s", val,
+				    reqs[i].opt);
+				return -EINVAL;
+			}
+			snprintf(reqs[i].val, sizeof(reqs[i].val), "%lu", v);
+		}
+		found++;
+	}
+
+	if (!found) {
+		print_err("Nothing to tune, give --%s%s%s", reqs[0].opt,
+		    nr > 2 ? ", ..." : " and/or --",
+		    nr > 2 ? "" : reqs[1].opt);
+		return -EINVAL;
+	}
+
+	return found;
+}
+
+/*
+ * tune_parse_where() will split --where "key=pattern,..." into 'w', the
+ * keys are checked against 'keys'. Returns the number of conditions, the
+ * strings point into 'buf' which has to be freed by the caller.
+ */
+static int tune_parse_where(struct tune_where *w, const char **keys,
+    int nr_keys, char **buf)
+{
+	char	*opt, *tok, *save, *eq;
+	int	nr = 0, i;
+
+	*buf = NULL;
+	opt = cmd_opt_value("where");
+	if (!opt)
+		return 0;
+
+	*buf = strdup(opt);
+	if (!*buf)
+		return -ENOMEM;
+
+	for (tok = strtok_r(*buf, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		eq = strchr(tok, '=');
+		if (!eq || eq == tok || nr == TUNE_MAX_WHERE) {
+			print_err("Invalid --where condition '%s'", tok);
+			return -EINVAL;
+		}
+		*eq = '\0';
+
+		for (i = 0; i < nr_keys; i++)
+			if (!strcmp(tok, keys[i]))
+				break;
+		if (i == nr_keys) {
+			print_err("Unknown --where key '%s'", tok);
+			return -EINVAL;
+		}
+
+		w[nr].key = tok;
+		w[nr].pattern = eq + 1;
+		nr++;
+	}
+
+	return nr;
+}
+
+static int tune_where_match(struct tune_where *w, int nr,
+    const char *(*get)(void *, const char *), void *ctx)
+{
+	const char	*val;
+	int		i;
+
+	for (i = 0; i < nr; i++) {
+		val = get(ctx, w[i].key);
+		if (!val || fnmatch(w[i].pattern, val, 0))
+			return 0;
+	}
+
+	return 1;
+}
+
+static int tune_add(struct tune_set *set, const char *dev, const char *attr,
+    const char *path, const char *val)
+{
+	struct tune_attr	*a;
+
+	if (strlen(path) >= sizeof(a->path) || strlen(dev) >= sizeof(a->dev) ||
+	    strlen(attr) >= sizeof(a->attr))
+		return -ENAMETOOLONG;
+
+	if (set->nr == set->alloc) {
+		set->alloc = set->alloc ? set->alloc * 2 : 64;
+		a = realloc(set->attrs, set->alloc * sizeof(*a));
+		if (!a)
+			return -ENOMEM;
+		set->attrs = a;
+	}
+
+	a = set->attrs + set->nr++;
+	memset(a, 0, sizeof(*a));
+	strcpy(a->dev, dev);
+	strcpy(a->attr, attr);
+	strcpy(a->path, path);
+	snprintf(a->val, sizeof(a->val), "%s", val);
+	strcpy(a->old, "-");
+	a->rewrite = !strcmp(attr, "ctrl_loss_tmo");
+
+	return 0;
+}
+
+static void tune_free(struct tune_set *set)
+{
+	free(set->attrs);
+	free(set->items);
+	memset(set, 0, sizeof(*set));
+}
+
+static void tune_fail(struct tune_attr *a, int err, const char *what)
+{
+	a->state = TUNE_FAILED;
+	a->err = err;
+	snprintf(a->result, sizeof(a->result), "%s%s", what, strerror(-err));
+}
+
+static void tune_read_item(void *arg)
+{
+	struct tune_item	*it = arg;
+	struct tune_attr	*a;
+	struct stat		st;
+	int			i, n, changed = 0;
+
+	for (i = 0; i < it->nr; i++) {
+		a = it->attrs + i;
+		n = sysfs_read_at(AT_FDCWD, a->path, a->old, sizeof(a->old));
+		if (n < 0) {
+			strcpy(a->old, "-");
+			tune_fail(a, n, "");
+		} else if (!strcmp(a->old, a->val) && !(a->rewrite && changed)) {
+			a->state = TUNE_UNCHANGED;
+			strcpy(a->result, "unchanged");
+		} else if (!stat(a->path, &st) && !(st.st_mode & 0222)) {
+			/* Root may open it, but sysfs has no store for it */
+			a->state = TUNE_FAILED;
+			a->err = -EACCES;
+			strcpy(a->result, "read-only attribute");
+		}
+		changed |= a->state == TUNE_PENDING;
+	}
+}
+
+static void tune_write_item(void *arg)
+{
+	struct tune_item	*it = arg;
+	struct tune_attr	*a;
+	char			cur[24];
+	int			i, n, pass;
+
+	/*
+	 * The FC transport wants fast_io_fail_tmo below dev_loss_tmo, so
+	 * depending on the direction of a change one of them has to go
+	 * first. An attribute refused with EINVAL is tried once more after
+	 * the other attributes of its device were written.
+	 */
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < it->nr; i++) {
+			a = it->attrs + i;
+			if (a->state != TUNE_PENDING)
+				continue;
+
+			a->err = sysfs_write_at(AT_FDCWD, a->path, a->val);
+			/* NVMe takes -1 for off, and shows it as off */
+			if (a->err == -EINVAL && !strcmp(a->val, "off"))
+				a->err = sysfs_write_at(AT_FDCWD, a->path,
+				    "-1");
+			if (a->err == -EINVAL && !pass && it->nr > 1)
+				continue;
+			if (a->err)
+				tune_fail(a, a->err, "");
+			else
+				a->state = TUNE_SET;
+		}
+	}
+
+	for (i = 0; i < it->nr; i++) {
+		a = it->attrs + i;
+		if (a->state != TUNE_SET)
+			continue;
+
+		n = sysfs_read_at(AT_FDCWD, a->path, cur, sizeof(cur));
+		if (n < 0) {
+			tune_fail(a, n, "verify: ");
+		} else if (strcmp(cur, a->val)) {
+			a->state = TUNE_FAILED;
+			a->err = -EIO;
+			snprintf(a->result, sizeof(a->result),
+			    "verify: reads %s", cur);
+		} else {
+			strcpy(a->result, "set");
+		}
+	}
+}
+
+/*
+ * tune_save_rollback() will write "path old-value" lines for every
+ * attribute about to change, 'tune rollback' reads them back. The file
+ * is complete on disk before the first write to sysfs.
+ */
+static int tune_save_rollback(struct tune_set *set, const char *file)
+{
+	char	tmp[PATH_MAX];
+	FILE	*fp;
+	int	i, err = 0, nr = 0;
+
+	print_trace_enter();
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+	fp = fopen(tmp, "w");
+	if (!fp) {
+		err = -errno;
+		print_err("Can not create %s (%s)", tmp, strerror(-err));
+		return err;
+	}
+
+	fprintf(fp, "# scsi-cli tune rollback\n");
+	for (i = 0; i < set->nr; i++) {
+		if (set->attrs[i].state != TUNE_PENDING)
+			continue;
+		fprintf(fp, "%s %s\n", set->attrs[i].path, set->attrs[i].old);
+		nr++;
+	}
+
+	if (fflush(fp) || fsync(fileno(fp)))
+		err = -errno;
+	if (fclose(fp) && !err)
+		err = -errno;
+	if (!err && rename(tmp, file))
+		err = -errno;
+	if (err) {
+		print_err("Can not write %s (%s)", file, strerror(-err));
+		unlink(tmp);
+		return err;
+	}
+
+	print_info(" Saved %d old values to %s", nr, file);
+
+	return 0;
+}
+
+/*
+ * tune_run() will read, save, write and verify all attributes of 'set'.
+ * The attributes of a device have to be next to each other.
+ */
+static int tune_run(struct tune_set *set)
+{
+	struct tune_attr	*a;
+	char			*save = cmd_opt_value("save");
+	int			i, jobs, err, nr_set = 0, nr_same = 0, nr_failed = 0;
+	u64			start = now_ms();
+
+	print_trace_enter();
+
+	if (!set->nr) {
+		print_info("No matching devices found");
+		return -ENODEV;
+	}
+
+	jobs = scan_jobs_opt(TUNE_DEF_JOBS);
+	if (jobs < 0)
+		return jobs;
+
+	set->items = calloc(set->nr, sizeof(*set->items));
+	if (!set->items)
+		return -ENOMEM;
+	for (i = 0; i < set->nr; i++) {
+		if (!i || strcmp(set->attrs[i].dev, set->attrs[i - 1].dev))
+			set->items[set->nr_items++].attrs = set->attrs + i;
+		set->items[set->nr_items - 1].nr++;
+	}
+
+	parallel_for_each(set->items, set->nr_items, sizeof(*set->items),
+	    tune_read_item, jobs);
+
+	if (save) {
+		err = tune_save_rollback(set, save);
+		if (err)
+			return err;
+	}
+
+	parallel_for_each(set->items, set->nr_items, sizeof(*set->items),
+	    tune_write_item, jobs);
+
+	print_tune_attr_header();
+	for (i = 0; i < set->nr; i++) {
+		a = set->attrs + i;
+		if (a->state == TUNE_UNCHANGED) {
+			nr_same++;
+			continue;
+		}
+		if (a->state == TUNE_SET)
+			nr_set++;
+		else
+			nr_failed++;
+		print_tune_attr(a);
+	}
+
+	if (out_is_text())
+		print_info("\n %d set, %d unchanged, %d failed on %d devices in %llu ms",
+		    nr_set, nr_same, nr_failed, set->nr_items,
+		    (unsigned long long)(now_ms() - start));
+
+	return nr_failed ? -EIO : 0;
+}
+
+struct tune_fc_ctx {
+	struct fc_rport_info	*rp;
+	char			host[16];
+};
+
+static const char *tune_fc_get(void *arg, const char *key)
+{
+	struct tune_fc_ctx	*ctx = arg;
+
+	if (!strcmp(key, "host"))
+		return ctx->host;
+	if (!strcmp(key, "rport"))
+		return ctx->rp->rport_name;
+	if (!strcmp(key, "port_name"))
+		return ctx->rp->port_name;
+	if (!strcmp(key, "node_name"))
+		return ctx->rp->node_name;
+	if (!strcmp(key, "roles"))
+		return ctx->rp->roles;
+	if (!strcmp(key, "state"))
+		return ctx->rp->port_state;
+
+	return NULL;
+}
+
+/**
+ * tune_fc() will set dev_loss_tmo and/or fast_io_fail_tmo on every FC
+ * remote port matching --where
+ */
+int tune_fc(void)
+{
+	struct tune_where	where[TUNE_MAX_WHERE];
+	struct fc_rport_index	idx;
+	struct tune_fc_ctx	ctx;
+	struct tune_set		set;
+	struct fc_rport_info	*rps;
+	char			path[PATH_MAX], *buf;
+	int			nr_where, host, nr, i, r, err;
+
+	print_trace_enter();
+
+	err = tune_parse_reqs(fc_reqs, ARRAY_SIZE(fc_reqs));
+	if (err < 0)
+		return err;
+
+	nr_where = tune_parse_where(where, fc_where_keys,
+	    ARRAY_SIZE(fc_where_keys), &buf);
+	if (nr_where < 0) {
+		free(buf);
+		return nr_where;
+	}
+
+	err = fc_rport_index_build(&idx);
+	if (err) {
+		print_info("No FC remote ports found");
+		free(buf);
+		return err;
+	}
+
+	memset(&set, 0, sizeof(set));
+	for (host = 0; host < idx.nr_hosts && !err; host++) {
+		rps = fc_rport_index_host(&idx, host, &nr);
+		snprintf(ctx.host, sizeof(ctx.host), "host%d", host);
+
+		for (i = 0; i < nr && !err; i++) {
+			ctx.rp = rps + i;
+			if (!tune_where_match(where, nr_where, tune_fc_get, &ctx))
+				continue;
+
+			for (r = 0; r < (int)ARRAY_SIZE(fc_reqs) && !err; r++) {
+				if (!fc_reqs[r].val[0])
+					continue;
+				snprintf(path, sizeof(path), "%s/%s/%s",
+				    SYSFS_FC_RPRT_PATH, ctx.rp->rport_name,
+				    fc_reqs[r].attr);
+				err = tune_add(&set, ctx.rp->rport_name,
+				    fc_reqs[r].attr, path, fc_reqs[r].val);
+			}
+		}
+	}
+	fc_rport_index_free(&idx);
+	free(buf);
+
+	if (!err)
+		err = tune_run(&set);
+	tune_free(&set);
+
+	return err;
+}
+
+struct tune_disk_ctx {
+	const char	*name;
+	char		vendor[64];
+	char		model[64];
+	int		read;
+};
+
+static void tune_disk_read_id(struct tune_disk_ctx *ctx)
+{
+	char	path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/%s/device/vendor", SYSFS_BLOCK_PATH,
+	    ctx->name);
+	sysfs_read_str_at(AT_FDCWD, path, ctx->vendor, sizeof(ctx->vendor));
+
+	snprintf(path, sizeof(path), "%s/%s/device/model", SYSFS_BLOCK_PATH,
+	    ctx->name);
+	sysfs_read_str_at(AT_FDCWD, path, ctx->model, sizeof(ctx->model));
+
+	ctx->read = 1;
+}
+
+static const char *tune_disk_get(void *arg, const char *key)
+{
+	struct tune_disk_ctx	*ctx = arg;
+
+	if (!strcmp(key, "name"))
+		return ctx->name;
+
+	if (!ctx->read)
+		tune_disk_read_id(ctx);
+	if (!strcmp(key, "vendor"))
+		return ctx->vendor;
+	if (!strcmp(key, "model"))
+		return ctx->model;
+
+	return NULL;
+}
+
+static int tune_disk_cmp(const void *a, const void *b)
+{
+	return dev_name_cmp(*(char * const *)a, *(char * const *)b);
+}
+
+/**
+ * tune_disk() will set the command timeout and/or the error handler
+ * timeout of every SCSI disk matching --where
+ */
+int tune_disk(void)
+{
+	struct tune_where	where[TUNE_MAX_WHERE];
+	struct tune_disk_ctx	ctx;
+	struct tune_set		set;
+	struct dirent		*entry;
+	DIR			*dir;
+	char			path[PATH_MAX], *buf, **names = NULL, **tmp;
+	int			nr_where, nr = 0, alloc = 0, i, r, err = 0;
+
+	print_trace_enter();
+
+	err = tune_parse_reqs(disk_reqs, ARRAY_SIZE(disk_reqs));
+	if (err < 0)
+		return err;
+	err = 0;
+
+	nr_where = tune_parse_where(where, disk_where_keys,
+	    ARRAY_SIZE(disk_where_keys), &buf);
+	if (nr_where < 0) {
+		free(buf);
+		return nr_where;
+	}
+
+	dir = opendir(SYSFS_BLOCK_PATH);
+	if (!dir) {
+		free(buf);
+		return -ENODEV;
+	}
+
+	for_each_dir(entry, dir) {
+		if (strncmp(entry->d_name, "sd", 2))
+			continue;
+		if (nr == alloc) {
+			alloc = alloc ? alloc * 2 : 64;
+			tmp = realloc(names, alloc * sizeof(*names));
+			if (!tmp) {
+				err = -ENOMEM;
+				break;
+			}
+			names = tmp;
+		}
+		names[nr] = strdup(entry->d_name);
+		if (!names[nr]) {
+			err = -ENOMEM;
+			break;
+		}
+		nr++;
+	}
+	closedir(dir);
+
+	if (nr)
+		qsort(names, nr, sizeof(*names), tune_disk_cmp);
+
+	memset(&set, 0, sizeof(set));
+	for (i = 0; i < nr && !err; i++) {
+		memset(&ctx, 0, sizeof(ctx));
+		ctx.name = names[i];
+		if (!tune_where_match(where, nr_where, tune_disk_get, &ctx))
+			continue;
+
+		for (r = 0; r < (int)ARRAY_SIZE(disk_reqs) && !err; r++) {
+			if (!disk_reqs[r].val[0])
+				continue;
+			snprintf(path, sizeof(path), "%s/%s/device/%s",
+			    SYSFS_BLOCK_PATH, names[i], disk_reqs[r].attr);
+			err = tune_add(&set, names[i], disk_reqs[r].attr,
+			    path, disk_reqs[r].val);
+		}
+	}
+
+	for (i = 0; i < nr; i++)
+		free(names[i]);
+	free(names);
+	free(buf);
+
+	if (!err)
+		err = tune_run(&set);
+	tune_free(&set);
+
+	return err;
+}
+
+struct tune_iscsi_ctx {
+	struct iscsi_sess_info	*s;
+};
+
+static const char *tune_iscsi_get(void *arg, const char *key)
+{
+	struct tune_iscsi_ctx	*ctx = arg;
+
+	if (!strcmp(key, "session"))
+		return ctx->s->session_name;
+	if (!strcmp(key, "host"))
+		return ctx->s->host_name;
+	if (!strcmp(key, "target"))
+		return ctx->s->targetname;
+	if (!strcmp(key, "address"))
+		return ctx->s->conn_address;
+	if (!strcmp(key, "iface"))
+		return ctx->s->ifacename;
+	if (!strcmp(key, "transport"))
+		return ctx->s->transport;
+	if (!strcmp(key, "state"))
+		return ctx->s->state;
+
+	return NULL;
+}
+
+/**
+ * tune_iscsi() will set recovery_tmo, and check abort_tmo, lu_reset_tmo
+ * and tgt_reset_tmo, on every iSCSI session matching --where
+ */
+int tune_iscsi(void)
+{
+	struct tune_where	where[TUNE_MAX_WHERE];
+	struct iscsi_index	idx;
+	struct tune_iscsi_ctx	ctx;
+	struct tune_set		set;
+	char			path[PATH_MAX], *buf;
+	int			nr_where, i, r, err, ro = 0;
+
+	print_trace_enter();
+
+	err = tune_parse_reqs(iscsi_reqs, ARRAY_SIZE(iscsi_reqs));
+	if (err < 0)
+		return err;
+
+	nr_where = tune_parse_where(where, iscsi_where_keys,
+	    ARRAY_SIZE(iscsi_where_keys), &buf);
+	if (nr_where < 0) {
+		free(buf);
+		return nr_where;
+	}
+
+	err = iscsi_index_build(&idx, 0);
+	if (err || !idx.nr_sessions) {
+		print_info("No iSCSI sessions found");
+		iscsi_index_free(&idx);
+		free(buf);
+		return err ? err : -ENODEV;
+	}
+
+	memset(&set, 0, sizeof(set));
+	for (i = 0; i < idx.nr_sessions && !err; i++) {
+		ctx.s = idx.sessions + i;
+		if (!tune_where_match(where, nr_where, tune_iscsi_get, &ctx))
+			continue;
+
+		for (r = 0; r < (int)ARRAY_SIZE(iscsi_reqs) && !err; r++) {
+			if (!iscsi_reqs[r].val[0])
+				continue;
+			snprintf(path, sizeof(path), "%s/%s/%s",
+			    SYSFS_ISCSI_SESS_PATH, ctx.s->session_name,
+			    iscsi_reqs[r].attr);
+			err = tune_add(&set, ctx.s->session_name,
+			    iscsi_reqs[r].attr, path, iscsi_reqs[r].val);
+		}
+	}
+	iscsi_index_free(&idx);
+	free(buf);
+
+	if (!err)
+		err = tune_run(&set);
+
+	for (i = 0; i < set.nr; i++)
+		ro |= set.attrs[i].err == -EACCES;
+	if (ro && out_is_text())
+		print_info(" Read-only timeouts come from iscsid: change them "
+		    "with iscsiadm -m node -o update -n "
+		    "node.session.err_timeo.<name> and log in again");
+	tune_free(&set);
+
+	return err;
+}
+
+struct tune_nvme_ctx {
+	char	subsys[24];
+	char	nqn[224];
+	char	model[48];
+	char	ctrl[16];
+	char	transport[8];
+	char	address[96];
+	char	state[16];
+	char	reconnect_delay[16];
+};
+
+static const char *tune_nvme_get(void *arg, const char *key)
+{
+	struct tune_nvme_ctx	*ctx = arg;
+
+	if (!strcmp(key, "ctrl"))
+		return ctx->ctrl;
+	if (!strcmp(key, "subsys"))
+		return ctx->subsys;
+	if (!strcmp(key, "nqn"))
+		return ctx->nqn;
+	if (!strcmp(key, "model"))
+		return ctx->model;
+	if (!strcmp(key, "transport"))
+		return ctx->transport;
+	if (!strcmp(key, "address"))
+		return ctx->address;
+	if (!strcmp(key, "state"))
+		return ctx->state;
+
+	return NULL;
+}
+
+/*
+ * tune_nvme_loss_tmo() will round ctrl_loss_tmo 'val' up to a multiple of
+ * 'delay', as the kernel does, into 'buf'. Returns 1 when it changed.
+ */
+static int tune_nvme_loss_tmo(const char *val, const char *delay, char *buf,
+    size_t len)
+{
+	long	v, d;
+	char	*end;
+
+	snprintf(buf, len, "%s", val);
+	v = strtol(val, &end, 10);
+	if (*end || v <= 0)
+		return 0;
+	d = strtol(delay, &end, 10);
+	if (*end || d <= 0 || !(v % d))
+		return 0;
+
+	snprintf(buf, len, "%ld", (v + d - 1) / d * d);
+	return 1;
+}
+
+/*
+ * Adds the controller timeouts of the fabrics controllers of subsystem
+ * 'name' matching 'where', and its iopolicy when one of its controllers
+ * matched.
+ */
+static int tune_nvme_subsys(struct tune_set *set, int class_fd, int nvme_fd,
+    const char *name, struct tune_where *where, int nr_where, int *nr_rounded)
+{
+	struct tune_nvme_ctx	ctx;
+	struct dirent		*dent;
+	DIR			*dir;
+	char			path[PATH_MAX], val[24];
+	const char		*delay;
+	int			dfd, cfd, end, x, r, err = 0, matched = 0;
+
+	dfd = openat(class_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd < 0)
+		return 0;
+	dir = fdopendir(dfd);
+	if (!dir) {
+		close(dfd);
+		return 0;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	snprintf(ctx.subsys, sizeof(ctx.subsys), "%.23s", name);
+	sysfs_read_str_at(dfd, "subsysnqn", ctx.nqn, sizeof(ctx.nqn));
+	sysfs_read_str_at(dfd, "model", ctx.model, sizeof(ctx.model));
+
+	for_each_dir(dent, dir) {
+		end = 0;
+		if (sscanf(dent->d_name, "nvme%d%n", &x, &end) != 1 ||
+		    dent->d_name[end])
+			continue;
+
+		cfd = openat(nvme_fd, dent->d_name,
+		    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (cfd < 0)
+			continue;
+		snprintf(ctx.ctrl, sizeof(ctx.ctrl), "%.15s", dent->d_name);
+		sysfs_read_str_at(cfd, "transport", ctx.transport,
+		    sizeof(ctx.transport));
+		sysfs_read_str_at(cfd, "address", ctx.address,
+		    sizeof(ctx.address));
+		sysfs_read_str_at(cfd, "state", ctx.state, sizeof(ctx.state));
+		sysfs_read_str_at(cfd, "reconnect_delay", ctx.reconnect_delay,
+		    sizeof(ctx.reconnect_delay));
+		close(cfd);
+
+		if (!tune_where_match(where, nr_where, tune_nvme_get, &ctx))
+			continue;
+		matched++;
+
+		/* PCIe controllers have no reconnect logic to tune */
+		if (!strcmp(ctx.transport, "pcie"))
+			continue;
+
+		delay = nvme_reqs[0].val[0] ? nvme_reqs[0].val :
+		    ctx.reconnect_delay;
+		for (r = 0; r < (int)ARRAY_SIZE(nvme_reqs) && !err; r++) {
+			if (!nvme_reqs[r].val[0] || nvme_reqs[r].words)
+				continue;
+			snprintf(val, sizeof(val), "%s", nvme_reqs[r].val);
+			if (!strcmp(nvme_reqs[r].attr, "ctrl_loss_tmo"))
+				*nr_rounded += tune_nvme_loss_tmo(
+				    nvme_reqs[r].val, delay, val, sizeof(val));
+			snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_NVME_PATH,
+			    ctx.ctrl, nvme_reqs[r].attr);
+			err = tune_add(set, ctx.ctrl, nvme_reqs[r].attr, path,
+			    val);
+		}
+		if (err)
+			break;
+	}
+
+	/* iopolicy only exists with native multipath */
+	for (r = 0; r < (int)ARRAY_SIZE(nvme_reqs) && !err && matched; r++) {
+		if (!nvme_reqs[r].val[0] || !nvme_reqs[r].words ||
+		    faccessat(dfd, nvme_reqs[r].attr, F_OK, 0))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s/%s", SYSFS_NVME_SUBSYS_PATH,
+		    name, nvme_reqs[r].attr);
+		err = tune_add(set, ctx.subsys, nvme_reqs[r].attr, path,
+		    nvme_reqs[r].val);
+	}
+	closedir(dir);
+
+	return err;
+}
+
+/**
+ * tune_nvme() will set reconnect_delay, ctrl_loss_tmo and fast_io_fail_tmo
+ * on every NVMe over Fabrics controller matching --where, and iopolicy
+ * on their subsystems
+ */
+int tune_nvme(void)
+{
+	struct tune_where	where[TUNE_MAX_WHERE];
+	struct tune_set		set;
+	struct dirent		*dent;
+	DIR			*dir;
+	char			*buf;
+	int			nr_where, nvme_fd, err, nr_rounded = 0;
+
+	print_trace_enter();
+
+	err = tune_parse_reqs(nvme_reqs, ARRAY_SIZE(nvme_reqs));
+	if (err < 0)
+		return err;
+
+	if (nvme_reqs[0].val[0] && !nvme_reqs[1].val[0]) {
+		print_err("--%s changes ctrl_loss_tmo, give --%s as well",
+		    nvme_reqs[0].opt, nvme_reqs[1].opt);
+		return -EINVAL;
+	}
+
+	nr_where = tune_parse_where(where, nvme_where_keys,
+	    ARRAY_SIZE(nvme_where_keys), &buf);
+	if (nr_where < 0) {
+		free(buf);
+		return nr_where;
+	}
+
+	dir = opendir(SYSFS_NVME_SUBSYS_PATH);
+	nvme_fd = open(SYSFS_NVME_PATH, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (!dir || nvme_fd < 0) {
+		print_info("No NVMe controllers found");
+		if (dir)
+			closedir(dir);
+		if (nvme_fd >= 0)
+			close(nvme_fd);
+		free(buf);
+		return -ENODEV;
+	}
+
+	memset(&set, 0, sizeof(set));
+	err = 0;
+	for_each_dir(dent, dir) {
+		if (strncmp(dent->d_name, "nvme-subsys", 11))
+			continue;
+		err = tune_nvme_subsys(&set, dirfd(dir), nvme_fd, dent->d_name,
+		    where, nr_where, &nr_rounded);
+		if (err)
+			break;
+	}
+	close(nvme_fd);
+	closedir(dir);
+	free(buf);
+
+	if (nr_rounded)
+		print_info(" ctrl_loss_tmo rounded up to a multiple of "
+		    "reconnect_delay on %d controllers", nr_rounded);
+
+	if (!err)
+		err = tune_run(&set);
+	tune_free(&set);
+
+	return err;
+}
+
+/*
+ * Only the attributes 'tune' writes itself are accepted from a rollback
+ * file: dev_loss_tmo and fast_io_fail_tmo of an rport-H:B-N in
+ * SYSFS_FC_RPRT_PATH, timeout and eh_timeout of an sdX in
+ * SYSFS_BLOCK_PATH, the timeouts of a sessionN in SYSFS_ISCSI_SESS_PATH,
+ * the timeouts of an nvmeN in SYSFS_NVME_PATH and the iopolicy of an
+ * nvme-subsysN in SYSFS_NVME_SUBSYS_PATH. The device name is returned in
+ * 'dev'.
+ */
+static int tune_rollback_path(const char *path, char *dev, size_t len)
+{
+	const char	*attr, *rest, *end;
+	size_t		n;
+
+	attr = strrchr(path, '/');
+	if (!attr)
+		return 0;
+	attr++;
+
+	n = strlen(SYSFS_FC_RPRT_PATH);
+	if (!strncmp(path, SYSFS_FC_RPRT_PATH "/rport-", n + 7)) {
+		if (strcmp(attr, "dev_loss_tmo") && strcmp(attr, "fast_io_fail_tmo"))
+			return 0;
+		rest = path + n + 1;
+		end = attr - 1;
+	} else if (!strncmp(path, SYSFS_BLOCK_PATH "/sd",
+	    strlen(SYSFS_BLOCK_PATH) + 3)) {
+		if (strcmp(attr, "timeout") && strcmp(attr, "eh_timeout"))
+			return 0;
+		rest = path + strlen(SYSFS_BLOCK_PATH) + 1;
+		end = attr - 1;
+		if (end - rest < 7 || strncmp(end - 7, "/device", 7))
+			return 0;
+		end -= 7;
+	} else if (!strncmp(path, SYSFS_ISCSI_SESS_PATH "/session",
+	    strlen(SYSFS_ISCSI_SESS_PATH) + 8)) {
+		for (n = 0; n < ARRAY_SIZE(iscsi_reqs); n++)
+			if (!strcmp(attr, iscsi_reqs[n].attr))
+				break;
+		if (n == ARRAY_SIZE(iscsi_reqs))
+			return 0;
+		rest = path + strlen(SYSFS_ISCSI_SESS_PATH) + 1;
+		end = attr - 1;
+	} else if (!strncmp(path, SYSFS_NVME_SUBSYS_PATH "/nvme-subsys",
+	    strlen(SYSFS_NVME_SUBSYS_PATH) + 12)) {
+		if (strcmp(attr, "iopolicy"))
+			return 0;
+		rest = path + strlen(SYSFS_NVME_SUBSYS_PATH) + 1;
+		end = attr - 1;
+	} else if (!strncmp(path, SYSFS_NVME_PATH "/nvme",
+	    strlen(SYSFS_NVME_PATH) + 5)) {
+		for (n = 0; n < ARRAY_SIZE(nvme_reqs); n++)
+			if (!nvme_reqs[n].words &&
+			    !strcmp(attr, nvme_reqs[n].attr))
+				break;
+		if (n == ARRAY_SIZE(nvme_reqs))
+			return 0;
+		rest = path + strlen(SYSFS_NVME_PATH) + 1;
+		end = attr - 1;
+	} else {
+		return 0;
+	}
+
+	n = end - rest;
+	if (!n || n >= len || memchr(rest, '/', n) || memchr(rest, '.', n))
+		return 0;
+
+	memcpy(dev, rest, n);
+	dev[n] = '\0';
+
+	return 1;
+}
+
+static int tune_value_valid(const char *attr, const char *val)
+{
+	const char	*p = val;
+
+	if (!strcmp(attr, "iopolicy"))
+		return tune_word(nvme_iopolicies, val) >= 0;
+	if (!strcmp(val, "off"))
+		return 1;
+
+	while (isdigit(*p))
+		p++;
+
+	return p != val && !*p;
+}
+
+/**
+ * tune_rollback() will restore the values saved by 'tune ... --save'
+ */
+int tune_rollback(char *file)
+{
+	struct tune_set	set;
+	char		line[256], path[128], val[24], dev[32];
+	FILE		*fp;
+	int		lineno = 0, err = 0;
+
+	print_trace_enter();
+
+	fp = fopen(file, "r");
+	if (!fp) {
+		err = -errno;
+		print_err("Can not open %s (%s)", file, strerror(-err));
+		return err;
+	}
+
+	memset(&set, 0, sizeof(set));
+	while (!err && fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if (line[0] == '#' || line[strspn(line, " \t\n")] == '\0')
+			continue;
+
+		if (sscanf(line, "%127s %23s", path, val) != 2 ||
+		    !tune_rollback_path(path, dev, sizeof(dev)) ||
+		    !tune_value_valid(strrchr(path, '/') + 1, val)) {
+			print_err("%s:%d: not a tunable attribute", file, lineno);
+			err = -EINVAL;
+			break;
+		}
+
+		err = tune_add(&set, dev, strrchr(path, '/') + 1, path, val);
+	}
+	fclose(fp);
+
+	if (!err)
+		err = tune_run(&set);
+	tune_free(&set);
+
+	return err;
+}
@@ -37,6 +37,9 @@
  * SOFTWARE.
  */
 
+#include <pthread.h>
+#include <sys/resource.h>
+
 #include "scsi.h"
 #include "scsi_fcp.h"
 #include "scsi_iscsi.h"
@@ -97,10 +100,45 @@ void put_fc_dev(struct fc_device_info *fc_dev)
 		free(fc_dev);
 }
 
+/**
+ * clear_scsi_dev() will release every string collected for a device and
+ * reset the record, so that the same buffer can be filled for the next one
+ */
+void clear_scsi_dev(struct scsi_device_info *scsi_dev)
+{
+	if (!scsi_dev)
+		return;
+
+	free(scsi_dev->alias_name);
+	free(scsi_dev->disk_path);
+	free(scsi_dev->disk_name);
+	free(scsi_dev->sysfs_root);
+	free(scsi_dev->pci_id);
+	free(scsi_dev->driver_name);
+	free(scsi_dev->model);
+	free(scsi_dev->rev);
+	free(scsi_dev->wwid);
+	free(scsi_dev->queue_type);
+	free(scsi_dev->state);
+	free(scsi_dev->vendor);
+	free(scsi_dev->q_data.scheduler);
+	free(scsi_dev->q_data.write_cache);
+	free(scsi_dev->zoned_cap);
+	free(scsi_dev->serial);
+	free(scsi_dev->dctype);
+	free(scsi_dev->cntrltype);
+	free(scsi_dev->transport);
+	free(scsi_dev->pci_address);
+
+	memset(scsi_dev, 0, sizeof(*scsi_dev));
+}
+
 void put_scsi_dev(struct scsi_device_info *scsi_dev)
 {
-	if (scsi_dev)
+	if (scsi_dev) {
+		clear_scsi_dev(scsi_dev);
 		free(scsi_dev);
+	}
 }
 
 void put_iscsi_dev(struct iscsi_dev_info *iscsi_dev)
@@ -108,3 +146,83 @@ void put_iscsi_dev(struct iscsi_dev_info *iscsi_dev)
 	if (iscsi_dev)
 		free(iscsi_dev);
 }
+
+#define PARALLEL_MAX_THREADS	16
+
+struct parallel_work {
+	char	*base;
+	size_t	size;
+	int	nr;
+	int	next;
+	void	(*fn)(void *);
+};
+
+static void *parallel_worker(void *arg)
+{
+	struct parallel_work	*w = arg;
+	int			i;
+
+	while ((i = __atomic_fetch_add(&w->next, 1, __ATOMIC_RELAXED)) < w->nr)
+		w->fn(w->base + (size_t)i * w->size);
+
+	return NULL;
+}
+
+/**
+ * parallel_for_each() will call fn() on each of the 'nr' elements of
+ * 'size' bytes at 'base', on at most 'max_threads' threads. Threads take
+ * the next element as they finish one, so a slow sysfs write does not
+ * hold up the others.
+ */
+void parallel_for_each(void *base, int nr, size_t size, void (*fn)(void *),
+    int max_threads)
+{
+	struct parallel_work	w = { base, size, nr, 0, fn };
+	pthread_t		tid[PARALLEL_MAX_THREADS];
+	int			i, started = 0;
+
+	max_threads = min(max_threads, PARALLEL_MAX_THREADS);
+	for (i = 1; i < min(nr, max_threads); i++) {
+		if (pthread_create(tid + started, NULL, parallel_worker, &w))
+			break;
+		started++;
+	}
+
+	/* The calling thread takes its share too */
+	parallel_worker(&w);
+
+	for (i = 0; i < started; i++)
+		pthread_join(tid[i], NULL);
+}
+
+/**
+ * dev_name_cmp() will order kernel device names the way they were handed
+ * out: shorter names first, so sdz comes before sdaa and host2 before
+ * host10
+ */
+int dev_name_cmp(const char *a, const char *b)
+{
+	size_t la = strlen(a), lb = strlen(b);
+
+	if (la != lb)
+		return la < lb ? -1 : 1;
+
+	return strcmp(a, b);
+}
+
+/**
+ * raise_nofile_limit() will lift the soft limit of open files to 'need',
+ * as far as the hard limit allows, for commands keeping many sysfs
+ * attributes open between samples
+ */
+void raise_nofile_limit(unsigned long need)
+{
+	struct rlimit	rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) || rl.rlim_cur >= need)
+		return;
+
+	rl.rlim_cur = rl.rlim_max == RLIM_INFINITY || rl.rlim_max > need ?
+	    need : rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+}
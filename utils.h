@@ -193,16 +193,16 @@ static inline int list_empty(const struct list_head *list)
 		}	\
 	} while (0)
 
+/* Regular output goes through the buffered writer in scsi_output.c */
 #define print_info(fmt, args...)\
 	do {				\
-		printf(fmt "\n",  ##args);	\
-		fflush(stdout);	\
+		out_msg(fmt "\n",  ##args);	\
 	} while (0)
 
 #define print_err(fmt, args...)\
 	do {			\
+		out_flush();	\
 		fprintf(stderr, "Error: " fmt "\n" , ##args); \
-		fflush(stderr); \
 	} while (0)
 
 #define UNUSED(x) ((void) x)